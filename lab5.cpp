@@ -2,1189 +2,10277 @@
 #include "SDL2/SDL_image.h"
 #include <iostream>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <iomanip>
+#include <functional>
+#include <sstream>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ENGINE_SSE2 1 ///< SSE2 kernels are compiled in, they are still picked at runtime through SDL_HasSSE2().
+#endif
+#if defined(ENGINE_SSE2) && defined(__GNUC__)
+#include <immintrin.h>
+#define ENGINE_AVX2 1 ///< AVX2 kernels are compiled with a per-function target attribute and picked through SDL_HasAVX2().
+#define ENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 using namespace std;
 
-class Engine {
-    private:
-            SDL_Renderer* renderer;
-            SDL_Window* window;
-    public:
-    /** engine constructor to init the SDL2 sub systems and window with renderer. */
-        Engine(){ 
-            if(!Init()){
-                cout << "Engine couldn't initialize!" << endl;
-                return;
-            }
-            cout << "Engine Init was successful" << endl; 
-        };
-
-         /** destructor which will call Destroy function on exit / engine termination. */
-        ~Engine(){
-            Destroy();
-        };
-
-        /** initialize SDL subsystems, create window and renderer and specify important flags / arguments. */
-        bool Init(){
-            /** subsystems, in our case VIDEO subsystem is initialized. */
-            if(SDL_InitSubSystem(SDL_INIT_VIDEO) < 0){
-                cout << "SDL_Init_video" << SDL_GetError() << endl;
-                return false;
-            }
+/**
+ * @enum LogLevel
+ * @brief Severity of a log message, its number is what `ENGINE_LOG_LEVEL` is compared with.
+ */
+enum LogLevel {
+    LOG_TRACE,  ///< 0: per-frame detail.
+    LOG_DEBUG,  ///< 1: object lifetimes and other development notes.
+    LOG_INFO,   ///< 2: regular progress and results.
+    LOG_WARN,   ///< 3: something didn't work, the program goes on without it.
+    LOG_ERROR   ///< 4: an operation failed.
+};
 
-            /** window creation with SDL_CreateWindow and SDL_Window* window pointer declared before.
-              * Parameters taken : specified height and width of the window, positioning of the window. */
-            window = SDL_CreateWindow("window", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_ALLOW_HIGHDPI);
+/**
+ * @enum LogCategory
+ * @brief Part of the engine a log message comes from, each one has its own runtime level.
+ */
+enum LogCategory {
+    LOG_CATEGORY_ENGINE,    ///< Engine setup, windows and renderers.
+    LOG_CATEGORY_RENDER,    ///< Drawing of objects and bitmaps.
+    LOG_CATEGORY_ASSETS,    ///< Loading of images and definitions.
+    LOG_CATEGORY_RECORDING, ///< Video recording.
+    LOG_CATEGORY_THREADS,   ///< Worker threads.
+    LOG_CATEGORY_BENCH,     ///< Benchmark results.
+    LOG_CATEGORY_COUNT      ///< Number of categories.
+};
 
-            if(window == NULL){cout << "SDL_CreateWindow" << SDL_GetError() << endl; return false;}
+#ifndef ENGINE_LOG_LEVEL
+#define ENGINE_LOG_LEVEL 2 ///< Lowest `LogLevel` compiled in, messages below it compile to nothing. Build with -DENGINE_LOG_LEVEL=0 to trace.
+#endif
 
-            /** renderer creation with SDL_CreateRenderer and SDL_Renderer* renderer pointer declated before. 
-              * Parameters taken : SDL_Window* window. */
-            renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-            
-            if(renderer == NULL){cout << "SDL_CreateRenderer" << SDL_GetError() << endl; return false;}
+/**
+ * @class Logger
+ * @brief Asynchronous log with levels and categories.
+ *
+ * Messages are formatted on the calling thread into a reused per-thread stream and copied into a bounded
+ * ring buffer, which any number of threads may write to without taking a lock (a sequence number per slot
+ * tells writers and the reader whose turn a slot is). A background thread drains the ring and writes the
+ * messages out, warnings and errors to stderr and the rest to stdout, with one flush per batch.
+ * When the ring is full the message is dropped and counted instead of blocking the caller, the drop count is
+ * reported with the next batch. Messages longer than a slot are cut.
+ *
+ * The `ENGINE_LOG_*` macros are the way to log, they skip formatting for disabled categories and the levels
+ * below `ENGINE_LOG_LEVEL` don't get compiled at all.
+ */
+class Logger {
+    private:
+        static const int capacity = 1024; ///< Number of slots in the ring, a power of two.
+        static const int textSize = 240; ///< Bytes of text a slot holds, the terminator included.
 
-            return true;
+        /**
+         * @brief One message in the ring.
+         */
+        struct Slot {
+            SDL_atomic_t sequence; ///< Equals the write position when the slot is free, one past it when it holds a message.
+            Uint32 ticks; ///< SDL_GetTicks() when the message was written.
+            LogLevel level; ///< Severity.
+            LogCategory category; ///< Origin.
+            int length; ///< Bytes of `text` used.
+            char text[textSize]; ///< The message, not terminated.
         };
 
-        /* destroys window, renderer and quits SDL, IMG(or any added lib's). 
-         * Parameters taken : SDL_Renderer* renderer, SDL_Window* window. */
-        void Destroy(){  
-            SDL_DestroyRenderer(renderer);
-            SDL_DestroyWindow(window);
-            IMG_Quit();
-            SDL_Quit();
-        }
+        vector<Slot> slots; ///< The ring.
+        SDL_atomic_t writePosition; ///< Next position a writer claims.
+        int readPosition = 0; ///< Next position the reader takes, only touched with `readLock` held.
+        SDL_atomic_t dropped; ///< Messages lost to a full ring since the last report.
+        SDL_atomic_t levels[LOG_CATEGORY_COUNT]; ///< Lowest level written for each category.
+        SDL_atomic_t running; ///< Cleared to stop the drain thread.
+        SDL_mutex* readLock = NULL; ///< Keeps the ring single-reader while `flush()` drains from another thread.
+        SDL_sem* wake = NULL; ///< Wakes the drain thread early.
+        SDL_Thread* drainThread = NULL; ///< Background writer, NULL when it couldn't start and writers drain themselves.
 
-        /*getter method for 'renderer'. */
-        SDL_Renderer* getRenderer(){ return renderer;};
-        /*getter method for 'window'. */
-        SDL_Window* getWindow(){return window;};
-};
+        /**
+         * @brief Position `count` steps after `position`, the positions wrap around as unsigned numbers.
+         */
+        static int positionAfter(int position, int count){
+            return static_cast<int>(static_cast<unsigned>(position) + static_cast<unsigned>(count));
+        }
 
+        /**
+         * @brief Steps from position `from` to position `to`, negative when `to` is behind.
+         */
+        static int distance(int from, int to){
+            return static_cast<int>(static_cast<unsigned>(to) - static_cast<unsigned>(from));
+        }
 
-/** 
- * @class Base
- * @brief An abstract base class defining a common interface for update and draw operations, actual name GameObject.
- * 
- * This class works as a base for other classes that require functionality, 
- * such as Drawing and Transforming an Object. 
- * Derived classes must provide implementations for the `update` and `draw` methods.
- */
-class Base {
-    public:
-        virtual ~Base() = default;
-        virtual void update() = 0;
-        virtual void draw() = 0;
-};
+        /**
+         * @brief Writes out everything in the ring, returns the number of messages written.
+         */
+        int drain(){
+            static const char* const levelNames[] = {"trace", "debug", "info", "warn", "error"};
+            static const char* const categoryNames[] = {"engine", "render", "assets", "recording", "threads", "bench"};
+            SDL_LockMutex(readLock);
+            int written = 0;
+            int lost = SDL_AtomicSet(&dropped, 0);
+            if(lost > 0){
+                fprintf(stderr, "[%9.3f] %-5s %-9s %d messages dropped, the log ring was full\n", SDL_GetTicks() / 1000.0, "warn", "log", lost);
+            }
+            for(;;){
+                Slot& slot = slots[readPosition & (capacity - 1)];
+                if(SDL_AtomicGet(&slot.sequence) != positionAfter(readPosition, 1)){
+                    break;
+                }
+                SDL_MemoryBarrierAcquire(); // the message fields are read only after its sequence was seen
+                FILE* stream = slot.level >= LOG_WARN ? stderr : stdout;
+                fprintf(stream, "[%9.3f] %-5s %-9s %.*s\n", slot.ticks / 1000.0, levelNames[slot.level], categoryNames[slot.category], slot.length, slot.text);
+                SDL_MemoryBarrierRelease(); // done reading before the slot is handed back to the writers
+                SDL_AtomicSet(&slot.sequence, positionAfter(readPosition, capacity));
+                readPosition = positionAfter(readPosition, 1);
+                written++;
+            }
+            if(written > 0 || lost > 0){
+                fflush(stdout);
+                fflush(stderr);
+            }
+            SDL_UnlockMutex(readLock);
+            return written;
+        }
 
-/**
- * @class UpdateAbility
- * @brief A mix - in update class which extends the `Base` class, providing a default implementation for the update function, actual name `UpdateObject`.
- * 
- * This class inherits virtually from the `Base` class, 
- * allowing it to be used as a part of virtual multiple inheritance hierarchy.
- * It provides a default empty implementation of the `update()` method, which can be overriden in the derived classes.  
- */
-class UpdateAbility : public virtual Base {
-    public:
-    /**
-     * @brief Default virtual destructor.
-     * 
-     * Makes sure the cleanup is done.
-     */
-        virtual ~UpdateAbility() = default;
-        virtual void update() override {};
-};
+        /**
+         * @brief Body of the drain thread, drains and naps until `running` is cleared.
+         */
+        static int drainLoop(void* data){
+            Logger* logger = static_cast<Logger*>(data);
+            while(SDL_AtomicGet(&logger->running)){
+                if(logger->drain() == 0){
+                    SDL_SemWaitTimeout(logger->wake, 10);
+                }
+            }
+            return 0;
+        }
 
-/**
- * @class DrawAbility
- * @brief This class extends the `Base` class, and provides the ability to `draw` and `update`, 
- * actual name `DrawObject`.
- * 
- * Provides `draw()` and `update()` methods, which can be overriden in the derived classes to provide custom behaviour for created objects. 
- */
-class DrawAbility : public virtual Base {
+        /**
+         * @brief Sets up the ring and starts the drain thread.
+         */
+        Logger() : slots(capacity){
+            for(int i = 0; i < capacity; i++){
+                SDL_AtomicSet(&slots[i].sequence, i);
+            }
+            SDL_AtomicSet(&writePosition, 0);
+            SDL_AtomicSet(&dropped, 0);
+            for(int i = 0; i < LOG_CATEGORY_COUNT; i++){
+                SDL_AtomicSet(&levels[i], LOG_TRACE);
+            }
+            SDL_AtomicSet(&running, 1);
+            readLock = SDL_CreateMutex();
+            wake = SDL_CreateSemaphore(0);
+            if(readLock != NULL && wake != NULL){
+                drainThread = SDL_CreateThread(drainLoop, "logger", this);
+            }
+        }
     public:
-    /**
-     * @brief Default virtual destructor.
-     * 
-     * Makes sure the cleanup is done.
-     */
-        virtual ~DrawAbility() = default;
-        virtual void draw() override {};
-        virtual void update() override {};
-};
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
 
-/**
- * @class Transformability
- * @brief This class provides transformation abilities.
- *
- * Provides the ability to transform an object through `rotate`, `scale`, 
- * and `translate` operations. It is an abstract class that defines pure virtual functions
- * for these transformations, which MUST be implemented by derived classes.
- */
-class Transformability : public virtual Base{
-    public:
-        virtual ~Transformability() = default;
-         /**
-         * @brief Rotates the object by the given angle.
-         * 
-         * This pure virtual method should be overridden by derived classes to implement 
-         * specific rotation behavior.
-         *
-         * @param angle The angle by which the object is to be rotated.
+        /**
+         * @brief Stops the drain thread and writes out what is left.
          */
-        virtual void rotate(float angle) = 0;
-         /**
-         * @brief Scales the object by the given value.
-         * 
-         * This pure virtual method should be overridden by derived classes to implement 
-         * specific scale behavior.
-         *
-         * @param factor The value by which the object is to be scaled.
+        ~Logger(){
+            SDL_AtomicSet(&running, 0);
+            if(drainThread != NULL){
+                SDL_SemPost(wake);
+                SDL_WaitThread(drainThread, NULL);
+            }
+            if(readLock != NULL){
+                drain();
+            }
+            SDL_DestroySemaphore(wake);
+            SDL_DestroyMutex(readLock);
+        }
+
+        /**
+         * @brief Tells if a message of `level` in `category` would be written.
          */
-        virtual void scale(float factor) = 0;
-         /**
-         * @brief Translates the object by the given `X` and `Y` coordinates.
-         * 
-         * This pure virtual method should be overridden by derived classes to implement 
-         * specific rotation behavior.
-         *
-         * @param dx translates an objects `X` coordinate.
-         * @param dy translates an objects `Y` coordinate.
+        bool isEnabled(LogLevel level, LogCategory category){
+            return level >= SDL_AtomicGet(&levels[category]);
+        }
+
+        /**
+         * @brief Sets the lowest level written for `category`, below `ENGINE_LOG_LEVEL` nothing is compiled in anyway.
          */
-        virtual void translate(int dx, int dy) = 0;
-};
+        void setLevel(LogCategory category, LogLevel level){
+            SDL_AtomicSet(&levels[category], level);
+        }
 
-/**
- * @class shapeObj
- * @brief A class representing a shape object that can be transformed and / or drawn. Inherits from Transformability and DrawAbility.
- *
- * The `shapeObj` class is more specific implementation of the `Transformability` and `DrawAbility`
- * classes. It combines the ability to perform geometric transformations (rotate, scale, translate)
- * with the ability to draw the object. It overrides the virtual methods from both the `Transformability`
- * and `DrawAbility` classes to provide specific behavior for each shape.
- */
-class shapeObj : public Transformability, public DrawAbility {
-    public:
-        virtual ~shapeObj() = default;
-        virtual void draw() override {};
-        virtual void rotate(float angle) override {};       
-        virtual void scale(float factor) override {};       
-        virtual void translate(int dx, int dy) override {};
-};
+        /**
+         * @brief Sets the lowest level written for every category.
+         */
+        void setLevel(LogLevel level){
+            for(int i = 0; i < LOG_CATEGORY_COUNT; i++){
+                setLevel(static_cast<LogCategory>(i), level);
+            }
+        }
 
-/**
- * @class Point2D
- * @brief A class representing a 2D point that can be transformed and drawn.
- *
- * The `Point2D` class virtually inherits from `shapeObj`, which provides transformation and drawing methods.
- * It represents a 2D point with specific x and y coordinates. The class provides methods for setting
- * and getting the coordinates, as well as drawing and transforming the point when inherited behavior is used.
- */
-class Point2D : public virtual shapeObj {
-    private:
-        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the point in the window.
-        int xInputed; ///< `X` - coordinate of the point.
-        int yInputed; ///< `Y` - coordinate of the point.
-    public:
         /**
-         * @brief Constructor to create a 2D point with specified coordinates.
-         *
-         * The constructor initializes the point with the given x and y coordinates. 
-         * If no coordinates are provided, it defaults to (0, 0).
+         * @brief Puts the text of `message` into the ring, or counts it as dropped when the ring is full.
          *
-         * @param x The x-coordinate of the point (default is 0).
-         * @param y The y-coordinate of the point (default is 0).
+         * @param level Severity.
+         * @param category Origin.
+         * @param message Stream from `formatStream()` holding the formatted text.
          */
-        Point2D(int x = 0, int y = 0) : xInputed(x), yInputed(y){};
+        void write(LogLevel level, LogCategory category, stringstream& message){
+            if(readLock == NULL){
+                return;
+            }
+            int position = SDL_AtomicGet(&writePosition);
+            Slot* slot;
+            for(;;){
+                slot = &slots[position & (capacity - 1)];
+                int difference = distance(position, SDL_AtomicGet(&slot->sequence));
+                if(difference == 0){
+                    if(SDL_AtomicCAS(&writePosition, position, positionAfter(position, 1))){
+                        break;
+                    }
+                    position = SDL_AtomicGet(&writePosition);
+                } else if(difference < 0){
+                    SDL_AtomicAdd(&dropped, 1);
+                    return;
+                } else {
+                    position = SDL_AtomicGet(&writePosition);
+                }
+            }
+            slot->ticks = SDL_GetTicks();
+            slot->level = level;
+            slot->category = category;
+            slot->length = static_cast<int>(message.rdbuf()->sgetn(slot->text, textSize - 1));
+            SDL_MemoryBarrierRelease(); // the message fields are visible before the sequence that publishes them
+            SDL_AtomicSet(&slot->sequence, positionAfter(position, 1));
+            if(drainThread == NULL){
+                drain();
+            } else if(level >= LOG_ERROR){
+                SDL_SemPost(wake);
+            }
+        }
 
         /**
-         * @brief Sets the coordinates of the point object.
-         *
-         * This method allows updating the x and y coordinates of the point.
-         *
-         * @param x The new x-coordinate of the point.
-         * @param y The new y-coordinate of the point.
+         * @brief Writes out everything logged so far before returning, e.g. before the program aborts.
          */
-        void setPoint(int x, int y){
-            this->xInputed = x;
-            this->yInputed = y;
+        void flush(){
+            if(readLock != NULL){
+                drain();
+            }
         }
 
         /**
-         * @brief Gets the x-coordinate of the point.
-         *
-         * This method returns x coordinate of the point.
-         * 
-         * @return The x-coordinate of the point.
+         * @brief Empty stream of the calling thread with the default formatting, messages are formatted into it.
          */
-        int getX(){
-         return xInputed;   
+        static stringstream& formatStream(){
+            static thread_local stringstream stream;
+            stream.str(string());
+            stream.clear();
+            stream.flags(ios_base::dec | ios_base::skipws);
+            stream.precision(6);
+            stream.fill(' ');
+            return stream;
         }
 
         /**
-         * @brief Gets the y-coordinate of the point.
-         *
-         * This method returns y coordinate of the point.
-         * 
-         * @return The y-coordinate of the point.
+         * @brief Log shared by the whole program, started on first use.
          */
-        int getY(){
-            return yInputed;
+        static Logger& instance(){
+            static Logger logger;
+            return logger;
         }
 };
 
 /**
- * @class LineSegment
- * @brief A class representing a 2D line segment between two points with drawing and transformation capabilities.
- *
- * The `LineSegment` class represents a line segment defined by two `Point2D` objects: the `start` and `end` points.
- * It provides functionality for setting / getting the points(their coordinates), drawing the segment from defined points, 
- * and applying transformations such as translation, rotation, and scaling. 
- * The class also uses an `SDL_Renderer` and an `SDL_Color` to render the line segment to a window with a given color.
+ * @brief Logs `message`, a chain of `<<` operands, at `level` in category `LOG_CATEGORY_<category>`.
+ * The message is only formatted when the category is enabled for the level.
  */
-class LineSegment : public virtual shapeObj {
-private:
-    Point2D start; ///< The start point of the lineSegment.
-    Point2D end; ///< The end point of the lineSegment.
-    SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the point in the window.
-    SDL_Color color; ///< SDL_Color used to specify the color of the lineSegment object.
+#define ENGINE_LOG(level, category, message) do { \
+        if(Logger::instance().isEnabled(level, LOG_CATEGORY_##category)){ \
+            stringstream& logStream = Logger::formatStream(); \
+            logStream << message; \
+            Logger::instance().write(level, LOG_CATEGORY_##category, logStream); \
+        } \
+    } while(0)
 
-public:
-    /**
-     * @brief Constructor for lineSegment object.
-     *
-     * Initializes a line segment with the given start and end points, renderer, and color.
-     *
-     * @param start The `Point2D` start point of the line segment.
-     * @param end The `Point2D` end point of the line segment.
-     * @param renderer The SDL_Renderer used for drawing the segment.
-     * @param color The color of the line segment.
-     */
-    LineSegment(Point2D &start, Point2D &end, SDL_Renderer* renderer, SDL_Color color)
-        : start(start), end(end), renderer(renderer), color(color) {}
+#if ENGINE_LOG_LEVEL <= 0
+#define ENGINE_LOG_TRACE(category, message) ENGINE_LOG(LOG_TRACE, category, message)
+#else
+#define ENGINE_LOG_TRACE(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 1
+#define ENGINE_LOG_DEBUG(category, message) ENGINE_LOG(LOG_DEBUG, category, message)
+#else
+#define ENGINE_LOG_DEBUG(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 2
+#define ENGINE_LOG_INFO(category, message) ENGINE_LOG(LOG_INFO, category, message)
+#else
+#define ENGINE_LOG_INFO(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 3
+#define ENGINE_LOG_WARN(category, message) ENGINE_LOG(LOG_WARN, category, message)
+#else
+#define ENGINE_LOG_WARN(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 4
+#define ENGINE_LOG_ERROR(category, message) ENGINE_LOG(LOG_ERROR, category, message)
+#else
+#define ENGINE_LOG_ERROR(category, message) do {} while(0)
+#endif
 
-    /**
-     * @brief Sets the start point of the line segment object.
-     *
-     * This method sets / updates the start point's coordinates to the given x and y values.
-     *
-     * @param xStart The new x-coordinate of the start point.
-     * @param yStart The new y-coordinate of the start point.
-     */
-    void setStart(int xStart, int yStart) {
-        start.setPoint(xStart, yStart);
+/**
+ * @brief Scalar reference of the frame conversion from 32-bit RGB pixels into planar YUV 4:2:0.
+ *
+ * Pixels are read as ARGB8888 / XRGB8888 (red in bits 16-23, green 8-15, blue 0-7), the output is BT.601 full range,
+ * which is what the `C420jpeg` colorspace of a Y4M stream expects. Luma is written for every pixel, chroma is the average
+ * of each 2x2 block, odd edges repeat the last row / column.
+ *
+ * @param pixels Pointer to the first pixel of the frame.
+ * @param pitch Length of a row in bytes.
+ * @param width Width of the frame in pixels.
+ * @param height Height of the frame in pixels.
+ * @param yPlane Output luma plane, `width * height` bytes.
+ * @param uPlane Output Cb plane, `((width + 1) / 2) * ((height + 1) / 2)` bytes.
+ * @param vPlane Output Cr plane, same size as `uPlane`.
+ */
+static void convertFrameToYUV420Scalar(const Uint8* pixels, int pitch, int width, int height, Uint8* yPlane, Uint8* uPlane, Uint8* vPlane){
+    int chromaWidth = (width + 1) / 2;
+    for(int y = 0; y < height; y++){
+        const Uint32* row = reinterpret_cast<const Uint32*>(pixels + y * pitch);
+        for(int x = 0; x < width; x++){
+            Uint32 p = row[x];
+            int r = (p >> 16) & 0xFF, g = (p >> 8) & 0xFF, b = p & 0xFF;
+            yPlane[y * width + x] = static_cast<Uint8>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
     }
-        /**
-     * @brief Sets the end point of the line segment.
-     *
-     * This method updates the end point's coordinates to the given x and y values.
-     *
-     * @param xEnd The new x-coordinate of the end point.
-     * @param yEnd The new y-coordinate of the end point.
-     */
-    void setEnd(int xEnd, int yEnd) {
-        end.setPoint(xEnd, yEnd);
+    for(int y = 0; y < height; y += 2){
+        const Uint32* row0 = reinterpret_cast<const Uint32*>(pixels + y * pitch);
+        const Uint32* row1 = reinterpret_cast<const Uint32*>(pixels + (y + 1 < height ? y + 1 : y) * pitch);
+        for(int x = 0; x < width; x += 2){
+            int x1 = x + 1 < width ? x + 1 : x;
+            Uint32 block[4] = {row0[x], row0[x1], row1[x], row1[x1]};
+            int r = 0, g = 0, b = 0;
+            for(int i = 0; i < 4; i++){
+                r += (block[i] >> 16) & 0xFF;
+                g += (block[i] >> 8) & 0xFF;
+                b += block[i] & 0xFF;
+            }
+            int u = ((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128;
+            int v = ((128 * r - 107 * g - 21 * b + 512) >> 10) + 128;
+            uPlane[(y / 2) * chromaWidth + x / 2] = static_cast<Uint8>(u < 0 ? 0 : (u > 255 ? 255 : u));
+            vPlane[(y / 2) * chromaWidth + x / 2] = static_cast<Uint8>(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
     }
-    /**
-     * @brief Gets the x-coordinate of the start point.
-     *
-     * This method returns the x-coordinate of the start point of the line segment.
-     *
-     * @return The x-coordinate of the start point.
-     */
-    int getStartX() { return start.getX(); }
-    /**
-     * @brief Gets the y-coordinate of the start point.
-     *
-     * This method returns the y-coordinate of the start point of the line segment.
-     *
-     * @return The y-coordinate of the start point.
-     */
-    int getStartY() { return start.getY(); }
-    /**
-     * @brief Gets the x-coordinate of the end point.
-     *
-     * This method returns the x-coordinate of the end point of the line segment.
-     *
-     * @return The x-coordinate of the end point.
-     */
-    int getEndX() { return end.getX(); }
-    /**
-     * @brief Gets the y-coordinate of the end point.
-     *
-     * This method returns the y-coordinate of the end point of the line segment.
-     *
-     * @return The y-coordinate of the end point.
-     */
-    int getEndY() { return end.getY(); }
+}
 
-    /**
-     * @brief Draws the line segment to the renderer.
-     *
-     * This method sets the drawing color and uses the SDL_Renderer to render the line segment between the start and
-     * end points.
-     */
-    void draw() override {
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-        SDL_RenderDrawLine(renderer, start.getX(), start.getY(), end.getX(), end.getY());
-        SDL_RenderPresent(renderer);
+#ifdef ENGINE_SSE2
+/**
+ * @brief Sums the two 32-bit halves of every pixel produced by `_mm_madd_epi16` for 4 pixels (2 per register).
+ */
+static inline __m128i sumPixelPairs(__m128i first, __m128i second){
+    __m128 a = _mm_castsi128_ps(first), b = _mm_castsi128_ps(second);
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+/**
+ * @brief Luma of 4 pixels as 32-bit lanes.
+ */
+static inline __m128i lumaOf4(__m128i px, __m128i coef){
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = sumPixelPairs(_mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coef), _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coef));
+    return _mm_srai_epi32(_mm_add_epi32(sums, _mm_set1_epi32(128)), 8);
+}
+
+/**
+ * @brief Channel sums of two 2x2 blocks (4 pixels of two rows) as 16-bit lanes, `B G R A` of the first block then the second.
+ */
+static inline __m128i blockSumsOf2(__m128i top, __m128i bottom){
+    const __m128i zero = _mm_setzero_si128();
+    __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+    __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+    left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+    right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+    return _mm_unpacklo_epi64(left, right);
+}
+
+/**
+ * @brief SSE2 version of `convertFrameToYUV420Scalar()`, 8 pixels per step with a scalar tail, bit exact with the reference.
+ */
+static void convertFrameToYUV420SSE2(const Uint8* pixels, int pitch, int width, int height, Uint8* yPlane, Uint8* uPlane, Uint8* vPlane){
+    const __m128i yCoef = _mm_setr_epi16(29, 150, 77, 0, 29, 150, 77, 0);
+    const __m128i uCoef = _mm_setr_epi16(128, -85, -43, 0, 128, -85, -43, 0);
+    const __m128i vCoef = _mm_setr_epi16(-21, -107, 128, 0, -21, -107, 128, 0);
+    const __m128i chromaRound = _mm_set1_epi32(512);
+    const __m128i chromaBias = _mm_set1_epi32(128);
+    int chromaWidth = (width + 1) / 2;
+    int vectorWidth = width & ~7;
+
+    for(int y = 0; y < height; y++){
+        const Uint8* row = pixels + y * pitch;
+        Uint8* out = yPlane + y * width;
+        for(int x = 0; x < vectorWidth; x += 8){
+            __m128i a = lumaOf4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 4)), yCoef);
+            __m128i b = lumaOf4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x * 4 + 16)), yCoef);
+            __m128i packed = _mm_packs_epi32(a, b);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(packed, packed));
+        }
     }
-    /**
-     * @brief Draws the line segment to the renderer.
-     *
-     * This method is similar to `draw()`, but allows drawing the line segment without overriding the inherited
-     * behavior, since the base classes have no `drawSegment()` method.
-     */
-    void drawSegment() {
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-        SDL_RenderDrawLine(renderer, start.getX(), start.getY(), end.getX(), end.getY());
-        SDL_RenderPresent(renderer);
+
+    for(int y = 0; y < height; y += 2){
+        const Uint8* row0 = pixels + y * pitch;
+        const Uint8* row1 = pixels + (y + 1 < height ? y + 1 : y) * pitch;
+        Uint8* uOut = uPlane + (y / 2) * chromaWidth;
+        Uint8* vOut = vPlane + (y / 2) * chromaWidth;
+        for(int x = 0; x < vectorWidth; x += 8){
+            __m128i first = blockSumsOf2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 4)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 4)));
+            __m128i second = blockSumsOf2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 4 + 16)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 4 + 16)));
+            __m128i u = sumPixelPairs(_mm_madd_epi16(first, uCoef), _mm_madd_epi16(second, uCoef));
+            __m128i v = sumPixelPairs(_mm_madd_epi16(first, vCoef), _mm_madd_epi16(second, vCoef));
+            u = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(u, chromaRound), 10), chromaBias);
+            v = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(v, chromaRound), 10), chromaBias);
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(u, v), _mm_setzero_si128());
+            Uint32 uv[2];
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(uv), packed);
+            memcpy(uOut + x / 2, &uv[0], 4);
+            memcpy(vOut + x / 2, &uv[1], 4);
+        }
     }
 
-    /**
-     * @brief Translates the line segment by given offset.
-     *
-     * This method translates the line segment object by a given vertical(dy) and horizontal(dx) offset in parameters of the function,
-     * and redraws the segment, derived function from the `Transformability` class.
-     * Is done using the `setPoint()` function and getter methods of `Point2D` class.
-     * 
-     * @param dx The horizontal offset.
-     * @param dy The vertical offset.
-     */
-    void translate(int dx, int dy) override {
-        start.setPoint(start.getX() + dx, start.getY() + dy);
-        end.setPoint(end.getX() + dx, end.getY() + dy);
-        drawSegment();
+    // the scalar reference finishes whatever is left of the right edge
+    if(vectorWidth < width){
+        int tailWidth = width - vectorWidth;
+        int tailChroma = (tailWidth + 1) / 2;
+        vector<Uint8> tailY(tailWidth * height), tailU(tailChroma * ((height + 1) / 2)), tailV(tailU.size());
+        convertFrameToYUV420Scalar(pixels + vectorWidth * 4, pitch, tailWidth, height, tailY.data(), tailU.data(), tailV.data());
+        for(int y = 0; y < height; y++){
+            memcpy(yPlane + y * width + vectorWidth, &tailY[y * tailWidth], tailWidth);
+        }
+        for(int y = 0; y < (height + 1) / 2; y++){
+            memcpy(uPlane + y * chromaWidth + vectorWidth / 2, &tailU[y * tailChroma], tailChroma);
+            memcpy(vPlane + y * chromaWidth + vectorWidth / 2, &tailV[y * tailChroma], tailChroma);
+        }
     }
-    /**
-     * @brief Rotates the line segment object by a given angle.
-     *
-     * This method rotates the line segment around its center point by the specified angle (in degrees, then converts it into radians) 
-     * and then redraws the segment.
-     *
-     * @param angle The angle by which to rotate the line segment, speicify it in degrees.
-     */
-    void rotate(float angle) override {
-        int x1 = start.getX();
-        int y1 = start.getY();
-        int x2 = end.getX();
-        int y2 = end.getY();
+}
+#endif
+
+typedef void (*YUV420Converter)(const Uint8*, int, int, int, Uint8*, Uint8*, Uint8*);
+
+/**
+ * @brief Picks the fastest frame converter the CPU supports, checked once at runtime.
+ */
+static YUV420Converter selectYUV420Converter(){
+#ifdef ENGINE_SSE2
+    if(SDL_HasSSE2()){
+        return convertFrameToYUV420SSE2;
+    }
+#endif
+    return convertFrameToYUV420Scalar;
+}
+
+/**
+ * @struct RecordingStats
+ * @brief Back-pressure statistics of a `VideoRecorder`.
+ *
+ * The recorder never drops a frame and never makes the main loop wait for the disk or the pipe,
+ * so when the writer falls behind the queue grows instead. These counters show by how much.
+ */
+struct RecordingStats {
+    Uint64 framesSubmitted = 0; ///< Frames handed over by the main loop.
+    Uint64 framesWritten = 0; ///< Frames converted and written by the writer thread.
+    Uint64 bytesWritten = 0; ///< Bytes written to the stream, headers included.
+    int queueDepth = 0; ///< Frames currently waiting for the writer.
+    int peakQueueDepth = 0; ///< Highest number of frames that were waiting at once.
+    int buffersAllocated = 0; ///< Frame buffers allocated so far, grows only when every recycled buffer is still queued.
+    double writerBusyMs = 0.0; ///< Time the writer thread spent converting and writing.
+    bool writeFailed = false; ///< Set when the file / pipe refused data, later frames are then discarded by the writer.
+};
+
+/**
+ * @class VideoRecorder
+ * @brief Streams rendered frames into a raw Y4M (YUV4MPEG2) file or pipe from a background thread.
+ *
+ * The main loop only copies the frame into a recycled buffer and queues it (`submitFrame()`),
+ * conversion to YUV 4:2:0 and writing happen on the writer thread. A target starting with `|`
+ * is treated as a shell command and the stream is piped into it, e.g. `|ffmpeg -i - out.mp4`.
+ */
+class VideoRecorder {
+    private:
+        /** One captured frame, tightly packed 32-bit pixels. */
+        struct Frame {
+            vector<Uint8> pixels;
+        };
+
+        FILE* output = NULL; ///< Y4M file or pipe the frames are written into.
+        bool outputIsPipe = false; ///< `true` when `output` was opened with popen and must be closed with pclose.
+        int width = 0; ///< Width of the recorded frames.
+        int height = 0; ///< Height of the recorded frames.
+        SDL_Thread* writerThread = NULL; ///< Background thread converting and writing queued frames.
+        SDL_mutex* queueLock = NULL; ///< Guards `pending`, `freeFrames`, `stopping` and `stats`.
+        SDL_cond* queueSignal = NULL; ///< Wakes the writer when a frame is queued or the recording stops.
+        deque<Frame*> pending; ///< Frames waiting for the writer, oldest first.
+        vector<Frame*> freeFrames; ///< Buffers the writer is done with, reused by `submitFrame()`.
+        bool stopping = false; ///< Tells the writer to finish the queue and exit.
+        RecordingStats stats; ///< Back-pressure statistics.
+        YUV420Converter convert = NULL; ///< Converter chosen for this CPU.
+
+        static int writerEntry(void* recorder){
+            return static_cast<VideoRecorder*>(recorder)->writerLoop();
+        }
+
+        /** Writer thread body, drains the queue until `stop()` is called and the queue is empty. */
+        int writerLoop(){
+            int chromaSize = ((width + 1) / 2) * ((height + 1) / 2);
+            vector<Uint8> yuv(width * height + 2 * chromaSize);
+            static const char frameHeader[] = "FRAME\n";
+
+            SDL_LockMutex(queueLock);
+            while(true){
+                while(pending.empty() && !stopping){
+                    SDL_CondWait(queueSignal, queueLock);
+                }
+                if(pending.empty()){
+                    break;
+                }
+                Frame* frame = pending.front();
+                pending.pop_front();
+                stats.queueDepth = static_cast<int>(pending.size());
+                bool failed = stats.writeFailed;
+                SDL_UnlockMutex(queueLock);
+
+                Uint64 begin = SDL_GetPerformanceCounter();
+                size_t written = 0;
+                if(!failed){
+                    convert(frame->pixels.data(), width * 4, width, height, yuv.data(), yuv.data() + width * height, yuv.data() + width * height + chromaSize);
+                    written = fwrite(frameHeader, 1, sizeof(frameHeader) - 1, output);
+                    written += fwrite(yuv.data(), 1, yuv.size(), output);
+                    failed = written != sizeof(frameHeader) - 1 + yuv.size();
+                }
+                double busyMs = (SDL_GetPerformanceCounter() - begin) * 1000.0 / SDL_GetPerformanceFrequency();
+
+                SDL_LockMutex(queueLock);
+                freeFrames.push_back(frame);
+                stats.writerBusyMs += busyMs;
+                stats.bytesWritten += written;
+                if(failed){
+                    if(!stats.writeFailed){
+                        ENGINE_LOG_ERROR(RECORDING, "VideoRecorder: writing the stream failed, remaining frames are discarded");
+                    }
+                    stats.writeFailed = true;
+                } else {
+                    stats.framesWritten++;
+                }
+            }
+            SDL_UnlockMutex(queueLock);
+            return 0;
+        }
+
+    public:
+        virtual ~VideoRecorder(){stop();}
+
+        VideoRecorder(){}
+
+        /**
+         * @brief Opens the output, writes the Y4M stream header and starts the writer thread.
+         *
+         * @param target Path of the `.y4m` file, or `|command` to pipe the stream into a process.
+         * @param frameWidth Width of the frames that will be submitted.
+         * @param frameHeight Height of the frames that will be submitted.
+         * @param fps Frame rate written into the stream header.
+         * @return `true` if recording started, `false` if the output couldn't be opened or the thread couldn't be created.
+         */
+        bool start(const string& target, int frameWidth, int frameHeight, int fps){
+            if(output != NULL || frameWidth <= 0 || frameHeight <= 0){
+                return false;
+            }
+            if(!target.empty() && target[0] == '|'){
+#ifdef _WIN32
+                output = _popen(target.c_str() + 1, "wb");
+#else
+                output = popen(target.c_str() + 1, "w");
+#endif
+                outputIsPipe = true;
+            } else {
+                output = fopen(target.c_str(), "wb");
+                outputIsPipe = false;
+            }
+            if(output == NULL){
+                ENGINE_LOG_ERROR(RECORDING, "VideoRecorder: couldn't open " << target);
+                return false;
+            }
+
+            width = frameWidth;
+            height = frameHeight;
+            stats = RecordingStats();
+            stopping = false;
+            convert = selectYUV420Converter();
+            int headerLength = fprintf(output, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps);
+            stats.bytesWritten = headerLength > 0 ? headerLength : 0;
+
+            queueLock = SDL_CreateMutex();
+            queueSignal = SDL_CreateCond();
+            writerThread = SDL_CreateThread(writerEntry, "VideoRecorder", this);
+            if(writerThread == NULL){
+                ENGINE_LOG_ERROR(RECORDING, "VideoRecorder: SDL_CreateThread " << SDL_GetError());
+                stop();
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Queues a copy of the frame for the writer thread.
+         *
+         * Never blocks on the writer: a recycled buffer is used when one is free, otherwise a new one is allocated
+         * and counted in `RecordingStats::buffersAllocated`.
+         *
+         * @param pixels Pointer to the first pixel, 32-bit ARGB8888 / XRGB8888.
+         * @param pitch Length of a source row in bytes.
+         * @return `false` if the recorder isn't running.
+         */
+        bool submitFrame(const void* pixels, int pitch){
+            if(writerThread == NULL || pixels == NULL){
+                return false;
+            }
+            Frame* frame = NULL;
+            SDL_LockMutex(queueLock);
+            if(!freeFrames.empty()){
+                frame = freeFrames.back();
+                freeFrames.pop_back();
+            } else {
+                stats.buffersAllocated++;
+            }
+            SDL_UnlockMutex(queueLock);
+
+            if(frame == NULL){
+                frame = new Frame();
+                frame->pixels.resize(static_cast<size_t>(width) * height * 4);
+            }
+            const Uint8* source = static_cast<const Uint8*>(pixels);
+            for(int y = 0; y < height; y++){
+                memcpy(&frame->pixels[static_cast<size_t>(y) * width * 4], source + y * pitch, width * 4);
+            }
+
+            SDL_LockMutex(queueLock);
+            pending.push_back(frame);
+            stats.framesSubmitted++;
+            stats.queueDepth = static_cast<int>(pending.size());
+            if(stats.queueDepth > stats.peakQueueDepth){
+                stats.peakQueueDepth = stats.queueDepth;
+            }
+            SDL_CondSignal(queueSignal);
+            SDL_UnlockMutex(queueLock);
+            return true;
+        }
+
+        /**
+         * @brief Lets the writer finish every queued frame, then joins it and closes the output.
+         */
+        void stop(){
+            if(writerThread != NULL){
+                SDL_LockMutex(queueLock);
+                stopping = true;
+                SDL_CondSignal(queueSignal);
+                SDL_UnlockMutex(queueLock);
+                SDL_WaitThread(writerThread, NULL);
+                writerThread = NULL;
+            }
+            if(output != NULL){
+                if(outputIsPipe){
+#ifdef _WIN32
+                    _pclose(output);
+#else
+                    pclose(output);
+#endif
+                } else {
+                    fclose(output);
+                }
+                output = NULL;
+            }
+            for(Frame* frame : pending){delete frame;}
+            for(Frame* frame : freeFrames){delete frame;}
+            pending.clear();
+            freeFrames.clear();
+            if(queueSignal){SDL_DestroyCond(queueSignal); queueSignal = NULL;}
+            if(queueLock){SDL_DestroyMutex(queueLock); queueLock = NULL;}
+        }
+
+        /** @brief `true` while the writer thread is running. */
+        bool isRecording(){
+            return writerThread != NULL;
+        }
+
+        /** @brief Copy of the current back-pressure statistics. */
+        RecordingStats getStats(){
+            if(queueLock == NULL){
+                return stats;
+            }
+            SDL_LockMutex(queueLock);
+            RecordingStats copy = stats;
+            SDL_UnlockMutex(queueLock);
+            return copy;
+        }
+};
+
+/**
+ * @class JobSystem
+ * @brief Work-stealing job scheduler: every thread has its own deque of jobs and idle threads steal from the others.
+ *
+ * A thread pushes and pops jobs at the bottom of its own deque (last in, first out, warm in its cache) while other
+ * threads steal from the top (a Chase-Lev deque, only the steals contend). The thread that creates the system is
+ * participant 0 next to the workers, other threads may submit too, their jobs go through a small locked queue.
+ *
+ * Jobs can have children (a job only finishes after them) and dependencies (a job only starts after them).
+ * `wait()` never just blocks, it runs other jobs until the one waited on is finished, so jobs may wait on jobs
+ * and `parallelFor()` may be nested. Jobs come from a ring per thread, a finished job is reused once about
+ * `jobRingSize` more jobs were created on the same thread and its handle must not be used after that. Jobs that
+ * aren't finished are never reused, the ring grows when all of them are in flight.
+ */
+class JobSystem {
+    public:
+        /**
+         * @brief A unit of work, created by `create()` and started by `submit()`.
+         */
+        struct Job {
+            function<void()> work; ///< Work of a plain job.
+            const function<void(int, int)>* range = NULL; ///< Body of a `parallelFor()` job, which runs it over [`begin`, `end`).
+            int begin = 0; ///< First index of a range job.
+            int end = 0; ///< End of a range job.
+            int grain = 1; ///< Range jobs split until they are this small.
+            Job* parent = NULL; ///< Job that only finishes after this one.
+            SDL_atomic_t unfinished; ///< This job plus its unfinished children, 0 when it is finished.
+            SDL_atomic_t pending; ///< Unfinished dependencies plus one until it is submitted, it is queued at 0.
+            SDL_SpinLock lock = 0; ///< Guards `dependents` and `done`.
+            vector<Job*> dependents; ///< Jobs waiting for this one to finish.
+            bool done = true; ///< Set once the dependents were released, a done job's slot may be reused.
+        };
+
+        static const int jobRingSize = 4096; ///< Jobs a thread can create before its oldest finished one is reused.
+    private:
+        /**
+         * @brief Chase-Lev deque of a participant, the owner works at the bottom and thieves take from the top.
+         *
+         * Positions are compared through their difference, so they may wrap around.
+         */
+        struct WorkQueue {
+            static const int capacity = 4096; ///< Jobs queued at most, a full deque runs new jobs right away.
+            Job* slots[capacity]; ///< The ring.
+            SDL_atomic_t top; ///< Oldest job, moved by thieves and the owner's last pop.
+            SDL_atomic_t bottom; ///< Slot after the newest job, moved by the owner.
+
+            WorkQueue(){
+                SDL_AtomicSet(&top, 0);
+                SDL_AtomicSet(&bottom, 0);
+            }
+
+            static int distance(int from, int to){
+                return static_cast<int>(static_cast<unsigned>(to) - static_cast<unsigned>(from));
+            }
+
+            static int offset(int position, int by){
+                return static_cast<int>(static_cast<unsigned>(position) + static_cast<unsigned>(by));
+            }
+
+            /** Owner only, `false` when full. */
+            bool push(Job* job){
+                int b = SDL_AtomicGet(&bottom);
+                if(distance(SDL_AtomicGet(&top), b) >= capacity){
+                    return false;
+                }
+                slots[b & (capacity - 1)] = job;
+                SDL_MemoryBarrierRelease();
+                SDL_AtomicSet(&bottom, offset(b, 1));
+                return true;
+            }
+
+            /** Owner only, NULL when empty. The decrement is a full barrier, so a thief can't miss it. */
+            Job* pop(){
+                int b = offset(SDL_AtomicAdd(&bottom, -1), -1);
+                int t = SDL_AtomicGet(&top);
+                int size = distance(t, b);
+                if(size < 0){
+                    SDL_AtomicSet(&bottom, t);
+                    return NULL;
+                }
+                Job* job = slots[b & (capacity - 1)];
+                if(size > 0){
+                    return job;
+                }
+                if(!SDL_AtomicCAS(&top, t, offset(t, 1))){
+                    job = NULL;
+                }
+                SDL_AtomicSet(&bottom, offset(t, 1));
+                return job;
+            }
+
+            /** Any thread, NULL when empty or when another thread took the job first. */
+            Job* steal(){
+                int t = SDL_AtomicGet(&top);
+                int b = SDL_AtomicGet(&bottom);
+                if(distance(t, b) <= 0){
+                    return NULL;
+                }
+                Job* job = slots[t & (capacity - 1)];
+                return SDL_AtomicCAS(&top, t, offset(t, 1)) ? job : NULL;
+            }
+        };
+
+        /**
+         * @brief What a worker thread needs to join the system.
+         */
+        struct WorkerStart {
+            JobSystem* system; ///< The system.
+            int queue; ///< Deque of the worker.
+        };
+
+        vector<WorkQueue*> queues; ///< Deque of each participant, 0 belongs to the creating thread.
+        vector<SDL_Thread*> workers; ///< Worker threads, worker `i` owns `queues[i + 1]`.
+        deque<Job*> injected; ///< Jobs submitted by threads without a deque.
+        SDL_mutex* injectLock = NULL; ///< Guards `injected`.
+        SDL_atomic_t injectedCount; ///< Size of `injected`, read without the lock.
+        SDL_sem* wake = NULL; ///< Posted when jobs are pushed while workers sleep.
+        SDL_atomic_t sleepers; ///< Workers waiting on `wake`.
+        SDL_atomic_t running; ///< Cleared to stop the workers.
+        vector<WorkerStart> starts; ///< Start data of the workers, sized before they start.
+        JobSystem* previousOwner = NULL; ///< System the creating thread participated in before this one.
+        int previousQueue = -1; ///< Its deque in that system.
+
+        /**
+         * @brief System and deque of the calling thread, a thread participates in at most one system at a time.
+         */
+        static JobSystem*& currentSystem(){
+            static thread_local JobSystem* system = NULL;
+            return system;
+        }
+
+        static int& currentQueue(){
+            static thread_local int queue = -1;
+            return queue;
+        }
+
+        /**
+         * @brief Deque of the calling thread in this system, -1 when it has none.
+         */
+        int ownQueue(){
+            return currentSystem() == this ? currentQueue() : -1;
+        }
+
+        /**
+         * @brief Next free job from the calling thread's ring.
+         *
+         * Slots of jobs that aren't done yet are skipped, nested waits can keep many jobs alive at once. When every
+         * slot is taken the ring grows by its size, the deque keeps the jobs already handed out where they are.
+         */
+        static Job* allocate(){
+            static thread_local deque<Job> ring(jobRingSize);
+            static thread_local size_t next = 0;
+            Job* job = NULL;
+            for(size_t tried = 0; tried < ring.size() && job == NULL; tried++){
+                Job* candidate = &ring[next++ % ring.size()];
+                SDL_AtomicLock(&candidate->lock);
+                if(candidate->done){
+                    job = candidate;
+                }
+                SDL_AtomicUnlock(&candidate->lock);
+            }
+            if(job == NULL){
+                size_t grown = ring.size();
+                ring.resize(grown * 2);
+                job = &ring[grown];
+                next = grown + 1;
+            }
+            job->work = nullptr;
+            job->range = NULL;
+            job->parent = NULL;
+            job->dependents.clear();
+            job->done = false;
+            job->lock = 0;
+            SDL_AtomicSet(&job->unfinished, 1);
+            SDL_AtomicSet(&job->pending, 1);
+            return job;
+        }
+
+        /**
+         * @brief Queues a job that is ready to run.
+         */
+        void push(Job* job){
+            int queue = ownQueue();
+            if(queue >= 0){
+                if(!queues[queue]->push(job)){
+                    execute(job);
+                    return;
+                }
+            } else {
+                SDL_LockMutex(injectLock);
+                injected.push_back(job);
+                SDL_AtomicAdd(&injectedCount, 1);
+                SDL_UnlockMutex(injectLock);
+            }
+            if(SDL_AtomicGet(&sleepers) > 0){
+                SDL_SemPost(wake);
+            }
+        }
+
+        /**
+         * @brief Finds a job to run: own deque first, then submitted ones, then stealing from a random other deque.
+         */
+        Job* findJob(int queue){
+            if(queue >= 0){
+                Job* job = queues[queue]->pop();
+                if(job != NULL){
+                    return job;
+                }
+            }
+            if(SDL_AtomicGet(&injectedCount) > 0){
+                Job* job = NULL;
+                SDL_LockMutex(injectLock);
+                if(!injected.empty()){
+                    job = injected.front();
+                    injected.pop_front();
+                    SDL_AtomicAdd(&injectedCount, -1);
+                }
+                SDL_UnlockMutex(injectLock);
+                if(job != NULL){
+                    return job;
+                }
+            }
+            static thread_local Uint32 seed = 0x9E3779B9u;
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            int count = static_cast<int>(queues.size());
+            int start = static_cast<int>(seed % count);
+            for(int i = 0; i < count; i++){
+                int victim = (start + i) % count;
+                if(victim != queue){
+                    Job* job = queues[victim]->steal();
+                    if(job != NULL){
+                        return job;
+                    }
+                }
+            }
+            return NULL;
+        }
+
+        /**
+         * @brief Runs a job. A range job first splits its upper halves off as children until it is down to its grain.
+         */
+        void execute(Job* job){
+            if(job->range != NULL){
+                while(job->end - job->begin > job->grain){
+                    int middle = job->begin + (job->end - job->begin) / 2;
+                    Job* half = allocate();
+                    half->range = job->range;
+                    half->begin = middle;
+                    half->end = job->end;
+                    half->grain = job->grain;
+                    half->parent = job;
+                    SDL_AtomicAdd(&job->unfinished, 1);
+                    submit(half);
+                    job->end = middle;
+                }
+                (*job->range)(job->begin, job->end);
+            } else if(job->work){
+                job->work();
+            }
+            finish(job);
+        }
+
+        /**
+         * @brief Counts one part of a job as done, the last part releases its dependents and finishes its parent.
+         *
+         * The dependents that became ready are collected under the job's spinlock and pushed after it is released,
+         * a push may run the job inline when the deque is full and must not do so with the lock held.
+         */
+        void finish(Job* job){
+            vector<Job*> ready;
+            while(job != NULL){
+                if(SDL_AtomicAdd(&job->unfinished, -1) != 1){
+                    return;
+                }
+                SDL_AtomicLock(&job->lock);
+                job->done = true;
+                for(Job* dependent : job->dependents){
+                    if(SDL_AtomicAdd(&dependent->pending, -1) == 1){
+                        ready.push_back(dependent);
+                    }
+                }
+                Job* parent = job->parent;
+                SDL_AtomicUnlock(&job->lock);
+                for(Job* dependent : ready){
+                    push(dependent);
+                }
+                ready.clear();
+                job = parent;
+            }
+        }
+
+        static int workerEntry(void* data){
+            WorkerStart* start = static_cast<WorkerStart*>(data);
+            currentSystem() = start->system;
+            currentQueue() = start->queue;
+            start->system->workerLoop(start->queue);
+            return 0;
+        }
+
+        /**
+         * @brief Runs jobs until the system closes, sleeping on `wake` after a while without any.
+         */
+        void workerLoop(int queue){
+            int idle = 0;
+            while(SDL_AtomicGet(&running)){
+                Job* job = findJob(queue);
+                if(job != NULL){
+                    execute(job);
+                    idle = 0;
+                    continue;
+                }
+                if(++idle < 64){
+                    SDL_Delay(0);
+                    continue;
+                }
+                SDL_AtomicAdd(&sleepers, 1);
+                job = findJob(queue);
+                if(job == NULL){
+                    SDL_SemWaitTimeout(wake, 2);
+                }
+                SDL_AtomicAdd(&sleepers, -1);
+                if(job != NULL){
+                    execute(job);
+                }
+                idle = 0;
+            }
+        }
+    public:
+        /**
+         * @brief Starts the workers, the calling thread becomes participant 0.
+         *
+         * @param threads Number of worker threads, by default one less than the CPU count so the caller makes up the last one.
+         */
+        JobSystem(int threads = -1){
+            if(threads < 0){
+                threads = SDL_GetCPUCount() - 1;
+            }
+            injectLock = SDL_CreateMutex();
+            wake = SDL_CreateSemaphore(0);
+            SDL_AtomicSet(&injectedCount, 0);
+            SDL_AtomicSet(&sleepers, 0);
+            SDL_AtomicSet(&running, 1);
+            queues.push_back(new WorkQueue());
+            previousOwner = currentSystem();
+            previousQueue = currentQueue();
+            currentSystem() = this;
+            currentQueue() = 0;
+            for(int i = 0; i < threads; i++){
+                queues.push_back(new WorkQueue());
+            }
+            starts.resize(threads);
+            for(int i = 0; i < threads; i++){
+                starts[i] = {this, i + 1};
+                SDL_Thread* worker = SDL_CreateThread(workerEntry, "JobSystem", &starts[i]);
+                if(worker == NULL){
+                    ENGINE_LOG_ERROR(THREADS, "JobSystem: SDL_CreateThread " << SDL_GetError());
+                    break;
+                }
+                workers.push_back(worker);
+            }
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /** @brief Stops and joins the workers, every submitted job has to be finished. */
+        ~JobSystem(){
+            SDL_AtomicSet(&running, 0);
+            for(size_t i = 0; i < workers.size(); i++){
+                SDL_SemPost(wake);
+            }
+            for(SDL_Thread* worker : workers){
+                SDL_WaitThread(worker, NULL);
+            }
+            for(WorkQueue* queue : queues){
+                delete queue;
+            }
+            if(currentSystem() == this){
+                currentSystem() = previousOwner;
+                currentQueue() = previousQueue;
+            }
+            SDL_DestroySemaphore(wake);
+            SDL_DestroyMutex(injectLock);
+        }
+
+        /**
+         * @brief Creates a job, it doesn't run before `submit()`.
+         *
+         * @param work The work.
+         * @param parent Job that only finishes after this one, NULL (default) for none. It must not be finished yet.
+         * @return The job.
+         */
+        Job* create(const function<void()>& work, Job* parent = NULL){
+            Job* job = allocate();
+            job->work = work;
+            job->parent = parent;
+            if(parent != NULL){
+                SDL_AtomicAdd(&parent->unfinished, 1);
+            }
+            return job;
+        }
+
+        /**
+         * @brief Makes `job` wait for `prerequisite`, before `job` is submitted. A finished prerequisite is ignored.
+         */
+        void addDependency(Job* job, Job* prerequisite){
+            SDL_AtomicLock(&prerequisite->lock);
+            if(!prerequisite->done){
+                SDL_AtomicAdd(&job->pending, 1);
+                prerequisite->dependents.push_back(job);
+            }
+            SDL_AtomicUnlock(&prerequisite->lock);
+        }
+
+        /**
+         * @brief Starts a job once its dependencies are finished.
+         */
+        void submit(Job* job){
+            if(SDL_AtomicAdd(&job->pending, -1) == 1){
+                push(job);
+            }
+        }
+
+        /**
+         * @brief Creates and submits a job.
+         */
+        Job* run(const function<void()>& work, Job* parent = NULL){
+            Job* job = create(work, parent);
+            submit(job);
+            return job;
+        }
+
+        /**
+         * @brief Tells if a job and its children are finished.
+         */
+        static bool isFinished(Job* job){
+            return SDL_AtomicGet(&job->unfinished) == 0;
+        }
+
+        /**
+         * @brief Runs other jobs until `job` is finished.
+         */
+        void wait(Job* job){
+            int queue = ownQueue();
+            int idle = 0;
+            while(!isFinished(job)){
+                Job* other = findJob(queue);
+                if(other != NULL){
+                    execute(other);
+                    idle = 0;
+                } else if(++idle > 64){
+                    SDL_Delay(0);
+                }
+            }
+        }
+
+        /**
+         * @brief Calls `body(begin, end)` over [0, `count`) in chunks of at least `grain` indices and waits for all of them.
+         *
+         * The range is split in halves as threads pick it up, down to a few chunks per thread, and the calling thread
+         * helps until the last chunk is done. Bodies may call `parallelFor()` themselves.
+         *
+         * @param count Number of indices.
+         * @param body Work for one chunk, called concurrently for different chunks.
+         * @param grain Smallest chunk, keeps tiny ranges from being split into useless pieces.
+         */
+        void parallelFor(int count, const function<void(int begin, int end)>& body, int grain = 16){
+            if(count <= 0){
+                return;
+            }
+            int threads = getThreadCount();
+            int chunk = max(grain, (count + threads * 4 - 1) / (threads * 4));
+            if(workers.empty() || chunk >= count){
+                body(0, count);
+                return;
+            }
+            Job* job = allocate();
+            job->range = &body;
+            job->begin = 0;
+            job->end = count;
+            job->grain = chunk;
+            submit(job);
+            wait(job);
+        }
+
+        /** @brief Worker threads plus the calling thread. */
+        int getThreadCount(){
+            return static_cast<int>(workers.size()) + 1;
+        }
+
+        /** @brief System shared by the engine's CPU-side passes, created on first use by the thread that becomes its participant 0. */
+        static JobSystem& shared(){
+            static JobSystem system;
+            return system;
+        }
+};
+
+/**
+ * @brief Where a `SystemScheduler` system may run.
+ */
+enum SystemThread {
+    SYSTEM_ANY_THREAD, ///< Any thread of the job system.
+    SYSTEM_MAIN_THREAD ///< Only the thread calling `run()`, for systems using the renderer or the window.
+};
+
+/**
+ * @class SystemScheduler
+ * @brief Runs the per-frame systems (input, animation, physics, culling, render submission...) in an order derived from
+ * the resources they read and write, independent systems concurrently on a `JobSystem`.
+ *
+ * Resources are named sets of data (a component array, the renderer, the input state), a system declares which ones it
+ * reads and which ones it writes. A system waits for every earlier declared system it conflicts with: one writes what the
+ * other reads or writes. Two readers never conflict, so they may run at the same time. Declaration order decides only
+ * between conflicting systems, which keeps the result the same as running everything one after the other.
+ *
+ * The graph is built when the systems change and kept until they change again, edges implied through other systems are
+ * dropped. `toDot()` writes it in Graphviz format with the conflicting resources on the edges.
+ *
+ * @code
+ * SystemScheduler systems;
+ * systems.addSystem("animation", {"detail"}, {"animation"}, [&](){animations.update();});
+ * systems.addSystem("draw", {"transform", "animation"}, {"renderer"}, [&](){p1.render(alpha);}, SYSTEM_MAIN_THREAD);
+ * systems.run(&JobSystem::shared());
+ * @endcode
+ */
+class SystemScheduler {
+    public:
+        static const int maxResources = 64; ///< Resources that fit in a set.
+        static const int maxSystems = 64; ///< Systems that fit in a dependency set.
+    private:
+        /**
+         * @brief A declared system.
+         */
+        struct System {
+            string name; ///< Name in logs and in the graph.
+            Uint64 reads; ///< Resources it reads, one bit each.
+            Uint64 writes; ///< Resources it writes.
+            function<void()> work; ///< The system itself.
+            SystemThread thread; ///< Where it may run.
+            Uint64 after = 0; ///< Systems it waits for directly, one bit each.
+            Uint64 ancestors = 0; ///< Systems it waits for directly or through others.
+            int level = 0; ///< Length of the longest dependency chain leading to it.
+            double lastMs = 0.0; ///< Time the last `run()` spent in it.
+        };
+
+        vector<string> resources; ///< Names of the resources, a resource's bit is its index.
+        vector<System> systems; ///< Systems in declaration order, which is a topological order of the graph.
+        vector<JobSystem::Job*> handles; ///< Scratch of `run()`: the job of each system.
+        bool dirty = true; ///< The graph needs to be rebuilt.
+        int levels = 0; ///< Longest dependency chain plus one, the number of waves the graph runs in.
+
+        /**
+         * @brief Bits of the named resources, registering the new ones.
+         */
+        Uint64 resourceSet(const vector<string>& names){
+            Uint64 set = 0;
+            for(const string& name : names){
+                int index = resource(name);
+                if(index >= 0){
+                    set |= Uint64(1) << index;
+                }
+            }
+            return set;
+        }
+
+        /**
+         * @brief Names of the resources in `set`, separated by `separator`.
+         */
+        string resourceNames(Uint64 set, const char* separator) const {
+            string names;
+            for(int i = 0; i < static_cast<int>(resources.size()); i++){
+                if(set & (Uint64(1) << i)){
+                    names += (names.empty() ? "" : separator) + resources[i];
+                }
+            }
+            return names;
+        }
+
+        /**
+         * @brief Resources over which two systems conflict, whichever order they run in.
+         */
+        static Uint64 conflicts(const System& first, const System& second){
+            return (first.writes & (second.reads | second.writes)) | (first.reads & second.writes);
+        }
+
+        /**
+         * @brief Builds the dependencies: every conflict with an earlier system, less the ones implied through another dependency.
+         */
+        void rebuild(){
+            levels = 0;
+            for(size_t i = 0; i < systems.size(); i++){
+                System& system = systems[i];
+                Uint64 direct = 0;
+                for(size_t j = 0; j < i; j++){
+                    if(conflicts(systems[j], system)){
+                        direct |= Uint64(1) << j;
+                    }
+                }
+                Uint64 implied = 0;
+                system.ancestors = direct;
+                system.level = 0;
+                for(size_t j = 0; j < i; j++){
+                    if(direct & (Uint64(1) << j)){
+                        implied |= systems[j].ancestors;
+                        system.ancestors |= systems[j].ancestors;
+                        system.level = max(system.level, systems[j].level + 1);
+                    }
+                }
+                system.after = direct & ~implied;
+                levels = max(levels, system.level + 1);
+            }
+            dirty = false;
+            ENGINE_LOG_DEBUG(ENGINE, "SystemScheduler: " << systems.size() << " systems in " << levels << " levels");
+        }
+
+        /**
+         * @brief Runs a system and times it.
+         */
+        void execute(int index){
+            Uint64 start = SDL_GetPerformanceCounter();
+            systems[index].work();
+            systems[index].lastMs = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        }
+    public:
+        /**
+         * @brief Index of a resource, registering it on first use.
+         *
+         * @return The index, -1 (logged) once `maxResources` are registered.
+         */
+        int resource(const string& name){
+            for(size_t i = 0; i < resources.size(); i++){
+                if(resources[i] == name){
+                    return static_cast<int>(i);
+                }
+            }
+            if(static_cast<int>(resources.size()) >= maxResources){
+                ENGINE_LOG_ERROR(ENGINE, "SystemScheduler: too many resources, ignoring " << name);
+                return -1;
+            }
+            resources.push_back(name);
+            return static_cast<int>(resources.size()) - 1;
+        }
+
+        /**
+         * @brief Declares a system, it runs after the earlier declared systems it conflicts with.
+         *
+         * @param name Name in logs and in the graph.
+         * @param reads Resources it only reads.
+         * @param writes Resources it writes (and may read).
+         * @param work The system.
+         * @param thread Where it may run, any thread by default.
+         * @return Index of the system, -1 (logged) once `maxSystems` are declared.
+         */
+        int addSystem(const string& name, const vector<string>& reads, const vector<string>& writes, const function<void()>& work,
+                      SystemThread thread = SYSTEM_ANY_THREAD){
+            if(static_cast<int>(systems.size()) >= maxSystems){
+                ENGINE_LOG_ERROR(ENGINE, "SystemScheduler: too many systems, ignoring " << name);
+                return -1;
+            }
+            System system;
+            system.name = name;
+            system.reads = resourceSet(reads);
+            system.writes = resourceSet(writes);
+            system.work = work;
+            system.thread = thread;
+            systems.push_back(system);
+            dirty = true;
+            return static_cast<int>(systems.size()) - 1;
+        }
+
+        /**
+         * @brief Runs every system once, waiting for all of them.
+         *
+         * With a job system each system becomes a job depending on the jobs of the systems it waits for, main thread
+         * systems run on the calling thread in declaration order, which helps with the other jobs while it waits.
+         *
+         * @param jobs Job system to run on, NULL (default) runs the systems one after the other in declaration order.
+         */
+        void run(JobSystem* jobs = NULL){
+            if(dirty){
+                rebuild();
+            }
+            int count = static_cast<int>(systems.size());
+            if(jobs == NULL || jobs->getThreadCount() == 1){
+                for(int i = 0; i < count; i++){
+                    execute(i);
+                }
+                return;
+            }
+            JobSystem::Job* frame = jobs->create(nullptr);
+            handles.resize(count);
+            for(int i = 0; i < count; i++){
+                if(systems[i].thread == SYSTEM_MAIN_THREAD){
+                    handles[i] = jobs->create(nullptr, frame);
+                    continue;
+                }
+                handles[i] = jobs->create([this, i](){execute(i);}, frame);
+                for(int j = 0; j < i; j++){
+                    if(systems[i].after & (Uint64(1) << j)){
+                        jobs->addDependency(handles[i], handles[j]);
+                    }
+                }
+            }
+            for(int i = 0; i < count; i++){
+                if(systems[i].thread != SYSTEM_MAIN_THREAD){
+                    jobs->submit(handles[i]);
+                }
+            }
+            // A main thread system's job only stands for it in the graph, it is submitted empty once the system ran
+            for(int i = 0; i < count; i++){
+                if(systems[i].thread == SYSTEM_MAIN_THREAD){
+                    for(int j = 0; j < i; j++){
+                        if(systems[i].after & (Uint64(1) << j)){
+                            jobs->wait(handles[j]);
+                        }
+                    }
+                    execute(i);
+                    jobs->submit(handles[i]);
+                }
+            }
+            jobs->submit(frame);
+            jobs->wait(frame);
+        }
+
+        /** @brief Number of declared systems. */
+        int getCount() const {return static_cast<int>(systems.size());}
+
+        /** @brief Name of a system. */
+        const string& getName(int system) const {return systems[system].name;}
+
+        /** @brief Time the last `run()` spent in a system, in milliseconds. */
+        double getTime(int system) const {return systems[system].lastMs;}
+
+        /** @brief Systems a system waits for directly, one bit per system index. */
+        Uint64 getDependencies(int system){
+            if(dirty){
+                rebuild();
+            }
+            return systems[system].after;
+        }
+
+        /** @brief Number of waves the graph runs in: the longest dependency chain plus one. */
+        int getLevels(){
+            if(dirty){
+                rebuild();
+            }
+            return levels;
+        }
+
+        /**
+         * @brief The graph in Graphviz DOT format: a box per system with its resources, ranked by level, main thread
+         * systems filled, and an edge per dependency labeled with the resources it is about.
+         */
+        string toDot(){
+            if(dirty){
+                rebuild();
+            }
+            ostringstream dot;
+            dot << "digraph systems {\n    rankdir=LR;\n    node [shape=box, fontname=\"monospace\"];\n";
+            for(size_t i = 0; i < systems.size(); i++){
+                const System& system = systems[i];
+                dot << "    s" << i << " [label=\"" << system.name << "\\nreads: " << resourceNames(system.reads, ", ")
+                    << "\\nwrites: " << resourceNames(system.writes, ", ") << "\"" << (system.thread == SYSTEM_MAIN_THREAD ? ", style=filled" : "") << "];\n";
+            }
+            for(int level = 0; level < levels; level++){
+                dot << "    { rank=same;";
+                for(size_t i = 0; i < systems.size(); i++){
+                    if(systems[i].level == level){
+                        dot << " s" << i << ";";
+                    }
+                }
+                dot << " }\n";
+            }
+            for(size_t i = 0; i < systems.size(); i++){
+                for(size_t j = 0; j < i; j++){
+                    if(systems[i].after & (Uint64(1) << j)){
+                        dot << "    s" << j << " -> s" << i << " [label=\"" << resourceNames(conflicts(systems[j], systems[i]), ", ") << "\"];\n";
+                    }
+                }
+            }
+            dot << "}\n";
+            return dot.str();
+        }
+
+        /**
+         * @brief Writes `toDot()` to a file.
+         *
+         * @return `false` (logged) when the file can't be written.
+         */
+        bool writeDot(const string& path){
+            FILE* file = fopen(path.c_str(), "w");
+            if(file == NULL){
+                ENGINE_LOG_ERROR(ENGINE, "SystemScheduler: can't write " << path);
+                return false;
+            }
+            string dot = toDot();
+            fwrite(dot.data(), 1, dot.size(), file);
+            fclose(file);
+            return true;
+        }
+};
+
+/**
+ * @brief Priority of deferred work, see `DeferredWork`.
+ */
+enum WorkPriority {
+    WORK_HIGH, ///< Wanted as soon as possible, e.g. a texture upload for a sprite about to be drawn.
+    WORK_NORMAL, ///< Wanted within a few frames, e.g. finishing an asset decode or a pathfinding request.
+    WORK_LOW, ///< Whenever there is time left, e.g. cache cleanup.
+    WORK_PRIORITY_COUNT ///< Number of priorities.
+};
+
+/**
+ * @struct DeferredWorkStats
+ * @brief What a `DeferredWork` queue has done since it was created.
+ */
+struct DeferredWorkStats {
+    Uint64 tasks = 0; ///< Tasks run.
+    Uint64 frames = 0; ///< Calls to `run()`.
+    Uint64 overruns = 0; ///< Calls that took longer than their budget.
+    Uint64 forced = 0; ///< Tasks run past the budget because they had waited `maxWaitFrames`.
+    Uint64 maxWait = 0; ///< Most frames a task waited.
+    double maxOverrun = 0.0; ///< Largest time over the budget, in milliseconds.
+};
+
+/**
+ * @class DeferredWork
+ * @brief Queue of work that doesn't have to happen in the frame it comes up in, run a frame's spare time at a time.
+ *
+ * Tasks come with a priority and an estimate of what they cost. `run()` takes them highest priority first, first in
+ * first out within a priority, and stops at the first task the rest of the budget is predicted not to cover, so a burst
+ * of work is spread over the following frames instead of making one frame miss its deadline. Estimates are scaled by
+ * what the tasks of the same priority really took so far (a running average of actual over estimated cost), so a
+ * consistently wrong guess corrects itself.
+ *
+ * Nothing waits forever: a task that waited `maxWaitFrames` runs even over the budget (one such task per frame, so a
+ * backlog that aged all at once is still spread out), and when nothing ran yet in a frame with some budget the first
+ * task runs whatever its estimate, so a task that never fits a budget still gets done.
+ * Tasks may be queued from any thread, `run()` belongs to the main thread, where textures can be created. Tasks that
+ * reference an object are queued with it as their owner, so the object can drop them with `cancel()` when it goes away.
+ */
+class DeferredWork {
+    private:
+        /**
+         * @brief A queued task.
+         */
+        struct Task {
+            function<void()> work; ///< The task.
+            double estimate; ///< Predicted cost in milliseconds, as given.
+            Uint64 frame; ///< `frames` when it was queued.
+            const void* owner; ///< Object the task belongs to, for `cancel()`, NULL for none.
+        };
+
+        deque<Task> queues[WORK_PRIORITY_COUNT]; ///< Waiting tasks of each priority, oldest first.
+        double correction[WORK_PRIORITY_COUNT]; ///< Running average of actual over estimated cost of each priority.
+        SDL_mutex* lock = NULL; ///< Guards `queues`.
+        SDL_atomic_t pending; ///< Tasks waiting, read without the lock.
+        Uint64 frames = 0; ///< Calls to `run()`.
+        Uint32 maxWaitFrames; ///< Frames after which a task runs regardless of the budget.
+        DeferredWorkStats stats; ///< What was done so far.
+
+        /**
+         * @brief Takes the next task to run off the queues, NULL-work when none fits.
+         *
+         * @param remaining Milliseconds left of the budget.
+         * @param first `true` when nothing ran yet in this call.
+         * @param mayForce `true` when no task was forced yet in this call.
+         * @param task Receives the task.
+         * @param priority Receives its priority.
+         * @return `true` when a task was taken.
+         */
+        bool take(double remaining, bool first, bool mayForce, Task& task, int& priority){
+            SDL_LockMutex(lock);
+            bool found = false;
+            // A task that waited too long comes first, then the front task of the highest non-empty priority
+            for(int level = 0; level < WORK_PRIORITY_COUNT && mayForce && !found; level++){
+                if(!queues[level].empty() && frames - queues[level].front().frame >= maxWaitFrames){
+                    priority = level;
+                    found = true;
+                    stats.forced++;
+                }
+            }
+            for(int level = 0; level < WORK_PRIORITY_COUNT && !found; level++){
+                if(!queues[level].empty()){
+                    if((first && remaining > 0.0) || queues[level].front().estimate * correction[level] <= remaining){
+                        priority = level;
+                        found = true;
+                    }
+                    break;
+                }
+            }
+            if(found){
+                task = std::move(queues[priority].front());
+                queues[priority].pop_front();
+                SDL_AtomicAdd(&pending, -1);
+            }
+            SDL_UnlockMutex(lock);
+            return found;
+        }
+    public:
+        /**
+         * @param maxWaitFrames Frames a task may wait before it runs regardless of the budget, 30 by default.
+         */
+        DeferredWork(Uint32 maxWaitFrames = 30) : maxWaitFrames(maxWaitFrames){
+            lock = SDL_CreateMutex();
+            SDL_AtomicSet(&pending, 0);
+            for(double& factor : correction){
+                factor = 1.0;
+            }
+        }
+
+        DeferredWork(const DeferredWork&) = delete;
+        DeferredWork& operator=(const DeferredWork&) = delete;
+
+        /** @brief Drops the tasks that didn't run. */
+        ~DeferredWork(){
+            if(SDL_AtomicGet(&pending) > 0){
+                ENGINE_LOG_DEBUG(ENGINE, "DeferredWork: dropping " << SDL_AtomicGet(&pending) << " tasks");
+            }
+            SDL_DestroyMutex(lock);
+        }
+
+        /**
+         * @brief Queues a task, from any thread.
+         *
+         * @param work The task, run on the thread calling `run()`.
+         * @param priority Its priority.
+         * @param estimate What it is expected to cost in milliseconds.
+         * @param owner Object the task belongs to, see `cancel()`.
+         */
+        void add(const function<void()>& work, WorkPriority priority = WORK_NORMAL, double estimate = 0.1, const void* owner = NULL){
+            Task task = {work, max(0.0, estimate), 0, owner};
+            SDL_LockMutex(lock);
+            task.frame = frames;
+            queues[priority].push_back(std::move(task));
+            SDL_AtomicAdd(&pending, 1);
+            SDL_UnlockMutex(lock);
+        }
+
+        /**
+         * @brief Drops the waiting tasks of `owner`, e.g. from its destructor. A task already running is not affected.
+         * @return Number of tasks dropped.
+         */
+        int cancel(const void* owner){
+            int dropped = 0;
+            SDL_LockMutex(lock);
+            for(deque<Task>& queue : queues){
+                for(auto task = queue.begin(); task != queue.end();){
+                    if(task->owner == owner){
+                        task = queue.erase(task);
+                        dropped++;
+                    } else {
+                        ++task;
+                    }
+                }
+            }
+            SDL_AtomicAdd(&pending, -dropped);
+            SDL_UnlockMutex(lock);
+            return dropped;
+        }
+
+        /**
+         * @brief Runs tasks until the budget is used up or the queues are empty, called once per frame.
+         *
+         * @param budget Milliseconds the tasks may take in this frame.
+         * @return Number of tasks run.
+         */
+        int run(double budget){
+            frames++;
+            stats.frames++;
+            if(SDL_AtomicGet(&pending) == 0){
+                return 0;
+            }
+            Uint64 start = SDL_GetPerformanceCounter();
+            double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+            int ran = 0;
+            double elapsed = 0.0;
+            Task task;
+            int priority = 0;
+            Uint64 forcedBefore = stats.forced;
+            while(take(budget - elapsed, ran == 0, stats.forced == forcedBefore, task, priority)){
+                stats.maxWait = max(stats.maxWait, frames - 1 - task.frame);
+                Uint64 taskStart = SDL_GetPerformanceCounter();
+                task.work();
+                Uint64 now = SDL_GetPerformanceCounter();
+                if(task.estimate > 0.0){
+                    double ratio = (now - taskStart) * 1000.0 / frequency / task.estimate;
+                    correction[priority] = min(100.0, max(0.01, correction[priority] * 0.9 + ratio * 0.1));
+                }
+                elapsed = (now - start) * 1000.0 / frequency;
+                ran++;
+            }
+            stats.tasks += ran;
+            if(elapsed > budget){
+                stats.overruns++;
+                stats.maxOverrun = max(stats.maxOverrun, elapsed - budget);
+            }
+            return ran;
+        }
+
+        /** @brief Number of tasks waiting. */
+        int getPending(){
+            return SDL_AtomicGet(&pending);
+        }
+
+        /** @brief Factor the estimates of a priority are currently scaled by. */
+        double getCorrection(WorkPriority priority){
+            return correction[priority];
+        }
+
+        /** @brief What was done so far. */
+        DeferredWorkStats getStats(){
+            return stats;
+        }
+
+        /**
+         * @brief Logs the statistics, meant for the end of a run.
+         */
+        void logStats(){
+            ENGINE_LOG_INFO(ENGINE, fixed << setprecision(3) << "Deferred work: " << stats.tasks << " tasks over " << stats.frames << " frames, "
+                 << stats.overruns << " frames over budget (worst by " << stats.maxOverrun << " ms), " << stats.forced << " forced, longest wait "
+                 << stats.maxWait << " frames, " << getPending() << " pending");
+        }
+};
+
+/**
+ * @class InputState
+ * @brief Keyboard state gathered once per frame and mapped to actions, read by the fixed update steps.
+ *
+ * Keys are kept as bits indexed by scancode: held, pressed since the edges were last cleared and released since then.
+ * The state is fed either by the events (`handleEvent()`, which ignores key repeats and also catches a tap shorter
+ * than a frame) or by polling `SDL_GetKeyboardState()` (`sampleKeyboard()`). Actions name what the game cares about
+ * ("left", "attack"...) and are bound to any number of keys, so the simulation never looks at keys.
+ *
+ * The edges stay set until `clearEdges()`, called after the update step that consumed them: a frame without an
+ * update step keeps its taps for the next one and a frame with several steps only reports them to the first.
+ *
+ * @code
+ * InputState input;
+ * int jump = input.addAction("jump");
+ * input.bind(jump, SDL_SCANCODE_SPACE);
+ * // per frame: input.handleEvent(e) for every event, per step: if(input.wasPressed(jump)){...} then input.clearEdges()
+ * @endcode
+ */
+class InputState {
+    public:
+        static const int maxActions = 32; ///< Actions that can be defined.
+    private:
+        static const int keyWords = (SDL_NUM_SCANCODES + 63) / 64; ///< Words of a key bitset.
+
+        Uint64 held[keyWords]; ///< Keys down right now.
+        Uint64 pressed[keyWords]; ///< Keys that went down since `clearEdges()`.
+        Uint64 released[keyWords]; ///< Keys that went up since `clearEdges()`.
+        vector<string> actionNames; ///< Name of each action, its index is the action.
+        vector<vector<SDL_Scancode>> bindings; ///< Keys bound to each action.
+
+        static bool test(const Uint64* bits, SDL_Scancode key){
+            return (bits[key >> 6] >> (key & 63)) & 1;
+        }
+
+        /**
+         * @brief Tells if any key bound to `action` is set in `bits`.
+         */
+        bool any(const Uint64* bits, int action) const {
+            if(action < 0 || action >= static_cast<int>(bindings.size())){
+                return false;
+            }
+            for(SDL_Scancode key : bindings[action]){
+                if(test(bits, key)){
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Records that `key` went down or up.
+         */
+        void setKey(SDL_Scancode key, bool down){
+            if(key <= SDL_SCANCODE_UNKNOWN || key >= SDL_NUM_SCANCODES || test(held, key) == down){
+                return;
+            }
+            Uint64 bit = Uint64(1) << (key & 63);
+            if(down){
+                held[key >> 6] |= bit;
+                pressed[key >> 6] |= bit;
+            } else {
+                held[key >> 6] &= ~bit;
+                released[key >> 6] |= bit;
+            }
+        }
+    public:
+        InputState(){
+            reset();
+        }
+
+        /**
+         * @brief Forgets every key and edge, the actions and their bindings stay.
+         */
+        void reset(){
+            memset(held, 0, sizeof(held));
+            clearEdges();
+        }
+
+        /**
+         * @brief Defines an action, or finds it when it exists.
+         *
+         * @return Index of the action, -1 (logged) once `maxActions` are defined.
+         */
+        int addAction(const string& name){
+            int existing = findAction(name);
+            if(existing >= 0){
+                return existing;
+            }
+            if(static_cast<int>(actionNames.size()) >= maxActions){
+                ENGINE_LOG_ERROR(ENGINE, "InputState: too many actions, ignoring " << name);
+                return -1;
+            }
+            actionNames.push_back(name);
+            bindings.emplace_back();
+            return static_cast<int>(actionNames.size()) - 1;
+        }
+
+        /**
+         * @brief Index of the action `name`, -1 when it isn't defined.
+         */
+        int findAction(const string& name) const {
+            for(size_t i = 0; i < actionNames.size(); i++){
+                if(actionNames[i] == name){
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
+
+        /**
+         * @brief Name of an action.
+         */
+        const string& getActionName(int action) const {
+            return actionNames[action];
+        }
+
+        /**
+         * @brief Binds a key to an action, in addition to the keys bound already.
+         */
+        void bind(int action, SDL_Scancode key){
+            if(action >= 0 && action < static_cast<int>(bindings.size()) && find(bindings[action].begin(), bindings[action].end(), key) == bindings[action].end()){
+                bindings[action].push_back(key);
+            }
+        }
+
+        /**
+         * @brief Removes every key bound to an action, to bind it anew.
+         */
+        void unbind(int action){
+            if(action >= 0 && action < static_cast<int>(bindings.size())){
+                bindings[action].clear();
+            }
+        }
+
+        /**
+         * @brief Takes in an event: key presses (repeats ignored) and releases, and losing the keyboard focus, which releases every key.
+         */
+        void handleEvent(const SDL_Event& event){
+            if(event.type == SDL_KEYDOWN){
+                if(!event.key.repeat){
+                    setKey(event.key.keysym.scancode, true);
+                }
+            } else if(event.type == SDL_KEYUP){
+                setKey(event.key.keysym.scancode, false);
+            } else if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_FOCUS_LOST){
+                for(int key = 0; key < SDL_NUM_SCANCODES; key++){
+                    setKey(static_cast<SDL_Scancode>(key), false);
+                }
+            }
+        }
+
+        /**
+         * @brief Polls the keyboard state SDL keeps (up to date after the frame's `SDL_PollEvent()` loop) instead of
+         * taking the events, a tap within one frame is missed this way.
+         */
+        void sampleKeyboard(){
+            int count = 0;
+            const Uint8* keys = SDL_GetKeyboardState(&count);
+            for(int key = 1; key < min(count, static_cast<int>(SDL_NUM_SCANCODES)); key++){
+                setKey(static_cast<SDL_Scancode>(key), keys[key] != 0);
+            }
+        }
+
+        /**
+         * @brief Clears the pressed and released edges, after the update step that read them.
+         */
+        void clearEdges(){
+            memset(pressed, 0, sizeof(pressed));
+            memset(released, 0, sizeof(released));
+        }
+
+        /** @brief Tells if a key bound to `action` is held. */
+        bool isDown(int action) const {return any(held, action);}
+
+        /** @brief Tells if a key bound to `action` went down since the edges were cleared. */
+        bool wasPressed(int action) const {return any(pressed, action);}
+
+        /** @brief Tells if a key bound to `action` went up since the edges were cleared. */
+        bool wasReleased(int action) const {return any(released, action);}
+
+        /** @brief Tells if `key` is held, whatever it is bound to. */
+        bool isKeyDown(SDL_Scancode key) const {
+            return key > SDL_SCANCODE_UNKNOWN && key < SDL_NUM_SCANCODES && test(held, key);
+        }
+};
+
+/**
+ * @class InputRecording
+ * @brief Records the input events of a run keyed by simulation step into a compact binary file, and plays them back.
+ *
+ * Only what reaches an `InputState` is kept: key presses (without repeats), key releases and the loss of the keyboard
+ * focus. An event is stored with the index of the fixed update step that will consume it, so feeding the events back
+ * into an `InputState` before the same steps makes a fixed-step simulation go through exactly the same states, whatever
+ * the frame rate and timing of either run.
+ *
+ * File layout, little-endian: the magic `EINP`, a 16-bit version and the 16-bit step rate, then one record per event:
+ * the steps since the previous record as a varint, a type byte (0 press, 1 release, 2 focus lost, 3 end) and, for
+ * keys, the scancode as a varint. The end record carries the total number of steps. A typical key event takes 3 bytes.
+ */
+class InputRecording {
+    private:
+        /**
+         * @brief Record types of the file.
+         */
+        enum RecordType : Uint8 {
+            RECORD_KEY_DOWN,
+            RECORD_KEY_UP,
+            RECORD_FOCUS_LOST,
+            RECORD_END
+        };
+
+        /**
+         * @brief An event to replay.
+         */
+        struct Entry {
+            Uint64 step; ///< Step the event is consumed by.
+            RecordType type; ///< What happened.
+            SDL_Scancode key; ///< The key, for key events.
+        };
+
+        static const Uint16 version = 1; ///< Version written and accepted.
+
+        FILE* output = NULL; ///< File being recorded to, NULL when not recording.
+        Uint64 lastStep = 0; ///< Step of the previous record written.
+        vector<Entry> entries; ///< Loaded events, in step order.
+        size_t nextEntry = 0; ///< First entry not injected yet.
+        Uint64 length = 0; ///< Steps of the loaded recording.
+        int stepsPerSecond = 0; ///< Step rate the recording was made at.
+
+        void writeVarint(Uint64 value){
+            do {
+                Uint8 byte = value & 0x7F;
+                value >>= 7;
+                fputc(byte | (value != 0 ? 0x80 : 0), output);
+            } while(value != 0);
+        }
+
+        static bool readVarint(const Uint8*& at, const Uint8* end, Uint64& value){
+            value = 0;
+            for(int shift = 0; shift < 64 && at < end; shift += 7){
+                Uint8 byte = *at++;
+                value |= static_cast<Uint64>(byte & 0x7F) << shift;
+                if(!(byte & 0x80)){
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void writeRecord(Uint64 step, RecordType type, int key = 0){
+            writeVarint(step - lastStep);
+            fputc(type, output);
+            if(type == RECORD_KEY_DOWN || type == RECORD_KEY_UP){
+                writeVarint(static_cast<Uint64>(key));
+            }
+            lastStep = step;
+        }
+    public:
+        InputRecording() = default;
+        InputRecording(const InputRecording&) = delete;
+        InputRecording& operator=(const InputRecording&) = delete;
+
+        /** @brief Ends a recording left open, at the step of its last event. */
+        ~InputRecording(){
+            if(output != NULL){
+                stopRecording(lastStep);
+            }
+        }
+
+        /**
+         * @brief Starts recording to `path`, replacing the file.
+         *
+         * @param path File to write.
+         * @param stepsPerSecond Step rate of the simulation, stored for the replay to check.
+         * @return `false` (logged) when the file can't be created.
+         */
+        bool startRecording(const string& path, int stepsPerSecond){
+            output = fopen(path.c_str(), "wb");
+            if(output == NULL){
+                ENGINE_LOG_ERROR(ENGINE, "InputRecording: can't create " << path);
+                return false;
+            }
+            Uint8 header[8] = {'E', 'I', 'N', 'P', version & 0xFF, version >> 8,
+                               static_cast<Uint8>(stepsPerSecond & 0xFF), static_cast<Uint8>(stepsPerSecond >> 8)};
+            fwrite(header, 1, sizeof(header), output);
+            lastStep = 0;
+            return true;
+        }
+
+        /**
+         * @brief Records an event the simulation will see in step `step`, events an `InputState` ignores are skipped.
+         *
+         * @param step Index of the next update step, the number of steps done so far.
+         * @param event The event.
+         */
+        void record(Uint64 step, const SDL_Event& event){
+            if(output == NULL){
+                return;
+            }
+            if((event.type == SDL_KEYDOWN && !event.key.repeat) || event.type == SDL_KEYUP){
+                writeRecord(step, event.type == SDL_KEYDOWN ? RECORD_KEY_DOWN : RECORD_KEY_UP, event.key.keysym.scancode);
+            } else if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_FOCUS_LOST){
+                writeRecord(step, RECORD_FOCUS_LOST);
+            }
+        }
+
+        /**
+         * @brief Ends the recording, which replays for `steps` steps.
+         */
+        void stopRecording(Uint64 steps){
+            if(output == NULL){
+                return;
+            }
+            writeRecord(max(steps, lastStep), RECORD_END);
+            fclose(output);
+            output = NULL;
+        }
+
+        /** @brief Tells if a recording is being written. */
+        bool isRecording(){
+            return output != NULL;
+        }
+
+        /**
+         * @brief Loads a recording to replay.
+         *
+         * @return `false` (logged) when the file can't be read or isn't a complete recording.
+         */
+        bool load(const string& path){
+            size_t size = 0;
+            Uint8* data = static_cast<Uint8*>(SDL_LoadFile(path.c_str(), &size));
+            if(data == NULL){
+                ENGINE_LOG_ERROR(ENGINE, "InputRecording: can't read " << path << ": " << SDL_GetError());
+                return false;
+            }
+            entries.clear();
+            nextEntry = 0;
+            length = 0;
+            bool valid = size >= 8 && memcmp(data, "EINP", 4) == 0 && (data[4] | data[5] << 8) == version;
+            bool ended = false;
+            if(valid){
+                stepsPerSecond = data[6] | data[7] << 8;
+                const Uint8* at = data + 8;
+                const Uint8* end = data + size;
+                Uint64 step = 0;
+                while(valid && !ended && at < end){
+                    Uint64 delta = 0, key = 0;
+                    valid = readVarint(at, end, delta) && at < end;
+                    if(!valid){
+                        break;
+                    }
+                    step += delta;
+                    RecordType type = static_cast<RecordType>(*at++);
+                    if(type == RECORD_KEY_DOWN || type == RECORD_KEY_UP){
+                        valid = readVarint(at, end, key) && key < SDL_NUM_SCANCODES;
+                        entries.push_back({step, type, static_cast<SDL_Scancode>(key)});
+                    } else if(type == RECORD_FOCUS_LOST){
+                        entries.push_back({step, type, SDL_SCANCODE_UNKNOWN});
+                    } else if(type == RECORD_END){
+                        length = step;
+                        ended = true;
+                    } else {
+                        valid = false;
+                    }
+                }
+            }
+            SDL_free(data);
+            if(!valid || !ended){
+                ENGINE_LOG_ERROR(ENGINE, "InputRecording: " << path << " isn't a complete input recording");
+                entries.clear();
+                length = 0;
+                return false;
+            }
+            ENGINE_LOG_INFO(ENGINE, "InputRecording: " << entries.size() << " events over " << length << " steps at " << stepsPerSecond << " steps per second");
+            return true;
+        }
+
+        /**
+         * @brief Feeds `input` the events recorded for step `step`, called right before that step with increasing steps.
+         */
+        void inject(Uint64 step, InputState& input){
+            for(; nextEntry < entries.size() && entries[nextEntry].step <= step; nextEntry++){
+                const Entry& entry = entries[nextEntry];
+                SDL_Event event;
+                SDL_zero(event);
+                if(entry.type == RECORD_FOCUS_LOST){
+                    event.type = SDL_WINDOWEVENT;
+                    event.window.event = SDL_WINDOWEVENT_FOCUS_LOST;
+                } else {
+                    event.type = entry.type == RECORD_KEY_DOWN ? SDL_KEYDOWN : SDL_KEYUP;
+                    event.key.keysym.scancode = entry.key;
+                }
+                input.handleEvent(event);
+            }
+        }
+
+        /** @brief Steps of the loaded recording. */
+        Uint64 getLength(){
+            return length;
+        }
+
+        /** @brief Step rate the loaded recording was made at. */
+        int getStepsPerSecond(){
+            return stepsPerSecond;
+        }
+
+        /** @brief Number of loaded events. */
+        size_t getEventCount(){
+            return entries.size();
+        }
+};
+
+class Engine {
+    private:
+            SDL_Renderer* renderer = NULL;
+            SDL_Window* window = NULL;
+            bool headless; ///< `true` when rendering into `offscreenTarget` instead of a window.
+            bool vsync; ///< `true` when the renderer waits for the display's refresh on present.
+            int width; ///< Width of the window / offscreen target.
+            int height; ///< Height of the window / offscreen target.
+            SDL_Surface* offscreenTarget = NULL; ///< Surface the software renderer draws into in headless mode.
+            VideoRecorder* recorder = NULL; ///< Active recording, `NULL` when not recording.
+            vector<Uint8> captureScratch; ///< Pixels read back from a windowed renderer before they are queued for recording.
+            DeferredWork deferred; ///< Work spread over the spare time of the frames, see `defer()`.
+
+            /** engine-wide premultiplied-alpha switch, read by every BitmapObject when it loads. */
+            static bool& premultipliedAlpha(){
+                static bool enabled = false;
+                return enabled;
+            }
+    public:
+    /** engine constructor to init the SDL2 sub systems and window with renderer.
+      * Parameters taken : headless (render offscreen into a surface, no window), width and height of the output,
+      * vsync (ask the renderer to wait for the display's refresh on present, ignored headless). */
+        Engine(bool headless = false, int width = 800, int height = 600, bool vsync = false) : headless(headless), vsync(vsync), width(width), height(height){ 
+            if(!Init()){
+                ENGINE_LOG_ERROR(ENGINE, "Engine couldn't initialize!");
+                return;
+            }
+            ENGINE_LOG_INFO(ENGINE, "Engine Init was successful");
+        };
+
+         /** destructor which will call Destroy function on exit / engine termination. */
+        ~Engine(){
+            Destroy();
+        };
+
+        /** initialize SDL subsystems, create window and renderer and specify important flags / arguments. */
+        bool Init(){
+            /** offscreen backend: no video subsystem and no window, a software renderer draws into an ARGB8888 surface. */
+            if(headless){
+                if(SDL_InitSubSystem(SDL_INIT_EVENTS | SDL_INIT_TIMER) < 0){
+                    ENGINE_LOG_ERROR(ENGINE, "SDL_Init_events" << SDL_GetError());
+                    return false;
+                }
+                offscreenTarget = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+                if(offscreenTarget == NULL){ENGINE_LOG_ERROR(ENGINE, "SDL_CreateRGBSurfaceWithFormat" << SDL_GetError()); return false;}
+
+                renderer = SDL_CreateSoftwareRenderer(offscreenTarget);
+                if(renderer == NULL){ENGINE_LOG_ERROR(ENGINE, "SDL_CreateSoftwareRenderer" << SDL_GetError()); return false;}
+
+                vsync = false;
+                return true;
+            }
+
+            /** subsystems, in our case VIDEO subsystem is initialized. */
+            if(SDL_InitSubSystem(SDL_INIT_VIDEO) < 0){
+                ENGINE_LOG_ERROR(ENGINE, "SDL_Init_video" << SDL_GetError());
+                return false;
+            }
+
+            /** window creation with SDL_CreateWindow and SDL_Window* window pointer declared before.
+              * Parameters taken : specified height and width of the window, positioning of the window. */
+            window = SDL_CreateWindow("window", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_ALLOW_HIGHDPI);
+
+            if(window == NULL){ENGINE_LOG_ERROR(ENGINE, "SDL_CreateWindow" << SDL_GetError()); return false;}
+
+            /** renderer creation with SDL_CreateRenderer and SDL_Renderer* renderer pointer declated before. 
+              * Parameters taken : SDL_Window* window, SDL_RENDERER_PRESENTVSYNC when vsync was asked for. */
+            renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+            
+            if(renderer == NULL){ENGINE_LOG_ERROR(ENGINE, "SDL_CreateRenderer" << SDL_GetError()); return false;}
+
+            /** the driver may not grant vsync, keep what it actually does. */
+            SDL_RendererInfo info;
+            vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+            return true;
+        };
+
+        /* destroys window, renderer and quits SDL, IMG(or any added lib's). 
+         * Parameters taken : SDL_Renderer* renderer, SDL_Window* window. */
+        void Destroy(){  
+            stopRecording();
+            if(renderer){SDL_DestroyRenderer(renderer);}
+            if(window){SDL_DestroyWindow(window);}
+            if(offscreenTarget){SDL_FreeSurface(offscreenTarget);}
+            renderer = NULL;
+            window = NULL;
+            offscreenTarget = NULL;
+            IMG_Quit();
+            SDL_Quit();
+        }
+
+        /** starts recording every presented frame into a Y4M file, or into a process when the target starts with '|'.
+          * Parameters taken : target path / command, frame rate written into the stream header. */
+        bool startRecording(const string& target, int fps = 60){
+            if(renderer == NULL || recorder != NULL){
+                return false;
+            }
+            int outputWidth = width, outputHeight = height;
+            if(!headless){
+                SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+            }
+            recorder = new VideoRecorder();
+            if(!recorder->start(target, outputWidth, outputHeight, fps)){
+                delete recorder;
+                recorder = NULL;
+                return false;
+            }
+            return true;
+        }
+
+        /** finishes writing every queued frame and prints the back-pressure statistics of the recording. */
+        void stopRecording(){
+            if(recorder == NULL){
+                return;
+            }
+            recorder->stop();
+            RecordingStats stats = recorder->getStats();
+            ENGINE_LOG_INFO(RECORDING, "Recording finished: " << stats.framesWritten << "/" << stats.framesSubmitted << " frames, "
+                 << stats.bytesWritten << " bytes, peak queue " << stats.peakQueueDepth << ", buffers " << stats.buffersAllocated
+                 << ", writer busy " << stats.writerBusyMs << " ms");
+            delete recorder;
+            recorder = NULL;
+        }
+
+        /** queues the current frame for the recorder, directly from the offscreen target or read back from the window. */
+        void captureFrame(){
+            if(recorder == NULL){
+                return;
+            }
+            if(offscreenTarget != NULL){
+                if(SDL_MUSTLOCK(offscreenTarget)){SDL_LockSurface(offscreenTarget);}
+                recorder->submitFrame(offscreenTarget->pixels, offscreenTarget->pitch);
+                if(SDL_MUSTLOCK(offscreenTarget)){SDL_UnlockSurface(offscreenTarget);}
+                return;
+            }
+            int outputWidth, outputHeight;
+            SDL_GetRendererOutputSize(renderer, &outputWidth, &outputHeight);
+            captureScratch.resize(static_cast<size_t>(outputWidth) * outputHeight * 4);
+            if(SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, captureScratch.data(), outputWidth * 4) == 0){
+                recorder->submitFrame(captureScratch.data(), outputWidth * 4);
+            }
+        }
+
+        /** presents the frame, capturing it first when a recording is running (the back buffer is undefined after present). */
+        void present(){
+            captureFrame();
+            SDL_RenderPresent(renderer);
+        }
+
+        /** premultiplied-alpha mode for every asset loaded afterwards: BitmapObject converts its pixels at load and draws them
+          * with the premultiplied blend mode, CPU blits use BLIT_PREMULTIPLIED. Fails (and stays off) when the renderer can't
+          * do custom blend modes, e.g. the software renderer of the headless backend: there the mode is not available at all
+          * and assets stay straight alpha, only explicit BLIT_PREMULTIPLIED CPU blits of premultiplied bitmaps still work.
+          * Parameters taken : enabled. */
+        bool setPremultipliedAlpha(bool enabled){
+            if(enabled && renderer != NULL){
+                SDL_Texture* probe = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 1, 1);
+                bool supported = probe != NULL && SDL_SetTextureBlendMode(probe, getPremultipliedBlendMode()) == 0;
+                if(probe){SDL_DestroyTexture(probe);}
+                if(!supported){
+                    premultipliedAlpha() = false;
+                    return false;
+                }
+            }
+            premultipliedAlpha() = enabled;
+            return true;
+        }
+
+        /** true while the premultiplied-alpha mode is on. */
+        static bool usesPremultipliedAlpha(){return premultipliedAlpha();};
+
+        /** "over" for premultiplied colors: dst = src + dst * (1 - srcAlpha), for color and alpha alike. */
+        static SDL_BlendMode getPremultipliedBlendMode(){
+            return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                                              SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+        }
+
+        /*getter method for 'renderer'. */
+        SDL_Renderer* getRenderer(){ return renderer;};
+        /*getter method for 'window'. */
+        SDL_Window* getWindow(){return window;};
+        /*getter method for the offscreen target, NULL unless headless. */
+        SDL_Surface* getOffscreenTarget(){return offscreenTarget;};
+        /*true when the engine renders offscreen. */
+        bool isHeadless(){return headless;};
+        /** @brief `true` when present waits for the display's refresh. */
+        bool usesVsync(){return vsync;};
+        /** @brief Width of the window / offscreen target. */
+        int getWidth(){return width;};
+        /** @brief Height of the window / offscreen target. */
+        int getHeight(){return height;};
+        /*getter method for the active recorder, NULL when not recording. */
+        VideoRecorder* getRecorder(){return recorder;};
+
+        /**
+         * @brief Queues work that may wait for a frame with time to spare (texture uploads, finishing asset decodes,
+         * cache cleanup...), from any thread. It runs on the main thread in `runDeferredWork()`.
+         *
+         * @param work The work.
+         * @param priority Its priority, see `WorkPriority`.
+         * @param estimate What it is expected to cost in milliseconds.
+         * @param owner Object the work belongs to, it drops what didn't run yet with `cancelDeferred()` when it is destroyed.
+         */
+        void defer(const function<void()>& work, WorkPriority priority = WORK_NORMAL, double estimate = 0.1, const void* owner = NULL){
+            deferred.add(work, priority, estimate, owner);
+        }
+
+        /** @brief Drops the deferred work of `owner` that didn't run yet. */
+        void cancelDeferred(const void* owner){
+            deferred.cancel(owner);
+        }
+
+        /**
+         * @brief Runs deferred work for at most about `budget` milliseconds, once per frame after presenting.
+         * @return Number of tasks run.
+         */
+        int runDeferredWork(double budget){
+            return deferred.run(budget);
+        }
+
+        /** @brief The deferred work queue, for its statistics. */
+        DeferredWork& getDeferredWork(){return deferred;};
+};
+
+
+/**
+ * @brief How a `FramePacer` waits for the next frame.
+ */
+enum PacingMode {
+    PACE_SLEEP, ///< `SDL_Delay()` in whole milliseconds only, cheap on the CPU but off by up to a millisecond or two.
+    PACE_HYBRID ///< Sleeps while the sleeps are sure to wake up early enough, then spins on the performance counter.
+};
+
+/**
+ * @struct PacingStats
+ * @brief Frame interval statistics of a `FramePacer`, in milliseconds.
+ *
+ * The pacing error of a frame is how far its interval was from the target interval, either way.
+ * The percentiles come from a histogram with 10 us bins, the maximum is exact.
+ */
+struct PacingStats {
+    Uint64 frames = 0; ///< Intervals measured.
+    double targetInterval = 0.0; ///< Interval the pacer aims for, 0 when it doesn't wait.
+    double meanInterval = 0.0; ///< Average interval.
+    double p50Error = 0.0; ///< Median pacing error.
+    double p99Error = 0.0; ///< 99th percentile pacing error.
+    double maxError = 0.0; ///< Largest pacing error.
+};
+
+/**
+ * @class FramePacer
+ * @brief Waits for the deadline of each frame and keeps a histogram of the frame intervals.
+ *
+ * `SDL_Delay()` only has millisecond resolution and often oversleeps by one or two, so in `PACE_HYBRID` the pacer
+ * sleeps a millisecond at a time while the time left exceeds what such a sleep has really taken (the running mean
+ * plus one standard deviation of the measured sleeps) and spins on the performance counter for the rest.
+ * Deadlines follow each other by exactly one interval, a frame that misses its deadline by more than a whole interval
+ * starts a new sequence instead of rushing the following ones.
+ * With vsync the presentation already blocks, the pacer then only measures.
+ */
+class FramePacer {
+    private:
+        static const int histogramBins = 10000; ///< Bins of the interval histogram, the last one also holds longer intervals.
+        static const int binMicroseconds = 10; ///< Width of a histogram bin.
+
+        Uint64 frequency; ///< Ticks of the performance counter per second.
+        Uint64 frameTicks = 0; ///< Target interval in counter ticks, 0 doesn't wait.
+        PacingMode mode; ///< How to wait.
+        bool vsync = false; ///< `true` when the presentation waits for the display, the pacer then doesn't.
+        Uint64 nextFrame = 0; ///< Deadline of the next frame.
+        Uint64 lastFrame = 0; ///< Counter value at the end of the previous `wait()`, 0 before the first.
+
+        double sleepMean = 0.0; ///< Running mean of the measured `SDL_Delay(1)` lengths in seconds.
+        double sleepM2 = 0.0; ///< Running sum of squared deviations of the measured sleeps.
+        Uint64 sleepCount = 0; ///< Sleeps in the estimate, capped so the estimate keeps adapting.
+
+        vector<Uint32> histogram; ///< Frame intervals in `binMicroseconds` bins.
+        Uint64 intervalCount = 0; ///< Intervals recorded.
+        double intervalSum = 0.0; ///< Sum of the recorded intervals in seconds.
+        double maxError = 0.0; ///< Largest pacing error in seconds.
+
+        /**
+         * @brief Adds a measured `SDL_Delay(1)` to the sleep estimate (Welford's running variance).
+         */
+        void addSleep(double seconds){
+            if(sleepCount < 1000){
+                sleepCount++;
+            }
+            double delta = seconds - sleepMean;
+            sleepMean += delta / sleepCount;
+            sleepM2 += delta * (seconds - sleepMean);
+            if(sleepCount == 1000){
+                sleepM2 *= 999.0 / 1000.0;
+            }
+        }
+
+        /**
+         * @brief Length a millisecond sleep has to be expected to take, in seconds.
+         */
+        double expectedSleep(){
+            if(sleepCount < 2){
+                return 0.002;
+            }
+            return sleepMean + sqrt(sleepM2 / (sleepCount - 1));
+        }
+
+        /**
+         * @brief Waits until the counter reaches `deadline`.
+         */
+        void waitUntil(Uint64 deadline){
+            Uint64 now = SDL_GetPerformanceCounter();
+            if(mode == PACE_SLEEP){
+                if(now < deadline){
+                    Uint32 milliseconds = static_cast<Uint32>((deadline - now) * 1000 / frequency);
+                    if(milliseconds > 0){
+                        SDL_Delay(milliseconds);
+                    }
+                }
+                return;
+            }
+            while(now < deadline && static_cast<double>(deadline - now) / frequency > expectedSleep()){
+                SDL_Delay(1);
+                Uint64 woke = SDL_GetPerformanceCounter();
+                addSleep(static_cast<double>(woke - now) / frequency);
+                now = woke;
+            }
+            while(now < deadline){
+#ifdef ENGINE_SSE2
+                _mm_pause();
+#endif
+                now = SDL_GetPerformanceCounter();
+            }
+        }
+
+        /**
+         * @brief Adds a frame interval of `ticks` to the statistics.
+         */
+        void record(Uint64 ticks){
+            double seconds = static_cast<double>(ticks) / frequency;
+            Uint64 bin = static_cast<Uint64>(seconds * 1e6) / binMicroseconds;
+            histogram[bin < static_cast<Uint64>(histogramBins) ? bin : histogramBins - 1]++;
+            intervalCount++;
+            intervalSum += seconds;
+            if(frameTicks > 0){
+                maxError = max(maxError, fabs(seconds - static_cast<double>(frameTicks) / frequency));
+            }
+        }
+    public:
+        /**
+         * @brief Constructor for the `FramePacer` class.
+         *
+         * @param framesPerSecond Target frame rate, 0 doesn't wait and only measures.
+         * @param mode How to wait, `PACE_HYBRID` (default) or `PACE_SLEEP`.
+         */
+        FramePacer(double framesPerSecond = 60.0, PacingMode mode = PACE_HYBRID)
+            : frequency(SDL_GetPerformanceFrequency()), mode(mode), histogram(histogramBins, 0){
+            setTargetRate(framesPerSecond);
+        }
+
+        /**
+         * @brief Changes the target frame rate, the statistics start over since they are relative to it.
+         *
+         * @param framesPerSecond Target frame rate, 0 doesn't wait and only measures.
+         */
+        void setTargetRate(double framesPerSecond){
+            frameTicks = framesPerSecond > 0.0 ? static_cast<Uint64>(frequency / framesPerSecond + 0.5) : 0;
+            lastFrame = 0;
+            resetStats();
+        }
+
+        /**
+         * @brief Gets the target frame rate, 0 when the pacer doesn't wait.
+         */
+        double getTargetRate(){
+            return frameTicks > 0 ? static_cast<double>(frequency) / frameTicks : 0.0;
+        }
+
+        /**
+         * @brief Tells the pacer the presentation waits for the display, so it only measures.
+         */
+        void setVsync(bool enabled){
+            vsync = enabled;
+        }
+
+        /**
+         * @brief Tells if the presentation waits for the display.
+         * @return `vsync`.
+         */
+        bool usesVsync(){
+            return vsync;
+        }
+
+        /**
+         * @brief Sets how the pacer waits.
+         */
+        void setMode(PacingMode mode){
+            this->mode = mode;
+        }
+
+        /**
+         * @brief Waits for the deadline of the next frame and records the interval since the previous call.
+         *
+         * The first call only starts the sequence.
+         */
+        void wait(){
+            if(lastFrame == 0){
+                lastFrame = SDL_GetPerformanceCounter();
+                nextFrame = lastFrame + frameTicks;
+                return;
+            }
+            if(frameTicks > 0 && !vsync){
+                waitUntil(nextFrame);
+            }
+            Uint64 now = SDL_GetPerformanceCounter();
+            record(now - lastFrame);
+            lastFrame = now;
+            nextFrame = now > nextFrame + frameTicks ? now + frameTicks : nextFrame + frameTicks;
+        }
+
+        /**
+         * @brief Time left until the deadline of the next frame, what the frame can still spend without being late.
+         *
+         * @return Milliseconds, 0 once the deadline passed, -1 without a deadline (not pacing, vsync or before the first frame).
+         */
+        double getTimeLeft(){
+            if(frameTicks == 0 || vsync || lastFrame == 0){
+                return -1.0;
+            }
+            Uint64 now = SDL_GetPerformanceCounter();
+            return now >= nextFrame ? 0.0 : static_cast<double>(nextFrame - now) * 1000.0 / frequency;
+        }
+
+        /**
+         * @brief Clears the interval statistics.
+         */
+        void resetStats(){
+            fill(histogram.begin(), histogram.end(), 0);
+            intervalCount = 0;
+            intervalSum = 0.0;
+            maxError = 0.0;
+        }
+
+        /**
+         * @brief Computes the statistics of the intervals recorded so far.
+         */
+        PacingStats getStats(){
+            PacingStats stats;
+            stats.frames = intervalCount;
+            if(intervalCount == 0){
+                return stats;
+            }
+            double target = frameTicks > 0 ? static_cast<double>(frameTicks) / frequency * 1000.0 : 0.0;
+            stats.targetInterval = target;
+            stats.meanInterval = intervalSum / intervalCount * 1000.0;
+            stats.maxError = maxError * 1000.0;
+            if(target <= 0.0){
+                return stats;
+            }
+            vector<pair<double, Uint32>> errors;
+            for(int bin = 0; bin < histogramBins; bin++){
+                if(histogram[bin] > 0){
+                    errors.push_back({fabs((bin + 0.5) * binMicroseconds / 1000.0 - target), histogram[bin]});
+                }
+            }
+            sort(errors.begin(), errors.end());
+            Uint64 p50Rank = (intervalCount + 1) / 2, p99Rank = (intervalCount * 99 + 99) / 100, seen = 0;
+            for(const pair<double, Uint32>& error : errors){
+                Uint64 before = seen;
+                seen += error.second;
+                if(before < p50Rank && seen >= p50Rank){
+                    stats.p50Error = error.first;
+                }
+                if(before < p99Rank && seen >= p99Rank){
+                    stats.p99Error = error.first;
+                }
+            }
+            return stats;
+        }
+
+        /**
+         * @brief Gets the interval histogram, bin `i` counts intervals in [i, i + 1) x `getBinMicroseconds()`.
+         */
+        const vector<Uint32>& getHistogram(){
+            return histogram;
+        }
+
+        /**
+         * @brief Gets the width of a histogram bin in microseconds.
+         */
+        static int getBinMicroseconds(){
+            return binMicroseconds;
+        }
+
+        /**
+         * @brief Logs the statistics so far.
+         */
+        void logStats(){
+            PacingStats stats = getStats();
+            ENGINE_LOG_INFO(ENGINE, fixed << setprecision(3) << "Frame pacing over " << stats.frames << " frames: target " << stats.targetInterval
+                 << " ms, mean " << stats.meanInterval << " ms, error p50 " << stats.p50Error << " ms, p99 " << stats.p99Error << " ms, max " << stats.maxError << " ms"
+                 << (vsync ? " (vsync)" : ""));
+        }
+};
+
+/**
+ * @class GameLoop
+ * @brief Fixed timestep loop: the simulation advances in equal steps, rendering happens once per frame in between.
+ *
+ * Time is measured with `SDL_GetPerformanceCounter()` and added to an accumulator every frame, which is spent on as many
+ * steps as fit. At most `maxCatchUpSteps` run per frame, a backlog beyond that (a breakpoint, a stalled window) is dropped
+ * instead of making the next frames slower still. What is left in the accumulator gives the interpolation factor
+ * passed to the render callback, the fraction of a step the real time is ahead of the latest simulated state,
+ * so drawing between the previous and the latest state keeps motion smooth when frame and step rate differ.
+ * Frames are paced by a `FramePacer`, which also measures how evenly they come.
+ */
+class GameLoop {
+    private:
+        Uint64 frequency; ///< Ticks of the performance counter per second.
+        Uint64 stepTicks; ///< Length of a simulation step in counter ticks.
+        FramePacer pacer; ///< Waits for the end of each frame.
+        int maxCatchUpSteps; ///< Most steps run in one frame.
+        double stepSeconds; ///< Length of a simulation step in seconds, passed to the update callback.
+        bool running = false; ///< Cleared by `stop()`.
+        double alpha = 0.0; ///< Interpolation factor of the latest frame.
+        Uint64 stepCount = 0; ///< Steps simulated so far.
+        Uint64 frameCount = 0; ///< Frames rendered so far.
+        Uint64 droppedSteps = 0; ///< Steps dropped because the backlog exceeded `maxCatchUpSteps`.
+    public:
+        /**
+         * @brief Constructor for the `GameLoop` class.
+         *
+         * @param updatesPerSecond Simulation steps per second.
+         * @param framesPerSecond Frames rendered per second at most, 0 doesn't limit them.
+         * @param maxCatchUpSteps Most steps run in one frame before the rest of the backlog is dropped.
+         */
+        GameLoop(double updatesPerSecond = 60.0, double framesPerSecond = 60.0, int maxCatchUpSteps = 5)
+            : frequency(SDL_GetPerformanceFrequency()), pacer(framesPerSecond), maxCatchUpSteps(maxCatchUpSteps > 0 ? maxCatchUpSteps : 1){
+            stepTicks = max<Uint64>(1, static_cast<Uint64>(frequency / updatesPerSecond + 0.5));
+            stepSeconds = static_cast<double>(stepTicks) / frequency;
+        }
+
+        /**
+         * @brief Runs the loop until `stop()` is called.
+         *
+         * Every frame calls `input`, then `update` once per due step and `render` once, then waits for the frame's deadline.
+         *
+         * @param input Handles the events of the frame, may be empty.
+         * @param update Advances the simulation by one step, gets the step length in seconds.
+         * @param render Draws the frame, gets the interpolation factor in [0, 1) between the previous and the latest state.
+         */
+        void run(const function<void()>& input, const function<void(double)>& update, const function<void(double)>& render){
+            running = true;
+            Uint64 previous = SDL_GetPerformanceCounter();
+            Uint64 accumulator = 0;
+            pacer.wait();
+            while(running){
+                Uint64 now = SDL_GetPerformanceCounter();
+                accumulator += now - previous;
+                previous = now;
+                if(input){
+                    input();
+                }
+                int steps = 0;
+                while(running && accumulator >= stepTicks && steps < maxCatchUpSteps){
+                    update(stepSeconds);
+                    accumulator -= stepTicks;
+                    stepCount++;
+                    steps++;
+                }
+                if(accumulator >= stepTicks){
+                    droppedSteps += accumulator / stepTicks;
+                    accumulator %= stepTicks;
+                }
+                if(!running){
+                    break;
+                }
+                alpha = static_cast<double>(accumulator) / stepTicks;
+                render(alpha);
+                frameCount++;
+                pacer.wait();
+            }
+        }
+
+        /**
+         * @brief Ends `run()` after the callback that called it returns.
+         */
+        void stop(){
+            running = false;
+        }
+
+        /**
+         * @brief Gets the pacer of the frames, to change the frame rate, enable vsync or read the statistics.
+         * @return `pacer`.
+         */
+        FramePacer& getPacer(){
+            return pacer;
+        }
+
+        /**
+         * @brief Blends a value from the previous to the latest step, for drawing at the interpolation factor `alpha`.
+         */
+        static int interpolate(int previous, int current, double alpha){
+            return previous + static_cast<int>(lround((current - previous) * alpha));
+        }
+
+        /**
+         * @brief Gets the length of a simulation step in seconds.
+         * @return `stepSeconds`.
+         */
+        double getStepSeconds(){
+            return stepSeconds;
+        }
+
+        /**
+         * @brief Gets the interpolation factor of the latest frame.
+         * @return `alpha`.
+         */
+        double getAlpha(){
+            return alpha;
+        }
+
+        /**
+         * @brief Gets the number of steps simulated so far.
+         * @return `stepCount`.
+         */
+        Uint64 getStepCount(){
+            return stepCount;
+        }
+
+        /**
+         * @brief Gets the number of frames rendered so far.
+         * @return `frameCount`.
+         */
+        Uint64 getFrameCount(){
+            return frameCount;
+        }
+
+        /**
+         * @brief Gets the number of steps dropped because too many were due in one frame.
+         * @return `droppedSteps`.
+         */
+        Uint64 getDroppedSteps(){
+            return droppedSteps;
+        }
+};
+
+/**
+ * @class TripleBuffer
+ * @brief Hands the latest of a stream of values from one writer thread to one reader thread without locks.
+ *
+ * Of the three slots the writer fills one, the reader holds one and the third is the latest published value.
+ * Publishing swaps the filled slot with the middle one and marks it fresh, acquiring swaps the reader's slot with
+ * the middle one when it is fresh, both with a single atomic exchange. Neither side ever waits for the other,
+ * the writer may publish faster than the reader acquires, values in between are simply overwritten.
+ * The slots are reused, so a value type that keeps its capacity stops allocating once it has grown.
+ */
+template<typename T>
+class TripleBuffer {
+    private:
+        static const int freshFlag = 4; ///< Set in `middle` when it holds a value the reader hasn't taken.
+        static const int indexMask = 3; ///< Slot index bits of `middle`.
+
+        T slots[3]; ///< The three values.
+        int back = 0; ///< Slot the writer fills, only touched by the writer.
+        int front = 1; ///< Slot the reader holds, only touched by the reader.
+        SDL_atomic_t middle; ///< Slot between them, with `freshFlag`.
+    public:
+        TripleBuffer(){
+            SDL_AtomicSet(&middle, 2);
+        }
+
+        /**
+         * @brief Slot the writer fills before `publish()`, writer thread only.
+         */
+        T& writeSlot(){
+            return slots[back];
+        }
+
+        /**
+         * @brief Makes the filled slot the latest value and starts on another one, writer thread only.
+         */
+        void publish(){
+            SDL_MemoryBarrierRelease();
+            back = SDL_AtomicSet(&middle, back | freshFlag) & indexMask;
+        }
+
+        /**
+         * @brief Takes the latest value if one was published since the previous call, reader thread only.
+         * @return `true` when `readSlot()` changed.
+         */
+        bool acquire(){
+            if((SDL_AtomicGet(&middle) & freshFlag) == 0){
+                return false;
+            }
+            front = SDL_AtomicSet(&middle, front) & indexMask;
+            SDL_MemoryBarrierAcquire();
+            return true;
+        }
+
+        /**
+         * @brief Value the reader holds, reader thread only.
+         */
+        const T& readSlot() const {
+            return slots[front];
+        }
+};
+
+/**
+ * @class SpscQueue
+ * @brief Bounded lock-free queue from one producer thread to one consumer thread.
+ *
+ * A ring whose capacity is rounded up to a power of two, the producer only moves the tail and the consumer only
+ * the head, so each side reads the other's position and writes its own.
+ */
+template<typename T>
+class SpscQueue {
+    private:
+        vector<T> items; ///< The ring.
+        int mask; ///< Capacity minus one.
+        SDL_atomic_t head; ///< Next item to pop, written by the consumer.
+        SDL_atomic_t tail; ///< Next slot to push into, written by the producer.
+    public:
+        /**
+         * @brief Constructor for the `SpscQueue` class.
+         *
+         * @param capacity Most items queued at once, rounded up to a power of two.
+         */
+        SpscQueue(int capacity = 256){
+            int size = 1;
+            while(size < capacity){
+                size <<= 1;
+            }
+            items.resize(size);
+            mask = size - 1;
+            SDL_AtomicSet(&head, 0);
+            SDL_AtomicSet(&tail, 0);
+        }
+
+        /**
+         * @brief Queues a copy of `item`, producer thread only.
+         * @return `false` when the queue is full.
+         */
+        bool push(const T& item){
+            int position = SDL_AtomicGet(&tail);
+            if(position - SDL_AtomicGet(&head) > mask){
+                return false;
+            }
+            items[position & mask] = item;
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicSet(&tail, position + 1);
+            return true;
+        }
+
+        /**
+         * @brief Takes the oldest item, consumer thread only.
+         * @return `false` when the queue is empty.
+         */
+        bool pop(T& item){
+            int position = SDL_AtomicGet(&head);
+            if(position == SDL_AtomicGet(&tail)){
+                return false;
+            }
+            SDL_MemoryBarrierAcquire();
+            item = items[position & mask];
+            SDL_AtomicSet(&head, position + 1);
+            return true;
+        }
+};
+
+/**
+ * @brief Compositing modes of `BitmapManager::copyTo()` with rectangles.
+ *
+ * Every mode works on 32-bit surfaces with alpha in the top byte (ARGB8888 / ABGR8888),
+ * the global alpha of the call modulates the per-pixel alpha in `BLIT_ALPHA` and `BLIT_ADDITIVE`.
+ */
+enum BlitMode {
+    BLIT_COPY, ///< source replaces destination.
+    BLIT_ALPHA, ///< straight alpha "over": `dst = src * a + dst * (1 - a)`.
+    BLIT_ADDITIVE, ///< `dst = min(1, dst + src * a)`, destination alpha is kept.
+    BLIT_COLORKEY, ///< source pixels whose color equals the key are skipped, the rest are copied.
+    BLIT_PREMULTIPLIED ///< premultiplied "over": `dst = src * g + dst * (1 - srcA * g)`, one multiply per channel at full global alpha.
+};
+
+/**
+ * @brief Exact `x / 255` rounded to nearest for `x` in [0, 255 * 255], the same formula is used by every kernel.
+ */
+static inline Uint32 divideBy255(Uint32 x){
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * @brief Straight alpha "over" of one pixel with alpha `a`, two channels at a time with the same rounding as `divideBy255()`.
+ *
+ * The source alpha byte is treated as 255, so the result alpha is `a + dstA * (255 - a) / 255`.
+ */
+static inline Uint32 blendOverPixel(Uint32 s, Uint32 d, Uint32 a){
+    Uint32 inv = 255 - a;
+    Uint32 rb = (s & 0x00FF00FF) * a + (d & 0x00FF00FF) * inv + 0x00800080;
+    Uint32 ag = (((s >> 8) & 0xFF) | 0x00FF0000) * a + ((d >> 8) & 0x00FF00FF) * inv + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    ag = ((ag + ((ag >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    return rb | (ag << 8);
+}
+
+/**
+ * @brief Premultiplied "over" of one pixel: `s + d * (255 - sA) / 255` per channel with a saturating add,
+ * so additive pixels (color above alpha) clamp instead of wrapping.
+ */
+static inline Uint32 blendPremultipliedPixel(Uint32 s, Uint32 d){
+    Uint32 inv = 255 - (s >> 24);
+    Uint32 rb = (d & 0x00FF00FF) * inv + 0x00800080;
+    Uint32 ag = ((d >> 8) & 0x00FF00FF) * inv + 0x00800080;
+    rb = (((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF) + (s & 0x00FF00FF);
+    ag = (((ag + ((ag >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF) + ((s >> 8) & 0x00FF00FF);
+    Uint32 overflowRB = rb & 0x01000100, overflowAG = ag & 0x01000100;
+    rb = (rb | (overflowRB - (overflowRB >> 8))) & 0x00FF00FF;
+    ag = (ag | (overflowAG - (overflowAG >> 8))) & 0x00FF00FF;
+    return rb | (ag << 8);
+}
+
+/** @brief Every channel of a pixel times `alpha` / 255, rounded like `divideBy255()`. */
+static inline Uint32 scalePixel(Uint32 s, Uint32 alpha){
+    Uint32 rb = (s & 0x00FF00FF) * alpha + 0x00800080;
+    Uint32 ag = ((s >> 8) & 0x00FF00FF) * alpha + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    ag = ((ag + ((ag >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    return rb | (ag << 8);
+}
+
+typedef void (*BlitRowFn)(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey);
+
+/**
+ * @struct BlitKernels
+ * @brief One implementation (scalar, SSE2 or AVX2) of every row kernel, picked once at runtime.
+ */
+struct BlitKernels {
+    const char* name; ///< Name printed by the benchmark.
+    BlitRowFn alpha; ///< `BLIT_ALPHA` row kernel.
+    BlitRowFn additive; ///< `BLIT_ADDITIVE` row kernel.
+    BlitRowFn colorKey; ///< `BLIT_COLORKEY` row kernel.
+    BlitRowFn premultiplied; ///< `BLIT_PREMULTIPLIED` row kernel.
+};
+
+/** @brief Scalar reference of the `BLIT_ALPHA` row, the SIMD kernels are bit exact with it. */
+static void blitRowAlphaScalar(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    (void)colorKey;
+    for(int i = 0; i < count; i++){
+        Uint32 s = src[i], d = dst[i];
+        Uint32 a = alpha == 255 ? (s >> 24) : divideBy255((s >> 24) * alpha);
+        if(a == 255){
+            dst[i] = s | 0xFF000000;
+            continue;
+        }
+        if(a == 0){
+            continue;
+        }
+        dst[i] = blendOverPixel(s, d, a);
+    }
+}
+
+/** @brief Scalar reference of the `BLIT_ADDITIVE` row. */
+static void blitRowAdditiveScalar(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    (void)colorKey;
+    for(int i = 0; i < count; i++){
+        Uint32 s = src[i], d = dst[i];
+        Uint32 a = alpha == 255 ? (s >> 24) : divideBy255((s >> 24) * alpha);
+        Uint32 out = d & 0xFF000000;
+        for(int shift = 0; shift < 24; shift += 8){
+            Uint32 c = ((d >> shift) & 0xFF) + divideBy255(((s >> shift) & 0xFF) * a);
+            out |= (c > 255 ? 255 : c) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+/** @brief Scalar reference of the `BLIT_COLORKEY` row, the key is compared without its alpha byte. */
+static void blitRowColorKeyScalar(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    (void)alpha;
+    for(int i = 0; i < count; i++){
+        if(((src[i] ^ colorKey) & 0x00FFFFFF) != 0){
+            dst[i] = src[i];
+        }
+    }
+}
+
+/** @brief Scalar reference of the `BLIT_PREMULTIPLIED` row, only pixels that are 0 in every channel are skipped. */
+static void blitRowPremultipliedScalar(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    (void)colorKey;
+    for(int i = 0; i < count; i++){
+        Uint32 s = alpha == 255 ? src[i] : scalePixel(src[i], alpha);
+        if(s >= 0xFF000000){
+            dst[i] = s;
+        } else if(s != 0){
+            dst[i] = blendPremultipliedPixel(s, dst[i]);
+        }
+    }
+}
+
+static const BlitKernels scalarBlitKernels = {"scalar", blitRowAlphaScalar, blitRowAdditiveScalar, blitRowColorKeyScalar, blitRowPremultipliedScalar};
+
+#ifdef ENGINE_SSE2
+/** @brief `divideBy255()` on 8 unsigned 16-bit lanes. */
+static inline __m128i divideBy255SSE2(__m128i x){
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/** @brief Alpha of 2 unpacked pixels broadcast to their 4 lanes, modulated by the global alpha. */
+static inline __m128i pixelAlphaSSE2(__m128i unpacked, __m128i globalAlpha, bool modulate){
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(unpacked, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    return modulate ? divideBy255SSE2(_mm_mullo_epi16(a, globalAlpha)) : a;
+}
+
+/** @brief "over" of 2 unpacked pixels, the source alpha lane is forced to 255 so alpha follows the same formula. */
+static inline __m128i blendOverSSE2(__m128i s, __m128i d, __m128i a){
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    __m128i inv = _mm_sub_epi16(full, a);
+    return divideBy255SSE2(_mm_add_epi16(_mm_mullo_epi16(_mm_or_si128(s, alphaLanes), a), _mm_mullo_epi16(d, inv)));
+}
+
+/** @brief SSE2 `BLIT_ALPHA` row, 4 pixels per step, fully opaque / transparent groups skip the math. */
+static void blitRowAlphaSSE2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    const __m128i globalAlpha = _mm_set1_epi16(static_cast<short>(alpha));
+    bool modulate = alpha != 255;
+    int i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i sa = _mm_and_si128(s, alphaMask);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xFFFF){
+            continue;
+        }
+        if(!modulate && _mm_movemask_epi8(_mm_cmpeq_epi32(sa, alphaMask)) == 0xFFFF){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i sLo = _mm_unpacklo_epi8(s, zero), sHi = _mm_unpackhi_epi8(s, zero);
+        __m128i lo = blendOverSSE2(sLo, _mm_unpacklo_epi8(d, zero), pixelAlphaSSE2(sLo, globalAlpha, modulate));
+        __m128i hi = blendOverSSE2(sHi, _mm_unpackhi_epi8(d, zero), pixelAlphaSSE2(sHi, globalAlpha, modulate));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    blitRowAlphaScalar(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+/** @brief SSE2 `BLIT_ADDITIVE` row, 4 pixels per step with saturating adds. */
+static void blitRowAdditiveSSE2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorLanes = _mm_setr_epi16(255, 255, 255, 0, 255, 255, 255, 0);
+    const __m128i globalAlpha = _mm_set1_epi16(static_cast<short>(alpha));
+    bool modulate = alpha != 255;
+    int i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i sLo = _mm_unpacklo_epi8(s, zero), sHi = _mm_unpackhi_epi8(s, zero);
+        __m128i lo = divideBy255SSE2(_mm_mullo_epi16(_mm_and_si128(sLo, colorLanes), pixelAlphaSSE2(sLo, globalAlpha, modulate)));
+        __m128i hi = divideBy255SSE2(_mm_mullo_epi16(_mm_and_si128(sHi, colorLanes), pixelAlphaSSE2(sHi, globalAlpha, modulate)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epu8(d, _mm_packus_epi16(lo, hi)));
+    }
+    blitRowAdditiveScalar(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+/** @brief SSE2 `BLIT_COLORKEY` row, 4 pixels per step with a branch-free select. */
+static void blitRowColorKeySSE2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i key = _mm_set1_epi32(static_cast<int>(colorKey & 0x00FFFFFF));
+    int i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i keyed = _mm_cmpeq_epi32(_mm_and_si128(s, colorMask), key);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(_mm_and_si128(keyed, d), _mm_andnot_si128(keyed, s)));
+    }
+    blitRowColorKeyScalar(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+/** @brief SSE2 `BLIT_PREMULTIPLIED` row, 4 pixels per step, the destination is the only operand that is multiplied. */
+static void blitRowPremultipliedSSE2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i globalAlpha = _mm_set1_epi16(static_cast<short>(alpha));
+    bool modulate = alpha != 255;
+    int i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if(modulate){
+            s = _mm_packus_epi16(divideBy255SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), globalAlpha)),
+                                 divideBy255SSE2(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), globalAlpha)));
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF){
+            continue;
+        }
+        if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), alphaMask)) == 0xFFFF){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        }
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i sLo = _mm_unpacklo_epi8(s, zero), sHi = _mm_unpackhi_epi8(s, zero);
+        __m128i lo = divideBy255SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_sub_epi16(full, pixelAlphaSSE2(sLo, globalAlpha, false))));
+        __m128i hi = divideBy255SSE2(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_sub_epi16(full, pixelAlphaSSE2(sHi, globalAlpha, false))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+    blitRowPremultipliedScalar(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+static const BlitKernels sse2BlitKernels = {"sse2", blitRowAlphaSSE2, blitRowAdditiveSSE2, blitRowColorKeySSE2, blitRowPremultipliedSSE2};
+#endif
+
+#ifdef ENGINE_AVX2
+/** @brief `divideBy255()` on 16 unsigned 16-bit lanes. */
+ENGINE_TARGET_AVX2 static inline __m256i divideBy255AVX2(__m256i x){
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+/** @brief Alpha of 4 unpacked pixels broadcast to their lanes, modulated by the global alpha. */
+ENGINE_TARGET_AVX2 static inline __m256i pixelAlphaAVX2(__m256i unpacked, __m256i globalAlpha, bool modulate){
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(unpacked, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    return modulate ? divideBy255AVX2(_mm256_mullo_epi16(a, globalAlpha)) : a;
+}
+
+/** @brief AVX2 `BLIT_ALPHA` row, 8 pixels per step, same math as the SSE2 kernel. */
+ENGINE_TARGET_AVX2 static void blitRowAlphaAVX2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+    const __m256i globalAlpha = _mm256_set1_epi16(static_cast<short>(alpha));
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i alphaLanes = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+    bool modulate = alpha != 255;
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i sa = _mm256_and_si256(s, alphaMask);
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) == -1){
+            continue;
+        }
+        if(!modulate && _mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, alphaMask)) == -1){
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), s);
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i sLo = _mm256_unpacklo_epi8(s, zero), sHi = _mm256_unpackhi_epi8(s, zero);
+        __m256i aLo = pixelAlphaAVX2(sLo, globalAlpha, modulate), aHi = pixelAlphaAVX2(sHi, globalAlpha, modulate);
+        __m256i lo = divideBy255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_or_si256(sLo, alphaLanes), aLo),
+                                                      _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_sub_epi16(full, aLo))));
+        __m256i hi = divideBy255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_or_si256(sHi, alphaLanes), aHi),
+                                                      _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_sub_epi16(full, aHi))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    _mm256_zeroupper(); // the tail runs legacy SSE code, avoid the AVX to SSE transition penalty
+    blitRowAlphaSSE2(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+/** @brief AVX2 `BLIT_ADDITIVE` row, 8 pixels per step. */
+ENGINE_TARGET_AVX2 static void blitRowAdditiveAVX2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i colorLanes = _mm256_setr_epi16(255, 255, 255, 0, 255, 255, 255, 0, 255, 255, 255, 0, 255, 255, 255, 0);
+    const __m256i globalAlpha = _mm256_set1_epi16(static_cast<short>(alpha));
+    bool modulate = alpha != 255;
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i sLo = _mm256_unpacklo_epi8(s, zero), sHi = _mm256_unpackhi_epi8(s, zero);
+        __m256i lo = divideBy255AVX2(_mm256_mullo_epi16(_mm256_and_si256(sLo, colorLanes), pixelAlphaAVX2(sLo, globalAlpha, modulate)));
+        __m256i hi = divideBy255AVX2(_mm256_mullo_epi16(_mm256_and_si256(sHi, colorLanes), pixelAlphaAVX2(sHi, globalAlpha, modulate)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_adds_epu8(d, _mm256_packus_epi16(lo, hi)));
+    }
+    _mm256_zeroupper();
+    blitRowAdditiveSSE2(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+/** @brief AVX2 `BLIT_COLORKEY` row, 8 pixels per step. */
+ENGINE_TARGET_AVX2 static void blitRowColorKeyAVX2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m256i colorMask = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i key = _mm256_set1_epi32(static_cast<int>(colorKey & 0x00FFFFFF));
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i keyed = _mm256_cmpeq_epi32(_mm256_and_si256(s, colorMask), key);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(_mm256_and_si256(keyed, d), _mm256_andnot_si256(keyed, s)));
+    }
+    _mm256_zeroupper();
+    blitRowColorKeySSE2(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+/** @brief AVX2 `BLIT_PREMULTIPLIED` row, 8 pixels per step. */
+ENGINE_TARGET_AVX2 static void blitRowPremultipliedAVX2(const Uint32* src, Uint32* dst, int count, Uint32 alpha, Uint32 colorKey){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i globalAlpha = _mm256_set1_epi16(static_cast<short>(alpha));
+    bool modulate = alpha != 255;
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if(modulate){
+            s = _mm256_packus_epi16(divideBy255AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), globalAlpha)),
+                                    divideBy255AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), globalAlpha)));
+        }
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) == -1){
+            continue;
+        }
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, alphaMask), alphaMask)) == -1){
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), s);
+            continue;
+        }
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i sLo = _mm256_unpacklo_epi8(s, zero), sHi = _mm256_unpackhi_epi8(s, zero);
+        __m256i lo = divideBy255AVX2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), _mm256_sub_epi16(full, pixelAlphaAVX2(sLo, globalAlpha, false))));
+        __m256i hi = divideBy255AVX2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), _mm256_sub_epi16(full, pixelAlphaAVX2(sHi, globalAlpha, false))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+    }
+    _mm256_zeroupper();
+    blitRowPremultipliedSSE2(src + i, dst + i, count - i, alpha, colorKey);
+}
+
+static const BlitKernels avx2BlitKernels = {"avx2", blitRowAlphaAVX2, blitRowAdditiveAVX2, blitRowColorKeyAVX2, blitRowPremultipliedAVX2};
+#endif
+
+/**
+ * @brief Picks the widest kernel set the CPU supports, checked once.
+ */
+static const BlitKernels& selectBlitKernels(){
+    static const BlitKernels* chosen = NULL;
+    if(chosen == NULL){
+        chosen = &scalarBlitKernels;
+#ifdef ENGINE_SSE2
+        if(SDL_HasSSE2()){
+            chosen = &sse2BlitKernels;
+        }
+#endif
+#ifdef ENGINE_AVX2
+        if(SDL_HasAVX2()){
+            chosen = &avx2BlitKernels;
+        }
+#endif
+    }
+    return *chosen;
+}
+
+/**
+ * @brief Row kernel of `kernels` for a compositing mode other than `BLIT_COPY`.
+ */
+static BlitRowFn blitRowFor(const BlitKernels& kernels, BlitMode mode){
+    switch(mode){
+        case BLIT_ADDITIVE: return kernels.additive;
+        case BLIT_COLORKEY: return kernels.colorKey;
+        case BLIT_PREMULTIPLIED: return kernels.premultiplied;
+        default: return kernels.alpha;
+    }
+}
+
+/**
+ * @brief `true` when both surfaces can go through the row kernels: 32 bits per pixel, alpha in the top byte and the same layout.
+ */
+static bool canUseBlitKernels(SDL_Surface* src, SDL_Surface* dst){
+    return src->format->BytesPerPixel == 4 && dst->format->BytesPerPixel == 4 &&
+           src->format->Amask == 0xFF000000 && src->format->format == dst->format->format;
+}
+
+/**
+ * @brief Clips a blit the way SDL_BlitSurface does: the source rectangle against the source surface,
+ * the shifted result against the destination clip rectangle.
+ *
+ * @param src Source surface.
+ * @param dst Destination surface.
+ * @param srcRect Source rectangle, `NULL` for the whole surface.
+ * @param dstRect Destination position (only `x` and `y` are used), `NULL` for (0, 0).
+ * @param clippedSrc Output source rectangle.
+ * @param clippedDst Output destination rectangle, same size as `clippedSrc`.
+ * @return `false` if nothing is left to draw.
+ */
+static bool clipBlit(SDL_Surface* src, SDL_Surface* dst, const SDL_Rect* srcRect, const SDL_Rect* dstRect, SDL_Rect& clippedSrc, SDL_Rect& clippedDst){
+    SDL_Rect whole = {0, 0, src->w, src->h};
+    SDL_Rect requested = srcRect ? *srcRect : whole;
+    int dx = dstRect ? dstRect->x : 0;
+    int dy = dstRect ? dstRect->y : 0;
+    if(!SDL_IntersectRect(&requested, &whole, &clippedSrc)){
+        return false;
+    }
+    dx += clippedSrc.x - requested.x;
+    dy += clippedSrc.y - requested.y;
+    SDL_Rect placed = {dx, dy, clippedSrc.w, clippedSrc.h};
+    if(!SDL_IntersectRect(&placed, &dst->clip_rect, &clippedDst)){
+        return false;
+    }
+    clippedSrc.x += clippedDst.x - dx;
+    clippedSrc.y += clippedDst.y - dy;
+    clippedSrc.w = clippedDst.w;
+    clippedSrc.h = clippedDst.h;
+    return true;
+}
+
+/**
+ * @brief Runs one of the blit modes row by row over already clipped rectangles with the given kernel set.
+ */
+static void blitWithKernels(SDL_Surface* src, const SDL_Rect& srcRect, SDL_Surface* dst, const SDL_Rect& dstRect, BlitMode mode, Uint8 alpha, Uint32 colorKey, const BlitKernels& kernels){
+    BlitRowFn row = blitRowFor(kernels, mode);
+    for(int y = 0; y < srcRect.h; y++){
+        const Uint32* s = reinterpret_cast<const Uint32*>(static_cast<Uint8*>(src->pixels) + (srcRect.y + y) * src->pitch) + srcRect.x;
+        Uint32* d = reinterpret_cast<Uint32*>(static_cast<Uint8*>(dst->pixels) + (dstRect.y + y) * dst->pitch) + dstRect.x;
+        if(mode == BLIT_COPY){
+            memmove(d, s, srcRect.w * 4);
+        } else {
+            row(s, d, srcRect.w, alpha, colorKey);
+        }
+    }
+}
+
+/**
+ * @brief Turns a premultiplied ARGB8888 surface back into straight alpha in place, rounded to nearest.
+ */
+static void unpremultiplySurface(SDL_Surface* surface){
+    if(SDL_MUSTLOCK(surface)){SDL_LockSurface(surface);}
+    for(int y = 0; y < surface->h; y++){
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+        for(int x = 0; x < surface->w; x++){
+            Uint32 a = row[x] >> 24;
+            if(a == 0 || a == 255){
+                continue;
+            }
+            Uint32 r = SDL_min(255u, (((row[x] >> 16) & 0xFF) * 255 + a / 2) / a);
+            Uint32 g = SDL_min(255u, (((row[x] >> 8) & 0xFF) * 255 + a / 2) / a);
+            Uint32 b = SDL_min(255u, ((row[x] & 0xFF) * 255 + a / 2) / a);
+            row[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+    if(SDL_MUSTLOCK(surface)){SDL_UnlockSurface(surface);}
+}
+
+/**
+ * @brief CPU-side blit of a rectangle of `src` onto `dst` with one of the `BlitMode`s.
+ *
+ * 32-bit surfaces of the same layout go through the SIMD row kernels, anything else falls back to SDL_BlitSurface
+ * with the matching blend mode / alpha mod / color key, so the result is the same just slower.
+ * SDL surfaces have no premultiplied blend mode: `BLIT_PREMULTIPLIED` between other formats converts the source to
+ * ARGB8888 first and either runs the kernels (ARGB8888 destination) or unpremultiplies the copy and blends it straight.
+ *
+ * @return `false` if a surface is missing, the rectangles don't overlap or SDL reported an error.
+ */
+static bool blitSurface(SDL_Surface* src, const SDL_Rect* srcRect, SDL_Surface* dst, const SDL_Rect* dstRect, BlitMode mode, Uint8 alpha = 255, Uint32 colorKey = 0){
+    if(src == NULL || dst == NULL){
+        return false;
+    }
+    if(canUseBlitKernels(src, dst)){
+        SDL_Rect clippedSrc, clippedDst;
+        if(!clipBlit(src, dst, srcRect, dstRect, clippedSrc, clippedDst)){
+            return false;
+        }
+        bool lockSrc = SDL_MUSTLOCK(src), lockDst = SDL_MUSTLOCK(dst);
+        if(lockSrc){SDL_LockSurface(src);}
+        if(lockDst){SDL_LockSurface(dst);}
+        blitWithKernels(src, clippedSrc, dst, clippedDst, mode, alpha, colorKey, selectBlitKernels());
+        if(lockDst){SDL_UnlockSurface(dst);}
+        if(lockSrc){SDL_UnlockSurface(src);}
+        return true;
+    }
+    if(mode == BLIT_PREMULTIPLIED){
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_ARGB8888, 0);
+        if(converted == NULL){
+            return false;
+        }
+        bool blitted;
+        if(canUseBlitKernels(converted, dst)){
+            blitted = blitSurface(converted, srcRect, dst, dstRect, BLIT_PREMULTIPLIED, alpha);
+        } else {
+            unpremultiplySurface(converted);
+            blitted = blitSurface(converted, srcRect, dst, dstRect, BLIT_ALPHA, alpha);
+        }
+        SDL_FreeSurface(converted);
+        return blitted;
+    }
+
+    SDL_BlendMode previousBlend;
+    Uint8 previousAlpha;
+    SDL_GetSurfaceBlendMode(src, &previousBlend);
+    SDL_GetSurfaceAlphaMod(src, &previousAlpha);
+    Uint32 previousKey = 0;
+    bool hadKey = SDL_HasColorKey(src) == SDL_TRUE && SDL_GetColorKey(src, &previousKey) == 0;
+    SDL_SetSurfaceBlendMode(src, mode == BLIT_ALPHA || mode == BLIT_COLORKEY ? SDL_BLENDMODE_BLEND : (mode == BLIT_ADDITIVE ? SDL_BLENDMODE_ADD : SDL_BLENDMODE_NONE));
+    SDL_SetSurfaceAlphaMod(src, mode == BLIT_COLORKEY ? 255 : alpha);
+    if(mode == BLIT_COLORKEY){
+        SDL_SetColorKey(src, SDL_TRUE, SDL_MapRGB(src->format, (colorKey >> 16) & 0xFF, (colorKey >> 8) & 0xFF, colorKey & 0xFF));
+        SDL_SetSurfaceBlendMode(src, SDL_BLENDMODE_NONE);
+    }
+    SDL_Rect placed = dstRect ? *dstRect : SDL_Rect{0, 0, 0, 0};
+    int result = SDL_BlitSurface(src, srcRect, dst, &placed);
+    if(mode == BLIT_COLORKEY){
+        SDL_SetColorKey(src, hadKey ? SDL_TRUE : SDL_FALSE, previousKey);
+    }
+    SDL_SetSurfaceBlendMode(src, previousBlend);
+    SDL_SetSurfaceAlphaMod(src, previousAlpha);
+    return result == 0;
+}
+
+/**
+ * @brief How `blitSurfaceTransformed()` samples the source.
+ */
+enum SampleFilter {
+    SAMPLE_NEAREST, ///< closest texel, keeps pixel art crisp.
+    SAMPLE_BILINEAR ///< weighted 2x2 texels with 8-bit weights, smooth under rotation and scaling.
+};
+
+/**
+ * @brief Fills `count` output pixels from source coordinates stepping by (`du`, `dv`) per pixel.
+ *
+ * Coordinates are 16.16 fixed point inside the source rectangle, the caller guarantees every sample is inside it.
+ */
+typedef void (*SampleRowFn)(const Uint8* pixels, int pitch, int w, int h, Sint32 u, Sint32 v, Sint32 du, Sint32 dv, Uint32* out, int count);
+
+/** @brief Nearest sampling row, there is no gather in SSE2 so this stays scalar for every kernel set. */
+static void sampleRowNearest(const Uint8* pixels, int pitch, int w, int h, Sint32 u, Sint32 v, Sint32 du, Sint32 dv, Uint32* out, int count){
+    (void)w;
+    (void)h;
+    for(int i = 0; i < count; i++){
+        out[i] = reinterpret_cast<const Uint32*>(pixels + (v >> 16) * pitch)[u >> 16];
+        u += du;
+        v += dv;
+    }
+}
+
+/**
+ * @brief Finds the 2x2 texels and 8-bit weights of a bilinear sample, edges are clamped.
+ */
+static inline void bilinearTaps(const Uint8* pixels, int pitch, int w, int h, Sint32 u, Sint32 v, const Uint32*& top, const Uint32*& bottom, int& x0, int& x1, Uint32& fx, Uint32& fy){
+    Sint32 bu = u - 0x8000;
+    Sint32 bv = v - 0x8000;
+    x0 = bu >> 16;
+    int y0 = bv >> 16;
+    fx = (bu >> 8) & 0xFF;
+    fy = (bv >> 8) & 0xFF;
+    x1 = x0 + 1 < w ? x0 + 1 : x0;
+    int y1 = y0 + 1 < h ? y0 + 1 : y0;
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    top = reinterpret_cast<const Uint32*>(pixels + y0 * pitch);
+    bottom = reinterpret_cast<const Uint32*>(pixels + y1 * pitch);
+}
+
+/** @brief Scalar reference of the bilinear row: vertical lerp first, then horizontal, each `(a * (256 - f) + b * f) >> 8`. */
+static void sampleRowBilinearScalar(const Uint8* pixels, int pitch, int w, int h, Sint32 u, Sint32 v, Sint32 du, Sint32 dv, Uint32* out, int count){
+    for(int i = 0; i < count; i++){
+        const Uint32* top;
+        const Uint32* bottom;
+        int x0, x1;
+        Uint32 fx, fy;
+        bilinearTaps(pixels, pitch, w, h, u, v, top, bottom, x0, x1, fx, fy);
+        Uint32 result = 0;
+        for(int shift = 0; shift < 32; shift += 8){
+            Uint32 left = (((top[x0] >> shift) & 0xFF) * (256 - fy) + ((bottom[x0] >> shift) & 0xFF) * fy) >> 8;
+            Uint32 right = (((top[x1] >> shift) & 0xFF) * (256 - fy) + ((bottom[x1] >> shift) & 0xFF) * fy) >> 8;
+            result |= ((left * (256 - fx) + right * fx) >> 8) << shift;
+        }
+        out[i] = result;
+        u += du;
+        v += dv;
+    }
+}
+
+#ifdef ENGINE_SSE2
+/** @brief SSE2 bilinear row, both columns of a sample are interpolated in one register, bit exact with the scalar row. */
+static void sampleRowBilinearSSE2(const Uint8* pixels, int pitch, int w, int h, Sint32 u, Sint32 v, Sint32 du, Sint32 dv, Uint32* out, int count){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(256);
+    for(int i = 0; i < count; i++){
+        const Uint32* top;
+        const Uint32* bottom;
+        int x0, x1;
+        Uint32 fx, fy;
+        bilinearTaps(pixels, pitch, w, h, u, v, top, bottom, x0, x1, fx, fy);
+        __m128i t = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(static_cast<int>(top[x0])), _mm_cvtsi32_si128(static_cast<int>(top[x1]))), zero);
+        __m128i b = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(static_cast<int>(bottom[x0])), _mm_cvtsi32_si128(static_cast<int>(bottom[x1]))), zero);
+        __m128i wy = _mm_set1_epi16(static_cast<short>(fy));
+        __m128i columns = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(t, _mm_sub_epi16(full, wy)), _mm_mullo_epi16(b, wy)), 8);
+        __m128i wx = _mm_unpacklo_epi64(_mm_sub_epi16(full, _mm_set1_epi16(static_cast<short>(fx))), _mm_set1_epi16(static_cast<short>(fx)));
+        __m128i weighted = _mm_mullo_epi16(columns, wx);
+        __m128i sum = _mm_srli_epi16(_mm_add_epi16(weighted, _mm_srli_si128(weighted, 8)), 8);
+        out[i] = static_cast<Uint32>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, zero)));
+        u += du;
+        v += dv;
+    }
+}
+#endif
+
+/**
+ * @brief Picks the bilinear row sampler once, nearest sampling has only the scalar one.
+ */
+static SampleRowFn selectBilinearSampler(){
+    static SampleRowFn chosen = NULL;
+    if(chosen == NULL){
+        chosen = sampleRowBilinearScalar;
+#ifdef ENGINE_SSE2
+        if(SDL_HasSSE2()){
+            chosen = sampleRowBilinearSSE2;
+        }
+#endif
+    }
+    return chosen;
+}
+
+/**
+ * @brief Narrows [`start`, `end`) to the pixels where `origin + t * step` (16.16) stays in [0, `limit` << 16).
+ *
+ * The range is first solved in floating point, then the ends are nudged until the fixed point values the
+ * sampler will actually see are inside, since they are linear every pixel in between is inside too.
+ */
+static void clipSpanToSource(Sint64 origin, Sint64 step, int limit, int& start, int& end){
+    Sint64 high = static_cast<Sint64>(limit) << 16;
+    if(step == 0){
+        if(origin < 0 || origin >= high){
+            end = start;
+        }
+        return;
+    }
+    double first = -static_cast<double>(origin) / step;
+    double last = static_cast<double>(high - origin) / step;
+    if(step < 0){
+        swap(first, last);
+    }
+    double from = ceil(first), to = ceil(last);
+    start = from > start ? static_cast<int>(from) : start;
+    end = to < end ? static_cast<int>(to) : end;
+    while(start < end && (origin + start * step < 0 || origin + start * step >= high)){
+        start++;
+    }
+    while(end > start && (origin + (end - 1) * step < 0 || origin + (end - 1) * step >= high)){
+        end--;
+    }
+}
+
+/**
+ * @brief CPU counterpart of SDL_RenderCopyExF for surfaces: draws a rectangle of `src` scaled into `dstRect`,
+ * rotated by `angle` around `center` and optionally flipped, with one of the `BlitMode`s.
+ *
+ * Every destination pixel center is mapped back into the source with an affine transform that is stepped
+ * incrementally in 16.16 fixed point. The covered span of each row is solved analytically and clipped against
+ * the destination clip rectangle, so no pixel outside the sprite is touched. Rows are sampled into a scratch
+ * line and composited with the SIMD row kernels of `blitSurface()`, `BLIT_COPY` samples straight into the target.
+ * Both surfaces must be 32-bit with the same layout.
+ *
+ * @param src Source surface.
+ * @param srcRect Part of `src` to draw, `NULL` for all of it.
+ * @param dst Destination surface.
+ * @param dstRect Where the unrotated source rectangle lands, its size sets the scale.
+ * @param angle Clockwise rotation in degrees.
+ * @param center Pivot relative to the top left corner of `dstRect`, `NULL` for its center.
+ * @param flip Mirroring applied before the rotation, like in SDL_RenderCopyEx.
+ * @param filter Sampling filter.
+ * @param mode How source and destination pixels are combined.
+ * @param alpha Global alpha (`BLIT_ALPHA`, `BLIT_ADDITIVE`).
+ * @param colorKey Color that is skipped in `BLIT_COLORKEY` mode.
+ * @return `false` if the surfaces can't be used or nothing was drawn.
+ */
+static bool blitSurfaceTransformed(SDL_Surface* src, const SDL_Rect* srcRect, SDL_Surface* dst, const SDL_FRect& dstRect, double angle, const SDL_FPoint* center,
+                                   SDL_RendererFlip flip, SampleFilter filter, BlitMode mode, Uint8 alpha = 255, Uint32 colorKey = 0){
+    if(src == NULL || dst == NULL || !canUseBlitKernels(src, dst) || dstRect.w <= 0.0f || dstRect.h <= 0.0f){
+        return false;
+    }
+    SDL_Rect whole = {0, 0, src->w, src->h};
+    SDL_Rect source;
+    if(!SDL_IntersectRect(srcRect ? srcRect : &whole, &whole, &source)){
+        return false;
+    }
+
+    double pivotX = center ? center->x : dstRect.w / 2.0;
+    double pivotY = center ? center->y : dstRect.h / 2.0;
+    double radians = angle * M_PI / 180.0;
+    double c = cos(radians), s = sin(radians);
+    double scaleU = source.w / static_cast<double>(dstRect.w);
+    double scaleV = source.h / static_cast<double>(dstRect.h);
+    double signU = (flip & SDL_FLIP_HORIZONTAL) ? -1.0 : 1.0;
+    double signV = (flip & SDL_FLIP_VERTICAL) ? -1.0 : 1.0;
+
+    // Bounding box of the rotated rectangle, clipped to the target.
+    double minX = 1e30, minY = 1e30, maxX = -1e30, maxY = -1e30;
+    for(int corner = 0; corner < 4; corner++){
+        double lx = (corner & 1) ? dstRect.w : 0.0, ly = (corner & 2) ? dstRect.h : 0.0;
+        double px = dstRect.x + pivotX + (lx - pivotX) * c - (ly - pivotY) * s;
+        double py = dstRect.y + pivotY + (lx - pivotX) * s + (ly - pivotY) * c;
+        minX = px < minX ? px : minX;
+        maxX = px > maxX ? px : maxX;
+        minY = py < minY ? py : minY;
+        maxY = py > maxY ? py : maxY;
+    }
+    const SDL_Rect& clip = dst->clip_rect;
+    int x0 = static_cast<int>(floor(minX)), x1 = static_cast<int>(ceil(maxX));
+    int y0 = static_cast<int>(floor(minY)), y1 = static_cast<int>(ceil(maxY));
+    x0 = x0 < clip.x ? clip.x : x0;
+    y0 = y0 < clip.y ? clip.y : y0;
+    x1 = x1 > clip.x + clip.w ? clip.x + clip.w : x1;
+    y1 = y1 > clip.y + clip.h ? clip.y + clip.h : y1;
+    if(x0 >= x1 || y0 >= y1){
+        return false;
+    }
+
+    // Source coordinates (16.16, relative to `source`) of the pixel center at (x0, y0) and their steps along x and y.
+    double dx = x0 + 0.5 - dstRect.x - pivotX;
+    double dy = y0 + 0.5 - dstRect.y - pivotY;
+    double localX = pivotX + dx * c + dy * s;
+    double localY = pivotY - dx * s + dy * c;
+    double u = signU > 0 ? localX * scaleU : source.w - localX * scaleU;
+    double v = signV > 0 ? localY * scaleV : source.h - localY * scaleV;
+    Sint64 uRow = llround(u * 65536.0), vRow = llround(v * 65536.0);
+    Sint64 duDx = llround(signU * c * scaleU * 65536.0), dvDx = llround(-signV * s * scaleV * 65536.0);
+    Sint64 duDy = llround(signU * s * scaleU * 65536.0), dvDy = llround(signV * c * scaleV * 65536.0);
+
+    SampleRowFn sample = filter == SAMPLE_BILINEAR ? selectBilinearSampler() : sampleRowNearest;
+    const BlitKernels& kernels = selectBlitKernels();
+    BlitRowFn composite = blitRowFor(kernels, mode);
+    static thread_local vector<Uint32> line;
+    if(mode != BLIT_COPY && static_cast<int>(line.size()) < x1 - x0){
+        line.resize(x1 - x0);
+    }
+
+    bool lockSrc = SDL_MUSTLOCK(src), lockDst = SDL_MUSTLOCK(dst);
+    if(lockSrc){SDL_LockSurface(src);}
+    if(lockDst){SDL_LockSurface(dst);}
+    const Uint8* pixels = static_cast<const Uint8*>(src->pixels) + source.y * src->pitch + source.x * 4;
+    bool drawn = false;
+    for(int y = y0; y < y1; y++, uRow += duDy, vRow += dvDy){
+        int start = 0, end = x1 - x0;
+        clipSpanToSource(uRow, duDx, source.w, start, end);
+        clipSpanToSource(vRow, dvDx, source.h, start, end);
+        if(start >= end){
+            continue;
+        }
+        Sint32 u0 = static_cast<Sint32>(uRow + start * duDx);
+        Sint32 v0 = static_cast<Sint32>(vRow + start * dvDx);
+        Uint32* target = reinterpret_cast<Uint32*>(static_cast<Uint8*>(dst->pixels) + y * dst->pitch) + x0 + start;
+        if(mode == BLIT_COPY){
+            sample(pixels, src->pitch, source.w, source.h, u0, v0, static_cast<Sint32>(duDx), static_cast<Sint32>(dvDx), target, end - start);
+        } else {
+            sample(pixels, src->pitch, source.w, source.h, u0, v0, static_cast<Sint32>(duDx), static_cast<Sint32>(dvDx), line.data(), end - start);
+            composite(line.data(), target, end - start, alpha, colorKey);
+        }
+        drawn = true;
+    }
+    if(lockDst){SDL_UnlockSurface(dst);}
+    if(lockSrc){SDL_UnlockSurface(src);}
+    return drawn;
+}
+
+/**
+ * @class RLESprite
+ * @brief Run-length encoded copy of a sprite (or one frame of a sheet) for fast CPU compositing.
+ *
+ * Every row is stored as runs of opaque, translucent and transparent pixels, only the pixels of the first two are kept.
+ * `draw()` copies opaque runs, blends translucent runs through the SIMD alpha kernel and never touches transparent
+ * ones, neither in the sprite nor in the target, which for mostly empty character frames is most of the rectangle.
+ * Encoded once at load time, the source surface is not referenced afterwards.
+ */
+class RLESprite {
+    public:
+        /** @brief Kind of a run. */
+        enum RunKind {
+            RUN_OPAQUE, ///< alpha 255, copied.
+            RUN_TRANSLUCENT ///< alpha 1-254, blended.
+        };
+
+        /** @brief Pixel counts of an encoded sprite, for the fill rate comparison with a full rectangle blit. */
+        struct Stats {
+            int opaquePixels = 0;
+            int translucentPixels = 0;
+            int transparentPixels = 0;
+            int runs = 0;
+        };
+
+    private:
+        /** @brief Non transparent run, transparent runs are the gaps between them. */
+        struct Run {
+            Uint16 x; ///< First column of the run.
+            Uint16 length; ///< Pixels in the run.
+            Uint8 kind; ///< `RunKind`.
+            Uint32 pixel; ///< Index of its first pixel in `pixels`.
+        };
+
+        int width = 0; ///< Width of the encoded rectangle.
+        int height = 0; ///< Height of the encoded rectangle.
+        vector<Run> runs; ///< Runs of every row, left to right, rows in order.
+        vector<Uint32> rowRuns; ///< Index of the first run of each row, `height + 1` entries.
+        vector<Uint32> pixels; ///< ARGB8888 pixels of the runs.
+        Stats stats; ///< Counts gathered while encoding.
+
+    public:
+        RLESprite(){}
+
+        /**
+         * @brief Encodes a rectangle of a surface.
+         *
+         * @param surface Source surface, converted to ARGB8888 on the fly when it is in another format.
+         * @param rect Part of the surface to encode (e.g. one animation frame), `NULL` for all of it.
+         * @return `false` if the surface is missing or couldn't be converted.
+         */
+        bool encode(SDL_Surface* surface, const SDL_Rect* rect = NULL){
+            runs.clear();
+            rowRuns.clear();
+            pixels.clear();
+            stats = Stats();
+            width = height = 0;
+            if(surface == NULL){
+                return false;
+            }
+            SDL_Surface* source = surface->format->format == SDL_PIXELFORMAT_ARGB8888 ? surface : SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+            if(source == NULL){
+                return false;
+            }
+            SDL_Rect whole = {0, 0, source->w, source->h};
+            SDL_Rect area;
+            if(!SDL_IntersectRect(rect ? rect : &whole, &whole, &area)){
+                area = {0, 0, 0, 0};
+            }
+            width = area.w;
+            height = area.h;
+            if(SDL_MUSTLOCK(source)){SDL_LockSurface(source);}
+            for(int y = 0; y < height; y++){
+                rowRuns.push_back(static_cast<Uint32>(runs.size()));
+                const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(source->pixels) + (area.y + y) * source->pitch) + area.x;
+                int x = 0;
+                while(x < width){
+                    Uint32 alpha = row[x] >> 24;
+                    int start = x;
+                    if(alpha == 0){
+                        while(x < width && (row[x] >> 24) == 0){x++;}
+                        stats.transparentPixels += x - start;
+                        continue;
+                    }
+                    Uint8 kind = alpha == 255 ? RUN_OPAQUE : RUN_TRANSLUCENT;
+                    while(x < width && x - start < 65535){
+                        Uint32 a = row[x] >> 24;
+                        if(a == 0 || (a == 255) != (kind == RUN_OPAQUE)){
+                            break;
+                        }
+                        x++;
+                    }
+                    Run run = {static_cast<Uint16>(start), static_cast<Uint16>(x - start), kind, static_cast<Uint32>(pixels.size())};
+                    runs.push_back(run);
+                    pixels.insert(pixels.end(), row + start, row + x);
+                    (kind == RUN_OPAQUE ? stats.opaquePixels : stats.translucentPixels) += x - start;
+                }
+            }
+            rowRuns.push_back(static_cast<Uint32>(runs.size()));
+            if(SDL_MUSTLOCK(source)){SDL_UnlockSurface(source);}
+            if(source != surface){
+                SDL_FreeSurface(source);
+            }
+            stats.runs = static_cast<int>(runs.size());
+            return true;
+        }
+
+        /**
+         * @brief Encodes every `frameW` x `frameH` cell of a sprite sheet, row by row.
+         *
+         * @return The frames in sheet order, empty if the surface is missing.
+         */
+        static vector<RLESprite> encodeSheet(SDL_Surface* sheet, int frameW, int frameH){
+            vector<RLESprite> frames;
+            if(sheet == NULL || frameW <= 0 || frameH <= 0){
+                return frames;
+            }
+            for(int y = 0; y + frameH <= sheet->h; y += frameH){
+                for(int x = 0; x + frameW <= sheet->w; x += frameW){
+                    SDL_Rect cell = {x, y, frameW, frameH};
+                    frames.push_back(RLESprite());
+                    frames.back().encode(sheet, &cell);
+                }
+            }
+            return frames;
+        }
+
+        /**
+         * @brief Draws the sprite with its top left corner at (`x`, `y`), clipped to the clip rectangle of `target`.
+         *
+         * @param target ARGB8888 (or XRGB8888) surface to draw into.
+         * @param x Horizontal position in the target.
+         * @param y Vertical position in the target.
+         * @param alpha Global alpha, below 255 the opaque runs are blended too.
+         * @return `false` if the target isn't a 32-bit surface or the sprite is fully clipped.
+         */
+        bool draw(SDL_Surface* target, int x, int y, Uint8 alpha = 255){
+            if(target == NULL || target->format->BytesPerPixel != 4 || alpha == 0){
+                return false;
+            }
+            const SDL_Rect& clip = target->clip_rect;
+            int firstRow = clip.y - y > 0 ? clip.y - y : 0;
+            int lastRow = clip.y + clip.h - y < height ? clip.y + clip.h - y : height;
+            int left = clip.x - x, right = clip.x + clip.w - x; // visible columns in sprite space
+            if(firstRow >= lastRow || left >= width || right <= 0){
+                return false;
+            }
+            BlitRowFn blend = selectBlitKernels().alpha;
+            if(SDL_MUSTLOCK(target)){SDL_LockSurface(target);}
+            for(int row = firstRow; row < lastRow; row++){
+                Uint32* out = reinterpret_cast<Uint32*>(static_cast<Uint8*>(target->pixels) + (y + row) * target->pitch) + x;
+                for(Uint32 i = rowRuns[row]; i < rowRuns[row + 1]; i++){
+                    const Run& run = runs[i];
+                    int from = run.x > left ? run.x : left;
+                    int to = run.x + run.length < right ? run.x + run.length : right;
+                    if(from >= to){
+                        continue;
+                    }
+                    const Uint32* in = &pixels[run.pixel + (from - run.x)];
+                    if(run.kind == RUN_OPAQUE && alpha == 255){
+                        memcpy(out + from, in, (to - from) * 4);
+                    } else {
+                        blend(in, out + from, to - from, alpha, 0);
+                    }
+                }
+            }
+            if(SDL_MUSTLOCK(target)){SDL_UnlockSurface(target);}
+            return true;
+        }
+
+        int getWidth() { return width; }
+        int getHeight() { return height; }
+
+        /** @brief Pixel and run counts of the encoded sprite. */
+        const Stats& getStats() { return stats; }
+
+        /** @brief Bytes used by the runs and their pixels. */
+        size_t getEncodedSize() { return runs.size() * sizeof(Run) + rowRuns.size() * sizeof(Uint32) + pixels.size() * 4; }
+};
+
+/**
+ * @brief Which parts of a self-intersecting or nested polygon `SurfaceRasterizer::fillPolygon()` fills.
+ */
+enum FillRule {
+    FILL_NONZERO, ///< inside where the winding number isn't zero.
+    FILL_EVEN_ODD ///< inside where a ray crosses an odd number of edges.
+};
+
+/**
+ * @class SurfaceRasterizer
+ * @brief CPU rasterizer drawing lines and polygons straight into a 32-bit SDL_Surface.
+ *
+ * Lines are Bresenham (`drawLine()`) or Xiaolin Wu antialiased (`drawLineAA()`), both clipped to the surface clip rectangle
+ * before stepping. Polygons are scanline filled with an active edge list, so concave and self-intersecting outlines work,
+ * and every scanline ends up in `fillSpan()`, which writes opaque spans with SSE2 stores and blends translucent ones
+ * through the `BLIT_ALPHA` row kernel. The surface stays locked while the rasterizer exists.
+ * Works on 32-bit formats whose top byte is alpha or unused (ARGB8888, ABGR8888, XRGB8888, ...).
+ */
+class SurfaceRasterizer {
+    private:
+        /** One non-horizontal polygon edge, `x` is the crossing at `yTop`. */
+        struct Edge {
+            float yTop;
+            float yBottom;
+            float x;
+            float slope;
+            int winding;
+        };
+        /** Crossing of an active edge with the current scanline. */
+        struct Crossing {
+            float x;
+            int winding;
+        };
+
+        SDL_Surface* target; ///< Surface drawn into.
+        bool locked = false; ///< `true` if the constructor had to lock `target`.
+        SDL_Rect clip; ///< Copy of the target clip rectangle.
+        int pitchPixels = 0; ///< Row length of the target in pixels.
+        Uint32 pixel = 0; ///< Current color in the target format, alpha in the top byte.
+        Uint8 alpha = 255; ///< Alpha of the current color.
+        vector<Uint32> colorRow; ///< `pixel` repeated, source row of the alpha kernel for translucent spans.
+        vector<Edge> edges; ///< Scratch for `fillPolygon()`, kept to avoid reallocating per polygon.
+        vector<int> active; ///< Indices of the edges crossing the current scanline.
+        vector<Crossing> crossings; ///< Sorted crossings of the current scanline.
+        vector<SDL_FPoint> converted; ///< Scratch for the integer `fillPolygon()` overload.
+        const BlitKernels& kernels; ///< Row kernels used for translucent spans.
+
+        Uint32* pixelAt(int x, int y){
+            return static_cast<Uint32*>(target->pixels) + y * pitchPixels + x;
+        }
+
+        /** Blends the current color with `coverage` (0-255) into an already bounds checked pixel. */
+        void blendPixel(Uint32* p, Uint32 coverage){
+            Uint32 a = divideBy255(alpha * coverage);
+            if(a == 255){
+                *p = pixel;
+            } else if(a != 0){
+                *p = blendOverPixel(pixel, *p, a);
+            }
+        }
+
+        /** Pixel plot of the antialiased line, `steep` lines are traced with x and y swapped. */
+        void plotCoverage(bool steep, int x, int y, float coverage){
+            if(steep){
+                int t = x; x = y; y = t;
+            }
+            if(x < clip.x || y < clip.y || x >= clip.x + clip.w || y >= clip.y + clip.h){
+                return;
+            }
+            int c = static_cast<int>(coverage * 255.0f + 0.5f);
+            if(c > 0){
+                blendPixel(pixelAt(x, y), c > 255 ? 255 : c);
+            }
+        }
+
+        /**
+         * Liang-Barsky clip of a segment against the clip rectangle grown by `margin` pixels.
+         * @return `false` if the segment is completely outside.
+         */
+        bool clipSegment(float& x0, float& y0, float& x1, float& y1, float margin){
+            if(clip.w <= 0 || clip.h <= 0){
+                return false;
+            }
+            float minX = clip.x - margin, maxX = clip.x + clip.w - 1 + margin;
+            float minY = clip.y - margin, maxY = clip.y + clip.h - 1 + margin;
+            float dx = x1 - x0, dy = y1 - y0;
+            float p[4] = {-dx, dx, -dy, dy};
+            float q[4] = {x0 - minX, maxX - x0, y0 - minY, maxY - y0};
+            float t0 = 0.0f, t1 = 1.0f;
+            for(int i = 0; i < 4; i++){
+                if(p[i] == 0.0f){
+                    if(q[i] < 0.0f){
+                        return false;
+                    }
+                    continue;
+                }
+                float t = q[i] / p[i];
+                if(p[i] < 0.0f){
+                    if(t > t1){return false;}
+                    if(t > t0){t0 = t;}
+                } else {
+                    if(t < t0){return false;}
+                    if(t < t1){t1 = t;}
+                }
+            }
+            float nx0 = x0 + t0 * dx, ny0 = y0 + t0 * dy;
+            x1 = x0 + t1 * dx;
+            y1 = y0 + t1 * dy;
+            x0 = nx0;
+            y0 = ny0;
+            return true;
+        }
+
+        /** Bresenham stepping over clipped endpoints, every plotted pixel is inside the clip rectangle. */
+        template<bool blend>
+        void traceLine(int x0, int y0, int x1, int y1){
+            int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+            int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+            int stepY = sy * pitchPixels;
+            int err = dx + dy;
+            Uint32* p = pixelAt(x0, y0);
+            for(int remaining = dx > -dy ? dx : -dy; ; remaining--){
+                if(blend){
+                    blendPixel(p, 255);
+                } else {
+                    *p = pixel;
+                }
+                if(remaining == 0){
+                    break;
+                }
+                int e2 = 2 * err;
+                if(e2 >= dy){err += dy; p += sx;}
+                if(e2 <= dx){err += dx; p += stepY;}
+            }
+        }
+
+    public:
+        /**
+         * @brief Locks `target` if needed and prepares drawing in white.
+         * @param target 32-bit surface to draw into, see `isValid()`.
+         */
+        SurfaceRasterizer(SDL_Surface* target) : target(target), kernels(selectBlitKernels()){
+            if(isValid()){
+                if(SDL_MUSTLOCK(target)){
+                    locked = SDL_LockSurface(target) == 0;
+                }
+                clip = target->clip_rect;
+                pitchPixels = target->pitch / 4;
+                colorRow.resize(target->w);
+            } else {
+                clip = {0, 0, 0, 0};
+            }
+            SDL_Color white = {255, 255, 255, 255};
+            setColor(white);
+        }
+
+        SurfaceRasterizer(const SurfaceRasterizer&) = delete;
+        SurfaceRasterizer& operator=(const SurfaceRasterizer&) = delete;
+
+        virtual ~SurfaceRasterizer(){
+            if(locked){
+                SDL_UnlockSurface(target);
+            }
+        }
+
+        /** @brief `true` if the target exists and is a 32-bit format this rasterizer can draw into. */
+        bool isValid(){
+            return target != NULL && target->format->BytesPerPixel == 4 &&
+                   ((target->format->Rmask | target->format->Gmask | target->format->Bmask) & 0xFF000000) == 0;
+        }
+
+        /** @brief Sets the color of everything drawn next, alpha below 255 blends with the surface. */
+        void setColor(SDL_Color color){
+            alpha = color.a;
+            Uint32 rgb = isValid() ? SDL_MapRGB(target->format, color.r, color.g, color.b) & 0x00FFFFFF : 0;
+            pixel = rgb | (static_cast<Uint32>(alpha) << 24);
+            fill(colorRow.begin(), colorRow.end(), pixel);
+        }
+
+        /**
+         * @brief Fills the pixels `[x0, x1)` of row `y`, clipped.
+         *
+         * Opaque spans are stored 4 pixels at a time, translucent spans go through the alpha row kernel.
+         */
+        void fillSpan(int y, int x0, int x1){
+            if(y < clip.y || y >= clip.y + clip.h){
+                return;
+            }
+            if(x0 < clip.x){x0 = clip.x;}
+            if(x1 > clip.x + clip.w){x1 = clip.x + clip.w;}
+            if(x0 >= x1){
+                return;
+            }
+            Uint32* p = pixelAt(x0, y);
+            int count = x1 - x0;
+            if(alpha != 255){
+                kernels.alpha(colorRow.data(), p, count, 255, 0);
+                return;
+            }
+            int i = 0;
+#ifdef ENGINE_SSE2
+            __m128i color = _mm_set1_epi32(static_cast<int>(pixel));
+            for(; i + 4 <= count; i += 4){
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), color);
+            }
+#endif
+            for(; i < count; i++){
+                p[i] = pixel;
+            }
+        }
+
+        /** @brief Fills a rectangle, clipped. */
+        void fillRect(const SDL_Rect& rect){
+            for(int y = rect.y; y < rect.y + rect.h; y++){
+                fillSpan(y, rect.x, rect.x + rect.w);
+            }
+        }
+
+        /**
+         * @brief Draws a one pixel wide Bresenham line, both endpoints included.
+         *
+         * The segment is clipped first, so long lines that mostly leave the surface cost only their visible part.
+         */
+        void drawLine(int x0, int y0, int x1, int y1){
+            float fx0 = x0, fy0 = y0, fx1 = x1, fy1 = y1;
+            if(!clipSegment(fx0, fy0, fx1, fy1, 0.0f)){
+                return;
+            }
+            x0 = static_cast<int>(lroundf(fx0)); y0 = static_cast<int>(lroundf(fy0));
+            x1 = static_cast<int>(lroundf(fx1)); y1 = static_cast<int>(lroundf(fy1));
+            if(y0 == y1){
+                fillSpan(y0, x0 < x1 ? x0 : x1, (x0 < x1 ? x1 : x0) + 1);
+            } else if(alpha == 255){
+                traceLine<false>(x0, y0, x1, y1);
+            } else {
+                traceLine<true>(x0, y0, x1, y1);
+            }
+        }
+
+        /**
+         * @brief Draws a Xiaolin Wu antialiased line between sub-pixel endpoints.
+         *
+         * Each step writes the two pixels straddling the ideal line with complementary coverage.
+         */
+        void drawLineAA(float x0, float y0, float x1, float y1){
+            if(!clipSegment(x0, y0, x1, y1, 1.0f)){
+                return;
+            }
+            bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+            if(steep){
+                swap(x0, y0);
+                swap(x1, y1);
+            }
+            if(x0 > x1){
+                swap(x0, x1);
+                swap(y0, y1);
+            }
+            float dx = x1 - x0, dy = y1 - y0;
+            float gradient = dx == 0.0f ? 1.0f : dy / dx;
+
+            float xEnd = roundf(x0);
+            float yEnd = y0 + gradient * (xEnd - x0);
+            float xGap = 1.0f - (x0 + 0.5f - floorf(x0 + 0.5f));
+            int xStart = static_cast<int>(xEnd);
+            int yPixel = static_cast<int>(floorf(yEnd));
+            float fraction = yEnd - floorf(yEnd);
+            plotCoverage(steep, xStart, yPixel, (1.0f - fraction) * xGap);
+            plotCoverage(steep, xStart, yPixel + 1, fraction * xGap);
+            float intersectY = yEnd + gradient;
+
+            xEnd = roundf(x1);
+            yEnd = y1 + gradient * (xEnd - x1);
+            xGap = x1 + 0.5f - floorf(x1 + 0.5f);
+            int xStop = static_cast<int>(xEnd);
+            yPixel = static_cast<int>(floorf(yEnd));
+            fraction = yEnd - floorf(yEnd);
+            plotCoverage(steep, xStop, yPixel, (1.0f - fraction) * xGap);
+            plotCoverage(steep, xStop, yPixel + 1, fraction * xGap);
+
+            for(int x = xStart + 1; x < xStop; x++){
+                int y = static_cast<int>(floorf(intersectY));
+                fraction = intersectY - y;
+                plotCoverage(steep, x, y, 1.0f - fraction);
+                plotCoverage(steep, x, y + 1, fraction);
+                intersectY += gradient;
+            }
+        }
+
+        /**
+         * @brief Scanline fills a polygon, convex or concave, sampled at pixel centers.
+         *
+         * Edges are sorted by their top once, then every scanline updates the active edge list,
+         * sorts its crossings and fills the inside spans according to `rule`.
+         *
+         * @param points Outline vertices, the last one connects back to the first.
+         * @param count Number of vertices.
+         * @param rule Which areas of a self-intersecting outline are inside.
+         */
+        void fillPolygon(const SDL_FPoint* points, int count, FillRule rule = FILL_NONZERO){
+            if(count < 3 || clip.w <= 0 || clip.h <= 0){
+                return;
+            }
+            edges.clear();
+            float minY = points[0].y, maxY = points[0].y;
+            for(int i = 0; i < count; i++){
+                SDL_FPoint a = points[i], b = points[(i + 1) % count];
+                minY = a.y < minY ? a.y : minY;
+                maxY = a.y > maxY ? a.y : maxY;
+                if(a.y == b.y){
+                    continue;
+                }
+                Edge edge;
+                edge.winding = a.y < b.y ? 1 : -1;
+                if(a.y > b.y){
+                    swap(a, b);
+                }
+                edge.yTop = a.y;
+                edge.yBottom = b.y;
+                edge.x = a.x;
+                edge.slope = (b.x - a.x) / (b.y - a.y);
+                edges.push_back(edge);
+            }
+            sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b){return a.yTop < b.yTop;});
+
+            int yFirst = static_cast<int>(ceilf(minY - 0.5f));
+            int yLast = static_cast<int>(ceilf(maxY - 0.5f));
+            if(yFirst < clip.y){yFirst = clip.y;}
+            if(yLast > clip.y + clip.h){yLast = clip.y + clip.h;}
+
+            active.clear();
+            size_t nextEdge = 0;
+            for(int y = yFirst; y < yLast; y++){
+                float sampleY = y + 0.5f;
+                while(nextEdge < edges.size() && edges[nextEdge].yTop <= sampleY){
+                    active.push_back(static_cast<int>(nextEdge++));
+                }
+                crossings.clear();
+                for(size_t i = 0; i < active.size(); ){
+                    const Edge& edge = edges[active[i]];
+                    if(edge.yBottom <= sampleY){
+                        active[i] = active.back();
+                        active.pop_back();
+                        continue;
+                    }
+                    if(edge.yTop <= sampleY){
+                        Crossing crossing = {edge.x + (sampleY - edge.yTop) * edge.slope, edge.winding};
+                        size_t j = crossings.size();
+                        crossings.push_back(crossing);
+                        while(j > 0 && crossings[j - 1].x > crossing.x){ // insertion sort, few crossings per row
+                            crossings[j] = crossings[j - 1];
+                            j--;
+                        }
+                        crossings[j] = crossing;
+                    }
+                    i++;
+                }
+                int winding = 0;
+                for(size_t i = 0; i + 1 < crossings.size(); i++){
+                    winding = rule == FILL_EVEN_ODD ? (winding ^ 1) : winding + crossings[i].winding;
+                    if(winding != 0){
+                        fillSpan(y, static_cast<int>(ceilf(crossings[i].x - 0.5f)), static_cast<int>(ceilf(crossings[i + 1].x - 0.5f)));
+                    }
+                }
+            }
+        }
+
+        /** @brief Integer vertex overload of `fillPolygon()`. */
+        void fillPolygon(const SDL_Point* points, int count, FillRule rule = FILL_NONZERO){
+            converted.resize(count > 0 ? count : 0);
+            for(int i = 0; i < count; i++){
+                converted[i].x = static_cast<float>(points[i].x);
+                converted[i].y = static_cast<float>(points[i].y);
+            }
+            fillPolygon(converted.data(), count, rule);
+        }
+};
+
+/**
+ * @enum Easing
+ * @brief Easing curves of a tween. Every curve is a cubic polynomial, so all of them share one vectorized pass.
+ */
+enum Easing {
+    EASE_LINEAR,        ///< Constant speed.
+    EASE_IN_QUAD,       ///< Starts slow, t^2.
+    EASE_OUT_QUAD,      ///< Ends slow.
+    EASE_IN_OUT_QUAD,   ///< Slow at both ends.
+    EASE_IN_CUBIC,      ///< Starts slower, t^3.
+    EASE_OUT_CUBIC,     ///< Ends slower.
+    EASE_IN_OUT_CUBIC,  ///< Slower at both ends.
+    EASE_SMOOTHSTEP,    ///< 3t^2 - 2t^3.
+    EASE_IN_BACK,       ///< Pulls back a little before moving.
+    EASE_OUT_BACK       ///< Overshoots a little and settles.
+};
+
+/**
+ * @struct EaseColumns
+ * @brief Column pointers of a tween timeline, the input of an `EaseBatchFn`.
+ *
+ * A curve is `f(u) = linear * u + quadratic * u^2 + cubic * u^3`. Tweens with `mirror` set use `1 - f(1 - t)` (ease out),
+ * tweens with `split` 2 run `f` over each half and mirror the second half (ease in-out), the rest use `f(t)`.
+ */
+struct EaseColumns {
+    const Uint32* starts; ///< Clock value each tween starts at, in milliseconds.
+    const int* durations; ///< Length of each tween in milliseconds.
+    const float* inverseDurations; ///< 1 / duration.
+    const float* linear; ///< u coefficient of the curve.
+    const float* quadratic; ///< u^2 coefficient of the curve.
+    const float* cubic; ///< u^3 coefficient of the curve.
+    const float* splits; ///< 1, or 2 for in-out curves.
+    const float* mirrors; ///< 1 for out curves, 0 otherwise.
+};
+
+/**
+ * @brief Eased progress of the tweens [`from`, `to`) at clock `now`, 0 before they start and exactly 1 once they are over.
+ */
+static void easeBatchScalar(const EaseColumns& columns, Uint32 now, float* progress, int from, int to){
+    for(int i = from; i < to; i++){
+        int elapsed = static_cast<int>(now - columns.starts[i]);
+        float t = static_cast<float>(elapsed) * columns.inverseDurations[i];
+        t = t > 0.0f ? t : 0.0f;
+        t = t < 1.0f ? t : 1.0f;
+        if(elapsed >= columns.durations[i]){
+            t = 1.0f;
+        }
+        float split = columns.splits[i];
+        bool mirrored = columns.mirrors[i] > 0.0f || (split > 1.0f && t >= 0.5f);
+        float u = mirrored ? split * (1.0f - t) : split * t;
+        float v = ((columns.cubic[i] * u + columns.quadratic[i]) * u + columns.linear[i]) * u;
+        v = v * (split > 1.0f ? 0.5f : 1.0f);
+        progress[i] = mirrored ? 1.0f - v : v;
+    }
+}
+
+#ifdef ENGINE_SSE2
+/**
+ * @brief SSE2 version of `easeBatchScalar()`, four tweens per step with the same operations, so the results are identical.
+ */
+static void easeBatchSSE2(const EaseColumns& columns, Uint32 now, float* progress, int from, int to){
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i clock = _mm_set1_epi32(static_cast<int>(now));
+    int i = from;
+    for(; i + 4 <= to; i += 4){
+        __m128i elapsed = _mm_sub_epi32(clock, _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns.starts + i)));
+        __m128i duration = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns.durations + i));
+        __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(elapsed), _mm_loadu_ps(columns.inverseDurations + i));
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+        __m128 done = _mm_castsi128_ps(_mm_or_si128(_mm_cmpgt_epi32(elapsed, duration), _mm_cmpeq_epi32(elapsed, duration)));
+        t = _mm_or_ps(_mm_andnot_ps(done, t), _mm_and_ps(done, one));
+        __m128 split = _mm_loadu_ps(columns.splits + i);
+        __m128 inOut = _mm_cmpgt_ps(split, one);
+        __m128 mirrored = _mm_or_ps(_mm_cmpgt_ps(_mm_loadu_ps(columns.mirrors + i), zero), _mm_and_ps(inOut, _mm_cmpge_ps(t, half)));
+        __m128 u = _mm_mul_ps(split, _mm_or_ps(_mm_and_ps(mirrored, _mm_sub_ps(one, t)), _mm_andnot_ps(mirrored, t)));
+        __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(columns.cubic + i), u), _mm_loadu_ps(columns.quadratic + i));
+        v = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(v, u), _mm_loadu_ps(columns.linear + i)), u);
+        v = _mm_mul_ps(v, _mm_or_ps(_mm_and_ps(inOut, half), _mm_andnot_ps(inOut, one)));
+        _mm_storeu_ps(progress + i, _mm_or_ps(_mm_and_ps(mirrored, _mm_sub_ps(one, v)), _mm_andnot_ps(mirrored, v)));
+    }
+    easeBatchScalar(columns, now, progress, i, to);
+}
+#endif
+
+typedef void (*EaseBatchFn)(const EaseColumns& columns, Uint32 now, float* progress, int from, int to);
+
+/**
+ * @brief Picks the fastest easing pass the CPU supports, checked once at runtime.
+ */
+static EaseBatchFn selectEaseBatch(){
+    static EaseBatchFn chosen = NULL;
+    if(chosen == NULL){
+        chosen = easeBatchScalar;
+#ifdef ENGINE_SSE2
+        if(SDL_HasSSE2()){
+            chosen = easeBatchSSE2;
+        }
+#endif
+    }
+    return chosen;
+}
+
+/**
+ * @struct TweenTargets
+ * @brief Pointers into an object's transform state that a `TweenSystem` can write to, NULL where the object has no such state.
+ *
+ * The objects compare that state with what they last drew, so a value written from outside is picked up on the next draw.
+ */
+struct TweenTargets {
+    int* x = NULL; ///< Position, x-coordinate.
+    int* y = NULL; ///< Position, y-coordinate.
+    int* w = NULL; ///< Width.
+    int* h = NULL; ///< Height.
+    float* angle = NULL; ///< Rotation in degrees.
+    float* scale = NULL; ///< Scale factor.
+    SDL_Color* color = NULL; ///< Color.
+};
+
+/**
+ * @class TweenSystem
+ * @brief Runs tweens of floats, integer points and colors straight on their target variables.
+ *
+ * Each property type has its own packed timeline (structure of arrays with the start, duration and curve coefficients
+ * of every tween), so an update is one vectorized easing pass per type followed by a plain loop writing
+ * `from + delta * progress` through the target pointers, no virtual call per tween.
+ * A tween leaves its target alone until its delay is over, then starts from the value the target has at that point,
+ * so tweens of one target can be chained with delays. It is dropped after it wrote its final value.
+ * Handles stay valid until the tween finishes or is cancelled, after that they may be given out again.
+ * Targets must outlive their tweens, cancel them first when an object goes away.
+ */
+class TweenSystem {
+    private:
+        /**
+         * @brief Tween timing shared by all property types, one entry per tween.
+         */
+        struct Timeline {
+            vector<Uint32> starts; ///< Clock value the tween starts at.
+            vector<int> durations; ///< Length in milliseconds, at least 1.
+            vector<float> inverseDurations; ///< 1 / duration.
+            vector<float> linear; ///< Curve coefficients, see `EaseColumns`.
+            vector<float> quadratic;
+            vector<float> cubic;
+            vector<float> splits;
+            vector<float> mirrors;
+            vector<int> handles; ///< Handle of the tween.
+            vector<Uint8> waiting; ///< 1 until the tween started and read its start value.
+
+            void push(Uint32 start, Uint32 duration, Easing easing, int handle){
+                static const float curves[][5] = {
+                    // linear, quadratic, cubic, split, mirror
+                    {1.0f, 0.0f, 0.0f, 1.0f, 0.0f},          // EASE_LINEAR
+                    {0.0f, 1.0f, 0.0f, 1.0f, 0.0f},          // EASE_IN_QUAD
+                    {0.0f, 1.0f, 0.0f, 1.0f, 1.0f},          // EASE_OUT_QUAD
+                    {0.0f, 1.0f, 0.0f, 2.0f, 0.0f},          // EASE_IN_OUT_QUAD
+                    {0.0f, 0.0f, 1.0f, 1.0f, 0.0f},          // EASE_IN_CUBIC
+                    {0.0f, 0.0f, 1.0f, 1.0f, 1.0f},          // EASE_OUT_CUBIC
+                    {0.0f, 0.0f, 1.0f, 2.0f, 0.0f},          // EASE_IN_OUT_CUBIC
+                    {0.0f, 3.0f, -2.0f, 1.0f, 0.0f},         // EASE_SMOOTHSTEP
+                    {0.0f, -1.70158f, 2.70158f, 1.0f, 0.0f}, // EASE_IN_BACK
+                    {0.0f, -1.70158f, 2.70158f, 1.0f, 1.0f}  // EASE_OUT_BACK
+                };
+                const float* curve = curves[easing];
+                int length = max<int>(static_cast<int>(min<Uint32>(duration, 0x7FFFFFFF)), 1);
+                starts.push_back(start);
+                durations.push_back(length);
+                inverseDurations.push_back(1.0f / length);
+                linear.push_back(curve[0]);
+                quadratic.push_back(curve[1]);
+                cubic.push_back(curve[2]);
+                splits.push_back(curve[3]);
+                mirrors.push_back(curve[4]);
+                handles.push_back(handle);
+                waiting.push_back(1);
+            }
+
+            /** @brief Moves the last entry to `index`, the caller pops it afterwards. */
+            void moveLast(int index){
+                int last = size() - 1;
+                starts[index] = starts[last];
+                durations[index] = durations[last];
+                inverseDurations[index] = inverseDurations[last];
+                linear[index] = linear[last];
+                quadratic[index] = quadratic[last];
+                cubic[index] = cubic[last];
+                splits[index] = splits[last];
+                mirrors[index] = mirrors[last];
+                handles[index] = handles[last];
+                waiting[index] = waiting[last];
+            }
+
+            void pop(){
+                starts.pop_back();
+                durations.pop_back();
+                inverseDurations.pop_back();
+                linear.pop_back();
+                quadratic.pop_back();
+                cubic.pop_back();
+                splits.pop_back();
+                mirrors.pop_back();
+                handles.pop_back();
+                waiting.pop_back();
+            }
+
+            int size() const {
+                return static_cast<int>(starts.size());
+            }
+
+            EaseColumns columns() const {
+                return {starts.data(), durations.data(), inverseDurations.data(), linear.data(), quadratic.data(), cubic.data(), splits.data(), mirrors.data()};
+            }
+
+            bool isOver(int index, Uint32 now) const {
+                return static_cast<int>(now - starts[index]) >= durations[index];
+            }
+
+            /** @brief Tells if entry `index` has to read its start value now, clears the flag when it does. */
+            bool starting(int index, Uint32 now){
+                if(!waiting[index] || static_cast<int>(now - starts[index]) < 0){
+                    return false;
+                }
+                waiting[index] = 0;
+                return true;
+            }
+        };
+
+        /** @brief Tweens of float variables. */
+        struct FloatTrack {
+            Timeline timeline;
+            vector<float*> targets;
+            vector<float> from;
+            vector<float> to;
+        };
+
+        /** @brief Tweens of integer point variables, e.g. a position. */
+        struct PointTrack {
+            Timeline timeline;
+            vector<int*> xs;
+            vector<int*> ys;
+            vector<float> fromX;
+            vector<float> fromY;
+            vector<float> toX;
+            vector<float> toY;
+        };
+
+        /** @brief Tweens of colors, all four channels. */
+        struct ColorTrack {
+            Timeline timeline;
+            vector<SDL_Color*> targets;
+            vector<SDL_Color> from;
+            vector<SDL_Color> to;
+        };
+
+        enum TrackKind {
+            TRACK_FLOAT,
+            TRACK_POINT,
+            TRACK_COLOR
+        };
+
+        /** @brief Where a handle's tween lives, `index` -1 for a free handle. */
+        struct Slot {
+            TrackKind kind;
+            int index;
+        };
+
+        FloatTrack floats; ///< Float tweens.
+        PointTrack points; ///< Point tweens.
+        ColorTrack colors; ///< Color tweens.
+        vector<Slot> slots; ///< Slot of each handle.
+        vector<int> freeHandles; ///< Handles that can be given out again.
+        vector<float> progress; ///< Eased progress of the track being updated.
+        EaseBatchFn ease; ///< Easing pass picked for the CPU.
+        Uint32 now = 0; ///< Clock of the system in milliseconds, moved by `advance()`.
+        Uint32 lastTicks = 0; ///< SDL_GetTicks() of the previous `update()`.
+        bool started = false; ///< Becomes true on the first `update()`, which only samples the clock.
+
+        int claimHandle(TrackKind kind, int index){
+            int handle;
+            if(!freeHandles.empty()){
+                handle = freeHandles.back();
+                freeHandles.pop_back();
+            } else {
+                handle = static_cast<int>(slots.size());
+                slots.push_back({kind, -1});
+            }
+            slots[handle] = {kind, index};
+            return handle;
+        }
+
+        void releaseHandle(int handle){
+            slots[handle].index = -1;
+            freeHandles.push_back(handle);
+        }
+
+        /** @brief Removes entry `index` of a track, the last entry takes its place. */
+        void removeFloat(int index){
+            releaseHandle(floats.timeline.handles[index]);
+            int last = floats.timeline.size() - 1;
+            if(index != last){
+                floats.timeline.moveLast(index);
+                floats.targets[index] = floats.targets[last];
+                floats.from[index] = floats.from[last];
+                floats.to[index] = floats.to[last];
+                slots[floats.timeline.handles[index]].index = index;
+            }
+            floats.timeline.pop();
+            floats.targets.pop_back();
+            floats.from.pop_back();
+            floats.to.pop_back();
+        }
+
+        void removePoint(int index){
+            releaseHandle(points.timeline.handles[index]);
+            int last = points.timeline.size() - 1;
+            if(index != last){
+                points.timeline.moveLast(index);
+                points.xs[index] = points.xs[last];
+                points.ys[index] = points.ys[last];
+                points.fromX[index] = points.fromX[last];
+                points.fromY[index] = points.fromY[last];
+                points.toX[index] = points.toX[last];
+                points.toY[index] = points.toY[last];
+                slots[points.timeline.handles[index]].index = index;
+            }
+            points.timeline.pop();
+            points.xs.pop_back();
+            points.ys.pop_back();
+            points.fromX.pop_back();
+            points.fromY.pop_back();
+            points.toX.pop_back();
+            points.toY.pop_back();
+        }
+
+        void removeColor(int index){
+            releaseHandle(colors.timeline.handles[index]);
+            int last = colors.timeline.size() - 1;
+            if(index != last){
+                colors.timeline.moveLast(index);
+                colors.targets[index] = colors.targets[last];
+                colors.from[index] = colors.from[last];
+                colors.to[index] = colors.to[last];
+                slots[colors.timeline.handles[index]].index = index;
+            }
+            colors.timeline.pop();
+            colors.targets.pop_back();
+            colors.from.pop_back();
+            colors.to.pop_back();
+        }
+
+        /** @brief Runs the easing pass of `timeline` into `progress`. */
+        void easeTimeline(const Timeline& timeline){
+            progress.resize(timeline.size());
+            ease(timeline.columns(), now, progress.data(), 0, timeline.size());
+        }
+
+        static Uint8 lerpChannel(Uint8 from, Uint8 to, float t){
+            float value = from + (to - from) * t + 0.5f;
+            return static_cast<Uint8>(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value));
+        }
+    public:
+        TweenSystem() : ease(selectEaseBatch()){}
+
+        /**
+         * @brief Tweens a float from its current value to `to`.
+         *
+         * @param target Variable to write, e.g. `TweenTargets::angle`.
+         * @param to Final value.
+         * @param duration Length in milliseconds.
+         * @param easing Curve.
+         * @param delay Milliseconds before the tween starts and reads its start value.
+         * @return Handle of the tween.
+         */
+        int tweenFloat(float* target, float to, Uint32 duration, Easing easing = EASE_LINEAR, Uint32 delay = 0){
+            int handle = claimHandle(TRACK_FLOAT, floats.timeline.size());
+            floats.timeline.push(now + delay, duration, easing, handle);
+            floats.targets.push_back(target);
+            floats.from.push_back(*target);
+            floats.to.push_back(to);
+            return handle;
+        }
+
+        /**
+         * @brief Tweens an integer point, e.g. `TweenTargets::x` and `TweenTargets::y`, from its current value to (`toX`, `toY`).
+         * See `tweenFloat()` for the other parameters.
+         */
+        int tweenPoint(int* x, int* y, int toX, int toY, Uint32 duration, Easing easing = EASE_LINEAR, Uint32 delay = 0){
+            int handle = claimHandle(TRACK_POINT, points.timeline.size());
+            points.timeline.push(now + delay, duration, easing, handle);
+            points.xs.push_back(x);
+            points.ys.push_back(y);
+            points.fromX.push_back(static_cast<float>(*x));
+            points.fromY.push_back(static_cast<float>(*y));
+            points.toX.push_back(static_cast<float>(toX));
+            points.toY.push_back(static_cast<float>(toY));
+            return handle;
+        }
+
+        /**
+         * @brief Tweens a color from its current value to `to`, channels overshooting with a back curve are clamped.
+         * See `tweenFloat()` for the other parameters.
+         */
+        int tweenColor(SDL_Color* target, SDL_Color to, Uint32 duration, Easing easing = EASE_LINEAR, Uint32 delay = 0){
+            int handle = claimHandle(TRACK_COLOR, colors.timeline.size());
+            colors.timeline.push(now + delay, duration, easing, handle);
+            colors.targets.push_back(target);
+            colors.from.push_back(*target);
+            colors.to.push_back(to);
+            return handle;
+        }
+
+        /**
+         * @brief Stops a tween where it is, its target keeps the last written value.
+         */
+        void cancel(int handle){
+            if(handle < 0 || handle >= static_cast<int>(slots.size()) || slots[handle].index < 0){
+                return;
+            }
+            Slot slot = slots[handle];
+            if(slot.kind == TRACK_FLOAT){
+                removeFloat(slot.index);
+            } else if(slot.kind == TRACK_POINT){
+                removePoint(slot.index);
+            } else {
+                removeColor(slot.index);
+            }
+        }
+
+        /**
+         * @brief Tells if the tween of `handle` is still running.
+         */
+        bool isActive(int handle){
+            return handle >= 0 && handle < static_cast<int>(slots.size()) && slots[handle].index >= 0;
+        }
+
+        /**
+         * @brief Moves the clock by `milliseconds` and writes the value of every started tween,
+         * finished tweens write their final value and are dropped.
+         */
+        void advance(Uint32 milliseconds){
+            now += milliseconds;
+
+            easeTimeline(floats.timeline);
+            for(int i = 0; i < floats.timeline.size(); i++){
+                if(floats.timeline.waiting[i]){
+                    if(!floats.timeline.starting(i, now)){
+                        continue;
+                    }
+                    floats.from[i] = *floats.targets[i];
+                }
+                *floats.targets[i] = floats.from[i] + (floats.to[i] - floats.from[i]) * progress[i];
+            }
+            for(int i = floats.timeline.size() - 1; i >= 0; i--){
+                if(floats.timeline.isOver(i, now)){
+                    removeFloat(i);
+                }
+            }
+
+            easeTimeline(points.timeline);
+            for(int i = 0; i < points.timeline.size(); i++){
+                if(points.timeline.waiting[i]){
+                    if(!points.timeline.starting(i, now)){
+                        continue;
+                    }
+                    points.fromX[i] = static_cast<float>(*points.xs[i]);
+                    points.fromY[i] = static_cast<float>(*points.ys[i]);
+                }
+                *points.xs[i] = static_cast<int>(floorf(points.fromX[i] + (points.toX[i] - points.fromX[i]) * progress[i] + 0.5f));
+                *points.ys[i] = static_cast<int>(floorf(points.fromY[i] + (points.toY[i] - points.fromY[i]) * progress[i] + 0.5f));
+            }
+            for(int i = points.timeline.size() - 1; i >= 0; i--){
+                if(points.timeline.isOver(i, now)){
+                    removePoint(i);
+                }
+            }
+
+            easeTimeline(colors.timeline);
+            for(int i = 0; i < colors.timeline.size(); i++){
+                if(colors.timeline.waiting[i]){
+                    if(!colors.timeline.starting(i, now)){
+                        continue;
+                    }
+                    colors.from[i] = *colors.targets[i];
+                }
+                SDL_Color from = colors.from[i], to = colors.to[i];
+                float t = progress[i];
+                *colors.targets[i] = {lerpChannel(from.r, to.r, t), lerpChannel(from.g, to.g, t), lerpChannel(from.b, to.b, t), lerpChannel(from.a, to.a, t)};
+            }
+            for(int i = colors.timeline.size() - 1; i >= 0; i--){
+                if(colors.timeline.isOver(i, now)){
+                    removeColor(i);
+                }
+            }
+        }
+
+        /**
+         * @brief Samples the clock once and advances every tween by the time since the previous call.
+         */
+        void update(){
+            Uint32 currentTicks = SDL_GetTicks();
+            if(started){
+                advance(currentTicks - lastTicks);
+            }
+            started = true;
+            lastTicks = currentTicks;
+        }
+
+        /**
+         * @brief Gets the number of running tweens.
+         */
+        int getCount(){
+            return floats.timeline.size() + points.timeline.size() + colors.timeline.size();
+        }
+};
+
+/** 
+ * @class Base
+ * @brief An abstract base class defining a common interface for update and draw operations, actual name GameObject.
+ * 
+ * This class works as a base for other classes that require functionality, 
+ * such as Drawing and Transforming an Object. 
+ * Derived classes must provide implementations for the `update` and `draw` methods.
+ */
+class Base {
+    public:
+        virtual ~Base() = default;
+        virtual void update() = 0;
+        virtual void draw() = 0;
+};
+
+/**
+ * @class UpdateAbility
+ * @brief A mix - in update class which extends the `Base` class, providing a default implementation for the update function, actual name `UpdateObject`.
+ * 
+ * This class inherits virtually from the `Base` class, 
+ * allowing it to be used as a part of virtual multiple inheritance hierarchy.
+ * It provides a default empty implementation of the `update()` method, which can be overriden in the derived classes.  
+ */
+class UpdateAbility : public virtual Base {
+    public:
+    /**
+     * @brief Default virtual destructor.
+     * 
+     * Makes sure the cleanup is done.
+     */
+        virtual ~UpdateAbility() = default;
+        virtual void update() override {};
+};
+
+/**
+ * @class DrawAbility
+ * @brief This class extends the `Base` class, and provides the ability to `draw` and `update`, 
+ * actual name `DrawObject`.
+ * 
+ * Provides `draw()` and `update()` methods, which can be overriden in the derived classes to provide custom behaviour for created objects. 
+ */
+class DrawAbility : public virtual Base {
+    public:
+    /**
+     * @brief Default virtual destructor.
+     * 
+     * Makes sure the cleanup is done.
+     */
+        virtual ~DrawAbility() = default;
+        virtual void draw() override {};
+        virtual void update() override {};
+};
+
+/**
+ * @class Transformability
+ * @brief This class provides transformation abilities.
+ *
+ * Provides the ability to transform an object through `rotate`, `scale`, 
+ * and `translate` operations. It is an abstract class that defines pure virtual functions
+ * for these transformations, which MUST be implemented by derived classes.
+ */
+class Transformability : public virtual Base{
+    public:
+        virtual ~Transformability() = default;
+         /**
+         * @brief Rotates the object by the given angle.
+         * 
+         * This pure virtual method should be overridden by derived classes to implement 
+         * specific rotation behavior.
+         *
+         * @param angle The angle by which the object is to be rotated.
+         */
+        virtual void rotate(float angle) = 0;
+         /**
+         * @brief Scales the object by the given value.
+         * 
+         * This pure virtual method should be overridden by derived classes to implement 
+         * specific scale behavior.
+         *
+         * @param factor The value by which the object is to be scaled.
+         */
+        virtual void scale(float factor) = 0;
+         /**
+         * @brief Translates the object by the given `X` and `Y` coordinates.
+         * 
+         * This pure virtual method should be overridden by derived classes to implement 
+         * specific rotation behavior.
+         *
+         * @param dx translates an objects `X` coordinate.
+         * @param dy translates an objects `Y` coordinate.
+         */
+        virtual void translate(int dx, int dy) = 0;
+};
+
+/**
+ * @class shapeObj
+ * @brief A class representing a shape object that can be transformed and / or drawn. Inherits from Transformability and DrawAbility.
+ *
+ * The `shapeObj` class is more specific implementation of the `Transformability` and `DrawAbility`
+ * classes. It combines the ability to perform geometric transformations (rotate, scale, translate)
+ * with the ability to draw the object. It overrides the virtual methods from both the `Transformability`
+ * and `DrawAbility` classes to provide specific behavior for each shape.
+ */
+class shapeObj : public Transformability, public DrawAbility {
+    public:
+        virtual ~shapeObj() = default;
+        virtual void draw() override {};
+        virtual void rotate(float angle) override {};       
+        virtual void scale(float factor) override {};       
+        virtual void translate(int dx, int dy) override {};
+        /**
+         * @brief Draws the shape into a surface through the CPU rasterizer instead of the renderer (baking).
+         *
+         * Default does nothing, shapes that can be baked override it.
+         *
+         * @param target Rasterizer of the surface to draw into.
+         */
+        virtual void rasterize(SurfaceRasterizer& /*target*/) {}
+};
+
+/**
+ * @class Point2D
+ * @brief A class representing a 2D point that can be transformed and drawn.
+ *
+ * The `Point2D` class virtually inherits from `shapeObj`, which provides transformation and drawing methods.
+ * It represents a 2D point with specific x and y coordinates. The class provides methods for setting
+ * and getting the coordinates, as well as drawing and transforming the point when inherited behavior is used.
+ */
+class Point2D : public virtual shapeObj {
+    private:
+        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the point in the window.
+        int xInputed; ///< `X` - coordinate of the point.
+        int yInputed; ///< `Y` - coordinate of the point.
+    public:
+        /**
+         * @brief Constructor to create a 2D point with specified coordinates.
+         *
+         * The constructor initializes the point with the given x and y coordinates. 
+         * If no coordinates are provided, it defaults to (0, 0).
+         *
+         * @param x The x-coordinate of the point (default is 0).
+         * @param y The y-coordinate of the point (default is 0).
+         */
+        Point2D(int x = 0, int y = 0) : xInputed(x), yInputed(y){};
+
+        /**
+         * @brief Sets the coordinates of the point object.
+         *
+         * This method allows updating the x and y coordinates of the point.
+         *
+         * @param x The new x-coordinate of the point.
+         * @param y The new y-coordinate of the point.
+         */
+        void setPoint(int x, int y){
+            this->xInputed = x;
+            this->yInputed = y;
+        }
+
+        /**
+         * @brief Gets the x-coordinate of the point.
+         *
+         * This method returns x coordinate of the point.
+         * 
+         * @return The x-coordinate of the point.
+         */
+        int getX(){
+         return xInputed;   
+        }
+
+        /**
+         * @brief Gets the y-coordinate of the point.
+         *
+         * This method returns y coordinate of the point.
+         * 
+         * @return The y-coordinate of the point.
+         */
+        int getY(){
+            return yInputed;
+        }
+};
+
+/**
+ * @class LineSegment
+ * @brief A class representing a 2D line segment between two points with drawing and transformation capabilities.
+ *
+ * The `LineSegment` class represents a line segment defined by two `Point2D` objects: the `start` and `end` points.
+ * It provides functionality for setting / getting the points(their coordinates), drawing the segment from defined points, 
+ * and applying transformations such as translation, rotation, and scaling. 
+ * The class also uses an `SDL_Renderer` and an `SDL_Color` to render the line segment to a window with a given color.
+ */
+class LineSegment : public virtual shapeObj {
+private:
+    Point2D start; ///< The start point of the lineSegment.
+    Point2D end; ///< The end point of the lineSegment.
+    SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the point in the window.
+    SDL_Color color; ///< SDL_Color used to specify the color of the lineSegment object.
+
+public:
+    /**
+     * @brief Constructor for lineSegment object.
+     *
+     * Initializes a line segment with the given start and end points, renderer, and color.
+     *
+     * @param start The `Point2D` start point of the line segment.
+     * @param end The `Point2D` end point of the line segment.
+     * @param renderer The SDL_Renderer used for drawing the segment.
+     * @param color The color of the line segment.
+     */
+    LineSegment(Point2D &start, Point2D &end, SDL_Renderer* renderer, SDL_Color color)
+        : start(start), end(end), renderer(renderer), color(color) {}
+
+    /**
+     * @brief Sets the start point of the line segment object.
+     *
+     * This method sets / updates the start point's coordinates to the given x and y values.
+     *
+     * @param xStart The new x-coordinate of the start point.
+     * @param yStart The new y-coordinate of the start point.
+     */
+    void setStart(int xStart, int yStart) {
+        start.setPoint(xStart, yStart);
+    }
+        /**
+     * @brief Sets the end point of the line segment.
+     *
+     * This method updates the end point's coordinates to the given x and y values.
+     *
+     * @param xEnd The new x-coordinate of the end point.
+     * @param yEnd The new y-coordinate of the end point.
+     */
+    void setEnd(int xEnd, int yEnd) {
+        end.setPoint(xEnd, yEnd);
+    }
+    /**
+     * @brief Gets the x-coordinate of the start point.
+     *
+     * This method returns the x-coordinate of the start point of the line segment.
+     *
+     * @return The x-coordinate of the start point.
+     */
+    int getStartX() { return start.getX(); }
+    /**
+     * @brief Gets the y-coordinate of the start point.
+     *
+     * This method returns the y-coordinate of the start point of the line segment.
+     *
+     * @return The y-coordinate of the start point.
+     */
+    int getStartY() { return start.getY(); }
+    /**
+     * @brief Gets the x-coordinate of the end point.
+     *
+     * This method returns the x-coordinate of the end point of the line segment.
+     *
+     * @return The x-coordinate of the end point.
+     */
+    int getEndX() { return end.getX(); }
+    /**
+     * @brief Gets the y-coordinate of the end point.
+     *
+     * This method returns the y-coordinate of the end point of the line segment.
+     *
+     * @return The y-coordinate of the end point.
+     */
+    int getEndY() { return end.getY(); }
+
+    /**
+     * @brief Draws the line segment to the renderer.
+     *
+     * This method sets the drawing color and uses the SDL_Renderer to render the line segment between the start and
+     * end points.
+     */
+    void draw() override {
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderDrawLine(renderer, start.getX(), start.getY(), end.getX(), end.getY());
+        SDL_RenderPresent(renderer);
+    }
+    /**
+     * @brief Draws the line segment to the renderer.
+     *
+     * This method is similar to `draw()`, but allows drawing the line segment without overriding the inherited
+     * behavior, since the base classes have no `drawSegment()` method.
+     */
+    void drawSegment() {
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderDrawLine(renderer, start.getX(), start.getY(), end.getX(), end.getY());
+        SDL_RenderPresent(renderer);
+    }
+
+    /**
+     * @brief Bakes the line segment into a surface with the Bresenham line of the rasterizer.
+     *
+     * @param target Rasterizer of the surface to draw into.
+     */
+    void rasterize(SurfaceRasterizer& target) override {
+        target.setColor(color);
+        target.drawLine(start.getX(), start.getY(), end.getX(), end.getY());
+    }
+
+    /**
+     * @brief Translates the line segment by given offset.
+     *
+     * This method translates the line segment object by a given vertical(dy) and horizontal(dx) offset in parameters of the function,
+     * and redraws the segment, derived function from the `Transformability` class.
+     * Is done using the `setPoint()` function and getter methods of `Point2D` class.
+     * 
+     * @param dx The horizontal offset.
+     * @param dy The vertical offset.
+     */
+    void translate(int dx, int dy) override {
+        start.setPoint(start.getX() + dx, start.getY() + dy);
+        end.setPoint(end.getX() + dx, end.getY() + dy);
+        drawSegment();
+    }
+    /**
+     * @brief Rotates the line segment object by a given angle.
+     *
+     * This method rotates the line segment around its center point by the specified angle (in degrees, then converts it into radians) 
+     * and then redraws the segment.
+     *
+     * @param angle The angle by which to rotate the line segment, speicify it in degrees.
+     */
+    void rotate(float angle) override {
+        int x1 = start.getX();
+        int y1 = start.getY();
+        int x2 = end.getX();
+        int y2 = end.getY();
+
+        float centerX = (x1 + x2) / 2.0f;
+        float centerY = (y1 + y2) / 2.0f;
+
+        float radians = angle * M_PI / 180.0f;
+
+        int newX1 = static_cast<int>(centerX + (x1 - centerX) * cos(radians) - (y1 - centerY) * sin(radians));
+        int newY1 = static_cast<int>(centerY + (x1 - centerX) * sin(radians) + (y1 - centerY) * cos(radians));
+        int newX2 = static_cast<int>(centerX + (x2 - centerX) * cos(radians) - (y2 - centerY) * sin(radians));
+        int newY2 = static_cast<int>(centerY + (x2 - centerX) * sin(radians) + (y2 - centerY) * cos(radians));
+
+        start.setPoint(newX1, newY1);
+        end.setPoint(newX2, newY2);
+        drawSegment();
+    }
+        /**
+     * @brief Scales the line segment object by a given factor.
+     *
+     * This method scales the line segment around its center point by the specified factor(float value) and then
+     * redraws the segment.
+     *
+     * @param factor The factor by which to scale the line segment.
+     */
+    void scale(float factor) override {
+        float centerX = (start.getX() + end.getX()) / 2.0f;
+        float centerY = (start.getY() + end.getY()) / 2.0f;
+
+        int newX1 = static_cast<int>(centerX + (start.getX() - centerX) * factor);
+        int newY1 = static_cast<int>(centerY + (start.getY() - centerY) * factor);
+
+        int newX2 = static_cast<int>(centerX + (end.getX() - centerX) * factor);
+        int newY2 = static_cast<int>(centerY + (end.getY() - centerY) * factor);
+
+        start.setPoint(newX1, newY1);
+        end.setPoint(newX2, newY2);
+        drawSegment();
+    }
+};
+
+/**
+ * @class Rectangle
+ * @brief A class representing a rectangle with drawing and transformation capabilities.
+ *
+ * The `Rectangle` class provides methods to create a rectangle
+ * and perform transformations such as translation, rotation, and scaling. The rectangle
+ * is rendered using an `SDL_Renderer` and a specified color.
+ */
+class Rectangle : public virtual shapeObj {
+    private:
+        int x; ///< x-coordinate declaration for rectangle object(position in horizontal axis).
+        int y; ///< y-coordinate declaration for rectangle object(position in vertical axis).
+        int w; ///< width declaration for rectangle object(property).
+        int h; ///< height declaration for rectangle object(property).
+        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the rectangle in the window.
+        SDL_Color* color; ///< SDL_Color pointer used to specify the color of the rectangle object.
+    public:
+        virtual ~Rectangle() {};
+
+        Rectangle(){};
+
+        /**
+         * @brief Initializes / creates rectangle with given properties(position, dimensions, color) and renderer.
+         * 
+         * @param x The x-coordinate of the top left corner of the rectangle object.
+         * @param y The y-coordinate of the top left corner of the rectangle object.
+         * @param w The width of the rectangle.
+         * @param h The height of the rectangle.
+         * @param color The color which will be used to create a rectangle(outline color).
+         * @param renderer SDL_renderer used for rendering the rectangle in the window.
+         */
+        void createObject(int x, int y, int w, int h, SDL_Color* color, SDL_Renderer *renderer){
+            ENGINE_LOG_DEBUG(RENDER, "Object Rectangle Created");
+            this->x = x;
+            this->y = y;
+            this->w = w;
+            this->h = h;
+            this->color = color;
+            this->renderer = renderer;
+        }
+
+        /**
+        * @brief Draws the rectangle on the SDL renderer.
+        *
+        * This method sets the drawing color and renders the rectangle's outline using SDL.
+        * Creates a SDL_Rect tmp and uses values which were assigned in the `createObject()` function.
+        * Set's a color from the `createObject()` and draws Rectangle to the renderer.
+        */
+        void draw() {
+            SDL_Rect tmp = {x, y, w, h};
+            SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
+            SDL_RenderDrawRect(renderer, &tmp);
+            SDL_RenderPresent(renderer);
+        }
+
+        /**
+        * @brief Bakes the rectangle's outline into a surface, covering the same pixels as SDL_RenderDrawRect.
+        *
+        * @param target Rasterizer of the surface to draw into.
+        */
+        void rasterize(SurfaceRasterizer& target) override {
+            if(w <= 0 || h <= 0){
+                return;
+            }
+            target.setColor(*color);
+            target.fillSpan(y, x, x + w);
+            if(h > 1){
+                target.fillSpan(y + h - 1, x, x + w);
+            }
+            if(h > 2){
+                target.drawLine(x, y + 1, x, y + h - 2);
+                target.drawLine(x + w - 1, y + 1, x + w - 1, y + h - 2);
+            }
+        }
+
+        /**
+        * @brief Translates the rectangle by a given offset.
+        *
+        * This method moves the rectangle by the specified horizontal (dx) and vertical (dy) offsets
+        * and redraws it.
+        *
+        * @param dx The horizontal offset to move the rectangle.
+        * @param dy The vertical offset to move the rectangle.
+        */
+        void translate(int dx, int dy){
+            x += dx;
+            y += dy;
+            draw();
+        }
+
+        /**
+        * @brief Rotates the rectangle around its center by a given angle.
+        *
+        * This method computes the rotated positions of the rectangle's corners and renders
+        * the transformed rectangle using lines connecting these points.
+        *
+        * @param angle The angle by which to rotate the rectangle, in degrees(which is converted to radians later).
+        */
+        void rotate(float angle){
+            float centerX = x + (w / 2);
+            float centerY = y + (h / 2);
+
+        // Convert angle to radians
+        float radians = angle * M_PI / 180.0f;
+
+        int points[4][2] = {
+            {x, y},              // Top-left
+            {x + w, y},          // Top-right
+            {x + w, y + h},      // Bottom-right
+            {x, y + h}           // Bottom-left
+        };
+
+        for (int i = 0; i < 4; ++i) {
+            float dx = points[i][0] - centerX;
+            float dy = points[i][1] - centerY;
+            points[i][0] = round(centerX + (dx * (cos(radians)) - dy * (sin(radians))));
+            points[i][1] = round(centerY + (dx * (sin(radians)) + dy * (cos(radians))));
+        }
+
+
+        SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
+
+        
+        SDL_RenderDrawLine(renderer, points[0][0], points[0][1], points[1][0], points[1][1]); // Top edge
+        SDL_RenderDrawLine(renderer, points[1][0], points[1][1], points[2][0], points[2][1]); // Right edge
+        SDL_RenderDrawLine(renderer, points[2][0], points[2][1], points[3][0], points[3][1]); // Bottom edge
+        SDL_RenderDrawLine(renderer, points[3][0], points[3][1], points[0][0], points[0][1]); // Left edge
+
+        SDL_RenderPresent(renderer);
+        }
+
+        /**
+         * @brief Scales the rectangle by a given factor around it's center.
+         *
+         * This method adjusts the rectangle's dimensions and position relative to its center
+         * based on the specified scaling factor and redraws it.
+         *
+         * @param factor The scaling factor (greater than 1 to enlarge, less than 1 to shrink).
+         */
+        void scale(float factor){
+            float scaledWidth = w * factor;
+            float scaledHeight = h * factor;    
+
+            float tmpX = (x + w / 2) - scaledWidth / 2;
+            float tmpY = (y + h / 2) - scaledHeight / 2;
+
+            x = static_cast<int>(tmpX);
+            y = static_cast<int>(tmpY);
+            w = static_cast<int>(scaledWidth);
+            h = static_cast<int>(scaledWidth);
+            draw();
+        }
+
+        virtual void update() override {}
+};
+
+/**
+ * @class Line
+ * @brief A class representing a Line with drawing and transformation capabilities.
+ *
+ * The `Line` class provides methods to create a Line
+ * and perform transformations such as translation, rotation, and scaling. The Line
+ * is rendered using an `SDL_Renderer` and a specified color.
+ */
+class Line : public virtual shapeObj {
+    private:
+        int xStart; ///< Starting x-coordinate of the Line object.
+        int yStart; ///< Starting y-coordinate of the Line object.
+        int xEnd; ///< Ending x-coordinate of the Line object.
+        int yEnd; ///< Ending y-coordinate of the Line object.
+        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the Line in the window.
+        SDL_Color* color; ///< SDL_Color pointer used to specify the color of the Line object.
+    public:
+        virtual ~Line(){};
+
+        Line(){}
+
+        /**
+         * @brief Initializes / creates Line with given properties(position, dimensions, color) and renderer.
+         * 
+         * @param x1 The start x-coordinate of the Line object.
+         * @param y1 The start y-coordinate of the Line object.
+         * @param x2 The end x-coordinate of the Line object.
+         * @param y2 The end y-coordinate of the Line object.
+         * @param color The color which will be used to create a Line(outline color).
+         * @param renderer SDL_renderer used for rendering the Line in the window.
+         */
+        void createObject(int x1, int y1, int x2, int y2, SDL_Color* color, SDL_Renderer* renderer){
+            this->xStart = x1;
+            this->yStart = y1;           
+            this->xEnd = x2;
+            this->yEnd = y2;
+            this->renderer = renderer;
+            this->color = color;
+        }
+
+        /**
+        * @brief Draws the Line on the SDL renderer.
+        *
+        * This method sets the drawing color and renders the Line based on its start and end coordinates.
+        */
+        void draw(){
+            SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
+            SDL_RenderDrawLine(renderer, xStart, yStart, xEnd, yEnd);      
+            SDL_RenderPresent(renderer);
+        }
+
+        /**
+        * @brief Bakes the Line into a surface with the Bresenham line of the rasterizer.
+        *
+        * @param target Rasterizer of the surface to draw into.
+        */
+        void rasterize(SurfaceRasterizer& target) override {
+            target.setColor(*color);
+            target.drawLine(xStart, yStart, xEnd, yEnd);
+        }
+
+        /**
+         * @brief Translates the Line by a given offset.
+         *
+         * This method moves the Line by the specified horizontal (dx) and vertical (dy) offsets
+         * and redraws it.
+         *
+         * @param dx The horizontal offset to move the Line.
+         * @param dy The vertical offset to move the Line.
+         */        
+        void translate(int dx, int dy){
+            xStart += dx;
+            xEnd += dx;
+            yStart += dy;
+            yEnd += dy;
+            draw();
+        }
+
+        /**
+         * @brief Rotates the Line around its center by a given angle.
+         *
+         * This method computes the rotated positions of the Line's start and end points and
+         * renders the transformed Line.
+         *
+         * @param angle The angle by which to rotate the Line, in degrees(converted to the radians later).
+         */
+        void rotate(float angle){
+            float centerX = (xStart + xEnd) / 2;
+            float centerY = (yStart + yEnd) / 2;
+
+            float radians = angle * M_PI / 180.0f;
+
+            int points[2][2] = {
+                {xStart, yStart}, 
+                {xEnd, yEnd}
+            };
+
+            for(int i = 0; i < 2; ++i){
+                float dx = points[i][0] - centerX;
+                float dy = points[i][1] - centerY;
+                points[i][0] = round(centerX + (dx * (cos(radians)) - dy * (sin(radians))));
+                points[i][1] = round(centerY + (dx * (sin(radians)) + dy * (cos(radians))));
+            }
+            
+            SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
+
+            SDL_RenderDrawLine(renderer, points[0][0], points[1][0], points[0][1], points[1][1]);
+            SDL_RenderPresent(renderer);
+
+        }
+
+        /**
+        * @brief Scales the Line by a given factor.
+        *
+        * This method adjusts the Line's start and end coordinates relative to its origin
+        * based on the specified scaling factor and redraws it.
+        *
+        * @param factor The scaling factor (greater than 1 to enlarge, less than 1 to shrink).
+        */
+        void scale(float factor){  
+        float tmpX = xStart * factor;
+        float tmpY = yStart * factor;
+        float tmpX2 = xEnd * factor;
+        float tmpY2 = yEnd * factor;
+
+        xStart = static_cast<int>(tmpX);
+        yStart = static_cast<int>(tmpY);
+        xEnd = static_cast<int>(tmpX2);
+        yEnd = static_cast<int>(tmpY2);
+        draw();
+    }
+
+        virtual void update() override{};
+};
+
+/**
+ * @brief Number of straight segments needed to follow an arc so that no chord strays more than a quarter pixel from it.
+ *
+ * @param radius Radius of the arc in pixels.
+ * @param sweep Swept angle of the arc in radians.
+ * @return Segment count, at least 1.
+ */
+static int arcSegments(float radius, float sweep){
+    const float tolerance = 0.25f;
+    if(radius <= tolerance){
+        return 1;
+    }
+    float step = 2.0f * acosf(1.0f - tolerance / radius);
+    int segments = static_cast<int>(ceilf(sweep / step));
+    return segments < 1 ? 1 : (segments > 256 ? 256 : segments);
+}
+
+/**
+ * @class FilledShape
+ * @brief Base of the filled shapes, keeps their tessellated geometry cached between frames.
+ *
+ * A filled shape describes itself once as a convex outline in local coordinates (`buildOutline()`), from which a
+ * triangle fan for SDL_RenderGeometry and the per-row spans for the software rasterizer are derived.
+ * That work is only repeated when the size of the shape changes: translating, rotating or recoloring only
+ * moves the cached vertices into place. Unlike the outline shapes, transformations do not draw on their own,
+ * the shape is drawn with `draw()` or submitted together with others through a `ShapeBatch`.
+ */
+class FilledShape : public virtual shapeObj {
+    protected:
+        int x; ///< x-coordinate of the top left corner of the bounding box.
+        int y; ///< y-coordinate of the top left corner of the bounding box.
+        int w; ///< Width of the bounding box.
+        int h; ///< Height of the bounding box.
+        float angle; ///< Rotation around the center of the bounding box, in degrees.
+        SDL_Color color; ///< Fill color.
+        SDL_Renderer* renderer; ///< SDL_Renderer used by `draw()`.
+        bool geometryDirty; ///< Set by subclasses when a shape parameter other than the size changes.
+
+        /**
+         * @brief Writes the convex outline of the shape, clockwise, in coordinates local to the bounding box.
+         *
+         * @param outline Receives the outline points, it is empty when called.
+         */
+        virtual void buildOutline(vector<SDL_FPoint>& outline) = 0;
+
+    private:
+        /** @brief Horizontal run of covered pixels in local coordinates, [x0, x1). */
+        struct Span {
+            int y;
+            int x0;
+            int x1;
+        };
+        vector<SDL_FPoint> outline; ///< Cached outline in local coordinates.
+        vector<Span> spans; ///< Cached pixel rows covered by the outline, used while the shape is not rotated.
+        vector<int> indices; ///< Triangle fan around vertex 0 (the center) as a triangle list.
+        vector<SDL_Vertex> placed; ///< Fan vertices moved to the current position, angle and color.
+        vector<SDL_FPoint> rotated; ///< Scratch outline for rasterizing a rotated shape.
+        int tessellatedW; ///< Width the cached geometry was built for.
+        int tessellatedH; ///< Height the cached geometry was built for.
+        bool placedValid; ///< Whether `placed` was built for the current outline.
+        int placedX; ///< Position, angle and color `placed` was built for, state written from outside
+        int placedY; ///< (e.g. by a `TweenSystem`) is noticed by comparing with them.
+        float placedAngle;
+        SDL_Color placedColor;
+
+        void tessellate(){
+            outline.clear();
+            buildOutline(outline);
+            int count = static_cast<int>(outline.size());
+
+            indices.clear();
+            for(int i = 0; i < count; i++){
+                indices.push_back(0);
+                indices.push_back(i + 1);
+                indices.push_back((i + 1) % count + 1);
+            }
+
+            // The outline is convex, so every row crosses it exactly twice; rows are sampled at
+            // their centers like SurfaceRasterizer::fillPolygon() does.
+            spans.clear();
+            for(int row = 0; row < h; row++){
+                float sampleY = row + 0.5f;
+                float left = 0.0f, right = 0.0f;
+                bool crossed = false;
+                for(int i = 0; i < count; i++){
+                    SDL_FPoint a = outline[i], b = outline[(i + 1) % count];
+                    if(a.y > b.y){
+                        swap(a, b);
+                    }
+                    if(a.y == b.y || sampleY < a.y || sampleY >= b.y){
+                        continue;
+                    }
+                    float crossX = a.x + (sampleY - a.y) * (b.x - a.x) / (b.y - a.y);
+                    left = crossed && left < crossX ? left : crossX;
+                    right = crossed && right > crossX ? right : crossX;
+                    crossed = true;
+                }
+                Span span = {row, static_cast<int>(ceilf(left - 0.5f)), static_cast<int>(ceilf(right - 0.5f))};
+                if(crossed && span.x0 < span.x1){
+                    spans.push_back(span);
+                }
+            }
+
+            tessellatedW = w;
+            tessellatedH = h;
+            geometryDirty = false;
+            placedValid = false;
+        }
+
+        void place(){
+            if(w != tessellatedW || h != tessellatedH || geometryDirty){
+                tessellate();
+            }
+            if(placedValid && x == placedX && y == placedY && angle == placedAngle && color.r == placedColor.r
+               && color.g == placedColor.g && color.b == placedColor.b && color.a == placedColor.a){
+                return;
+            }
+            float centerX = w / 2.0f;
+            float centerY = h / 2.0f;
+            float radians = angle * M_PI / 180.0f;
+            float cosA = cosf(radians);
+            float sinA = sinf(radians);
+
+            placed.resize(outline.size() + 1);
+            for(size_t i = 0; i < placed.size(); i++){
+                float dx = i == 0 ? 0.0f : outline[i - 1].x - centerX;
+                float dy = i == 0 ? 0.0f : outline[i - 1].y - centerY;
+                placed[i].position.x = x + centerX + dx * cosA - dy * sinA;
+                placed[i].position.y = y + centerY + dx * sinA + dy * cosA;
+                placed[i].color = color;
+                placed[i].tex_coord.x = 0.0f;
+                placed[i].tex_coord.y = 0.0f;
+            }
+            placedX = x;
+            placedY = y;
+            placedAngle = angle;
+            placedColor = color;
+            placedValid = true;
+        }
+
+    public:
+        /**
+         * @brief Sets up the shape, the geometry itself is built lazily on first use.
+         *
+         * @param renderer SDL_Renderer used by `draw()`, may be NULL when the shape is only rasterized.
+         * @param x The x-coordinate of the top left corner of the bounding box.
+         * @param y The y-coordinate of the top left corner of the bounding box.
+         * @param w The width of the bounding box.
+         * @param h The height of the bounding box.
+         * @param color The fill color.
+         */
+        FilledShape(SDL_Renderer* renderer, int x, int y, int w, int h, SDL_Color color)
+            : x(x), y(y), w(w), h(h), angle(0.0f), color(color), renderer(renderer), geometryDirty(true),
+              tessellatedW(-1), tessellatedH(-1), placedValid(false) {}
+        virtual ~FilledShape() {}
+
+        /**
+         * @brief Draws the cached triangles with a single SDL_RenderGeometry call.
+         */
+        void draw() override {
+            if(w <= 0 || h <= 0){
+                return;
+            }
+            place();
+            SDL_RenderGeometry(renderer, NULL, placed.data(), static_cast<int>(placed.size()), indices.data(), static_cast<int>(indices.size()));
+        }
+
+        /**
+         * @brief Fills the shape into a surface from the cached spans, or through the polygon filler when rotated.
+         *
+         * @param target Rasterizer of the surface to draw into.
+         */
+        void rasterize(SurfaceRasterizer& target) override {
+            if(w <= 0 || h <= 0){
+                return;
+            }
+            place();
+            target.setColor(color);
+            if(fmodf(angle, 360.0f) == 0.0f){
+                for(size_t i = 0; i < spans.size(); i++){
+                    target.fillSpan(y + spans[i].y, x + spans[i].x0, x + spans[i].x1);
+                }
+                return;
+            }
+            rotated.resize(placed.size() - 1);
+            for(size_t i = 0; i < rotated.size(); i++){
+                rotated[i] = placed[i + 1].position;
+            }
+            target.fillPolygon(rotated.data(), static_cast<int>(rotated.size()));
+        }
+
+        /**
+         * @brief Appends the placed triangles of the shape to a shared vertex and index list.
+         *
+         * @param vertices Vertex list to append to.
+         * @param batchIndices Index list to append to, offset to the appended vertices.
+         */
+        void appendGeometry(vector<SDL_Vertex>& vertices, vector<int>& batchIndices){
+            if(w <= 0 || h <= 0){
+                return;
+            }
+            place();
+            int base = static_cast<int>(vertices.size());
+            vertices.insert(vertices.end(), placed.begin(), placed.end());
+            for(size_t i = 0; i < indices.size(); i++){
+                batchIndices.push_back(base + indices[i]);
+            }
+        }
+
+        /**
+         * @brief Moves the shape, the cached geometry is kept.
+         *
+         * @param dx The horizontal offset.
+         * @param dy The vertical offset.
+         */
+        void translate(int dx, int dy) override {
+            x += dx;
+            y += dy;
+            placedValid = false;
+        }
+
+        /**
+         * @brief Rotates the shape around the center of its bounding box, the cached geometry is kept.
+         *
+         * @param angle The angle to add to the current rotation, in degrees.
+         */
+        void rotate(float angle) override {
+            this->angle += angle;
+            placedValid = false;
+        }
+
+        /**
+         * @brief Scales the shape around its center, which rebuilds the geometry on next use.
+         *
+         * @param factor The scaling factor (greater than 1 to enlarge, less than 1 to shrink).
+         */
+        void scale(float factor) override {
+            float scaledWidth = w * factor;
+            float scaledHeight = h * factor;
+            x = static_cast<int>(x + w / 2.0f - scaledWidth / 2.0f);
+            y = static_cast<int>(y + h / 2.0f - scaledHeight / 2.0f);
+            w = static_cast<int>(scaledWidth);
+            h = static_cast<int>(scaledHeight);
+            placedValid = false;
+        }
+
+        /**
+         * @brief Changes the fill color, only the vertex colors are refreshed.
+         *
+         * @param color The new fill color.
+         */
+        void setColor(SDL_Color color){
+            this->color = color;
+            placedValid = false;
+        }
+
+        /**
+         * @brief Resizes the bounding box, keeping its top left corner.
+         *
+         * @param w The new width.
+         * @param h The new height.
+         */
+        void setSize(int w, int h){
+            this->w = w;
+            this->h = h;
+            placedValid = false;
+        }
+
+        int getX() { return x; }
+        int getY() { return y; }
+        int getWidth() { return w; }
+        int getHeight() { return h; }
+        float getAngle() { return angle; }
+        SDL_Color getColor() { return color; }
+
+        /**
+         * @brief Position, size, angle and color for a `TweenSystem` to write into, changes show on the next draw.
+         */
+        TweenTargets getTweenTargets(){
+            TweenTargets targets;
+            targets.x = &x;
+            targets.y = &y;
+            targets.w = &w;
+            targets.h = &h;
+            targets.angle = &angle;
+            targets.color = &color;
+            return targets;
+        }
+
+        virtual void update() override {}
+};
+
+/**
+ * @class FilledRectangle
+ * @brief A solid axis aligned rectangle (two triangles, one span per row).
+ */
+class FilledRectangle : public FilledShape {
+    protected:
+        void buildOutline(vector<SDL_FPoint>& outline) override {
+            outline.push_back({0.0f, 0.0f});
+            outline.push_back({static_cast<float>(w), 0.0f});
+            outline.push_back({static_cast<float>(w), static_cast<float>(h)});
+            outline.push_back({0.0f, static_cast<float>(h)});
+        }
+    public:
+        /**
+         * @brief Creates a filled rectangle.
+         *
+         * @param renderer SDL_Renderer used by `draw()`.
+         * @param x The x-coordinate of the top left corner.
+         * @param y The y-coordinate of the top left corner.
+         * @param w The width of the rectangle.
+         * @param h The height of the rectangle.
+         * @param color The fill color.
+         */
+        FilledRectangle(SDL_Renderer* renderer, int x, int y, int w, int h, SDL_Color color)
+            : FilledShape(renderer, x, y, w, h, color) {}
+};
+
+/**
+ * @class FilledEllipse
+ * @brief A solid axis aligned ellipse inscribed in its bounding box.
+ *
+ * The outline gets as many segments as needed to stay within a quarter pixel of the true ellipse.
+ */
+class FilledEllipse : public FilledShape {
+    protected:
+        void buildOutline(vector<SDL_FPoint>& outline) override {
+            float radiusX = w / 2.0f;
+            float radiusY = h / 2.0f;
+            int segments = arcSegments(radiusX > radiusY ? radiusX : radiusY, 2.0f * M_PI);
+            segments = segments < 8 ? 8 : segments;
+            for(int i = 0; i < segments; i++){
+                float t = 2.0f * M_PI * i / segments;
+                outline.push_back({radiusX + radiusX * cosf(t), radiusY + radiusY * sinf(t)});
+            }
+        }
+    public:
+        /**
+         * @brief Creates a filled ellipse.
+         *
+         * @param renderer SDL_Renderer used by `draw()`.
+         * @param x The x-coordinate of the top left corner of the bounding box.
+         * @param y The y-coordinate of the top left corner of the bounding box.
+         * @param w The width of the ellipse.
+         * @param h The height of the ellipse.
+         * @param color The fill color.
+         */
+        FilledEllipse(SDL_Renderer* renderer, int x, int y, int w, int h, SDL_Color color)
+            : FilledShape(renderer, x, y, w, h, color) {}
+};
+
+/**
+ * @class FilledCircle
+ * @brief A solid circle, an ellipse with equal radii which is created from its center.
+ */
+class FilledCircle : public FilledEllipse {
+    public:
+        /**
+         * @brief Creates a filled circle.
+         *
+         * @param renderer SDL_Renderer used by `draw()`.
+         * @param centerX The x-coordinate of the center.
+         * @param centerY The y-coordinate of the center.
+         * @param radius The radius of the circle.
+         * @param color The fill color.
+         */
+        FilledCircle(SDL_Renderer* renderer, int centerX, int centerY, int radius, SDL_Color color)
+            : FilledEllipse(renderer, centerX - radius, centerY - radius, 2 * radius, 2 * radius, color) {}
+
+        int getRadius() { return w / 2; }
+};
+
+/**
+ * @class FilledRoundedRect
+ * @brief A solid rectangle whose corners are quarter circles.
+ */
+class FilledRoundedRect : public FilledShape {
+    private:
+        int radius; ///< Corner radius, limited to half of the shorter side when tessellating.
+    protected:
+        void buildOutline(vector<SDL_FPoint>& outline) override {
+            float r = static_cast<float>(radius);
+            float limit = (w < h ? w : h) / 2.0f;
+            r = r > limit ? limit : (r < 0.0f ? 0.0f : r);
+            if(r == 0.0f){
+                outline.push_back({0.0f, 0.0f});
+                outline.push_back({static_cast<float>(w), 0.0f});
+                outline.push_back({static_cast<float>(w), static_cast<float>(h)});
+                outline.push_back({0.0f, static_cast<float>(h)});
+                return;
+            }
+            // Corner centers clockwise from the top right one, each arc sweeps a quarter turn.
+            const float centers[4][2] = {{w - r, r}, {w - r, h - r}, {r, h - r}, {r, r}};
+            int segments = arcSegments(r, M_PI / 2.0f);
+            for(int corner = 0; corner < 4; corner++){
+                float start = (corner - 1) * M_PI / 2.0f;
+                for(int i = 0; i <= segments; i++){
+                    float t = start + (M_PI / 2.0f) * i / segments;
+                    outline.push_back({centers[corner][0] + r * cosf(t), centers[corner][1] + r * sinf(t)});
+                }
+            }
+        }
+    public:
+        /**
+         * @brief Creates a filled rounded rectangle.
+         *
+         * @param renderer SDL_Renderer used by `draw()`.
+         * @param x The x-coordinate of the top left corner.
+         * @param y The y-coordinate of the top left corner.
+         * @param w The width of the rectangle.
+         * @param h The height of the rectangle.
+         * @param radius The corner radius.
+         * @param color The fill color.
+         */
+        FilledRoundedRect(SDL_Renderer* renderer, int x, int y, int w, int h, int radius, SDL_Color color)
+            : FilledShape(renderer, x, y, w, h, color), radius(radius) {}
+
+        /**
+         * @brief Changes the corner radius, which rebuilds the geometry on next use.
+         *
+         * @param radius The new corner radius.
+         */
+        void setRadius(int radius){
+            this->radius = radius;
+            geometryDirty = true;
+        }
+
+        /**
+         * @brief Scales the rectangle and its corner radius around its center.
+         *
+         * @param factor The scaling factor.
+         */
+        void scale(float factor) override {
+            FilledShape::scale(factor);
+            setRadius(static_cast<int>(radius * factor));
+        }
+
+        int getRadius() { return radius; }
+};
+
+/**
+ * @class ShapeBatch
+ * @brief Collects filled shapes so that they are submitted together instead of one call per shape.
+ *
+ * The placed triangles of every added shape are copied into one vertex and index list when it is added, so the
+ * batch holds a snapshot: later changes to a shape aren't seen and the shape may be destroyed before the flush.
+ * On the renderer path the list is drawn with a single SDL_RenderGeometry call, on the software path the outline
+ * of each shape is filled from the copied vertices. Either flush empties the batch, the buffers are kept for the
+ * next frame.
+ */
+class ShapeBatch {
+    private:
+        /** @brief Vertices of one added shape, the center first and then its outline. */
+        struct Range {
+            int first;
+            int count;
+        };
+
+        vector<SDL_Vertex> vertices; ///< Placed vertices of every added shape.
+        vector<int> indices; ///< Triangle list into `vertices`.
+        vector<Range> ranges; ///< Vertices of each added shape, in order, for the software path.
+        vector<SDL_FPoint> outline; ///< Scratch outline for the software path.
+    public:
+        /**
+         * @brief Adds a copy of the shape as it is now, later changes to it are not seen by this batch.
+         *
+         * @param shape The shape to add.
+         */
+        void add(FilledShape& shape){
+            int first = static_cast<int>(vertices.size());
+            shape.appendGeometry(vertices, indices);
+            int count = static_cast<int>(vertices.size()) - first;
+            if(count > 1){
+                Range range = {first, count};
+                ranges.push_back(range);
+            }
+        }
+
+        /**
+         * @brief Draws every added shape with one SDL_RenderGeometry call and empties the batch.
+         *
+         * @param renderer SDL_Renderer to draw with.
+         * @return The result of SDL_RenderGeometry, 0 when there was nothing to draw.
+         */
+        int flush(SDL_Renderer* renderer){
+            int result = 0;
+            if(!indices.empty()){
+                result = SDL_RenderGeometry(renderer, NULL, vertices.data(), static_cast<int>(vertices.size()), indices.data(), static_cast<int>(indices.size()));
+            }
+            clear();
+            return result;
+        }
+
+        /**
+         * @brief Fills every added shape into a surface, in the order they were added, and empties the batch.
+         *
+         * @param target Rasterizer of the surface to draw into.
+         */
+        void flush(SurfaceRasterizer& target){
+            for(const Range& range : ranges){
+                outline.clear();
+                for(int i = range.first + 1; i < range.first + range.count; i++){
+                    outline.push_back(vertices[i].position);
+                }
+                target.setColor(vertices[range.first].color);
+                target.fillPolygon(outline.data(), static_cast<int>(outline.size()));
+            }
+            clear();
+        }
+
+        void clear(){
+            vertices.clear();
+            indices.clear();
+            ranges.clear();
+        }
+
+        size_t getShapeCount() { return ranges.size(); }
+        size_t getTriangleCount() { return indices.size() / 3; }
+};
+
+/**
+ * @class BitmapManager
+ * @brief This class will be handling fundamental bitmap operations such as creation, loading, deleting, saving and copying to other bmp.
+ * 
+ * Will be using SDL's SDL_Surface structure to manipulate bitmap operations.
+ *
+ * Copies of a `BitmapManager` share one reference counted surface (SDL_Surface::refcount) and each of them
+ * duplicates it on its first write, so variants and undo snapshots cost nothing until they diverge.
+ * Writes are everything that goes through `editSurface()`: being the destination of `copyTo()`, `getRasterizer()` and
+ * `bake()`, a `FilterPipeline` result simply replaces the shared surface. The counting is not atomic, copies of one
+ * bitmap belong to one thread.
+ */
+class BitmapManager {
+    private:
+        SDL_Surface* imageSurface = NULL; ///< Pointer to the SDL_Surface representing the bitmap image.
+        Uint64 generation = 0; ///< Changes whenever the pixels may have changed, unique across all managers.
+        bool premultiplied = false; ///< `true` after `premultiplyAlpha()`, until other pixels are loaded.
+
+        /** @brief Next value of the process wide generation counter. */
+        static Uint64 nextGeneration(){
+            static SDL_atomic_t counter;
+            return static_cast<Uint64>(SDL_AtomicIncRef(&counter)) + 1;
+        }
+
+        /** @brief Gives this bitmap its own copy of the surface if anything else still references it. */
+        bool detach(){
+            if(imageSurface == NULL || imageSurface->refcount <= 1){
+                return true;
+            }
+            SDL_Surface* copy = SDL_DuplicateSurface(imageSurface);
+            if(copy == NULL){
+                return false;
+            }
+            SDL_FreeSurface(imageSurface); // drops our reference, the other owners keep the original
+            imageSurface = copy;
+            return true;
+        }
+    public:
+        /**
+         * @brief Destructor for the `BitmapManager` class.
+         * 
+         * Cleans up and deletes any associated resources by freeing the `imageSurface`, freeing the surface is important mechanic in the Manager. 
+         */
+        virtual ~BitmapManager(){deleteBitmapObj();}
+
+        BitmapManager(){}
+
+        /**
+         * @brief Copy constructor, shares the surface of `other` until either of them writes into it.
+         */
+        BitmapManager(const BitmapManager& other) : imageSurface(other.imageSurface), generation(other.generation), premultiplied(other.premultiplied){
+            if(imageSurface != NULL){
+                imageSurface->refcount++;
+            }
+        }
+
+        /**
+         * @brief Copy assignment, releases the current surface and shares the one of `other`.
+         */
+        BitmapManager& operator=(const BitmapManager& other){
+            if(this != &other){
+                if(other.imageSurface != NULL){
+                    other.imageSurface->refcount++;
+                }
+                deleteBitmapObj();
+                imageSurface = other.imageSurface;
+                generation = other.generation;
+                premultiplied = other.premultiplied;
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Makes the bitmap share an existing surface (e.g. a cached filter result) instead of copying it.
+         *
+         * The surface gets one more reference, it is duplicated before this bitmap first writes into it.
+         *
+         * @param surface Surface to share, `NULL` empties the bitmap.
+         */
+        void shareSurface(SDL_Surface* surface){
+            if(surface != NULL){
+                surface->refcount++;
+            }
+            deleteBitmapObj();
+            imageSurface = surface;
+            premultiplied = false;
+            markModified();
+        }
+
+        /**
+         * @brief Loads bitmap image from a given string filename into the surface(`imageSurface`).
+         * 
+         * If a surface is already loaded, it frees that surface so we can keep using it.
+         * 
+         * @param filename Reference to a string containing the path and file itself that we ought to load.
+         * @return `true` if the image is successfully loaded, `false` if it couldn't either find it with given path,
+         * or the file doesn't exist.
+         */
+        bool loadBitmapContent(string& filename){
+            if(imageSurface != NULL){
+                SDL_FreeSurface(imageSurface);
+                imageSurface = NULL;
+            }
+            
+            imageSurface = IMG_Load(filename.c_str());
+            premultiplied = false;
+            markModified();
+            if(imageSurface != NULL){
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Creates a bitmap object / new blank bitmap surface with the specified height, width and bit depth.
+         * 
+         * If a surface is already loaded, it frees that surface so we can keep using it.
+         * Creates a surface with the specified format.
+         * 
+         * @param bWidth The width of the bitmap.
+         * @param bHeight The height of the bitmap.
+         * @param depth The bit depth of the bitmap(set to 24 by default), 32 creates an ARGB8888 surface with alpha.
+         * @return `true` if the surface is successfully created, `false` if it isn't.
+         */
+        bool createBitmapObj(int bWidth, int bHeight, int depth = 24){
+            if(imageSurface != NULL){
+                SDL_FreeSurface(imageSurface);
+                imageSurface = NULL;
+            }
+            imageSurface = SDL_CreateRGBSurfaceWithFormat(0, bWidth, bHeight, depth, depth == 32 ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_RGB24);
+            premultiplied = false;
+            markModified();
+
+            if(imageSurface != NULL){
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief deletes the bitmap object / current bitmap surface, by freeing the surface.
+         */
+        void deleteBitmapObj(){
+            if(imageSurface != NULL){
+                SDL_FreeSurface(imageSurface);
+                imageSurface = NULL;
+                markModified();
+            }
+        }
+        /**
+        * @brief Saves the current bitmap surface to a specified file.
+        *
+        * This method saves the bitmap content to the specified file.
+        *
+        * @param filename Reference to a string containing the path where the bitmap will be saved.
+        * @return `true` if the file is successfully saved, `false` otherwise.
+        */
+        bool saveToFile(string& filename){ // can either save to already exisitng or specify the path myself in parameter;  
+            if(imageSurface != NULL){ // checks if it exists
+                if(SDL_SaveBMP(imageSurface, filename.c_str()) == 0){
+                    /*or should I make it < 0, which will mean save filed*/
+                    return true; // file was saved
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Copies the bitmap content to another `BitmapManager` object.
+         *
+         * Performs a blit operation to copy the content of this surface to the destination surface.
+         *
+         * @param copyDestination Reference to another `BitmapManager` object where the content will be copied.
+         * @return `true` if the copy operation is successful, `false` otherwise.
+         */
+        bool copyTo(BitmapManager& copyDestination){
+            if(imageSurface && copyDestination.editSurface()){
+                SDL_BlitSurface(imageSurface, nullptr, copyDestination.imageSurface, nullptr);
+                return true;
+            }
+            return false; // copying failed cuz there is either no surface or no copyDest.
+        }
+
+        /**
+         * @brief Copies a rectangle of the bitmap onto another `BitmapManager` with a compositing mode.
+         *
+         * Clipped like SDL_BlitSurface. 32-bit surfaces with alpha use the SIMD kernels (`blitSurface()`),
+         * other formats go through SDL with the equivalent blend mode.
+         *
+         * @param copyDestination Reference to another `BitmapManager` object where the content will be composited.
+         * @param srcRect Part of this bitmap to copy, `NULL` for all of it.
+         * @param destRect Position in the destination (`w` / `h` are ignored), `NULL` for the top left corner.
+         * @param mode How source and destination pixels are combined.
+         * @param alpha Global alpha multiplied with the per-pixel alpha (`BLIT_ALPHA`, `BLIT_ADDITIVE`).
+         * @param colorKey Color that is skipped in `BLIT_COLORKEY` mode, 0xRRGGBB for ARGB8888 surfaces.
+         * @return `true` if anything was drawn, `false` otherwise.
+         */
+        bool copyTo(BitmapManager& copyDestination, const SDL_Rect* srcRect, const SDL_Rect* destRect, BlitMode mode, Uint8 alpha = 255, Uint32 colorKey = 0){
+            return blitSurface(imageSurface, srcRect, copyDestination.editSurface(), destRect, mode, alpha, colorKey);
+        }
+
+        /**
+         * @brief Copies a rectangle of the bitmap onto another `BitmapManager` scaled, rotated and / or flipped.
+         *
+         * Software counterpart of SDL_RenderCopyExF, see `blitSurfaceTransformed()`. Both bitmaps must be 32-bit
+         * with the same layout (e.g. created with depth 32).
+         *
+         * @param copyDestination Reference to another `BitmapManager` object where the content will be composited.
+         * @param srcRect Part of this bitmap to copy, `NULL` for all of it.
+         * @param destRect Where the unrotated copy lands, its size sets the scale.
+         * @param angle Clockwise rotation in degrees.
+         * @param center Pivot relative to `destRect`, `NULL` for its center.
+         * @param flip Mirroring of the copy.
+         * @param filter Sampling filter.
+         * @param mode How source and destination pixels are combined.
+         * @param alpha Global alpha multiplied with the per-pixel alpha (`BLIT_ALPHA`, `BLIT_ADDITIVE`).
+         * @param colorKey Color that is skipped in `BLIT_COLORKEY` mode.
+         * @return `true` if anything was drawn, `false` otherwise.
+         */
+        bool copyTo(BitmapManager& copyDestination, const SDL_Rect* srcRect, const SDL_FRect& destRect, double angle, const SDL_FPoint* center,
+                    SDL_RendererFlip flip, SampleFilter filter, BlitMode mode, Uint8 alpha = 255, Uint32 colorKey = 0){
+            return blitSurfaceTransformed(imageSurface, srcRect, copyDestination.editSurface(), destRect, angle, center, flip, filter, mode, alpha, colorKey);
+        }
+
+        /**
+         * @brief Gives a CPU rasterizer drawing into the bitmap.
+         *
+         * The rasterizer needs 32-bit pixels, a bitmap in another format (e.g. the default RGB24 of `createBitmapObj()`)
+         * is converted to ARGB8888 first.
+         *
+         * @return Rasterizer of the surface, check `isValid()` when there may be no surface.
+         */
+        SurfaceRasterizer getRasterizer(){
+            if(imageSurface != NULL && imageSurface->format->BytesPerPixel != 4){
+                SDL_Surface* converted = SDL_ConvertSurfaceFormat(imageSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+                if(converted != NULL){
+                    SDL_FreeSurface(imageSurface);
+                    imageSurface = converted;
+                }
+            }
+            return SurfaceRasterizer(editSurface());
+        }
+
+        /**
+         * @brief Bakes a shape (Line, LineSegment, Rectangle, ...) into the bitmap without going through the renderer.
+         *
+         * @param shape Shape to draw.
+         * @return `false` if there is no surface to draw into.
+         */
+        bool bake(shapeObj& shape){
+            SurfaceRasterizer rasterizer = getRasterizer();
+            if(!rasterizer.isValid()){
+                return false;
+            }
+            shape.rasterize(rasterizer);
+            return true;
+        }
+
+        /**
+         * @brief Getter method for surface.
+         * 
+         * Provides a read only access to the surface, it may be shared with other bitmaps, use `editSurface()` to write.
+         */
+        SDL_Surface* getSurface() {
+            return imageSurface;
+        }
+
+        /**
+         * @brief Surface to write into: copied first if it is shared, and the bitmap gets a new generation.
+         *
+         * @return The surface owned by this bitmap alone, `NULL` if there is none or the copy failed.
+         */
+        SDL_Surface* editSurface() {
+            if(!detach()){
+                return NULL;
+            }
+            markModified();
+            return imageSurface;
+        }
+
+        /**
+         * @brief Converts the bitmap to premultiplied ARGB8888 in place (SDL_PremultiplyAlpha), for `BLIT_PREMULTIPLIED`
+         * and the premultiplied blend mode of `Engine`. Converting twice does nothing.
+         *
+         * @return `false` if there is no surface or it couldn't be converted.
+         */
+        bool premultiplyAlpha(){
+            if(imageSurface == NULL){
+                return false;
+            }
+            if(premultiplied){
+                return true;
+            }
+            if(imageSurface->format->format != SDL_PIXELFORMAT_ARGB8888){
+                SDL_Surface* converted = SDL_ConvertSurfaceFormat(imageSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+                if(converted == NULL){
+                    return false;
+                }
+                SDL_FreeSurface(imageSurface);
+                imageSurface = converted;
+            }
+            SDL_Surface* target = editSurface();
+            if(target == NULL){
+                return false;
+            }
+            if(SDL_MUSTLOCK(target)){SDL_LockSurface(target);}
+            int result = SDL_PremultiplyAlpha(target->w, target->h, SDL_PIXELFORMAT_ARGB8888, target->pixels, target->pitch,
+                                              SDL_PIXELFORMAT_ARGB8888, target->pixels, target->pitch);
+            if(SDL_MUSTLOCK(target)){SDL_UnlockSurface(target);}
+            premultiplied = result == 0;
+            return premultiplied;
+        }
+
+        /** @brief `true` when the colors are premultiplied by their alpha. */
+        bool isPremultiplied() {
+            return premultiplied;
+        }
+
+        /** @brief `true` while the surface is shared with another bitmap (or a cache). */
+        bool isShared() {
+            return imageSurface != NULL && imageSurface->refcount > 1;
+        }
+
+        /**
+         * @brief Generation of the pixels, caches built from this bitmap (e.g. `FilterPipeline`) compare it to notice changes.
+         */
+        Uint64 getGeneration() {
+            return generation;
+        }
+
+        /**
+         * @brief Gives the bitmap a new generation, `editSurface()` and every other write call it.
+         */
+        void markModified() {
+            generation = nextGeneration();
+        }
+};
+
+/**
+ * @class FilterPipeline
+ * @brief Chainable CPU filters for sprite surfaces: tint, grayscale, flash, blur and outline.
+ *
+ * Point filters (`tint()`, `grayscale()`, `flash()`) are affine in RGB, so any run of them is composed into one
+ * color matrix when added. That matrix is applied while the following spatial filter loads its source rows, or
+ * while the last one stores its result, so each pixel is read once per spatial filter and a chain of only point
+ * filters is a single pass. Blur is a separable Gaussian on premultiplied colors (no dark fringes around
+ * transparent pixels), outline is a separable alpha dilation composited under the sprite. Every pass splits
+ * its rows into chunks on a `JobSystem`.
+ *
+ * Results are cached by the generation of the source bitmap and the signature of the pipeline (the list of its
+ * filters with their parameters), shared across pipelines, so many sprites flashing the same way filter once.
+ * The output has the size of the input, blur and outline need a transparent margin around the sprite to spread into.
+ *
+ * @code
+ * FilterPipeline hurt;
+ * hurt.flash({255, 255, 255, 255}, 0.6f).outline({200, 0, 0, 255}, 1);
+ * hurt.applyTo(soldierHurt, hurtFlashed);
+ * @endcode
+ */
+class FilterPipeline {
+    private:
+        enum StageType {
+            STAGE_POINT, ///< color matrix only.
+            STAGE_BLUR, ///< separable Gaussian blur.
+            STAGE_OUTLINE ///< separable alpha dilation under the sprite.
+        };
+
+        /** @brief Affine RGB transform, rows are the output channels r, g, b, columns r, g, b and a constant (0-1). */
+        struct ColorMatrix {
+            float m[3][4];
+
+            ColorMatrix(){
+                for(int row = 0; row < 3; row++){
+                    for(int col = 0; col < 4; col++){
+                        m[row][col] = row == col ? 1.0f : 0.0f;
+                    }
+                }
+            }
+
+            /** @brief `this` applied after `first`. */
+            ColorMatrix after(const ColorMatrix& first) const {
+                ColorMatrix result;
+                for(int row = 0; row < 3; row++){
+                    for(int col = 0; col < 4; col++){
+                        float sum = col == 3 ? m[row][3] : 0.0f;
+                        for(int k = 0; k < 3; k++){
+                            sum += m[row][k] * first.m[k][col];
+                        }
+                        result.m[row][col] = sum;
+                    }
+                }
+                return result;
+            }
+
+            bool isIdentity() const {
+                ColorMatrix identity;
+                return memcmp(m, identity.m, sizeof(m)) == 0;
+            }
+        };
+
+        /** @brief `ColorMatrix` in 4.12 fixed point with the constant scaled to 0-255, as the passes use it. */
+        struct FixedMatrix {
+            Sint32 m[3][4];
+            bool identity;
+
+            FixedMatrix(const ColorMatrix& color = ColorMatrix()){
+                for(int row = 0; row < 3; row++){
+                    for(int col = 0; col < 4; col++){
+                        m[row][col] = static_cast<Sint32>(lroundf(color.m[row][col] * (col == 3 ? 255.0f * 4096.0f : 4096.0f)));
+                    }
+                }
+                identity = color.isIdentity();
+            }
+
+            Uint32 apply(Uint32 pixel) const {
+                if(identity){
+                    return pixel;
+                }
+                Sint32 r = (pixel >> 16) & 0xFF, g = (pixel >> 8) & 0xFF, b = pixel & 0xFF;
+                Uint32 result = pixel & 0xFF000000;
+                for(int row = 0; row < 3; row++){
+                    Sint32 c = (m[row][0] * r + m[row][1] * g + m[row][2] * b + m[row][3] + 2048) >> 12;
+                    result |= static_cast<Uint32>(c < 0 ? 0 : (c > 255 ? 255 : c)) << (16 - row * 8);
+                }
+                return result;
+            }
+        };
+
+        struct Stage {
+            StageType type;
+            ColorMatrix color; ///< `STAGE_POINT` matrix.
+            int radius; ///< Blur radius or outline thickness in pixels.
+            SDL_Color outlineColor; ///< `STAGE_OUTLINE` color.
+        };
+
+        /** @brief One pass over the image: a spatial filter with the point filters before / after it folded in. */
+        struct Pass {
+            StageType type;
+            int radius;
+            SDL_Color outlineColor;
+            FixedMatrix pre; ///< Applied to every source pixel as it is loaded.
+            FixedMatrix post; ///< Applied to every result pixel before it is stored.
+        };
+
+        struct CacheEntry {
+            Uint64 generation; ///< Generation of the source bitmap.
+            string signature; ///< Signature of the pipeline that produced `result`.
+            SDL_Surface* result; ///< Filtered ARGB8888 surface, owned by the cache.
+            Uint64 lastUse; ///< For least recently used eviction.
+        };
+
+        vector<Stage> stages; ///< Filters in order, consecutive point filters already merged.
+        string signature; ///< Text form of `stages`, part of the cache key.
+        JobSystem* jobs; ///< Job system the passes run on.
+
+        static vector<CacheEntry>& cache(){
+            static vector<CacheEntry> entries;
+            return entries;
+        }
+
+        static SDL_mutex* cacheLock(){
+            static SDL_mutex* lock = SDL_CreateMutex();
+            return lock;
+        }
+
+        static const size_t cacheLimit = 64; ///< Cached results kept across all pipelines.
+
+        FilterPipeline& addPoint(const ColorMatrix& color, const char* name, float a, float b, float c, float d){
+            if(!stages.empty() && stages.back().type == STAGE_POINT){
+                stages.back().color = color.after(stages.back().color);
+            } else {
+                Stage stage = {STAGE_POINT, color, 0, {0, 0, 0, 0}};
+                stages.push_back(stage);
+            }
+            char text[96];
+            snprintf(text, sizeof(text), "%s(%g,%g,%g,%g)|", name, a, b, c, d);
+            signature += text;
+            return *this;
+        }
+
+        static Uint32 premultiply(Uint32 pixel){
+            Uint32 a = pixel >> 24;
+            return (pixel & 0xFF000000) | (divideBy255(((pixel >> 16) & 0xFF) * a) << 16) |
+                   (divideBy255(((pixel >> 8) & 0xFF) * a) << 8) | divideBy255((pixel & 0xFF) * a);
+        }
+
+        static Uint32 unpremultiply(Uint32 r, Uint32 g, Uint32 b, Uint32 a){
+            if(a == 0){
+                return 0;
+            }
+            r = (r * 255 + a / 2) / a;
+            g = (g * 255 + a / 2) / a;
+            b = (b * 255 + a / 2) / a;
+            return (a << 24) | ((r > 255 ? 255 : r) << 16) | ((g > 255 ? 255 : g) << 8) | (b > 255 ? 255 : b);
+        }
+
+        static Uint32* rowOf(SDL_Surface* surface, int y){
+            return reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+        }
+
+        void runPoint(SDL_Surface* src, SDL_Surface* dst, const Pass& pass){
+            FixedMatrix combined = pass.pre; // a point-only pipeline has a single merged matrix in `pre`
+            jobs->parallelFor(src->h, [&](int begin, int end){
+                for(int y = begin; y < end; y++){
+                    const Uint32* in = rowOf(src, y);
+                    Uint32* out = rowOf(dst, y);
+                    for(int x = 0; x < src->w; x++){
+                        out[x] = combined.apply(in[x]);
+                    }
+                }
+            }, 8);
+        }
+
+        void runBlur(SDL_Surface* src, SDL_Surface* dst, const Pass& pass){
+            int w = src->w, h = src->h, r = pass.radius;
+            // integer Gaussian weights (sigma = radius / 2) summing to 4096, rounding error goes to the center tap
+            vector<Sint32> weights(2 * r + 1);
+            float sigma = r / 2.0f > 0.5f ? r / 2.0f : 0.5f, total = 0.0f;
+            vector<float> exact(2 * r + 1);
+            for(int k = -r; k <= r; k++){
+                exact[k + r] = expf(-(k * k) / (2.0f * sigma * sigma));
+                total += exact[k + r];
+            }
+            Sint32 sum = 0;
+            for(int k = 0; k <= 2 * r; k++){
+                weights[k] = static_cast<Sint32>(lroundf(exact[k] / total * 4096.0f));
+                sum += weights[k];
+            }
+            weights[r] += 4096 - sum;
+
+            // horizontal: pre matrix + premultiply once per source pixel into a padded row, then convolve
+            vector<Uint32> horizontal(static_cast<size_t>(w) * h);
+            jobs->parallelFor(h, [&](int begin, int end){
+                vector<Sint32> padded(4 * (w + 2 * r));
+                for(int y = begin; y < end; y++){
+                    const Uint32* in = rowOf(src, y);
+                    for(int x = -r; x < w + r; x++){
+                        Uint32 p = premultiply(pass.pre.apply(in[x < 0 ? 0 : (x >= w ? w - 1 : x)]));
+                        Sint32* lanes = &padded[4 * (x + r)];
+                        lanes[0] = p & 0xFF;
+                        lanes[1] = (p >> 8) & 0xFF;
+                        lanes[2] = (p >> 16) & 0xFF;
+                        lanes[3] = p >> 24;
+                    }
+                    Uint32* out = &horizontal[static_cast<size_t>(y) * w];
+                    for(int x = 0; x < w; x++){
+                        Sint32 acc[4] = {2048, 2048, 2048, 2048};
+                        const Sint32* lanes = &padded[4 * x];
+                        for(int k = 0; k <= 2 * r; k++, lanes += 4){
+                            acc[0] += lanes[0] * weights[k];
+                            acc[1] += lanes[1] * weights[k];
+                            acc[2] += lanes[2] * weights[k];
+                            acc[3] += lanes[3] * weights[k];
+                        }
+                        out[x] = ((acc[3] >> 12) << 24) | ((acc[2] >> 12) << 16) | ((acc[1] >> 12) << 8) | (acc[0] >> 12);
+                    }
+                }
+            });
+
+            // vertical: accumulate whole rows tap by tap, then unpremultiply and apply the post matrix
+            jobs->parallelFor(h, [&](int begin, int end){
+                vector<Sint32> acc(4 * w);
+                for(int y = begin; y < end; y++){
+                    fill(acc.begin(), acc.end(), 2048);
+                    for(int k = -r; k <= r; k++){
+                        int sy = y + k < 0 ? 0 : (y + k >= h ? h - 1 : y + k);
+                        const Uint32* in = &horizontal[static_cast<size_t>(sy) * w];
+                        Sint32 weight = weights[k + r];
+                        for(int x = 0; x < w; x++){
+                            Uint32 p = in[x];
+                            acc[4 * x] += static_cast<Sint32>(p & 0xFF) * weight;
+                            acc[4 * x + 1] += static_cast<Sint32>((p >> 8) & 0xFF) * weight;
+                            acc[4 * x + 2] += static_cast<Sint32>((p >> 16) & 0xFF) * weight;
+                            acc[4 * x + 3] += static_cast<Sint32>(p >> 24) * weight;
+                        }
+                    }
+                    Uint32* out = rowOf(dst, y);
+                    for(int x = 0; x < w; x++){
+                        out[x] = pass.post.apply(unpremultiply(acc[4 * x + 2] >> 12, acc[4 * x + 1] >> 12, acc[4 * x] >> 12, acc[4 * x + 3] >> 12));
+                    }
+                }
+            });
+        }
+
+        void runOutline(SDL_Surface* src, SDL_Surface* dst, const Pass& pass){
+            int w = src->w, h = src->h, t = pass.radius;
+            // horizontal max of alpha, the color matrix doesn't touch alpha so the source is used as is
+            vector<Uint8> widened(static_cast<size_t>(w) * h);
+            jobs->parallelFor(h, [&](int begin, int end){
+                for(int y = begin; y < end; y++){
+                    const Uint32* in = rowOf(src, y);
+                    Uint8* out = &widened[static_cast<size_t>(y) * w];
+                    for(int x = 0; x < w; x++){
+                        Uint32 best = 0;
+                        int from = x - t < 0 ? 0 : x - t, to = x + t >= w ? w - 1 : x + t;
+                        for(int k = from; k <= to; k++){
+                            Uint32 a = in[k] >> 24;
+                            best = a > best ? a : best;
+                        }
+                        out[x] = static_cast<Uint8>(best);
+                    }
+                }
+            });
+
+            // vertical max, then the (pre transformed) sprite pixel "over" the outline color
+            Uint32 outline = (static_cast<Uint32>(pass.outlineColor.r) << 16) | (static_cast<Uint32>(pass.outlineColor.g) << 8) | pass.outlineColor.b;
+            jobs->parallelFor(h, [&](int begin, int end){
+                vector<Uint8> dilated(w);
+                for(int y = begin; y < end; y++){
+                    fill(dilated.begin(), dilated.end(), 0);
+                    int from = y - t < 0 ? 0 : y - t, to = y + t >= h ? h - 1 : y + t;
+                    for(int k = from; k <= to; k++){
+                        const Uint8* in = &widened[static_cast<size_t>(k) * w];
+                        for(int x = 0; x < w; x++){
+                            dilated[x] = in[x] > dilated[x] ? in[x] : dilated[x];
+                        }
+                    }
+                    const Uint32* in = rowOf(src, y);
+                    Uint32* out = rowOf(dst, y);
+                    for(int x = 0; x < w; x++){
+                        Uint32 s = pass.pre.apply(in[x]);
+                        Uint32 sa = s >> 24;
+                        Uint32 oa = divideBy255(dilated[x] * pass.outlineColor.a);
+                        Uint32 under = divideBy255(oa * (255 - sa));
+                        Uint32 a = sa + under;
+                        Uint32 rgb[3];
+                        for(int c = 0; c < 3; c++){
+                            int shift = 16 - c * 8;
+                            Uint32 total = ((s >> shift) & 0xFF) * sa + ((outline >> shift) & 0xFF) * under;
+                            rgb[c] = a ? (total + a / 2) / a : 0;
+                        }
+                        out[x] = pass.post.apply((a << 24) | (rgb[0] << 16) | (rgb[1] << 8) | rgb[2]);
+                    }
+                }
+            });
+        }
+
+        SDL_Surface* run(SDL_Surface* source){
+            vector<Pass> passes;
+            ColorMatrix pending;
+            for(const Stage& stage : stages){
+                if(stage.type == STAGE_POINT){
+                    pending = stage.color.after(pending);
+                    continue;
+                }
+                Pass pass = {stage.type, stage.radius, stage.outlineColor, FixedMatrix(pending), FixedMatrix()};
+                passes.push_back(pass);
+                pending = ColorMatrix();
+            }
+            if(passes.empty()){
+                Pass pass = {STAGE_POINT, 0, {0, 0, 0, 0}, FixedMatrix(pending), FixedMatrix()};
+                passes.push_back(pass);
+            } else {
+                passes.back().post = FixedMatrix(pending);
+            }
+
+            SDL_Surface* current = source->format->format == SDL_PIXELFORMAT_ARGB8888 ? source : SDL_ConvertSurfaceFormat(source, SDL_PIXELFORMAT_ARGB8888, 0);
+            if(current == NULL){
+                return NULL;
+            }
+            bool lockSource = current == source && SDL_MUSTLOCK(source);
+            if(lockSource){SDL_LockSurface(source);}
+            for(const Pass& pass : passes){
+                SDL_Surface* next = SDL_CreateRGBSurfaceWithFormat(0, current->w, current->h, 32, SDL_PIXELFORMAT_ARGB8888);
+                if(next != NULL){
+                    if(pass.type == STAGE_BLUR){
+                        runBlur(current, next, pass);
+                    } else if(pass.type == STAGE_OUTLINE){
+                        runOutline(current, next, pass);
+                    } else {
+                        runPoint(current, next, pass);
+                    }
+                }
+                if(current != source){
+                    SDL_FreeSurface(current);
+                }
+                current = next;
+                if(current == NULL){
+                    break;
+                }
+            }
+            if(lockSource){SDL_UnlockSurface(source);}
+            return current;
+        }
+
+    public:
+        /**
+         * @brief Empty pipeline, filters are added with the chainable methods.
+         *
+         * @param jobs Job system the passes run on, the shared one by default.
+         */
+        FilterPipeline(JobSystem& jobs = JobSystem::shared()) : jobs(&jobs) {}
+
+        /**
+         * @brief Multiplies the colors with `color`, `amount` fades between no change (0) and the full multiply (1).
+         */
+        FilterPipeline& tint(SDL_Color color, float amount = 1.0f){
+            ColorMatrix matrix;
+            const Uint8 channels[3] = {color.r, color.g, color.b};
+            for(int c = 0; c < 3; c++){
+                matrix.m[c][c] = 1.0f - amount + amount * channels[c] / 255.0f;
+            }
+            return addPoint(matrix, "tint", color.r, color.g, color.b, amount);
+        }
+
+        /**
+         * @brief Desaturates towards BT.601 luma, `amount` 1 is fully gray.
+         */
+        FilterPipeline& grayscale(float amount = 1.0f){
+            const float luma[3] = {0.299f, 0.587f, 0.114f};
+            ColorMatrix matrix;
+            for(int row = 0; row < 3; row++){
+                for(int col = 0; col < 3; col++){
+                    matrix.m[row][col] = (row == col ? 1.0f - amount : 0.0f) + amount * luma[col];
+                }
+            }
+            return addPoint(matrix, "gray", amount, 0, 0, 0);
+        }
+
+        /**
+         * @brief Blends the colors towards a flat `color` keeping the alpha, e.g. a white damage flash.
+         */
+        FilterPipeline& flash(SDL_Color color, float amount = 1.0f){
+            ColorMatrix matrix;
+            const Uint8 channels[3] = {color.r, color.g, color.b};
+            for(int c = 0; c < 3; c++){
+                matrix.m[c][c] = 1.0f - amount;
+                matrix.m[c][3] = amount * channels[c] / 255.0f;
+            }
+            return addPoint(matrix, "flash", color.r, color.g, color.b, amount);
+        }
+
+        /**
+         * @brief Separable Gaussian blur with the given radius (sigma is half of it).
+         */
+        FilterPipeline& blur(int radius){
+            if(radius > 0){
+                Stage stage = {STAGE_BLUR, ColorMatrix(), radius, {0, 0, 0, 0}};
+                stages.push_back(stage);
+                signature += "blur(" + to_string(radius) + ")|";
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Draws `color` under the sprite wherever it is within `thickness` pixels (square) of a covered pixel.
+         */
+        FilterPipeline& outline(SDL_Color color, int thickness = 1){
+            if(thickness > 0){
+                Stage stage = {STAGE_OUTLINE, ColorMatrix(), thickness, color};
+                stages.push_back(stage);
+                char text[64];
+                snprintf(text, sizeof(text), "outline(%d,%d,%d,%d,%d)|", color.r, color.g, color.b, color.a, thickness);
+                signature += text;
+            }
+            return *this;
+        }
+
+        /** @brief Removes every filter. */
+        FilterPipeline& clear(){
+            stages.clear();
+            signature.clear();
+            return *this;
+        }
+
+        /** @brief Text form of the filters, equal pipelines share cached results. */
+        const string& getSignature(){
+            return signature;
+        }
+
+        /**
+         * @brief Filters the bitmap, or returns the cached result if this bitmap generation went through an equal pipeline before.
+         *
+         * @param source Bitmap to filter, any format.
+         * The cache may evict the result at any time, so the caller gets its own reference (taken under the cache lock)
+         * and has to release it with SDL_FreeSurface when done.
+         *
+         * @return ARGB8888 surface the caller frees, `NULL` without a source.
+         */
+        SDL_Surface* apply(BitmapManager& source){
+            SDL_Surface* surface = source.getSurface();
+            if(surface == NULL){
+                return NULL;
+            }
+            static Uint64 useCounter = 0;
+            vector<CacheEntry>& entries = cache();
+            SDL_LockMutex(cacheLock());
+            for(CacheEntry& entry : entries){
+                if(entry.generation == source.getGeneration() && entry.signature == signature){
+                    entry.lastUse = ++useCounter;
+                    SDL_Surface* result = entry.result;
+                    result->refcount++;
+                    SDL_UnlockMutex(cacheLock());
+                    return result;
+                }
+            }
+            SDL_UnlockMutex(cacheLock());
+
+            SDL_Surface* result = run(surface);
+            if(result == NULL){
+                return NULL;
+            }
+            SDL_LockMutex(cacheLock());
+            if(entries.size() >= cacheLimit){
+                auto oldest = min_element(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b){return a.lastUse < b.lastUse;});
+                SDL_FreeSurface(oldest->result);
+                entries.erase(oldest);
+            }
+            CacheEntry entry = {source.getGeneration(), signature, result, ++useCounter};
+            entries.push_back(entry);
+            result->refcount++;
+            SDL_UnlockMutex(cacheLock());
+            return result;
+        }
+
+        /**
+         * @brief Filters the bitmap into another `BitmapManager`, which becomes an ARGB8888 bitmap of the same size.
+         *
+         * The destination shares the cached result and only copies it if it is written into later.
+         *
+         * @return `false` if there was no source or the filters failed.
+         */
+        bool applyTo(BitmapManager& source, BitmapManager& destination){
+            SDL_Surface* result = apply(source);
+            if(result == NULL){
+                return false;
+            }
+            destination.shareSurface(result);
+            SDL_FreeSurface(result);
+            return true;
+        }
+
+        /** @brief Frees every cached result of every pipeline. */
+        static void clearCache(){
+            SDL_LockMutex(cacheLock());
+            for(CacheEntry& entry : cache()){
+                SDL_FreeSurface(entry.result);
+            }
+            cache().clear();
+            SDL_UnlockMutex(cacheLock());
+        }
+};
+
+/**
+ * @brief Filter used to generate the mip levels of a `BitmapObject`.
+ */
+enum MipFilter {
+    MIP_NONE, ///< no mip chain, the renderer resamples the full texture.
+    MIP_BOX, ///< 2x2 box filter, SIMD, cheapest to build.
+    MIP_LANCZOS ///< separable Lanczos-2 filter, sharper levels for detailed art, built once at load.
+};
+
+/**
+ * @brief Per-byte average of four packed pixels, `(a + b + c + d + 2) >> 2` rounded to nearest.
+ */
+static inline Uint32 averagePixels(Uint32 a, Uint32 b, Uint32 c, Uint32 d){
+    Uint32 result = 0;
+    for(int shift = 0; shift < 32; shift += 8){
+        Uint32 sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        result |= ((sum + 2) >> 2) << shift;
+    }
+    return result;
+}
+
+/**
+ * @brief Scalar reference for one output row of the 2x2 box downsample.
+ *
+ * The four pixels are summed and rounded once, the SIMD version does the same so both are bit exact.
+ */
+static void downsampleBoxRowScalar(const Uint32* row0, const Uint32* row1, int inWidth, Uint32* out, int from, int outWidth){
+    for(int x = from; x < outWidth; x++){
+        int x0 = 2 * x;
+        int x1 = x0 + 1 < inWidth ? x0 + 1 : x0;
+        out[x] = averagePixels(row0[x0], row0[x1], row1[x0], row1[x1]);
+    }
+}
+
+#ifdef ENGINE_SSE2
+/**
+ * @brief Sums the channels of the two vertical pixel pairs in 4 pixels of two rows into 16-bit lanes,
+ * rounds and divides by 4: the two output pixels of the 4 input columns.
+ */
+static inline __m128i downsampleBoxPairSSE2(__m128i top, __m128i bottom){
+    const __m128i zero = _mm_setzero_si128();
+    __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+    __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(left, right), _mm_unpackhi_epi64(left, right));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+/**
+ * @brief SSE2 version of `downsampleBoxRowScalar()`, 4 output pixels per step.
+ */
+static void downsampleBoxRowSSE2(const Uint32* row0, const Uint32* row1, int inWidth, Uint32* out, int outWidth){
+    int x = 0;
+    for(; (x + 4) * 2 <= inWidth && x + 4 <= outWidth; x += 4){
+        __m128i a = downsampleBoxPairSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x)));
+        __m128i b = downsampleBoxPairSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x + 4)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x + 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(a, b));
+    }
+    downsampleBoxRowScalar(row0, row1, inWidth, out, x, outWidth);
+}
+#endif
+
+/**
+ * @brief Halves a 32-bit surface with the 2x2 box filter.
+ *
+ * @param source ARGB8888 surface, premultiplied so that transparent pixels don't bleed their color.
+ * @return New surface of `max(1, w / 2)` x `max(1, h / 2)`, `NULL` if it couldn't be created.
+ */
+static SDL_Surface* downsampleBox(SDL_Surface* source){
+    int outWidth = source->w / 2 > 0 ? source->w / 2 : 1;
+    int outHeight = source->h / 2 > 0 ? source->h / 2 : 1;
+    SDL_Surface* result = SDL_CreateRGBSurfaceWithFormat(0, outWidth, outHeight, 32, source->format->format);
+    if(result == NULL){
+        return NULL;
+    }
+#ifdef ENGINE_SSE2
+    bool useSSE2 = SDL_HasSSE2();
+#endif
+    for(int y = 0; y < outHeight; y++){
+        int y0 = 2 * y;
+        int y1 = y0 + 1 < source->h ? y0 + 1 : y0;
+        const Uint32* row0 = reinterpret_cast<const Uint32*>(static_cast<Uint8*>(source->pixels) + y0 * source->pitch);
+        const Uint32* row1 = reinterpret_cast<const Uint32*>(static_cast<Uint8*>(source->pixels) + y1 * source->pitch);
+        Uint32* out = reinterpret_cast<Uint32*>(static_cast<Uint8*>(result->pixels) + y * result->pitch);
+#ifdef ENGINE_SSE2
+        if(useSSE2){
+            downsampleBoxRowSSE2(row0, row1, source->w, out, outWidth);
+            continue;
+        }
+#endif
+        downsampleBoxRowScalar(row0, row1, source->w, out, 0, outWidth);
+    }
+    return result;
+}
+
+/**
+ * @brief Fixed point (1 << 14) weights of the 8-tap Lanczos-2 kernel for an exact 2:1 reduction.
+ *
+ * Output sample `i` sits between input samples `2i` and `2i + 1`, tap `k` reads input `2i + k - 3`.
+ * The weights are the same for every output sample, so they are computed once.
+ */
+static const int* lanczosHalvingWeights(){
+    static int weights[8];
+    static bool computed = false;
+    if(!computed){
+        double raw[8], sum = 0.0;
+        for(int k = 0; k < 8; k++){
+            double x = ((k - 3) - 0.5) / 2.0;
+            double a = M_PI * x, b = M_PI * x / 2.0;
+            raw[k] = (x == 0.0) ? 1.0 : (sin(a) / a) * (sin(b) / b);
+            sum += raw[k];
+        }
+        int total = 0;
+        for(int k = 0; k < 8; k++){
+            weights[k] = static_cast<int>(lround(raw[k] / sum * (1 << 14)));
+            total += weights[k];
+        }
+        // keep the sum exact so flat colors stay flat, split between the two center taps to stay symmetric
+        weights[3] += ((1 << 14) - total) / 2;
+        weights[4] += (1 << 14) - total - ((1 << 14) - total) / 2;
+        computed = true;
+    }
+    return weights;
+}
+
+/**
+ * @brief Halves a 32-bit surface with a separable Lanczos-2 filter (horizontal pass, then vertical pass).
+ *
+ * The colors of the result are clamped to its alpha, the ringing of the filter could push them above.
+ *
+ * @param source ARGB8888 surface, premultiplied so that transparent pixels don't bleed their color.
+ * @return New surface of `max(1, w / 2)` x `max(1, h / 2)`, `NULL` if it couldn't be created.
+ */
+static SDL_Surface* downsampleLanczos(SDL_Surface* source){
+    const int* weights = lanczosHalvingWeights();
+    int inWidth = source->w, inHeight = source->h;
+    int outWidth = inWidth / 2 > 0 ? inWidth / 2 : 1;
+    int outHeight = inHeight / 2 > 0 ? inHeight / 2 : 1;
+    SDL_Surface* result = SDL_CreateRGBSurfaceWithFormat(0, outWidth, outHeight, 32, source->format->format);
+    if(result == NULL){
+        return NULL;
+    }
+
+    // horizontal pass into 8-bit channels, outWidth x inHeight
+    vector<Uint8> horizontal(static_cast<size_t>(outWidth) * inHeight * 4);
+    for(int y = 0; y < inHeight; y++){
+        const Uint8* row = static_cast<const Uint8*>(source->pixels) + y * source->pitch;
+        Uint8* out = &horizontal[static_cast<size_t>(y) * outWidth * 4];
+        for(int x = 0; x < outWidth; x++){
+            int acc[4] = {1 << 13, 1 << 13, 1 << 13, 1 << 13};
+            for(int k = 0; k < 8; k++){
+                int sx = 2 * x + k - 3;
+                sx = sx < 0 ? 0 : (sx >= inWidth ? inWidth - 1 : sx);
+                for(int c = 0; c < 4; c++){
+                    acc[c] += weights[k] * row[sx * 4 + c];
+                }
+            }
+            for(int c = 0; c < 4; c++){
+                int v = acc[c] >> 14;
+                out[x * 4 + c] = static_cast<Uint8>(v < 0 ? 0 : (v > 255 ? 255 : v));
+            }
+        }
+    }
+
+    // vertical pass, the inner loop runs over whole rows so the compiler can vectorize it
+    vector<int> acc(static_cast<size_t>(outWidth) * 4);
+    int rowLength = outWidth * 4;
+    for(int y = 0; y < outHeight; y++){
+        fill(acc.begin(), acc.end(), 1 << 13);
+        for(int k = 0; k < 8; k++){
+            int sy = 2 * y + k - 3;
+            sy = sy < 0 ? 0 : (sy >= inHeight ? inHeight - 1 : sy);
+            const Uint8* in = &horizontal[static_cast<size_t>(sy) * rowLength];
+            int w = weights[k];
+            for(int i = 0; i < rowLength; i++){
+                acc[i] += w * in[i];
+            }
+        }
+        Uint8* out = static_cast<Uint8*>(result->pixels) + y * result->pitch;
+        for(int i = 0; i < rowLength; i++){
+            int v = acc[i] >> 14;
+            out[i] = static_cast<Uint8>(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+        // Byte 3 of an ARGB8888 pixel is its alpha, a premultiplied color never exceeds it
+        for(int i = 0; i < rowLength; i += 4){
+            out[i] = SDL_min(out[i], out[i + 3]);
+            out[i + 1] = SDL_min(out[i + 1], out[i + 3]);
+            out[i + 2] = SDL_min(out[i + 2], out[i + 3]);
+        }
+    }
+    return result;
+}
+
+/**
+ * @class MipChain
+ * @brief Prefiltered, progressively halved copies of a bitmap, one texture per level.
+ *
+ * Level 0 is the original texture owned by the `BitmapObject`, the chain stores levels 1..N where
+ * level `i` is `1 / 2^i` of the original size. At draw time the level closest to (and not smaller than)
+ * the effective scale is picked, so zoomed-out sprites sample a small prefiltered texture instead of
+ * resampling the full one.
+ */
+class MipChain {
+    private:
+        vector<SDL_Texture*> levels; ///< Textures of levels 1..N, `levels[i]` holds level `i + 1`.
+
+    public:
+        MipChain(){}
+        MipChain(const MipChain&) = delete;
+        MipChain& operator=(const MipChain&) = delete;
+        virtual ~MipChain(){release();}
+
+        /**
+         * @brief Builds the chain from the surface the base texture was created from.
+         *
+         * @param renderer Renderer the level textures are created for.
+         * @param base Full size surface, any format (converted to ARGB8888 first).
+         * @param filter Filter used for every halving step.
+         * @param maxLevels Maximum number of levels generated below the base.
+         * @param blendMode Blend mode of the level textures, the premultiplied one when `base` is premultiplied.
+         * The levels are always filtered from premultiplied pixels, which keeps the color of transparent texels
+         * out of the edges; for any other blend mode `base` is premultiplied first and every level unpremultiplied
+         * again for its texture.
+         * @return `true` if at least one level was generated.
+         */
+        bool generate(SDL_Renderer* renderer, SDL_Surface* base, MipFilter filter, int maxLevels = 6, SDL_BlendMode blendMode = SDL_BLENDMODE_BLEND){
+            release();
+            if(filter == MIP_NONE || base == NULL){
+                return false;
+            }
+            SDL_Surface* current = SDL_ConvertSurfaceFormat(base, SDL_PIXELFORMAT_ARGB8888, 0);
+            bool straight = blendMode != Engine::getPremultipliedBlendMode();
+            if(current != NULL && straight){
+                if(SDL_MUSTLOCK(current)){SDL_LockSurface(current);}
+                SDL_PremultiplyAlpha(current->w, current->h, SDL_PIXELFORMAT_ARGB8888, current->pixels, current->pitch,
+                                     SDL_PIXELFORMAT_ARGB8888, current->pixels, current->pitch);
+                if(SDL_MUSTLOCK(current)){SDL_UnlockSurface(current);}
+            }
+            while(current != NULL && static_cast<int>(levels.size()) < maxLevels && (current->w > 1 || current->h > 1)){
+                SDL_Surface* next = filter == MIP_LANCZOS ? downsampleLanczos(current) : downsampleBox(current);
+                SDL_FreeSurface(current);
+                current = next;
+                if(current == NULL){
+                    break;
+                }
+                SDL_Surface* upload = current;
+                if(straight){
+                    upload = SDL_DuplicateSurface(current);
+                    if(upload == NULL){
+                        break;
+                    }
+                    unpremultiplySurface(upload);
+                }
+                SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, upload);
+                if(upload != current){
+                    SDL_FreeSurface(upload);
+                }
+                if(texture == NULL){
+                    break;
+                }
+                SDL_SetTextureBlendMode(texture, blendMode);
+                SDL_SetTextureScaleMode(texture, SDL_ScaleModeLinear);
+                levels.push_back(texture);
+            }
+            if(current != NULL){
+                SDL_FreeSurface(current);
+            }
+            return !levels.empty();
+        }
+
+        /** @brief Destroys every level texture. */
+        void release(){
+            for(SDL_Texture* texture : levels){
+                SDL_DestroyTexture(texture);
+            }
+            levels.clear();
+        }
+
+        /** @brief Number of generated levels below the base. */
+        int getLevelCount(){
+            return static_cast<int>(levels.size());
+        }
+
+        /**
+         * @brief Picks the smallest level that is still at least as large as the drawn size.
+         *
+         * @param scale Effective scale the bitmap is drawn at.
+         * @return 0 for the base texture, otherwise the level index.
+         */
+        int selectLevel(float scale){
+            int level = 0;
+            while(level < static_cast<int>(levels.size()) && scale * static_cast<float>(2 << level) <= 1.0f){
+                level++;
+            }
+            return level;
+        }
+
+        /** @brief Texture of `level` (>= 1). */
+        SDL_Texture* getTexture(int level){
+            return levels[level - 1];
+        }
+
+        /**
+         * @brief Maps a source rectangle of the base texture onto `level`.
+         *
+         * Frames whose size is a multiple of `2^level` map exactly, others are rounded to whole texels.
+         */
+        static SDL_Rect scaleRect(const SDL_Rect& rect, int level){
+            int x0 = rect.x >> level, y0 = rect.y >> level;
+            int x1 = (rect.x + rect.w) >> level, y1 = (rect.y + rect.h) >> level;
+            SDL_Rect scaled = {x0, y0, x1 > x0 ? x1 - x0 : 1, y1 > y0 ? y1 - y0 : 1};
+            return scaled;
+        }
+};
+
+/**
+ * @class BitmapObject
+ * @brief A class representing a bitmap object with posibiliity of custom draw and transform behaviour.
+ *
+ * The `BitmapObject` class allows creating and managing a bitmap object that can be drawn, translated,
+ * rotated, scaled, and cropped. It integrates with SDL to render textures and performs transformations
+ * on the bitmap directly.
+ * 
+ * The bitmapObject is heavily reliant on the SDL's source and destination rectangle. In the spritesheet,
+ * it will be setting a position of where the source rectangle should be reading and copying it into destination rectangle in the renderer.
+ */
+class BitmapObject : public DrawAbility, public Transformability{
+    private:
+        BitmapManager bt; ///< Bitmapmanager instance to manage the bitmap surface and loading operations.
+        SDL_Surface* tmpSurface; ///< Temporary surface used for loading and converting textures.
+        SDL_Texture* texture = NULL; ///< SDL_Texture object used for rendering the bitmap.
+        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the bitmapObject.
+        string& filename; ///< Reference to the filename BMP will be loaded from.
+        int objPosX; ///< object's x-coordinate position.
+        int objPosY; ///< object's y-coordinate position.
+        int objWidth; ///< bitmap object's width.
+        int objHeight; ///< bitmap object's height.
+
+         // This ones are destRect related, also no use for objWidth and objHeight
+        int spritePosX = 0; ///< X-coordinate of the source rectangle in the spritesheet / sprite related operation(crops by X-axis).
+        int spritePosY = 0; ///< Y-coordinate of the source rectangle in the spritesheet / sprite realted operation(crops by Y-axis).
+        int spritePosW = 0; ///< Width of the source rectangle in the spritesheet / sprite related operation(crops by width).
+        int spritePosH = 0; ///< Width of the source rectangle in the spritesheet / sprite related operation(crops by width).
+        SDL_Rect destRect; ///< Destination rectangle for rendering the bitmap on the screen.
+        SDL_Rect srcRect; ///< Source rectangle for cropping the bitmap from texture.
+        float scaleFactor = 1.0f; ///< Accumulated `scale()` factor, the drawn size is the source rectangle times this.
+        MipChain mips; ///< Prefiltered smaller copies of the texture, empty unless a `MipFilter` was requested.
+        Engine* mipEngine = NULL; ///< Engine a `deferMipChain()` build is waiting in, NULL when none is.
+        SDL_RendererFlip flip = SDL_FLIP_NONE; ///< Mirroring applied by `draw()`, e.g. to face a sprite the other way.
+
+        /**
+         * @brief Copies `frame` of the texture to `dest`, sampling the mip level for `scale` when there is one.
+         */
+        void copyFrame(const SDL_Rect& frame, const SDL_Rect& dest, float scale, SDL_RendererFlip flip){
+            int level = mips.selectLevel(scale);
+            SDL_Texture* source = texture;
+            SDL_Rect sourceRect = frame;
+            if(level > 0){
+                source = mips.getTexture(level);
+                sourceRect = MipChain::scaleRect(frame, level);
+            }
+            if(flip == SDL_FLIP_NONE){
+                SDL_RenderCopy(renderer, source, &sourceRect, &dest);
+            } else {
+                SDL_RenderCopyEx(renderer, source, &sourceRect, &dest, 0.0, NULL, flip);
+            }
+        }
+    public:
+        /**
+         * @brief destructor for the `BitmapObject` class to destroy the created Texture from Surface.
+         */
+        virtual ~BitmapObject(){
+            if(mipEngine != NULL){
+                mipEngine->cancelDeferred(this);
+            }
+            if(texture){
+                SDL_DestroyTexture(texture);
+            }
+        }
+
+       /**
+        * @brief Constructor for the `BitmapObject` class.
+        *
+        * Initializes the bitmap object with the specified properties and renderer.
+        * Using the provided `filename` we load Bitmap Content.
+        * After we use the getter method to get the access to the created surface and create Texture from it.
+        * When a `mipFilter` is given, the mip chain is generated from the same surface before it is freed.
+        * In the premultiplied-alpha mode of `Engine` the pixels are premultiplied first and drawn with the premultiplied blend mode.
+        * The source rectangle starts as the whole texture, sprites narrow it down with `setSrcRect()`.
+        *
+        * @param filename Reference to a string containing the path to the bitmap file to be loaded.
+        * @param renderer Pointer to the SDL_Renderer used for rendering the bitmap.
+        * @param x X-coordinate of the object's position in the renderer / window.
+        * @param y Y-coordinate of the object's position in the renderer / window.
+        * @param w Width of the bitmap object.
+        * @param h Height of the bitmap object.
+        * @param mipFilter Filter for the optional mip chain, `MIP_NONE` (default) skips it.
+        */
+        BitmapObject(string& filename, SDL_Renderer* renderer, int x, int y, int w, int h, MipFilter mipFilter = MIP_NONE) : renderer(renderer), filename(filename), objPosX(x), objPosY(y), objWidth(w), objHeight(h){
+            if(bt.loadBitmapContent(filename)){
+                bool premultiplied = Engine::usesPremultipliedAlpha() && bt.premultiplyAlpha();
+                SDL_BlendMode blendMode = premultiplied ? Engine::getPremultipliedBlendMode() : SDL_BLENDMODE_BLEND;
+                tmpSurface = bt.getSurface();
+                texture = SDL_CreateTextureFromSurface(renderer, tmpSurface);
+                if(texture != NULL){
+                    SDL_SetTextureBlendMode(texture, blendMode);
+                    SDL_QueryTexture(texture, NULL, NULL, &spritePosW, &spritePosH);
+                }
+                if(mipFilter != MIP_NONE){
+                    mips.generate(renderer, tmpSurface, mipFilter, 6, blendMode);
+                }
+                bt.deleteBitmapObj();
+                tmpSurface = NULL;
+            } else {
+                ENGINE_LOG_ERROR(ASSETS, "texture loading failed! " << filename);
+            }
+        }
+
+        /**
+         * @brief Builds the mip chain later, in the spare time of the frames, instead of while loading.
+         *
+         * The work goes through `Engine::defer()` at low priority and decodes the image again when it runs, until then
+         * the full texture is drawn at every scale. Work that didn't run yet is dropped when the object is destroyed.
+         *
+         * @param engine Engine whose deferred work queue builds the chain.
+         * @param filter Filter for the mip chain, `MIP_NONE` does nothing.
+         */
+        void deferMipChain(Engine& engine, MipFilter filter){
+            if(texture == NULL || filter == MIP_NONE){
+                return;
+            }
+            if(mipEngine != NULL){
+                mipEngine->cancelDeferred(this);
+            }
+            mipEngine = &engine;
+            string path = filename;
+            engine.defer([this, path, filter]() mutable {
+                mipEngine = NULL;
+                SDL_BlendMode blendMode = SDL_BLENDMODE_BLEND;
+                SDL_GetTextureBlendMode(texture, &blendMode);
+                // The level pixels have to match the base texture, premultiplied when it was loaded premultiplied
+                if(bt.loadBitmapContent(path) && (blendMode != Engine::getPremultipliedBlendMode() || bt.premultiplyAlpha())){
+                    mips.generate(renderer, bt.getSurface(), filter, 6, blendMode);
+                }
+                bt.deleteBitmapObj();
+            }, WORK_LOW, filter == MIP_LANCZOS ? 4.0 : 1.0, this);
+        }
+
+        /**
+         * @brief Draws the bitmap object to the screen using the renderer.
+         *
+         * Uses the source and destination rectangles to determine (cropping / position of specified bmp) and rendering locations.
+         * Checks if the texture loaded and created or not.
+         * destRect is set by the objects position, provided in the constructor and dimensions of the sprite times the scale.
+         * srcRect is set by the `setSrcRect()` function, which is called each time we have to change the frame of the sprite.
+         * When the object is drawn smaller than half its size and has a mip chain, the matching level is sampled instead.
+         * A flip set with `setFlip()` mirrors the drawn image.
+         */
+        void draw() override {
+            if(texture != NULL){
+                destRect = {objPosX, objPosY, static_cast<int>(spritePosW * scaleFactor), static_cast<int>(spritePosH * scaleFactor)};
+                srcRect = {spritePosX, spritePosY, spritePosW, spritePosH};
+                ENGINE_LOG_TRACE(RENDER, "BitmapObject draw " << spritePosX << " " << spritePosY << " " << spritePosW << " " << spritePosH);
+                copyFrame(srcRect, destRect, scaleFactor, flip);
+            }
+        }
+
+        /**
+         * @brief Draws `frame` of the texture to `dest`, independent of the object's own position, frame and flip.
+         *
+         * Only the texture, its mip chain and the renderer are read, which don't change after loading, so a render thread
+         * can draw from a `RenderSnapshot` while another thread keeps updating the object.
+         *
+         * @param frame Source rectangle in the texture.
+         * @param dest Destination rectangle, its size over the frame's sets the mip level.
+         * @param flip Mirroring to apply.
+         */
+        void drawFrame(const SDL_Rect& frame, const SDL_Rect& dest, SDL_RendererFlip flip){
+            if(texture != NULL && frame.w > 0){
+                copyFrame(frame, dest, static_cast<float>(dest.w) / frame.w, flip);
+            }
+        }
+
+        /**
+         * @brief Translates the bitmap object by the specified offsets.
+         * 
+         * Moves the object by modifying it's position coordinates and redraws it.
+         * 
+         * @param dx The horizontal offset to move the object.
+         * @param dy The vertical offset to move the object.
+         */
+        void translate(int dx, int dy) override {
+            objPosX += dx;
+            objPosY += dy;
+            draw();
+        }
+
+        /**
+         * @brief Rotates the bitmap object around its center by the specified angle.
+         *
+         * Uses SDL_RenderCopyEx for rotation. The angle is specified in degrees. The SDL_Point pivot is relative
+         * to the destination rectangle, so the center of an object is half of its size.
+         *
+         * @param angle The angle to rotate the object, in degrees.
+         */
+        void rotate(float angle) override {
+            if(texture != NULL){
+                SDL_Point pt;
+                pt = {destRect.w / 2, destRect.h / 2};
+                SDL_RenderCopyEx(renderer, texture, NULL, &destRect, angle, &pt, SDL_FLIP_NONE);
+            } else {
+                ENGINE_LOG_WARN(RENDER, "Something with rotate in BitmapObject!");
+            }
+        }
+
+        /**
+         * @brief Sets the source rectangle for cropping the texture from the spritesheet.
+         *
+         * Specifies the area of the texture to be rendered.
+         *
+         * @param x X-coordinate of the source rectangle.
+         * @param y Y-coordinate of the source rectangle.
+         * @param w Width of the source rectangle.
+         * @param h Height of the source rectangle.
+         */
+        void setSrcRect(int x, int y, int w, int h) {
+            this->spritePosX = x;
+            this->spritePosY = y;
+            this->spritePosW = w;
+            this->spritePosH = h;
+            srcRect = {spritePosX, spritePosY, spritePosW, spritePosH};
+            ENGINE_LOG_TRACE(RENDER, "setSrcRect BitmapObj called");
+        }
+
+        /**
+         * @brief Sets the source rectangle to an animation frame.
+         *
+         * Same as `setSrcRect()` without the trace message, it is called on every frame change of a sprite.
+         *
+         * @param frame Rectangle of the frame in the spritesheet.
+         */
+        void setFrameRect(const SDL_Rect& frame){
+            spritePosX = frame.x;
+            spritePosY = frame.y;
+            spritePosW = frame.w;
+            spritePosH = frame.h;
+            srcRect = frame;
+        }
+
+        /**
+         * @brief Scales the bitmap object by the specified factor.
+         *
+         * Adjusts the object's drawn size and position to scale it around its center.
+         * The factor accumulates, the drawn size is always the source rectangle times the total scale.
+         *
+         * @param factor The scaling factor.
+         */
+        void scale(float factor){
+            if(texture != NULL && factor > 0.0f){
+                float oldWidth = spritePosW * scaleFactor;
+                float oldHeight = spritePosH * scaleFactor;
+                scaleFactor *= factor;
+                objPosX += static_cast<int>((oldWidth - spritePosW * scaleFactor) / 2);
+                objPosY += static_cast<int>((oldHeight - spritePosH * scaleFactor) / 2);
+                objWidth = static_cast<int>(objWidth * factor);
+                objHeight = static_cast<int>(objHeight * factor);
+                draw();
+            }
+        }
+
+        /**
+         * @brief Gets the accumulated scale of the bitmap object.
+         * @return `scaleFactor`.
+         */
+        float getScale(){
+            return scaleFactor;
+        }
+
+        /**
+         * @brief Moves the object to (`x`, `y`) without drawing it.
+         */
+        void setPosition(int x, int y){
+            objPosX = x;
+            objPosY = y;
+        }
+
+        /**
+         * @brief Gets the x-coordinate of the object's position.
+         * @return `objPosX`.
+         */
+        int getX(){
+            return objPosX;
+        }
+
+        /**
+         * @brief Gets the y-coordinate of the object's position.
+         * @return `objPosY`.
+         */
+        int getY(){
+            return objPosY;
+        }
+
+        /**
+         * @brief Gets the source rectangle, the frame of a sprite.
+         */
+        SDL_Rect getFrameRect(){
+            return {spritePosX, spritePosY, spritePosW, spritePosH};
+        }
+
+        /**
+         * @brief Gets the rectangle `draw()` covers, the source rectangle's size times the scale at the object's position.
+         */
+        SDL_Rect getBounds(){
+            return {objPosX, objPosY, static_cast<int>(spritePosW * scaleFactor), static_cast<int>(spritePosH * scaleFactor)};
+        }
+
+        /**
+         * @brief Sets the mirroring `draw()` applies, `SDL_FLIP_HORIZONTAL` turns a sprite to face the other way.
+         */
+        void setFlip(SDL_RendererFlip flip){
+            this->flip = flip;
+        }
+
+        /**
+         * @brief Gets the mirroring `draw()` applies.
+         * @return `flip`.
+         */
+        SDL_RendererFlip getFlip(){
+            return flip;
+        }
+
+        /**
+         * @brief Position and scale for a `TweenSystem` to write into, `draw()` reads them every time.
+         *
+         * Unlike `scale()`, writing the scale directly keeps the top left corner in place.
+         */
+        TweenTargets getTweenTargets(){
+            TweenTargets targets;
+            targets.x = &objPosX;
+            targets.y = &objPosY;
+            targets.scale = &scaleFactor;
+            return targets;
+        }
+};
+
+/**
+ * @struct SpriteInstance
+ * @brief A sprite as a `RenderSnapshot` holds it: which part of which texture to draw where.
+ */
+struct SpriteInstance {
+    BitmapObject* bitmap; ///< Object owning the texture, only its `drawFrame()` is called.
+    SDL_Rect frame; ///< Source rectangle in the texture.
+    SDL_Rect previous; ///< Destination after the step before the latest one.
+    SDL_Rect current; ///< Destination after the latest step.
+    SDL_RendererFlip flip; ///< Mirroring to apply.
+};
+
+/**
+ * @struct RectInstance
+ * @brief A rectangle of a shape list as a `RenderSnapshot` holds it.
+ */
+struct RectInstance {
+    SDL_Rect rect; ///< Where to draw it.
+    SDL_Color color; ///< Color to draw it with.
+    bool filled; ///< `true` fills it, `false` draws the outline.
+};
+
+/**
+ * @struct RenderSnapshot
+ * @brief Everything the render thread needs to draw one simulated state, written once by the simulation and then only read.
+ *
+ * Sprites carry their destination after the latest and the previous step, so the render thread can interpolate
+ * between them. The lists are cleared and refilled in place, once they have grown refilling allocates nothing.
+ */
+struct RenderSnapshot {
+    Uint64 step = 0; ///< Simulation steps done when the snapshot was taken.
+    Uint64 publishedAt = 0; ///< Performance counter value when it was published.
+    Uint64 stepTicks = 1; ///< Length of a simulation step in counter ticks.
+    vector<SpriteInstance> sprites; ///< Sprites in drawing order.
+    vector<RectInstance> rects; ///< Rectangles, drawn before the sprites.
+    vector<SpriteInstance> culled; ///< Scratch list of `cull()`, swapped with `sprites`.
+    vector<int> chunkStarts; ///< Scratch of `cull()`: visible sprites per chunk, then where each chunk's go.
+
+    static const int cullChunk = 2048; ///< Sprites a `cull()` chunk tests.
+
+    /**
+     * @brief Empties the lists, keeping their capacity.
+     */
+    void clear(){
+        sprites.clear();
+        rects.clear();
+    }
+
+    /**
+     * @brief Interpolation factor at counter value `now`: how far into the next step the real time is, clamped to [0, 1].
+     */
+    double alphaAt(Uint64 now) const {
+        if(now <= publishedAt){
+            return 0.0;
+        }
+        return min(1.0, static_cast<double>(now - publishedAt) / stepTicks);
+    }
+
+    /**
+     * @brief Drops the sprites that are outside `view` at both their previous and latest destination, keeping the order.
+     *
+     * Chunks of sprites are counted in parallel, a prefix sum gives each chunk its place and the chunks then copy
+     * their visible sprites in parallel, so the draw list comes out as if it was built on one thread.
+     *
+     * @param view Visible area in world coordinates.
+     * @param jobs Job system to split the work over, NULL (default) runs it on the calling thread.
+     */
+    void cull(const SDL_Rect& view, JobSystem* jobs = NULL){
+        int count = static_cast<int>(sprites.size());
+        int chunks = (count + cullChunk - 1) / cullChunk;
+        auto visible = [&view](const SpriteInstance& instance){
+            return SDL_HasIntersection(&instance.current, &view) || SDL_HasIntersection(&instance.previous, &view);
+        };
+        auto forChunks = [jobs, chunks](const function<void(int, int)>& body){
+            if(jobs != NULL){
+                jobs->parallelFor(chunks, body, 1);
+            } else {
+                body(0, chunks);
+            }
+        };
+        chunkStarts.assign(chunks + 1, 0);
+        forChunks([&](int begin, int end){
+            for(int chunk = begin; chunk < end; chunk++){
+                int kept = 0;
+                for(int i = chunk * cullChunk, last = min(count, i + cullChunk); i < last; i++){
+                    kept += visible(sprites[i]);
+                }
+                chunkStarts[chunk + 1] = kept;
+            }
+        });
+        for(int chunk = 0; chunk < chunks; chunk++){
+            chunkStarts[chunk + 1] += chunkStarts[chunk];
+        }
+        culled.resize(chunkStarts[chunks]);
+        forChunks([&](int begin, int end){
+            for(int chunk = begin; chunk < end; chunk++){
+                int out = chunkStarts[chunk];
+                for(int i = chunk * cullChunk, last = min(count, i + cullChunk); i < last; i++){
+                    if(visible(sprites[i])){
+                        culled[out++] = sprites[i];
+                    }
+                }
+            }
+        });
+        sprites.swap(culled);
+    }
+
+    /**
+     * @brief Draws the snapshot with `renderer`, the sprites between their previous and latest destination at `alpha`.
+     */
+    void draw(SDL_Renderer* renderer, double alpha) const {
+        for(const RectInstance& instance : rects){
+            SDL_SetRenderDrawColor(renderer, instance.color.r, instance.color.g, instance.color.b, instance.color.a);
+            if(instance.filled){
+                SDL_RenderFillRect(renderer, &instance.rect);
+            } else {
+                SDL_RenderDrawRect(renderer, &instance.rect);
+            }
+        }
+        for(const SpriteInstance& instance : sprites){
+            SDL_Rect dest = {GameLoop::interpolate(instance.previous.x, instance.current.x, alpha),
+                             GameLoop::interpolate(instance.previous.y, instance.current.y, alpha), instance.current.w, instance.current.h};
+            instance.bitmap->drawFrame(instance.frame, dest, instance.flip);
+        }
+    }
+};
+
+/**
+ * @class SimulationThread
+ * @brief Runs the fixed-step simulation on its own thread and publishes a `RenderSnapshot` after each batch of steps.
+ *
+ * The main thread keeps the window: it polls the events and forwards them with `postEvent()`, and draws whatever
+ * `latest()` returns, so a slow update no longer holds up presentation and a slow frame no longer holds up the simulation.
+ * Events travel through an `SpscQueue` and snapshots through a `TripleBuffer`, neither side takes a lock.
+ * Everything the callbacks touch belongs to the simulation thread while it runs, the render thread only reads snapshots
+ * and the textures they point at.
+ */
+class SimulationThread {
+    private:
+        SDL_Thread* thread = NULL; ///< The simulation thread, NULL when not running.
+        SDL_atomic_t running; ///< Cleared by `stop()`.
+        SpscQueue<SDL_Event> events; ///< Events from the main thread.
+        TripleBuffer<RenderSnapshot> snapshots; ///< Snapshots to the main thread.
+        bool published = false; ///< Set on the render thread once a snapshot was acquired.
+        Uint64 frequency; ///< Ticks of the performance counter per second.
+        Uint64 stepTicks; ///< Length of a simulation step in counter ticks.
+        double updatesPerSecond; ///< Simulation steps per second.
+        int maxCatchUpSteps; ///< Most steps run in one batch.
+        function<void(SDL_Event&)> input; ///< Handles an event on the simulation thread.
+        function<void(double)> update; ///< Advances the simulation by one step.
+        function<void(RenderSnapshot&)> capture; ///< Fills a snapshot of the simulated state.
+
+        /**
+         * @brief Entry point of the thread.
+         */
+        static int threadMain(void* data){
+            static_cast<SimulationThread*>(data)->loop();
+            return 0;
+        }
+
+        /**
+         * @brief Steps the simulation like `GameLoop::run()` does and publishes a snapshot after every batch.
+         */
+        void loop(){
+            FramePacer pacer(updatesPerSecond);
+            double stepSeconds = static_cast<double>(stepTicks) / frequency;
+            Uint64 stepCount = 0;
+            Uint64 previous = SDL_GetPerformanceCounter();
+            Uint64 accumulator = stepTicks;
+            pacer.wait();
+            while(SDL_AtomicGet(&running)){
+                SDL_Event event;
+                while(events.pop(event)){
+                    input(event);
+                }
+                Uint64 now = SDL_GetPerformanceCounter();
+                accumulator += now - previous;
+                previous = now;
+                int steps = 0;
+                while(accumulator >= stepTicks && steps < maxCatchUpSteps){
+                    update(stepSeconds);
+                    accumulator -= stepTicks;
+                    steps++;
+                }
+                accumulator %= stepTicks;
+                if(steps > 0){
+                    stepCount += steps;
+                    RenderSnapshot& snapshot = snapshots.writeSlot();
+                    snapshot.clear();
+                    capture(snapshot);
+                    snapshot.step = stepCount;
+                    snapshot.stepTicks = stepTicks;
+                    snapshot.publishedAt = SDL_GetPerformanceCounter();
+                    snapshots.publish();
+                }
+                pacer.wait();
+            }
+        }
+    public:
+        /**
+         * @brief Constructor for the `SimulationThread` class.
+         *
+         * @param updatesPerSecond Simulation steps per second.
+         * @param maxCatchUpSteps Most steps run in one batch before the rest of the backlog is dropped.
+         */
+        SimulationThread(double updatesPerSecond = 60.0, int maxCatchUpSteps = 5)
+            : events(256), frequency(SDL_GetPerformanceFrequency()), updatesPerSecond(updatesPerSecond), maxCatchUpSteps(maxCatchUpSteps > 0 ? maxCatchUpSteps : 1){
+            stepTicks = max<Uint64>(1, static_cast<Uint64>(frequency / updatesPerSecond + 0.5));
+            SDL_AtomicSet(&running, 0);
+        }
+
+        ~SimulationThread(){
+            stop();
+        }
+
+        /**
+         * @brief Starts the thread.
+         *
+         * @param input Handles an event forwarded by `postEvent()`.
+         * @param update Advances the simulation by one step, gets the step length in seconds.
+         * @param capture Fills the (cleared) snapshot with the simulated state.
+         * @return `false` when the thread couldn't be created or is already running.
+         */
+        bool start(const function<void(SDL_Event&)>& input, const function<void(double)>& update, const function<void(RenderSnapshot&)>& capture){
+            if(thread != NULL){
+                return false;
+            }
+            this->input = input;
+            this->update = update;
+            this->capture = capture;
+            SDL_AtomicSet(&running, 1);
+            thread = SDL_CreateThread(threadMain, "simulation", this);
+            if(thread == NULL){
+                SDL_AtomicSet(&running, 0);
+                ENGINE_LOG_ERROR(THREADS, "Simulation thread couldn't start: " << SDL_GetError());
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Stops the thread and waits for it, after which the simulated objects belong to the caller again.
+         */
+        void stop(){
+            if(thread != NULL){
+                SDL_AtomicSet(&running, 0);
+                SDL_WaitThread(thread, NULL);
+                thread = NULL;
+            }
+        }
+
+        /**
+         * @brief Forwards an event to the simulation thread, render thread only.
+         * @return `false` when the queue is full and the event was dropped.
+         */
+        bool postEvent(const SDL_Event& event){
+            return events.push(event);
+        }
+
+        /**
+         * @brief Latest published snapshot, render thread only.
+         *
+         * @return The snapshot, valid until the next call, NULL before the first one was published.
+         */
+        const RenderSnapshot* latest(){
+            if(snapshots.acquire()){
+                published = true;
+            }
+            return published ? &snapshots.readSlot() : NULL;
+        }
+};
+
+/**
+ * @enum LoopMode
+ * @brief What an `AnimationClip` does after its last frame.
+ */
+enum LoopMode {
+    LOOP_REPEAT,    ///< Starts over from the first frame.
+    LOOP_ONCE,      ///< Holds the last frame.
+    LOOP_PING_PONG  ///< Plays back to the first frame, the turning frames are shown once.
+};
+
+/**
+ * @class AnimationClip
+ * @brief An immutable sequence of spritesheet frames with a duration for each frame.
+ *
+ * The frame rectangles and the timeline of one cycle are computed once on construction. The timeline is a list of steps,
+ * each a frame and the clip time it ends at, a ping-pong cycle lists the frames on the way back as steps of their own.
+ * Finding the frame for a point in time is a binary search over the step ends, and a cursor that is moved forward
+ * only has to step to the next entries.
+ * Clips are meant to be loaded once into an `AnimationLibrary` and shared by every sprite playing them,
+ * a sprite only keeps a pointer to the clip and its own time cursor.
+ */
+class AnimationClip {
+    private:
+        string name; ///< Name the clip is looked up by.
+        vector<SDL_Rect> frames; ///< Source rectangle of each frame in the spritesheet.
+        vector<Uint32> durations; ///< Milliseconds each frame is shown.
+        vector<int> stepFrames; ///< Frame of each step of the timeline.
+        vector<Uint32> stepEnds; ///< Clip time each step ends at, UINT32_MAX for the held last step of a clip played once.
+        LoopMode loopMode; ///< Behaviour after the last frame.
+        Uint32 cycleDuration; ///< Length of one full cycle, a ping-pong cycle goes there and back.
+
+        /**
+         * @brief Index of the step containing `time`, a cursor already wrapped by `wrapTime()`.
+         */
+        int stepAt(Uint32 time) const {
+            int step = static_cast<int>(upper_bound(stepEnds.begin(), stepEnds.end(), time) - stepEnds.begin());
+            return min(step, getStepCount() - 1);
+        }
+    public:
+        /**
+         * @brief Constructor for the `AnimationClip` class.
+         *
+         * `durations` holds one value per frame, when it is shorter the last value is used for the remaining frames,
+         * so a single value gives every frame the same duration. Durations below 1 ms are raised to 1 ms.
+         *
+         * @param name Name of the clip.
+         * @param frames Source rectangles of the frames, in playing order.
+         * @param durations Milliseconds each frame is shown.
+         * @param loopMode Behaviour after the last frame.
+         */
+        AnimationClip(const string& name, const vector<SDL_Rect>& frames, const vector<Uint32>& durations, LoopMode loopMode = LOOP_REPEAT)
+            : name(name), frames(frames), loopMode(loopMode), cycleDuration(0){
+            Uint32 duration = 100;
+            for(size_t i = 0; i < frames.size(); i++){
+                if(i < durations.size()){
+                    duration = max<Uint32>(durations[i], 1);
+                }
+                this->durations.push_back(duration);
+                cycleDuration += duration;
+                stepFrames.push_back(static_cast<int>(i));
+                stepEnds.push_back(cycleDuration);
+            }
+            if(loopMode == LOOP_PING_PONG){
+                for(int i = static_cast<int>(frames.size()) - 2; i > 0; i--){
+                    cycleDuration += this->durations[i];
+                    stepFrames.push_back(i);
+                    stepEnds.push_back(cycleDuration);
+                }
+            }
+            if(loopMode == LOOP_ONCE && !stepEnds.empty()){
+                stepEnds.back() = UINT32_MAX;
+            }
+        }
+
+        /**
+         * @brief Builds the rectangles of `count` frames laid out left to right in one row of a spritesheet.
+         *
+         * @param x X-coordinate of the first frame.
+         * @param y Y-coordinate of the row.
+         * @param frameWidth Width of each frame.
+         * @param frameHeight Height of each frame.
+         * @param count Number of frames.
+         * @return The frame rectangles.
+         */
+        static vector<SDL_Rect> gridFrames(int x, int y, int frameWidth, int frameHeight, int count){
+            vector<SDL_Rect> frames;
+            for(int i = 0; i < count; i++){
+                frames.push_back({x + i * frameWidth, y, frameWidth, frameHeight});
+            }
+            return frames;
+        }
+
+        /**
+         * @brief Wraps a time cursor into one cycle of the clip.
+         *
+         * Repeating and ping-pong clips wrap around, a clip played once stops at its end.
+         * Keeping the cursor wrapped keeps it from overflowing however long the clip plays.
+         *
+         * @param time Milliseconds since the clip started.
+         * @return The equivalent time within the first cycle.
+         */
+        Uint32 wrapTime(Uint32 time) const {
+            if(time < cycleDuration){
+                return time;
+            }
+            if(cycleDuration == 0 || loopMode == LOOP_ONCE){
+                return cycleDuration;
+            }
+            return time % cycleDuration;
+        }
+
+        /**
+         * @brief Index of the frame shown at `time` milliseconds since the clip started.
+         */
+        int frameAt(Uint32 time) const {
+            return stepFrames.empty() ? 0 : stepFrames[stepAt(wrapTime(time))];
+        }
+
+        /**
+         * @brief Moves a cursor that is on `step` forward to `time`.
+         *
+         * The cursor only ever moves forward, so the new step is found by walking on from the current one.
+         * A cursor past the end of the cycle is wrapped first and walks from the first step, a jump over
+         * more than a cycle falls back to the binary search.
+         *
+         * @param step Step the cursor was on.
+         * @param time New cursor value, wrapped in place.
+         * @return Step the cursor is on now.
+         */
+        int advanceStep(int step, Uint32& time) const {
+            if(time >= cycleDuration && loopMode != LOOP_ONCE){
+                if(time - cycleDuration >= cycleDuration){
+                    time = wrapTime(time);
+                    return stepAt(time);
+                }
+                time -= cycleDuration;
+                step = 0;
+            }
+            while(time >= stepEnds[step] && step + 1 < getStepCount()){
+                step++;
+            }
+            return step;
+        }
+
+        /**
+         * @brief Gets the number of steps in the timeline.
+         */
+        int getStepCount() const {
+            return static_cast<int>(stepFrames.size());
+        }
+
+        /**
+         * @brief Gets the frame of timeline step `step`.
+         */
+        int getStepFrame(int step) const {
+            return stepFrames[step];
+        }
+
+        /**
+         * @brief Gets the clip time step `step` ends at, UINT32_MAX for the held last step of a clip played once.
+         */
+        Uint32 getStepEnd(int step) const {
+            return stepEnds[step];
+        }
+
+        /**
+         * @brief Tells if a clip played once has reached its end at `time`, other clips never finish.
+         */
+        bool isFinished(Uint32 time) const {
+            return loopMode == LOOP_ONCE && time >= cycleDuration;
+        }
+
+        /**
+         * @brief Gets the name of the clip.
+         * @return `name`.
+         */
+        const string& getName() const {
+            return name;
+        }
+
+        /**
+         * @brief Gets the number of frames.
+         */
+        int getFrameCount() const {
+            return static_cast<int>(frames.size());
+        }
+
+        /**
+         * @brief Gets the source rectangle of frame `index`.
+         */
+        const SDL_Rect& getFrame(int index) const {
+            return frames[index];
+        }
+
+        /**
+         * @brief Gets the milliseconds frame `index` is shown.
+         */
+        Uint32 getFrameDuration(int index) const {
+            return durations[index];
+        }
+
+        /**
+         * @brief Gets the length of one cycle in milliseconds, there and back for ping-pong clips.
+         * @return `cycleDuration`.
+         */
+        Uint32 getCycleDuration() const {
+            return cycleDuration;
+        }
+
+        /**
+         * @brief Gets the loop mode.
+         * @return `loopMode`.
+         */
+        LoopMode getLoopMode() const {
+            return loopMode;
+        }
+};
+
+/**
+ * @class AnimationLibrary
+ * @brief Owns the loaded `AnimationClip`s and hands out shared pointers to them by name.
+ *
+ * Clips are stored in a deque so the pointers stay valid as more are added, and a clip is never replaced,
+ * adding a name twice gives back the clip that was there first.
+ * Lookups are a linear search by name, they are done once when a sprite picks its clips and not per frame.
+ *
+ * Definitions can be loaded from a text file, one clip per line:
+ *
+ *     clip <name> <x> <y> <frame width> <frame height> <frames> <ms per frame> <repeat|once|pingpong> [ms of each frame...]
+ *
+ * The frames are laid out left to right from (x, y). Empty lines and lines starting with `#` are skipped.
+ */
+class AnimationLibrary {
+    private:
+        deque<AnimationClip> clips; ///< Loaded clips.
+
+        /**
+         * @brief Parses one definition line into a clip, returns false when the line is malformed.
+         */
+        static bool parseDefinition(const string& line, vector<AnimationClip>& parsed){
+            istringstream in(line);
+            string keyword, name, mode;
+            int x, y, frameWidth, frameHeight, count;
+            Uint32 duration;
+            if(!(in >> keyword >> name >> x >> y >> frameWidth >> frameHeight >> count >> duration >> mode) || keyword != "clip" || count <= 0){
+                return false;
+            }
+            LoopMode loopMode;
+            if(mode == "repeat"){
+                loopMode = LOOP_REPEAT;
+            } else if(mode == "once"){
+                loopMode = LOOP_ONCE;
+            } else if(mode == "pingpong"){
+                loopMode = LOOP_PING_PONG;
+            } else {
+                return false;
+            }
+            vector<Uint32> durations;
+            Uint32 frameDuration;
+            while(in >> frameDuration){
+                durations.push_back(frameDuration);
+            }
+            if(durations.empty()){
+                durations.push_back(duration);
+            }
+            parsed.push_back(AnimationClip(name, AnimationClip::gridFrames(x, y, frameWidth, frameHeight, count), durations, loopMode));
+            return true;
+        }
+    public:
+        /**
+         * @brief Adds a clip to the library.
+         *
+         * @param clip The clip, it is copied in.
+         * @return Pointer to the stored clip, the existing one if the name is taken, NULL for a clip without frames.
+         */
+        const AnimationClip* add(const AnimationClip& clip){
+            if(clip.getFrameCount() == 0){
+                return NULL;
+            }
+            const AnimationClip* existing = get(clip.getName());
+            if(existing != NULL){
+                return existing;
+            }
+            clips.push_back(clip);
+            return &clips.back();
+        }
+
+        /**
+         * @brief Looks up a clip by name.
+         * @return The clip, NULL when there is none with that name.
+         */
+        const AnimationClip* get(const string& name) const {
+            for(const AnimationClip& clip : clips){
+                if(clip.getName() == name){
+                    return &clip;
+                }
+            }
+            return NULL;
+        }
+
+        /**
+         * @brief Loads clip definitions from a text file, see the class description for the format.
+         *
+         * Malformed lines are reported and skipped, the rest of the file is still loaded.
+         *
+         * @param path Path to the definitions file.
+         * @return Number of clips added, -1 when the file can't be read.
+         */
+        int loadDefinitions(const string& path){
+            size_t size = 0;
+            char* data = static_cast<char*>(SDL_LoadFile(path.c_str(), &size));
+            if(data == NULL){
+                ENGINE_LOG_ERROR(ASSETS, "Animation definitions couldn't load: " << path);
+                return -1;
+            }
+            istringstream file(string(data, size));
+            SDL_free(data);
+            vector<AnimationClip> parsed;
+            string line;
+            int lineNumber = 0;
+            while(getline(file, line)){
+                lineNumber++;
+                size_t start = line.find_first_not_of(" \t\r");
+                if(start == string::npos || line[start] == '#'){
+                    continue;
+                }
+                if(!parseDefinition(line, parsed)){
+                    ENGINE_LOG_WARN(ASSETS, "Skipping animation definition " << path << ":" << lineNumber);
+                }
+            }
+            int added = 0;
+            for(const AnimationClip& clip : parsed){
+                if(get(clip.getName()) == NULL && add(clip) != NULL){
+                    added++;
+                }
+            }
+            return added;
+        }
+
+        /**
+         * @brief Gets the number of loaded clips.
+         */
+        int getClipCount() const {
+            return static_cast<int>(clips.size());
+        }
+
+        /**
+         * @brief Library shared by the whole program.
+         */
+        static AnimationLibrary& shared(){
+            static AnimationLibrary library;
+            return library;
+        }
+};
+
+/**
+ * @brief How often an `AnimationSystem` advances an animation, the level of detail it is animated at.
+ *
+ * Reduced levels are advanced in slices, a fraction of their animations per pass, so their cost is spread evenly over the frames.
+ */
+enum AnimationDetail {
+    DETAIL_FULL, ///< Advanced on every pass.
+    DETAIL_HALF, ///< Advanced on every 2nd pass.
+    DETAIL_QUARTER, ///< Advanced on every 4th pass.
+    DETAIL_EIGHTH, ///< Advanced on every 8th pass.
+    DETAIL_HIDDEN, ///< Not advanced at all, catches up on the first pass after it gets a visible level.
+    DETAIL_COUNT ///< Number of levels.
+};
+
+/**
+ * @class AnimationSystem
+ * @brief Advances every registered animation in one pass from a single clock sample.
+ *
+ * The state of each animation lives in parallel arrays (clip, clock time the clip started, clock time of the next frame change,
+ * timeline step), so a pass is a linear walk over them. Most animations only compare the clock to their next change,
+ * the ones whose frame changes step forward in the clip's timeline with `AnimationClip::advanceStep()`.
+ * Animations are addressed by handles that stay valid while others are removed or change level.
+ * Large passes are split over a `JobSystem` when one is given.
+ *
+ * Each animation has an `AnimationDetail`. The arrays are kept grouped by level, so a pass only walks the slices
+ * of the levels that are due and hidden animations cost nothing. Since the times are kept on the system's clock
+ * instead of as per-animation cursors, a skipped animation loses no time: whenever it is walked again it jumps
+ * straight to the frame of the current clock, which is how hidden animations catch up once they become visible.
+ */
+class AnimationSystem {
+    private:
+        vector<const AnimationClip*> clips; ///< Clip of each entry, may be NULL.
+        vector<Uint64> clipStarts; ///< Clock time each entry's clip started, moved forward as looping clips wrap.
+        vector<Uint64> nextChanges; ///< Clock time at which each entry's frame changes.
+        vector<int> steps; ///< Timeline step of each entry as of its last pass, see `AnimationClip`.
+        vector<int> entryHandles; ///< Handle of each entry.
+        vector<int> handleEntries; ///< Entry of each handle, -1 for a free handle.
+        vector<int> freeHandles; ///< Handles that can be given out again.
+        int levelStarts[DETAIL_COUNT + 1] = {}; ///< First entry of each level, the entries of a level are contiguous.
+        JobSystem* jobs; ///< Job system the pass is split over, NULL runs it on the calling thread.
+        Uint64 clock = 0; ///< Milliseconds advanced since the system was created.
+        Uint32 passes = 0; ///< Number of passes so far, picks the slice of each reduced level.
+        Uint32 lastTicks = 0; ///< Clock sample of the previous `update()`.
+        bool started = false; ///< Becomes true on the first `update()`, which only samples the clock.
+
+        static const int parallelThreshold = 32768; ///< Fewer entries than this are advanced on the calling thread.
+        static const int parallelGrain = 8192; ///< Smallest band of entries given to a worker.
+
+        /**
+         * @brief Resets an entry to the start of `clip`.
+         */
+        void startClip(int entry, const AnimationClip* clip){
+            clips[entry] = clip != NULL && clip->getFrameCount() > 0 ? clip : NULL;
+            clipStarts[entry] = clock;
+            steps[entry] = 0;
+            nextChanges[entry] = clips[entry] != NULL ? clock + clip->getStepEnd(0) : UINT64_MAX;
+        }
+
+        /**
+         * @brief Time into its clip of an entry, on the system's clock.
+         */
+        Uint32 clipTimeOf(int entry) const {
+            Uint64 elapsed = clock - clipStarts[entry];
+            if(elapsed < UINT32_MAX){
+                return static_cast<Uint32>(elapsed);
+            }
+            const AnimationClip* clip = clips[entry];
+            if(clip->getLoopMode() == LOOP_ONCE || clip->getCycleDuration() == 0){
+                return UINT32_MAX;
+            }
+            return static_cast<Uint32>(elapsed % clip->getCycleDuration());
+        }
+
+        /**
+         * @brief Swaps two entries, keeping their handles pointing at them.
+         */
+        void swapEntries(int a, int b){
+            if(a == b){
+                return;
+            }
+            swap(clips[a], clips[b]);
+            swap(clipStarts[a], clipStarts[b]);
+            swap(nextChanges[a], nextChanges[b]);
+            swap(steps[a], steps[b]);
+            swap(entryHandles[a], entryHandles[b]);
+            handleEntries[entryHandles[a]] = a;
+            handleEntries[entryHandles[b]] = b;
+        }
+
+        /**
+         * @brief Level the entry belongs to.
+         */
+        AnimationDetail levelOf(int entry) const {
+            int level = 0;
+            while(entry >= levelStarts[level + 1]){
+                level++;
+            }
+            return static_cast<AnimationDetail>(level);
+        }
+
+        /**
+         * @brief Moves an entry to another level by swapping it across the boundaries in between.
+         * @return The entry's new index.
+         */
+        int moveEntry(int entry, int from, int to){
+            for(int level = from; level < to; level++){
+                int last = levelStarts[level + 1] - 1;
+                swapEntries(entry, last);
+                levelStarts[level + 1]--;
+                entry = last;
+            }
+            for(int level = from; level > to; level--){
+                int first = levelStarts[level];
+                swapEntries(entry, first);
+                levelStarts[level]++;
+                entry = first;
+            }
+            return entry;
+        }
+
+        /**
+         * @brief Brings the entries [`begin`, `end`) to the current clock.
+         */
+        void advanceRange(int begin, int end){
+            const AnimationClip* const* clip = clips.data();
+            Uint64* clipStart = clipStarts.data();
+            Uint64* nextChange = nextChanges.data();
+            int* step = steps.data();
+            Uint64 now = clock;
+            for(int i = begin; i < end; i++){
+                if(now >= nextChange[i] && clip[i] != NULL){
+                    Uint32 time = clipTimeOf(i);
+                    step[i] = clip[i]->advanceStep(step[i], time);
+                    clipStart[i] = now - time;
+                    nextChange[i] = clipStart[i] + clip[i]->getStepEnd(step[i]);
+                }
+            }
+        }
+
+        /**
+         * @brief Advances the entries [`begin`, `end`), split over the job system when there are enough of them.
+         */
+        void runRange(int begin, int end){
+            int count = end - begin;
+            if(jobs != NULL && count >= parallelThreshold && jobs->getThreadCount() > 1){
+                jobs->parallelFor(count, [this, begin](int from, int to){
+                    advanceRange(begin + from, begin + to);
+                }, parallelGrain);
+            } else {
+                advanceRange(begin, end);
+            }
+        }
+    public:
+        /**
+         * @brief Constructor for the `AnimationSystem` class.
+         *
+         * @param jobs Job system large passes are split over, NULL (default) keeps every pass on the calling thread.
+         */
+        AnimationSystem(JobSystem* jobs = NULL) : jobs(jobs){}
+
+        /**
+         * @brief Registers an animation playing `clip` from its start.
+         *
+         * @param clip The clip, NULL registers an entry that stays on frame 0 until `play()` gives it one.
+         * @param detail Level of detail to animate it at, `DETAIL_FULL` (default) advances it on every pass.
+         * @return Handle of the animation.
+         */
+        int add(const AnimationClip* clip, AnimationDetail detail = DETAIL_FULL){
+            int handle;
+            if(!freeHandles.empty()){
+                handle = freeHandles.back();
+                freeHandles.pop_back();
+            } else {
+                handle = static_cast<int>(handleEntries.size());
+                handleEntries.push_back(-1);
+            }
+            int entry = static_cast<int>(clips.size());
+            clips.push_back(NULL);
+            clipStarts.push_back(0);
+            nextChanges.push_back(UINT64_MAX);
+            steps.push_back(0);
+            entryHandles.push_back(handle);
+            handleEntries[handle] = entry;
+            levelStarts[DETAIL_COUNT]++;
+            entry = moveEntry(entry, DETAIL_HIDDEN, detail);
+            startClip(entry, clip);
+            return handle;
+        }
+
+        /**
+         * @brief Unregisters an animation, its handle may be given out again by `add()`.
+         */
+        void remove(int handle){
+            int entry = handleEntries[handle];
+            entry = moveEntry(entry, levelOf(entry), DETAIL_HIDDEN);
+            swapEntries(entry, static_cast<int>(clips.size()) - 1);
+            clips.pop_back();
+            clipStarts.pop_back();
+            nextChanges.pop_back();
+            steps.pop_back();
+            entryHandles.pop_back();
+            levelStarts[DETAIL_COUNT]--;
+            handleEntries[handle] = -1;
+            freeHandles.push_back(handle);
+        }
 
-        float centerX = (x1 + x2) / 2.0f;
-        float centerY = (y1 + y2) / 2.0f;
+        /**
+         * @brief Switches an animation to another clip.
+         *
+         * Playing the clip that is already playing keeps its time cursor unless `restart` is set.
+         *
+         * @param handle Handle of the animation.
+         * @param clip The clip to play.
+         * @param restart If `true`, the clip starts over even when it is already playing.
+         */
+        void play(int handle, const AnimationClip* clip, bool restart = false){
+            int entry = handleEntries[handle];
+            if(clip != clips[entry] || restart){
+                startClip(entry, clip);
+            }
+        }
 
-        float radians = angle * M_PI / 180.0f;
+        /**
+         * @brief Changes the level of detail an animation is advanced at.
+         *
+         * The animation keeps its place in the clip, one that was skipped catches up the next time it is advanced.
+         *
+         * @param handle Handle of the animation.
+         * @param detail The new level.
+         */
+        void setDetail(int handle, AnimationDetail detail){
+            int entry = handleEntries[handle];
+            moveEntry(entry, levelOf(entry), detail);
+        }
 
-        int newX1 = static_cast<int>(centerX + (x1 - centerX) * cos(radians) - (y1 - centerY) * sin(radians));
-        int newY1 = static_cast<int>(centerY + (x1 - centerX) * sin(radians) + (y1 - centerY) * cos(radians));
-        int newX2 = static_cast<int>(centerX + (x2 - centerX) * cos(radians) - (y2 - centerY) * sin(radians));
-        int newY2 = static_cast<int>(centerY + (x2 - centerX) * sin(radians) + (y2 - centerY) * cos(radians));
+        /**
+         * @brief Gets the level of detail an animation is advanced at.
+         */
+        AnimationDetail getDetail(int handle) const {
+            return levelOf(handleEntries[handle]);
+        }
 
-        start.setPoint(newX1, newY1);
-        end.setPoint(newX2, newY2);
-        drawSegment();
-    }
         /**
-     * @brief Scales the line segment object by a given factor.
-     *
-     * This method scales the line segment around its center point by the specified factor(float value) and then
-     * redraws the segment.
-     *
-     * @param factor The factor by which to scale the line segment.
-     */
-    void scale(float factor) override {
-        float centerX = (start.getX() + end.getX()) / 2.0f;
-        float centerY = (start.getY() + end.getY()) / 2.0f;
+         * @brief Picks the level of detail for something drawn at `bounds` when `view` is visible.
+         *
+         * Off-screen bounds are hidden, the rest get a lower rate the smaller they are drawn:
+         * full from 48 pixels on their longer side, half from 24, a quarter from 12 and an eighth below that.
+         *
+         * @param bounds Where it is drawn, in the same space as `view`.
+         * @param view The visible area.
+         * @return The level to use.
+         */
+        static AnimationDetail chooseDetail(const SDL_Rect& bounds, const SDL_Rect& view){
+            if(!SDL_HasIntersection(&bounds, &view)){
+                return DETAIL_HIDDEN;
+            }
+            int size = max(bounds.w, bounds.h);
+            if(size >= 48){
+                return DETAIL_FULL;
+            }
+            if(size >= 24){
+                return DETAIL_HALF;
+            }
+            return size >= 12 ? DETAIL_QUARTER : DETAIL_EIGHTH;
+        }
 
-        int newX1 = static_cast<int>(centerX + (start.getX() - centerX) * factor);
-        int newY1 = static_cast<int>(centerY + (start.getY() - centerY) * factor);
+        /**
+         * @brief Advances the clock by `milliseconds` and brings the animations that are due up to it.
+         *
+         * Full detail animations are all walked, a level advanced every n-th pass walks 1/n of its animations
+         * and hidden ones aren't walked at all.
+         *
+         * @param milliseconds Time to advance by.
+         */
+        void advance(Uint32 milliseconds){
+            clock += milliseconds;
+            passes++;
+            for(int level = DETAIL_FULL; level < DETAIL_HIDDEN; level++){
+                Uint32 slices = 1u << level;
+                Uint32 slice = passes & (slices - 1);
+                Uint64 count = levelStarts[level + 1] - levelStarts[level];
+                runRange(levelStarts[level] + static_cast<int>(count * slice / slices), levelStarts[level] + static_cast<int>(count * (slice + 1) / slices));
+            }
+        }
 
-        int newX2 = static_cast<int>(centerX + (end.getX() - centerX) * factor);
-        int newY2 = static_cast<int>(centerY + (end.getY() - centerY) * factor);
+        /**
+         * @brief Samples the clock once and advances every animation by the time since the previous call.
+         */
+        void update(){
+            Uint32 currentTicks = SDL_GetTicks();
+            if(started){
+                advance(currentTicks - lastTicks);
+            }
+            started = true;
+            lastTicks = currentTicks;
+        }
 
-        start.setPoint(newX1, newY1);
-        end.setPoint(newX2, newY2);
-        drawSegment();
-    }
+        /**
+         * @brief Gets the frame an animation shows, as of the last pass that advanced it.
+         */
+        int getFrame(int handle) const {
+            int entry = handleEntries[handle];
+            return clips[entry] != NULL ? clips[entry]->getStepFrame(steps[entry]) : 0;
+        }
+
+        /**
+         * @brief Gets the clip an animation plays.
+         */
+        const AnimationClip* getClip(int handle) const {
+            return clips[handleEntries[handle]];
+        }
+
+        /**
+         * @brief Tells if an animation playing a clip once has reached its end, on the current clock whatever its level.
+         */
+        bool isFinished(int handle) const {
+            int entry = handleEntries[handle];
+            return clips[entry] != NULL && clips[entry]->isFinished(clipTimeOf(entry));
+        }
+
+        /**
+         * @brief Gets the number of registered animations.
+         */
+        int getCount() const {
+            return static_cast<int>(clips.size());
+        }
+
+        /**
+         * @brief Gets the number of animations at `detail`.
+         */
+        int getCount(AnimationDetail detail) const {
+            return levelStarts[detail + 1] - levelStarts[detail];
+        }
 };
 
 /**
- * @class Rectangle
- * @brief A class representing a rectangle with drawing and transformation capabilities.
+ * @class AnimationStateMachine
+ * @brief Shared definition of animation states and the transitions between them, compiled into a flat table.
  *
- * The `Rectangle` class provides methods to create a rectangle
- * and perform transformations such as translation, rotation, and scaling. The rectangle
- * is rendered using an `SDL_Renderer` and a specified color.
+ * Each state plays a clip, optionally with an overlay clip on a second layer (e.g. a shadow).
+ * A transition fires when every condition bit in its `required` mask is set and none of its `forbidden` mask is,
+ * the bits are chosen by the owner of the machine (held keys, one-off events, ...) except `CLIP_FINISHED`,
+ * which the caller sets while the clip of the current state has played to its end.
+ *
+ * The definition is built once with names, then `compile()` lays the transitions out per state in evaluation order:
+ * the transitions from `ANY_STATE` first, then the state's own ones, each group in the order they were added.
+ * `next()` walks only that slice with two mask tests per transition, so evaluating a state costs no lookups or allocations
+ * and one machine can be shared by every instance, each only keeps the index of its current state.
  */
-class Rectangle : public virtual shapeObj {
+class AnimationStateMachine {
+    public:
+        static const int ANY_STATE = -1; ///< Source of a transition that can leave every interruptible state.
+        static const Uint32 CLIP_FINISHED = 0x80000000u; ///< Condition bit set while the current state's clip has ended.
     private:
-        int x; ///< x-coordinate declaration for rectangle object(position in horizontal axis).
-        int y; ///< y-coordinate declaration for rectangle object(position in vertical axis).
-        int w; ///< width declaration for rectangle object(property).
-        int h; ///< height declaration for rectangle object(property).
-        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the rectangle in the window.
-        SDL_Color* color; ///< SDL_Color pointer used to specify the color of the rectangle object.
+        /**
+         * @brief A state as it is defined.
+         */
+        struct State {
+            string name; ///< Name used while building the machine.
+            const AnimationClip* clip; ///< Clip the state plays.
+            const AnimationClip* overlay; ///< Clip played on the second layer, may be NULL.
+            bool interruptible; ///< If `false`, transitions from `ANY_STATE` don't leave the state.
+        };
+
+        /**
+         * @brief A transition, `from` is `ANY_STATE` for the ones that can leave every interruptible state.
+         */
+        struct Transition {
+            int from; ///< Source state.
+            int to; ///< Target state.
+            Uint32 required; ///< Condition bits that all have to be set.
+            Uint32 forbidden; ///< Condition bits that all have to be clear.
+        };
+
+        vector<State> states; ///< States by index.
+        vector<Transition> transitions; ///< Transitions in the order they were added.
+        vector<Transition> compiled; ///< Transitions grouped by source state in evaluation order.
+        vector<int> firstTransitions; ///< Start of each state's group in `compiled`, one extra entry marks the end.
     public:
-        virtual ~Rectangle() {};
+        /**
+         * @brief Adds a state.
+         *
+         * @param name Name of the state, `findState()` looks it up while building.
+         * @param clip Clip the state plays.
+         * @param overlay Clip played on the second layer, NULL (default) for none.
+         * @param interruptible If `false`, the state is only left by its own transitions.
+         * @return Index of the state.
+         */
+        int addState(const string& name, const AnimationClip* clip, const AnimationClip* overlay = NULL, bool interruptible = true){
+            states.push_back({name, clip, overlay, interruptible});
+            return static_cast<int>(states.size()) - 1;
+        }
 
-        Rectangle(){};
+        /**
+         * @brief Adds a transition, the machine has to be compiled again before it is used.
+         *
+         * @param from Source state, `ANY_STATE` for every interruptible state other than `to`.
+         * @param to Target state.
+         * @param required Condition bits that all have to be set.
+         * @param forbidden Condition bits that all have to be clear, 0 (default) for none.
+         */
+        void addTransition(int from, int to, Uint32 required, Uint32 forbidden = 0){
+            transitions.push_back({from, to, required, forbidden});
+        }
 
         /**
-         * @brief Initializes / creates rectangle with given properties(position, dimensions, color) and renderer.
-         * 
-         * @param x The x-coordinate of the top left corner of the rectangle object.
-         * @param y The y-coordinate of the top left corner of the rectangle object.
-         * @param w The width of the rectangle.
-         * @param h The height of the rectangle.
-         * @param color The color which will be used to create a rectangle(outline color).
-         * @param renderer SDL_renderer used for rendering the rectangle in the window.
+         * @brief Lays the transitions out per state for `next()`.
          */
-        void createObject(int x, int y, int w, int h, SDL_Color* color, SDL_Renderer *renderer){
-            cout << "Object Rectangle Created" << endl;
-            this->x = x;
-            this->y = y;
-            this->w = w;
-            this->h = h;
-            this->color = color;
-            this->renderer = renderer;
+        void compile(){
+            int count = static_cast<int>(states.size());
+            compiled.clear();
+            firstTransitions.assign(count + 1, 0);
+            for(int state = 0; state < count; state++){
+                firstTransitions[state] = static_cast<int>(compiled.size());
+                if(states[state].interruptible){
+                    for(const Transition& transition : transitions){
+                        if(transition.from == ANY_STATE && transition.to != state){
+                            compiled.push_back(transition);
+                        }
+                    }
+                }
+                for(const Transition& transition : transitions){
+                    if(transition.from == state){
+                        compiled.push_back(transition);
+                    }
+                }
+            }
+            firstTransitions[count] = static_cast<int>(compiled.size());
         }
 
         /**
-        * @brief Draws the rectangle on the SDL renderer.
-        *
-        * This method sets the drawing color and renders the rectangle's outline using SDL.
-        * Creates a SDL_Rect tmp and uses values which were assigned in the `createObject()` function.
-        * Set's a color from the `createObject()` and draws Rectangle to the renderer.
-        */
-        void draw() {
-            SDL_Rect tmp = {x, y, w, h};
-            SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
-            SDL_RenderDrawRect(renderer, &tmp);
-            SDL_RenderPresent(renderer);
+         * @brief Evaluates the transitions leaving `state`.
+         *
+         * @param state The current state.
+         * @param conditions Condition bits that are set, including `CLIP_FINISHED` when the state's clip has ended.
+         * @return Target of the first transition that fires, `state` when none does.
+         */
+        int next(int state, Uint32 conditions) const {
+            const Transition* transition = compiled.data() + firstTransitions[state];
+            const Transition* end = compiled.data() + firstTransitions[state + 1];
+            for(; transition != end; ++transition){
+                if((conditions & transition->required) == transition->required && (conditions & transition->forbidden) == 0){
+                    return transition->to;
+                }
+            }
+            return state;
         }
 
         /**
-        * @brief Translates the rectangle by a given offset.
-        *
-        * This method moves the rectangle by the specified horizontal (dx) and vertical (dy) offsets
-        * and redraws it.
-        *
-        * @param dx The horizontal offset to move the rectangle.
-        * @param dy The vertical offset to move the rectangle.
-        */
-        void translate(int dx, int dy){
-            x += dx;
-            y += dy;
-            draw();
+         * @brief Looks up a state by name, meant for building the machine and not per frame.
+         * @return Index of the state, -1 when there is none with that name.
+         */
+        int findState(const string& name) const {
+            for(size_t i = 0; i < states.size(); i++){
+                if(states[i].name == name){
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
         }
 
         /**
-        * @brief Rotates the rectangle around its center by a given angle.
-        *
-        * This method computes the rotated positions of the rectangle's corners and renders
-        * the transformed rectangle using lines connecting these points.
-        *
-        * @param angle The angle by which to rotate the rectangle, in degrees(which is converted to radians later).
-        */
-        void rotate(float angle){
-            float centerX = x + (w / 2);
-            float centerY = y + (h / 2);
+         * @brief Gets the clip a state plays.
+         */
+        const AnimationClip* getClip(int state) const {
+            return states[state].clip;
+        }
 
-        // Convert angle to radians
-        float radians = angle * M_PI / 180.0f;
+        /**
+         * @brief Gets the clip a state plays on the second layer, NULL for none.
+         */
+        const AnimationClip* getOverlay(int state) const {
+            return states[state].overlay;
+        }
 
-        int points[4][2] = {
-            {x, y},              // Top-left
-            {x + w, y},          // Top-right
-            {x + w, y + h},      // Bottom-right
-            {x, y + h}           // Bottom-left
-        };
+        /**
+         * @brief Gets the name of a state.
+         */
+        const string& getStateName(int state) const {
+            return states[state].name;
+        }
 
-        for (int i = 0; i < 4; ++i) {
-            float dx = points[i][0] - centerX;
-            float dy = points[i][1] - centerY;
-            points[i][0] = round(centerX + (dx * (cos(radians)) - dy * (sin(radians))));
-            points[i][1] = round(centerY + (dx * (sin(radians)) + dy * (cos(radians))));
+        /**
+         * @brief Gets the number of states.
+         */
+        int getStateCount() const {
+            return static_cast<int>(states.size());
+        }
+};
+
+/**
+ * @class AnimatedObject
+ * @brief Abstract base class for objects with animation capabilities.
+ *
+ * The `AnimatedObject` class provides a pure virtual method `animate` to be implemented
+ * by derived classes. It serves as a base class for any object requiring animation functionality.
+ */
+class AnimatedObject {
+    public:
+        virtual ~AnimatedObject() = default;
+        /**
+         * @brief Pure virtual method to handle animation logic that will be dervied later.
+         */
+        virtual void animate() = 0;        
+};
+
+
+/**
+ * @class SpriteObject
+ * @brief A class representing an animated sprite object with drawable and animated capabilities.
+ *
+ * The `SpriteObject` class extends `BitmapObject` and `AnimatedObject` to provide functionalities
+ * for drawing, loading and animating sprites. The frames come from a shared `AnimationClip`,
+ * the sprite itself only holds a pointer to the clip and a time cursor into it.
+ * A sprite bound to an `AnimationSystem` leaves the cursor to the system and only reads its frame back.
+ */
+class SpriteObject : public BitmapObject, public AnimatedObject {
+    private:
+        const AnimationClip* clip; ///< Clip being played, owned by an `AnimationLibrary`, NULL shows the whole sheet.
+        Uint32 clipTime = 0; ///< Time cursor into the clip in milliseconds, kept within one cycle.
+        int currentFrame = -1; ///< Frame of the clip shown in the source rectangle, -1 before the first one.
+        Uint32 lastFrameTime; ///< Timestamp of the last `animate()` call.
+        AnimationSystem* system = NULL; ///< System advancing the sprite, NULL when it keeps its own cursor.
+        int systemHandle = -1; ///< Handle of the sprite in `system`.
+        AnimationDetail detail = DETAIL_FULL; ///< Level of detail the sprite is animated at.
+        Uint32 skippedCalls = 0; ///< `animate()` calls skipped since the last advance at a reduced level.
+
+        /**
+         * @brief Points the source rectangle at `frame` of the clip, only when the frame changed.
+         */
+        void showFrame(int frame){
+            if(frame != currentFrame){
+                currentFrame = frame;
+                setFrameRect(clip->getFrame(frame));
+            }
+        }
+
+        /**
+         * @brief Shows the frame under the time cursor.
+         */
+        void applyFrame(){
+            showFrame(clip->frameAt(clipTime));
+        }
+    public:
+        virtual ~SpriteObject(){
+            if(system != NULL){
+                system->remove(systemHandle);
+            }
+        }
+
+        /**
+         * @brief Constructor for the `SpriteObject` class.
+         *
+         * Initializes the sprite object with a sprite sheet, renderer, position and the clip it starts playing.
+         *
+         * @param filename Reference to a string containing the path to the sprite sheet.
+         * @param renderer Pointer to the SDL_Renderer used for rendering the sprite.
+         * @param x X-coordinate of the sprite's initial position.
+         * @param y Y-coordinate of the sprite's initial position.
+         * @param clip Clip to start with, NULL draws the whole sheet until `play()` is called.
+         * @param mipFilter Filter for the optional mip chain of the sheet, see `BitmapObject`.
+         */
+        SpriteObject(string& filename, SDL_Renderer* renderer, int x, int y, const AnimationClip* clip, MipFilter mipFilter = MIP_NONE)
+            : BitmapObject(filename, renderer, x, y, clip ? clip->getFrame(0).w : 0, clip ? clip->getFrame(0).h : 0, mipFilter), clip(clip){
+            lastFrameTime = SDL_GetTicks();
+            if(clip != NULL){
+                applyFrame();
+            }
+        }
+
+        /**
+         * @brief Calls in the `draw()` method from the `BitmapObject` class.
+         */
+        void draw() override {
+            BitmapObject::draw();
+        }
+
+        /**
+         * @brief Switches to another clip.
+         *
+         * Playing the clip that is already playing keeps its time cursor unless `restart` is set,
+         * so the caller can request the wanted clip every frame.
+         *
+         * @param clip The clip to play.
+         * @param restart If `true`, the clip starts over even when it is already playing.
+         */
+        void play(const AnimationClip* clip, bool restart = false){
+            if(clip == NULL || (clip == this->clip && !restart)){
+                return;
+            }
+            this->clip = clip;
+            clipTime = 0;
+            currentFrame = -1;
+            if(system != NULL){
+                system->play(systemHandle, clip, true);
+            }
+            applyFrame();
         }
 
+        /**
+         * @brief Hands the animation over to `system`, which has to outlive the sprite.
+         *
+         * From then on `system.update()` advances the clip and `animate()` only shows the frame the system computed.
+         *
+         * @param system The system to register with.
+         */
+        void useSystem(AnimationSystem& system){
+            if(this->system != NULL){
+                this->system->remove(systemHandle);
+            }
+            this->system = &system;
+            systemHandle = system.add(clip, detail);
+        }
 
-        SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
+        /**
+         * @brief Sets the level of detail the sprite is animated at.
+         *
+         * A sprite keeping its own cursor advances on every n-th `animate()` call of a reduced level and not at all
+         * while hidden, either way it catches up with the time that passed on the next advance.
+         *
+         * @param detail The new level.
+         */
+        void setDetail(AnimationDetail detail){
+            if(detail == this->detail){
+                return;
+            }
+            this->detail = detail;
+            skippedCalls = 0;
+            if(system != NULL){
+                system->setDetail(systemHandle, detail);
+            }
+        }
 
-        
-        SDL_RenderDrawLine(renderer, points[0][0], points[0][1], points[1][0], points[1][1]); // Top edge
-        SDL_RenderDrawLine(renderer, points[1][0], points[1][1], points[2][0], points[2][1]); // Right edge
-        SDL_RenderDrawLine(renderer, points[2][0], points[2][1], points[3][0], points[3][1]); // Bottom edge
-        SDL_RenderDrawLine(renderer, points[3][0], points[3][1], points[0][0], points[0][1]); // Left edge
+        /**
+         * @brief Picks the level of detail from where the sprite is drawn, see `AnimationSystem::chooseDetail()`.
+         *
+         * @param view The visible area.
+         */
+        void updateDetail(const SDL_Rect& view){
+            setDetail(AnimationSystem::chooseDetail(getBounds(), view));
+        }
 
-        SDL_RenderPresent(renderer);
+        /**
+         * @brief Gets the level of detail the sprite is animated at.
+         * @return `detail`.
+         */
+        AnimationDetail getDetail(){
+            return detail;
         }
 
         /**
-         * @brief Scales the rectangle by a given factor around it's center.
+         * @brief Moves the time cursor forward and updates the frame, a sprite bound to an `AnimationSystem` ignores it.
          *
-         * This method adjusts the rectangle's dimensions and position relative to its center
-         * based on the specified scaling factor and redraws it.
+         * @param milliseconds Time to advance by.
+         */
+        void advance(Uint32 milliseconds){
+            if(clip != NULL && system == NULL){
+                clipTime = clip->wrapTime(clipTime + milliseconds);
+                applyFrame();
+            }
+        }
+
+        /**
+         * @brief Advances the clip by the time passed since the previous call.
          *
-         * @param factor The scaling factor (greater than 1 to enlarge, less than 1 to shrink).
+         * A sprite bound to an `AnimationSystem` shows the frame the system computed instead.
+         * At a reduced level of detail only every n-th call advances, a hidden sprite doesn't advance until it is visible again.
          */
-        void scale(float factor){
-            float scaledWidth = w * factor;
-            float scaledHeight = h * factor;    
+        void animate() override{
+            if(system != NULL){
+                if(clip != NULL && detail != DETAIL_HIDDEN){
+                    showFrame(system->getFrame(systemHandle));
+                }
+                return;
+            }
+            if(detail == DETAIL_HIDDEN || ++skippedCalls < (1u << detail)){
+                return;
+            }
+            skippedCalls = 0;
+            Uint32 currentTicks = SDL_GetTicks();
+            advance(currentTicks - lastFrameTime);
+            lastFrameTime = currentTicks;
+        }
 
-            float tmpX = (x + w / 2) - scaledWidth / 2;
-            float tmpY = (y + h / 2) - scaledHeight / 2;
+        /**
+         * @brief Gets the clip being played.
+         * @return `clip`.
+         */
+        const AnimationClip* getClip(){
+            return clip;
+        }
 
-            x = static_cast<int>(tmpX);
-            y = static_cast<int>(tmpY);
-            w = static_cast<int>(scaledWidth);
-            h = static_cast<int>(scaledWidth);
-            draw();
+        /**
+         * @brief Gets the frame of the clip being shown.
+         * @return `currentFrame`.
+         */
+        int getCurrentFrame(){
+            return currentFrame;
         }
 
-        virtual void update() override {}
+        /**
+         * @brief Tells if a clip played once has reached its end.
+         */
+        bool isFinished(){
+            if(system != NULL){
+                return system->isFinished(systemHandle);
+            }
+            return clip != NULL && clip->isFinished(clipTime);
+        }
 };
 
 /**
- * @class Line
- * @brief A class representing a Line with drawing and transformation capabilities.
+ * @class Player
+ * @brief A class representing a player-controlled sprite in a game.
+ * 
+ * The `Player` class extends `SpriteObject` to include frame animations for a player object, 
+ * turns input actions into movement and animation. It manages
+ * direction the player is facing, travel speed, and idle state.
  *
- * The `Line` class provides methods to create a Line
- * and perform transformations such as translation, rotation, and scaling. The Line
- * is rendered using an `SDL_Renderer` and a specified color.
+ * The clips are picked by an `AnimationStateMachine` over the Soldier sheet (idle, walk, three attacks, hurt and death),
+ * built once by `soldierMachine()` and shared by every player. Input sets condition bits, the machine picks the state
+ * in `update()` and finished attack and hurt clips lead back to idle. A shadow drawn from the Soldier shadow sheets
+ * follows the player, which of the sheets is used comes with the state as its overlay clip.
+ * The clips are named `soldier_<clip>`, when the shared `AnimationLibrary` doesn't have them they are registered from the sheet layout.
+ *
+ * The player is simulated in fixed steps of a `GameLoop`: `update()` reads its actions from an `InputState` (see
+ * `useInput()`), moves the player and steps the machine, `render()` draws it between its previous and latest position.
  */
-class Line : public virtual shapeObj {
-    private:
-        int xStart; ///< Starting x-coordinate of the Line object.
-        int yStart; ///< Starting y-coordinate of the Line object.
-        int xEnd; ///< Ending x-coordinate of the Line object.
-        int yEnd; ///< Ending y-coordinate of the Line object.
-        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the Line in the window.
-        SDL_Color* color; ///< SDL_Color pointer used to specify the color of the Line object.
-    public:
-        virtual ~Line(){};
+class Player : public SpriteObject {
+public:
+    /**
+     * @brief Actions the player reads from its `InputState`, the directions first in the order of `direction`.
+     */
+    enum PlayerAction {
+        ACTION_UP,
+        ACTION_LEFT,
+        ACTION_DOWN,
+        ACTION_RIGHT,
+        ACTION_ATTACK01,
+        ACTION_ATTACK02,
+        ACTION_ATTACK03,
+        ACTION_HURT,
+        ACTION_DIE,
+        ACTION_REVIVE,
+        ACTION_COUNT
+    };
+private:
+    /**
+     * @brief States of the soldier machine, in the order `buildSoldierMachine()` adds them.
+     */
+    enum SoldierState {
+        SOLDIER_IDLE,
+        SOLDIER_WALK,
+        SOLDIER_ATTACK01,
+        SOLDIER_ATTACK02,
+        SOLDIER_ATTACK03,
+        SOLDIER_HURT,
+        SOLDIER_DEATH
+    };
 
-        Line(){}
+    /**
+     * @brief Condition bits the player feeds to the soldier machine.
+     */
+    enum PlayerCondition : Uint32 {
+        PLAYER_MOVING = 1u << 0, ///< A movement key is held.
+        PLAYER_ATTACK01 = 1u << 1, ///< The first attack was requested.
+        PLAYER_ATTACK02 = 1u << 2, ///< The second attack was requested.
+        PLAYER_ATTACK03 = 1u << 3, ///< The third attack was requested.
+        PLAYER_HURT = 1u << 4, ///< The player was hit.
+        PLAYER_DIE = 1u << 5, ///< The player was killed.
+        PLAYER_REVIVE = 1u << 6 ///< A dead player was asked to get back up.
+    };
 
-        /**
-         * @brief Initializes / creates Line with given properties(position, dimensions, color) and renderer.
-         * 
-         * @param x1 The start x-coordinate of the Line object.
-         * @param y1 The start y-coordinate of the Line object.
-         * @param x2 The end x-coordinate of the Line object.
-         * @param y2 The end y-coordinate of the Line object.
-         * @param color The color which will be used to create a Line(outline color).
-         * @param renderer SDL_renderer used for rendering the Line in the window.
-         */
-        void createObject(int x1, int y1, int x2, int y2, SDL_Color* color, SDL_Renderer* renderer){
-            this->xStart = x1;
-            this->yStart = y1;           
-            this->xEnd = x2;
-            this->yEnd = y2;
-            this->renderer = renderer;
-            this->color = color;
-        }
+    static const int shadowCount = 3; ///< Number of shadow sheets: standing, second attack and death.
 
-        /**
-        * @brief Draws the Line on the SDL renderer.
-        *
-        * This method sets the drawing color and renders the Line based on its start and end coordinates.
-        */
-        void draw(){
-            SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
-            SDL_RenderDrawLine(renderer, xStart, yStart, xEnd, yEnd);      
-            SDL_RenderPresent(renderer);
+    int moveSpeed; ///< Movement speed of the player, in pixels per simulation step.
+    int direction; ///< 0: Up, 1: Left, 2: Down, 3: Right
+    bool idle; ///< keeps track if the player just standing or moving.
+    int heldDirections = 0; ///< Bit per direction whose action is held.
+    int positionX; ///< Simulated x-coordinate after the latest step.
+    int positionY; ///< Simulated y-coordinate after the latest step.
+    int previousX; ///< Simulated x-coordinate before the latest step.
+    int previousY; ///< Simulated y-coordinate before the latest step.
+    const AnimationStateMachine& machine; ///< Shared soldier machine.
+    int state = SOLDIER_IDLE; ///< Current state of `machine`.
+    Uint32 triggered = 0; ///< One-off conditions raised since the last `update()`.
+    const InputState* input = NULL; ///< Input read in `update()`, NULL keeps the player still.
+    int actions[ACTION_COUNT]; ///< Index in `input` of each `PlayerAction`, set by `useInput()`.
+    string shadowFiles[shadowCount]; ///< Paths of the shadow sheets, the shadow sprites keep references to them.
+    SpriteObject standingShadow; ///< Shadow of every state without its own.
+    SpriteObject attackShadow; ///< Shadow of the second attack.
+    SpriteObject deathShadow; ///< Shadow of the death.
+    SpriteObject* shadows[shadowCount]; ///< The shadow sprites in the order of `shadowFiles`.
+    int shadow = 0; ///< Index of the shadow drawn under the current state.
+
+    /**
+     * @brief Finds the clip `name`, registering it from the sheet layout when it is missing.
+     *
+     * The registered clip has `count` frames of `frameWidth` x `frameHeight` in row `row`, each shown for `duration` ms.
+     */
+    static const AnimationClip* findClip(const string& name, int row, int count, Uint32 duration, LoopMode loopMode, int frameWidth, int frameHeight){
+        AnimationLibrary& library = AnimationLibrary::shared();
+        const AnimationClip* clip = library.get(name);
+        if(clip == NULL){
+            clip = library.add(AnimationClip(name, AnimationClip::gridFrames(0, row * frameHeight, frameWidth, frameHeight, count), {duration}, loopMode));
         }
+        return clip;
+    }
 
-        /**
-         * @brief Translates the Line by a given offset.
-         *
-         * This method moves the Line by the specified horizontal (dx) and vertical (dy) offsets
-         * and redraws it.
-         *
-         * @param dx The horizontal offset to move the Line.
-         * @param dy The vertical offset to move the Line.
-         */        
-        void translate(int dx, int dy){
-            xStart += dx;
-            xEnd += dx;
-            yStart += dy;
-            yEnd += dy;
-            draw();
+    /**
+     * @brief Builds the soldier machine, the states are added in the order of `SoldierState`.
+     *
+     * Dying and getting hurt leave any state, attacks start from idle or walking and return to idle when their clip ends.
+     * A dead soldier stays down until it is revived after the death clip has played.
+     */
+    static AnimationStateMachine buildSoldierMachine(int frameWidth, int frameHeight){
+        const AnimationClip* standing = findClip("soldier_shadow", 0, 1, 100, LOOP_ONCE, frameWidth, frameHeight);
+        const AnimationClip* attacking = findClip("soldier_shadow_attack2", 0, 6, 80, LOOP_ONCE, frameWidth, frameHeight);
+        const AnimationClip* dying = findClip("soldier_shadow_death", 0, 4, 120, LOOP_ONCE, frameWidth, frameHeight);
+
+        AnimationStateMachine soldier;
+        soldier.addState("idle", findClip("soldier_idle", 0, 6, 100, LOOP_REPEAT, frameWidth, frameHeight), standing);
+        soldier.addState("walk", findClip("soldier_walk", 1, 8, 100, LOOP_REPEAT, frameWidth, frameHeight), standing);
+        soldier.addState("attack01", findClip("soldier_attack01", 2, 6, 80, LOOP_ONCE, frameWidth, frameHeight), standing);
+        soldier.addState("attack02", findClip("soldier_attack02", 3, 6, 80, LOOP_ONCE, frameWidth, frameHeight), attacking);
+        soldier.addState("attack03", findClip("soldier_attack03", 4, 9, 70, LOOP_ONCE, frameWidth, frameHeight), standing);
+        soldier.addState("hurt", findClip("soldier_hurt", 5, 4, 80, LOOP_ONCE, frameWidth, frameHeight), standing);
+        soldier.addState("death", findClip("soldier_death", 6, 4, 120, LOOP_ONCE, frameWidth, frameHeight), dying, false);
+
+        soldier.addTransition(AnimationStateMachine::ANY_STATE, SOLDIER_DEATH, PLAYER_DIE);
+        soldier.addTransition(AnimationStateMachine::ANY_STATE, SOLDIER_HURT, PLAYER_HURT);
+        for(int from : {SOLDIER_IDLE, SOLDIER_WALK}){
+            soldier.addTransition(from, SOLDIER_ATTACK01, PLAYER_ATTACK01);
+            soldier.addTransition(from, SOLDIER_ATTACK02, PLAYER_ATTACK02);
+            soldier.addTransition(from, SOLDIER_ATTACK03, PLAYER_ATTACK03);
+        }
+        soldier.addTransition(SOLDIER_IDLE, SOLDIER_WALK, PLAYER_MOVING);
+        soldier.addTransition(SOLDIER_WALK, SOLDIER_IDLE, 0, PLAYER_MOVING);
+        for(int from : {SOLDIER_ATTACK01, SOLDIER_ATTACK02, SOLDIER_ATTACK03, SOLDIER_HURT}){
+            soldier.addTransition(from, SOLDIER_IDLE, AnimationStateMachine::CLIP_FINISHED);
         }
+        soldier.addTransition(SOLDIER_DEATH, SOLDIER_IDLE, AnimationStateMachine::CLIP_FINISHED | PLAYER_REVIVE);
+        soldier.compile();
+        return soldier;
+    }
 
-        /**
-         * @brief Rotates the Line around its center by a given angle.
-         *
-         * This method computes the rotated positions of the Line's start and end points and
-         * renders the transformed Line.
-         *
-         * @param angle The angle by which to rotate the Line, in degrees(converted to the radians later).
-         */
-        void rotate(float angle){
-            float centerX = (xStart + xEnd) / 2;
-            float centerY = (yStart + yEnd) / 2;
+    /**
+     * @brief Soldier machine shared by every player, built by the first one with its frame size.
+     */
+    static const AnimationStateMachine& soldierMachine(int frameWidth, int frameHeight){
+        static const AnimationStateMachine soldier = buildSoldierMachine(frameWidth, frameHeight);
+        return soldier;
+    }
 
-            float radians = angle * M_PI / 180.0f;
+    /**
+     * @brief Path of the shadow sheet `name` next to the player's sheet.
+     */
+    static string shadowFile(const string& filename, const char* name){
+        size_t slash = filename.find_last_of('/');
+        return (slash == string::npos ? string() : filename.substr(0, slash + 1)) + name;
+    }
 
-            int points[2][2] = {
-                {xStart, yStart}, 
-                {xEnd, yEnd}
-            };
+    /**
+     * @brief Switches to `next`, restarting its clip and the shadow sprite that plays its overlay.
+     */
+    void enterState(int next){
+        state = next;
+        play(machine.getClip(state), true);
+        const AnimationClip* overlay = machine.getOverlay(state);
+        for(int i = 0; i < shadowCount; i++){
+            if(shadows[i]->getClip() == overlay){
+                shadow = i;
+                shadows[i]->play(overlay, true);
+                break;
+            }
+        }
+    }
 
-            for(int i = 0; i < 2; ++i){
-                float dx = points[i][0] - centerX;
-                float dy = points[i][1] - centerY;
-                points[i][0] = round(centerX + (dx * (cos(radians)) - dy * (sin(radians))));
-                points[i][1] = round(centerY + (dx * (sin(radians)) + dy * (cos(radians))));
+    /**
+     * @brief Tells if the state lets the player walk.
+     */
+    bool canMove(){
+        return state == SOLDIER_IDLE || state == SOLDIER_WALK;
+    }
+
+    /**
+     * @brief Reads the player's actions from `input`: the held directions, the newest pressed one to face, and the one-off requests.
+     *
+     * The player faces a newly pressed direction while it is idle or walking, and when the direction it faces is
+     * released it turns to another one still held.
+     */
+    void readInput(const InputState& input){
+        int held = 0;
+        for(int d = 0; d < 4; d++){
+            if(input.isDown(actions[d])){
+                held |= 1 << d;
             }
-            
-            SDL_SetRenderDrawColor(renderer, color->r, color->g, color->b, color->a);
+        }
+        if(canMove()){
+            for(int d = 0; d < 4; d++){
+                if((held & (1 << d)) && input.wasPressed(actions[d])){
+                    setDirection(d);
+                }
+            }
+        }
+        if(held != 0 && !(held & (1 << direction))){
+            for(int d = 0; d < 4; d++){
+                if(held & (1 << d)){
+                    setDirection(d);
+                    break;
+                }
+            }
+        }
+        heldDirections = held;
+        idle = held == 0;
+        static const Uint32 requests[6] = {PLAYER_ATTACK01, PLAYER_ATTACK02, PLAYER_ATTACK03, PLAYER_HURT, PLAYER_DIE, PLAYER_REVIVE};
+        for(int i = 0; i < 6; i++){
+            if(input.wasPressed(actions[ACTION_ATTACK01 + i])){
+                triggered |= requests[i];
+            }
+        }
+    }
+public:
+    virtual ~Player() = default;
+    
+    /**
+     * @brief Constructs a Player object with specified properties.
+     * 
+     * direction is set to 2, which is looking down. Idle bool is set to true at the start.
+     * The shadow sheets are looked up next to `filename`.
+     * 
+     * @param filename The path to the Soldier sprite sheet for the player.
+     * @param renderer SDL_Renderer used for rendering the player in the game window.
+     * @param spawnX The x-coordinate where the player spawns.
+     * @param spawnY The y-coordinate where the player spawns.
+     * @param playerWidth The width of a single frame of the player sprite.
+     * @param playerHeight The height of a single frame of the player sprite.
+     * @param moveSpeed The speed at which the player moves, in pixels per simulation step.
+     */
+    Player(string& filename, SDL_Renderer* renderer, int spawnX, int spawnY, int playerWidth, int playerHeight, int moveSpeed)
+        : SpriteObject(filename, renderer, spawnX, spawnY, soldierMachine(playerWidth, playerHeight).getClip(SOLDIER_IDLE)), moveSpeed(moveSpeed),
+          positionX(spawnX), positionY(spawnY), previousX(spawnX), previousY(spawnY),
+          machine(soldierMachine(playerWidth, playerHeight)),
+          shadowFiles{shadowFile(filename, "Soldier-Shadow.png"), shadowFile(filename, "Soldier-Shadow_attack2.png"), shadowFile(filename, "Soldier-Shadow_death.png")},
+          standingShadow(shadowFiles[0], renderer, spawnX, spawnY, machine.getOverlay(SOLDIER_IDLE)),
+          attackShadow(shadowFiles[1], renderer, spawnX, spawnY, machine.getOverlay(SOLDIER_ATTACK02)),
+          deathShadow(shadowFiles[2], renderer, spawnX, spawnY, machine.getOverlay(SOLDIER_DEATH)),
+          shadows{&standingShadow, &attackShadow, &deathShadow}{
+            direction = 2;
+            idle = true;
+    }
+
+    /**
+     * @brief Hands the player's animation and the ones of its shadows over to `system`, see `SpriteObject::useSystem()`.
+     */
+    void useSystem(AnimationSystem& system){
+        SpriteObject::useSystem(system);
+        for(SpriteObject* layer : shadows){
+            layer->useSystem(system);
+        }
+    }
+
+    /**
+     * @brief Picks the level of detail of the player and its shadows, see `SpriteObject::updateDetail()`.
+     */
+    void updateDetail(const SDL_Rect& view){
+        SpriteObject::updateDetail(view);
+        for(SpriteObject* layer : shadows){
+            layer->setDetail(getDetail());
+        }
+    }
+
+    /**
+     * @brief Gets direction which the player is currently facing.
+     * @return `direction`.
+     */
+    int getDirection(){
+        return direction;
+    }
+
+    /**
+     * @brief Sets direction in which the player is facing.
+     *
+     * The Soldier sheet faces right, facing left mirrors it. Up and down keep the side the player faced before.
+     */
+    void setDirection(int direction){
+        this->direction = direction;
+        if(direction == 1){
+            setFlip(SDL_FLIP_HORIZONTAL);
+        } else if(direction == 3){
+            setFlip(SDL_FLIP_NONE);
+        }
+    }
 
-            SDL_RenderDrawLine(renderer, points[0][0], points[1][0], points[0][1], points[1][1]);
-            SDL_RenderPresent(renderer);
+    /**
+     * @brief Gets the name of the state the soldier machine is in.
+     */
+    const string& getStateName(){
+        return machine.getStateName(state);
+    }
 
+    /**
+     * @brief FNV-1a hash of the simulated state: position, direction, machine state and whether its clip has ended.
+     *
+     * Runs that simulated the same steps from the same input end on the same hash, see `InputRecording`.
+     */
+    Uint64 stateHash(){
+        Uint64 hash = 14695981039346656037ull;
+        for(int value : {positionX, positionY, direction, state, isFinished() ? 1 : 0}){
+            for(int byte = 0; byte < 4; byte++){
+                hash = (hash ^ ((static_cast<unsigned>(value) >> (byte * 8)) & 0xFF)) * 1099511628211ull;
+            }
         }
+        return hash;
+    }
 
-        /**
-        * @brief Scales the Line by a given factor.
-        *
-        * This method adjusts the Line's start and end coordinates relative to its origin
-        * based on the specified scaling factor and redraws it.
-        *
-        * @param factor The scaling factor (greater than 1 to enlarge, less than 1 to shrink).
-        */
-        void scale(float factor){  
-        float tmpX = xStart * factor;
-        float tmpY = yStart * factor;
-        float tmpX2 = xEnd * factor;
-        float tmpY2 = yEnd * factor;
+    /**
+     * @brief Reads its actions from `input` in every `update()`, defining the missing ones with the default keys:
+     * arrows or WASD to walk, Z, X and C for the three attacks, H to get hurt, K to die and R to revive.
+     *
+     * @param input Input state filled by the main loop, it has to outlive the player.
+     */
+    void useInput(InputState& input){
+        static const char* names[ACTION_COUNT] = {"up", "left", "down", "right", "attack01", "attack02", "attack03", "hurt", "die", "revive"};
+        static const SDL_Scancode keys[ACTION_COUNT][2] = {
+            {SDL_SCANCODE_UP, SDL_SCANCODE_W}, {SDL_SCANCODE_LEFT, SDL_SCANCODE_A}, {SDL_SCANCODE_DOWN, SDL_SCANCODE_S}, {SDL_SCANCODE_RIGHT, SDL_SCANCODE_D},
+            {SDL_SCANCODE_Z, SDL_SCANCODE_UNKNOWN}, {SDL_SCANCODE_X, SDL_SCANCODE_UNKNOWN}, {SDL_SCANCODE_C, SDL_SCANCODE_UNKNOWN},
+            {SDL_SCANCODE_H, SDL_SCANCODE_UNKNOWN}, {SDL_SCANCODE_K, SDL_SCANCODE_UNKNOWN}, {SDL_SCANCODE_R, SDL_SCANCODE_UNKNOWN}};
+        for(int i = 0; i < ACTION_COUNT; i++){
+            actions[i] = input.findAction(names[i]);
+            if(actions[i] < 0){
+                actions[i] = input.addAction(names[i]);
+                for(SDL_Scancode key : keys[i]){
+                    if(key != SDL_SCANCODE_UNKNOWN){
+                        input.bind(actions[i], key);
+                    }
+                }
+            }
+        }
+        this->input = &input;
+    }
 
-        xStart = static_cast<int>(tmpX);
-        yStart = static_cast<int>(tmpY);
-        xEnd = static_cast<int>(tmpX2);
-        yEnd = static_cast<int>(tmpY2);
+    /**
+     * @brief First class to actually use update, what a surprise. 
+     * Advances the player by one simulation step.
+     * - Reads the actions of its `InputState`, see `useInput()`.
+     * - Evaluates the soldier machine with the held and triggered conditions, a new state restarts its clip and shadow.
+     * - Moves the player by `moveSpeed` in its direction while a movement key is held and the state lets it walk.
+     */
+    void update() override {
+        if(input != NULL){
+            readInput(*input);
+        }
+        Uint32 conditions = triggered;
+        triggered = 0;
+        if(!idle){
+            conditions |= PLAYER_MOVING;
+        }
+        if(isFinished()){
+            conditions |= AnimationStateMachine::CLIP_FINISHED;
+        }
+        int next = machine.next(state, conditions);
+        if(next != state){
+            enterState(next);
+        }
+        previousX = positionX;
+        previousY = positionY;
+        if(!idle && canMove()){
+            static const int stepX[4] = {0, -1, 0, 1};
+            static const int stepY[4] = {-1, 0, 1, 0};
+            positionX += stepX[direction] * moveSpeed;
+            positionY += stepY[direction] * moveSpeed;
+        }
+    }
+
+    /**
+     * @brief Renders the player on the screen between its previous and latest simulated position.
+     * - Calls the `animate` method to advance the clip.
+     * - Draws the shadow under the player, then calls the `draw` method to render the player on the screen.
+     *
+     * @param alpha Interpolation factor from the `GameLoop`, 0 draws the previous position and 1 the latest.
+     */
+    void render(double alpha){
+        setPosition(GameLoop::interpolate(previousX, positionX, alpha), GameLoop::interpolate(previousY, positionY, alpha));
+        animate();
+        SpriteObject* layer = shadows[shadow];
+        layer->setPosition(getX(), getY());
+        layer->setFlip(getFlip());
+        layer->animate();
+        layer->draw();
         draw();
     }
 
-        virtual void update() override{};
+    /**
+     * @brief Instead of `render()`, adds the player and its shadow to `snapshot` for a render thread to draw.
+     *
+     * Animates the player and the shadow like `render()` does, so it is called on the simulation thread.
+     *
+     * @param snapshot Snapshot to add to.
+     */
+    void capture(RenderSnapshot& snapshot){
+        setPosition(positionX, positionY);
+        animate();
+        SpriteObject* layer = shadows[shadow];
+        layer->animate();
+        SDL_Rect current = getBounds();
+        SDL_Rect previous = {previousX, previousY, current.w, current.h};
+        snapshot.sprites.push_back({layer, layer->getFrameRect(), previous, current, getFlip()});
+        snapshot.sprites.push_back({this, getFrameRect(), previous, current, getFlip()});
+    }
 };
 
 /**
- * @class BitmapManager
- * @brief This class will be handling fundamental bitmap operations such as creation, loading, deleting, saving and copying to other bmp.
- * 
- * Will be using SDL's SDL_Surface structure to manipulate bitmap operations.
+ * @brief Seconds elapsed since `start`, a value of SDL_GetPerformanceCounter().
  */
-class BitmapManager {
-    private:
-        SDL_Surface* imageSurface = NULL; ///< Pointer to the SDL_Surface representing the bitmap image.
-    public:
-        /**
-         * @brief Destructor for the `BitmapManager` class.
-         * 
-         * Cleans up and deletes any associated resources by freeing the `imageSurface`, freeing the surface is important mechanic in the Manager. 
-         */
-        virtual ~BitmapManager(){deleteBitmapObj();}
-
-        BitmapManager(){}
+static double secondsSince(Uint64 start){
+    return (SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+}
 
-        /**
-         * @brief Loads bitmap image from a given string filename into the surface(`imageSurface`).
-         * 
-         * If a surface is already loaded, it frees that surface so we can keep using it.
-         * 
-         * @param filename Reference to a string containing the path and file itself that we ought to load.
-         * @return `true` if the image is successfully loaded, `false` if it couldn't either find it with given path,
-         * or the file doesn't exist.
-         */
-        bool loadBitmapContent(string& filename){
-            if(imageSurface != NULL){
-                SDL_FreeSurface(imageSurface);
-                imageSurface == NULL;
-            }
-            
-            imageSurface = IMG_Load(filename.c_str());
-            if(imageSurface != NULL){
-                return true;
+/**
+ * @brief Throughput of the CPU blit kernels against SDL_BlitSurface, in megapixels per second (`--bench-blit`).
+ *
+ * Blits a 512x512 sprite-like source (runs of transparent, translucent and opaque pixels) onto a 1024x1024 ARGB8888 target.
+ * Every SIMD kernel is first checked against the scalar reference, a mismatch is reported next to its timing.
+ */
+static void runBlitBenchmark(){
+    const int size = 512, iterations = 200;
+    SDL_Surface* source = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, 1024, 1024, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Surface* expected = SDL_CreateRGBSurfaceWithFormat(0, 1024, 1024, 32, SDL_PIXELFORMAT_ARGB8888);
+    if(source == NULL || target == NULL || expected == NULL){
+        ENGINE_LOG_ERROR(BENCH, "runBlitBenchmark: SDL_CreateRGBSurfaceWithFormat " << SDL_GetError());
+        return;
+    }
+    Uint32 seed = 12345;
+    for(int y = 0; y < size; y++){
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(source->pixels) + y * source->pitch);
+        for(int x = 0; x < size; x++){
+            seed = seed * 1664525 + 1013904223;
+            int band = (x / 32 + y / 32) % 3; // transparent, translucent and opaque patches like a sprite sheet
+            Uint32 alpha = band == 0 ? 0 : (band == 1 ? (seed >> 24) : 255);
+            row[x] = (alpha << 24) | (seed & 0x00FFFFFF);
+        }
+    }
+    auto resetTarget = [](SDL_Surface* surface){
+        for(int y = 0; y < surface->h; y++){
+            Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+            for(int x = 0; x < surface->w; x++){
+                row[x] = 0xFF000000 | ((x * 7) << 16 & 0xFF0000) | ((y * 3) << 8 & 0xFF00) | ((x + y) & 0xFF);
             }
-            return false;
         }
+    };
 
-        /**
-         * @brief Creates a bitmap object / new blank bitmap surface with the specified height, width and bit depth.
-         * 
-         * If a surface is already loaded, it frees that surface so we can keep using it.
-         * Creates a surface with the specified format.
-         * 
-         * @param bWidth The width of the bitmap.
-         * @param bHeight The height of the bitmap.
-         * @param depth The bit depth of the bitmap(set to 24 by default).
-         * @return `true` if the surface is successfully created, `false` if it isn't.
-         */
-        bool createBitmapObj(int bWidth, int bHeight, int depth = 24){
-            if(imageSurface != NULL){
-                SDL_FreeSurface(imageSurface);
-                imageSurface = NULL;
-            }
-            imageSurface = SDL_CreateRGBSurfaceWithFormat(0, bWidth, bHeight, depth, SDL_PIXELFORMAT_RGB24);
+    vector<const BlitKernels*> implementations(1, &scalarBlitKernels);
+#ifdef ENGINE_SSE2
+    if(SDL_HasSSE2()){implementations.push_back(&sse2BlitKernels);}
+#endif
+#ifdef ENGINE_AVX2
+    if(SDL_HasAVX2()){implementations.push_back(&avx2BlitKernels);}
+#endif
 
-            if(imageSurface != NULL){
-                return true;
+    const BlitMode modes[] = {BLIT_COPY, BLIT_ALPHA, BLIT_ADDITIVE, BLIT_COLORKEY};
+    const char* modeNames[] = {"copy", "alpha", "additive", "colorkey"};
+    const Uint8 alpha = 200;
+    const Uint32 colorKey = 0x00FF00FF;
+    SDL_Rect srcRect = {0, 0, size, size};
+    SDL_Rect dstRect = {256, 256, size, size};
+    double megapixels = static_cast<double>(size) * size * iterations / 1e6;
+
+    for(int m = 0; m < 4; m++){
+        resetTarget(expected);
+        blitWithKernels(source, srcRect, expected, dstRect, modes[m], alpha, colorKey, scalarBlitKernels);
+        for(const BlitKernels* kernels : implementations){
+            resetTarget(target);
+            blitWithKernels(source, srcRect, target, dstRect, modes[m], alpha, colorKey, *kernels);
+            bool matches = memcmp(target->pixels, expected->pixels, static_cast<size_t>(target->pitch) * target->h) == 0;
+            Uint64 start = SDL_GetPerformanceCounter();
+            for(int i = 0; i < iterations; i++){
+                blitWithKernels(source, srcRect, target, dstRect, modes[m], alpha, colorKey, *kernels);
             }
-            return false;
+            ENGINE_LOG_INFO(BENCH, fixed << setprecision(1) << setw(9) << modeNames[m] << " " << setw(8) << kernels->name << " " << setw(9) << megapixels / secondsSince(start) << " MP/s"
+                 << (matches ? "" : "  MISMATCH vs scalar"));
         }
 
-        /**
-         * @brief deletes the bitmap object / current bitmap surface, by freeing the surface.
-         */
-        void deleteBitmapObj(){
-            if(imageSurface != NULL){
-                SDL_FreeSurface(imageSurface);
-            }
+        SDL_SetSurfaceBlendMode(source, modes[m] == BLIT_ALPHA ? SDL_BLENDMODE_BLEND : (modes[m] == BLIT_ADDITIVE ? SDL_BLENDMODE_ADD : SDL_BLENDMODE_NONE));
+        SDL_SetSurfaceAlphaMod(source, modes[m] == BLIT_ALPHA || modes[m] == BLIT_ADDITIVE ? alpha : 255);
+        SDL_SetColorKey(source, modes[m] == BLIT_COLORKEY ? SDL_TRUE : SDL_FALSE, colorKey);
+        resetTarget(target);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int i = 0; i < iterations; i++){
+            SDL_Rect placed = dstRect;
+            SDL_BlitSurface(source, &srcRect, target, &placed);
         }
-        /**
-        * @brief Saves the current bitmap surface to a specified file.
-        *
-        * This method saves the bitmap content to the specified file.
-        *
-        * @param filename Reference to a string containing the path where the bitmap will be saved.
-        * @return `true` if the file is successfully saved, `false` otherwise.
-        */
-        bool saveToFile(string& filename){ // can either save to already exisitng or specify the path myself in parameter;  
-            if(imageSurface != NULL){ // checks if it exists
-                if(SDL_SaveBMP(imageSurface, filename.c_str()) == 0){
-                    /*or should I make it < 0, which will mean save filed*/
-                    return true; // file was saved
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(1) << setw(9) << modeNames[m] << " " << setw(8) << "sdl" << " " << setw(9) << megapixels / secondsSince(start) << " MP/s");
+        SDL_SetColorKey(source, SDL_FALSE, 0);
+    }
+
+    SDL_FreeSurface(source);
+    SDL_FreeSurface(target);
+    SDL_FreeSurface(expected);
+}
+
+/**
+ * @brief Cost of the CPU rasterizer at 100k short lines per frame, plus concave polygon fills (`--bench-raster`).
+ *
+ * Draws into a 1024x768 ARGB8888 surface with a fixed seed and prints the average milliseconds per frame
+ * for opaque and translucent Bresenham lines, Wu antialiased lines and star shaped polygons.
+ */
+static void runRasterBenchmark(){
+    const int width = 1024, height = 768, linesPerFrame = 100000, polygonsPerFrame = 10000, frames = 10;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if(surface == NULL){
+        ENGINE_LOG_ERROR(BENCH, "runRasterBenchmark: SDL_CreateRGBSurfaceWithFormat " << SDL_GetError());
+        return;
+    }
+    // endpoints up to 32 pixels apart, a few percent start outside the surface to exercise clipping
+    vector<SDL_Point> ends(linesPerFrame * 2);
+    Uint32 seed = 777;
+    auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+    for(int i = 0; i < linesPerFrame; i++){
+        ends[2 * i].x = next(width + 64) - 32;
+        ends[2 * i].y = next(height + 64) - 32;
+        ends[2 * i + 1].x = ends[2 * i].x + next(65) - 32;
+        ends[2 * i + 1].y = ends[2 * i].y + next(65) - 32;
+    }
+    vector<SDL_FPoint> stars(polygonsPerFrame * 10);
+    for(int i = 0; i < polygonsPerFrame; i++){
+        float cx = static_cast<float>(next(width)), cy = static_cast<float>(next(height)), radius = 4.0f + next(28);
+        for(int k = 0; k < 10; k++){
+            float r = k % 2 == 0 ? radius : radius * 0.4f;
+            float angle = k * static_cast<float>(M_PI) / 5.0f;
+            stars[i * 10 + k].x = cx + r * cosf(angle);
+            stars[i * 10 + k].y = cy + r * sinf(angle);
+        }
+    }
+
+    SurfaceRasterizer rasterizer(surface);
+    SDL_Color opaque = {255, 200, 40, 255}, translucent = {40, 200, 255, 128};
+    const char* names[] = {"lines opaque", "lines blended", "lines wu aa", "polygons"};
+    for(int test = 0; test < 4; test++){
+        rasterizer.setColor(test == 0 || test == 3 ? opaque : translucent);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int frame = 0; frame < frames; frame++){
+            if(test == 3){
+                for(int i = 0; i < polygonsPerFrame; i++){
+                    rasterizer.fillPolygon(&stars[i * 10], 10, FILL_NONZERO);
+                }
+                continue;
+            }
+            for(int i = 0; i < linesPerFrame; i++){
+                const SDL_Point& a = ends[2 * i];
+                const SDL_Point& b = ends[2 * i + 1];
+                if(test == 2){
+                    rasterizer.drawLineAA(static_cast<float>(a.x), static_cast<float>(a.y), static_cast<float>(b.x), static_cast<float>(b.y));
+                } else {
+                    rasterizer.drawLine(a.x, a.y, b.x, b.y);
                 }
             }
-            return false;
         }
+        double ms = secondsSince(start) * 1000.0 / frames;
+        int perFrame = test == 3 ? polygonsPerFrame : linesPerFrame;
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(2) << setw(14) << names[test] << " " << setw(8) << ms << " ms/frame  (" << perFrame << " per frame, "
+             << setw(7) << perFrame / ms / 1000.0 << " M/s)");
+    }
+    SDL_FreeSurface(surface);
+}
 
-        /**
-         * @brief Copies the bitmap content to another `BitmapManager` object.
-         *
-         * Performs a blit operation to copy the content of this surface to the destination surface.
-         *
-         * @param copyDestination Reference to another `BitmapManager` object where the content will be copied.
-         * @return `true` if the copy operation is successful, `false` otherwise.
-         */
-        bool copyTo(BitmapManager& copyDestination){
-            if(imageSurface && copyDestination.imageSurface){
-                SDL_BlitSurface(imageSurface, nullptr, copyDestination.imageSurface, nullptr);
-                return true;
-            }
-            return false; // copying failed cuz there is either no surface or no copyDest.
+/**
+ * @brief `--bench-rotate`: thousands of rotated and scaled 64x64 sprites composited on the CPU with
+ * `blitSurfaceTransformed()`, nearest and bilinear, the SSE2 bilinear row checked against the scalar one first.
+ */
+static void runRotateBenchmark(){
+    const int width = 1024, height = 768, spriteSize = 64, spritesPerFrame = 5000, frames = 10;
+    SDL_Surface* sprite = SDL_CreateRGBSurfaceWithFormat(0, spriteSize, spriteSize, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if(sprite == NULL || target == NULL){
+        ENGINE_LOG_ERROR(BENCH, "runRotateBenchmark: SDL_CreateRGBSurfaceWithFormat " << SDL_GetError());
+        SDL_FreeSurface(sprite);
+        SDL_FreeSurface(target);
+        return;
+    }
+    // a disc with a soft edge and a gradient inside, transparent corners
+    for(int y = 0; y < spriteSize; y++){
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(sprite->pixels) + y * sprite->pitch);
+        for(int x = 0; x < spriteSize; x++){
+            float distance = hypotf(x + 0.5f - spriteSize / 2.0f, y + 0.5f - spriteSize / 2.0f);
+            float coverage = spriteSize / 2.0f - distance;
+            Uint32 a = coverage >= 1.0f ? 255 : (coverage <= 0.0f ? 0 : static_cast<Uint32>(coverage * 255.0f));
+            row[x] = (a << 24) | (static_cast<Uint32>(x * 4) << 16) | (static_cast<Uint32>(y * 4) << 8) | 0x80;
         }
+    }
 
-        /**
-         * @brief Getter method for surface.
-         * 
-         * Provides an access to the surface.
-         */
-        SDL_Surface* getSurface() {
-            return imageSurface;
+    Uint32 seed = 4242;
+    auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+    vector<SDL_FRect> places(spritesPerFrame);
+    vector<double> angles(spritesPerFrame);
+    for(int i = 0; i < spritesPerFrame; i++){
+        float size = 24.0f + next(80);
+        places[i] = {static_cast<float>(next(width + 64) - 64), static_cast<float>(next(height + 64) - 64), size, size};
+        angles[i] = next(3600) / 10.0;
+    }
+
+    vector<Uint32> fast(spriteSize / 2), reference(spriteSize / 2);
+    const Uint8* pixels = static_cast<const Uint8*>(sprite->pixels);
+    sampleRowBilinearScalar(pixels, sprite->pitch, spriteSize, spriteSize, 0x1234, 0x5678, 0x5A3F, 0x2C11, reference.data(), static_cast<int>(reference.size()));
+    selectBilinearSampler()(pixels, sprite->pitch, spriteSize, spriteSize, 0x1234, 0x5678, 0x5A3F, 0x2C11, fast.data(), static_cast<int>(fast.size()));
+    ENGINE_LOG_INFO(BENCH, "bilinear row kernel matches scalar: " << (fast == reference ? "yes" : "NO"));
+
+    const char* names[] = {"nearest", "bilinear"};
+    for(int filter = 0; filter < 2; filter++){
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int frame = 0; frame < frames; frame++){
+            for(int i = 0; i < spritesPerFrame; i++){
+                blitSurfaceTransformed(sprite, NULL, target, places[i], angles[i] + frame, NULL, i % 2 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE,
+                                       static_cast<SampleFilter>(filter), BLIT_ALPHA);
+            }
         }
-};
+        double ms = secondsSince(start) * 1000.0 / frames;
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(2) << setw(10) << names[filter] << " " << setw(8) << ms << " ms/frame  (" << spritesPerFrame << " sprites, "
+             << setw(6) << spritesPerFrame / ms << " sprites/ms)");
+    }
+    SDL_FreeSurface(sprite);
+    SDL_FreeSurface(target);
+}
 
 /**
- * @class BitmapObject
- * @brief A class representing a bitmap object with posibiliity of custom draw and transform behaviour.
- *
- * The `BitmapObject` class allows creating and managing a bitmap object that can be drawn, translated,
- * rotated, scaled, and cropped. It integrates with SDL to render textures and performs transformations
- * on the bitmap directly.
- * 
- * The bitmapObject is heavily reliant on the SDL's source and destination rectangle. In the spritesheet,
- * it will be setting a position of where the source rectangle should be reading and copying it into destination rectangle in the renderer.
+ * @brief `--bench-rle`: fill rate of the img/Soldier sheets drawn as full frame rectangles through `blitSurface()`
+ * versus their `RLESprite` frames, both into the same target, which must come out identical.
  */
-class BitmapObject : public DrawAbility, public Transformability{
-    private:
-        BitmapManager bt; ///< Bitmapmanager instance to manage the bitmap surface and loading operations.
-        SDL_Surface* tmpSurface; ///< Temporary surface used for loading and converting textures.
-        SDL_Texture* texture; ///< SDL_Texture object used for rendering the bitmap.
-        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the bitmapObject.
-        string& filename; ///< Reference to the filename BMP will be loaded from.
-        int objPosX; ///< object's x-coordinate position.
-        int objPosY; ///< object's y-coordinate position.
-        int objWidth; ///< bitmap object's width.
-        int objHeight; ///< bitmap object's height.
-
-         // This ones are destRect related, also no use for objWidth and objHeight
-        int spritePosX; ///< X-coordinate of the source rectangle in the spritesheet / sprite related operation(crops by X-axis).
-        int spritePosY; ///< Y-coordinate of the source rectangle in the spritesheet / sprite realted operation(crops by Y-axis).
-        int spritePosW; ///< Width of the source rectangle in the spritesheet / sprite related operation(crops by width).
-        int spritePosH; ///< Width of the source rectangle in the spritesheet / sprite related operation(crops by width).
-        SDL_Rect destRect; ///< Destination rectangle for rendering the bitmap on the screen.
-        SDL_Rect srcRect; ///< Source rectangle for cropping the bitmap from texture.
-    public:
-        /**
-         * @brief destructor for the `BitmapObject` class to destroy the created Texture from Surface.
-         */
-        virtual ~BitmapObject(){if(texture) 
-        SDL_DestroyTexture(texture);}
+static void runRLEBenchmark(){
+    const char* sheets[] = {"Soldier-Attack01", "Soldier-Attack02", "Soldier-Attack03", "Soldier-Death", "Soldier-Hurt",
+                            "Soldier-Idle", "Soldier-Shadow", "Soldier-Shadow_attack2", "Soldier-Shadow_death", "Soldier-Walk"};
+    const int frameSize = 100, width = 1024, height = 768, drawsPerFrame = 2000;
+    SDL_Surface* full = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Surface* encoded = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if(full == NULL || encoded == NULL){
+        ENGINE_LOG_ERROR(BENCH, "runRLEBenchmark: SDL_CreateRGBSurfaceWithFormat " << SDL_GetError());
+        SDL_FreeSurface(full);
+        SDL_FreeSurface(encoded);
+        return;
+    }
+    ENGINE_LOG_INFO(BENCH, setw(24) << "sheet" << "  frames  touched%  opaque%  runs/frame  bytes(raw/rle)   rect ms  rle ms  speedup");
+    Uint32 seed = 99;
+    auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+    for(const char* name : sheets){
+        string path = string("img/Soldier/") + name + ".png";
+        SDL_Surface* loaded = IMG_Load(path.c_str());
+        SDL_Surface* sheet = loaded ? SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0) : NULL;
+        SDL_FreeSurface(loaded);
+        if(sheet == NULL){
+            ENGINE_LOG_ERROR(BENCH, "runRLEBenchmark: can't load " << path);
+            continue;
+        }
+        vector<RLESprite> frames = RLESprite::encodeSheet(sheet, frameSize, frameSize);
+        int frameCount = static_cast<int>(frames.size());
+        if(frameCount == 0){
+            SDL_FreeSurface(sheet);
+            continue;
+        }
+        RLESprite::Stats total;
+        size_t rleBytes = 0;
+        for(RLESprite& frame : frames){
+            total.opaquePixels += frame.getStats().opaquePixels;
+            total.translucentPixels += frame.getStats().translucentPixels;
+            total.transparentPixels += frame.getStats().transparentPixels;
+            total.runs += frame.getStats().runs;
+            rleBytes += frame.getEncodedSize();
+        }
+        vector<SDL_Point> places(drawsPerFrame);
+        for(SDL_Point& place : places){
+            place.x = next(width + frameSize) - frameSize;
+            place.y = next(height + frameSize) - frameSize;
+        }
 
-       /**
-        * @brief Constructor for the `BitmapObject` class.
-        *
-        * Initializes the bitmap object with the specified properties and renderer.
-        * Using the provided `filename` we load Bitmap Content.
-        * After we use the getter method to get the access to the created surface and create Texture from it.
-        *
-        * @param filename Reference to a string containing the path to the bitmap file to be loaded.
-        * @param renderer Pointer to the SDL_Renderer used for rendering the bitmap.
-        * @param x X-coordinate of the object's position in the renderer / window.
-        * @param y Y-coordinate of the object's position in the renderer / window.
-        * @param w Width of the bitmap object.
-        * @param h Height of the bitmap object.
-        */
-        BitmapObject(string& filename, SDL_Renderer* renderer, int x, int y, int w, int h) : filename(filename), renderer(renderer), objPosX(x), objPosY(y), objWidth(w), objHeight(h){
-            if(bt.loadBitmapContent(filename)){
-                tmpSurface = bt.getSurface();
-                texture = SDL_CreateTextureFromSurface(renderer, tmpSurface);
-                SDL_FreeSurface(tmpSurface);
-            } else {
-                cout << "texture loading failed!" << endl;
-            }
+        SDL_FillRect(full, NULL, 0xFF203040);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int i = 0; i < drawsPerFrame; i++){
+            SDL_Rect cell = {(i % frameCount) % (sheet->w / frameSize) * frameSize, (i % frameCount) / (sheet->w / frameSize) * frameSize, frameSize, frameSize};
+            SDL_Rect at = {places[i].x, places[i].y, 0, 0};
+            blitSurface(sheet, &cell, full, &at, BLIT_ALPHA);
         }
+        double rectMs = secondsSince(start) * 1000.0;
 
-        /**
-         * @brief Draws the bitmap object to the screen using the renderer.
-         *
-         * Uses the source and destination rectangles to determine (cropping / position of specified bmp) and rendering locations.
-         * Checks if the texture loaded and created or not.
-         * destRect is set by the objects position, provided in the constructor and dimensions of the sprite.
-         * srcRect is set by the `setSrcRect()` function, which is called each time we have to change the frame of the sprite.
-         */
-        void draw() override {
-            if(texture != NULL){
-                destRect = {objPosX, objPosY, spritePosW, spritePosH};
-                srcRect = {spritePosX, spritePosY, spritePosW, spritePosH};
-                cout << spritePosX << endl;
-                cout << spritePosY << endl;
-                cout << spritePosW << endl;
-                cout << spritePosH << endl;
-                SDL_RenderCopy(renderer, texture, &srcRect, &destRect);
-            }
+        SDL_FillRect(encoded, NULL, 0xFF203040);
+        start = SDL_GetPerformanceCounter();
+        for(int i = 0; i < drawsPerFrame; i++){
+            frames[i % frameCount].draw(encoded, places[i].x, places[i].y);
         }
+        double rleMs = secondsSince(start) * 1000.0;
 
-        /**
-         * @brief Translates the bitmap object by the specified offsets.
-         * 
-         * Moves the object by modifying it's position coordinates and redraws it.
-         * 
-         * @param dx The horizontal offset to move the object.
-         * @param dy The vertical offset to move the object.
-         */
-        void translate(int dx, int dy) override {
-            objPosX += dx;
-            objPosY += dy;
-            draw();
+        bool same = true;
+        for(int y = 0; y < height && same; y++){
+            same = memcmp(static_cast<Uint8*>(full->pixels) + y * full->pitch, static_cast<Uint8*>(encoded->pixels) + y * encoded->pitch, width * 4) == 0;
+        }
+        int area = frameCount * frameSize * frameSize;
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(2) << setw(24) << name << "  " << setw(6) << frameCount << "  " << setw(8) << 100.0 * (total.opaquePixels + total.translucentPixels) / area
+             << "  " << setw(7) << 100.0 * total.opaquePixels / area << "  " << setw(10) << static_cast<double>(total.runs) / frameCount
+             << "  " << setw(7) << area * 4 << "/" << setw(6) << rleBytes << "  " << setw(8) << rectMs << "  " << setw(6) << rleMs
+             << "  " << setw(6) << rectMs / rleMs << "x" << (same ? "" : "  MISMATCH"));
+        SDL_FreeSurface(sheet);
+    }
+    SDL_FreeSurface(full);
+    SDL_FreeSurface(encoded);
+}
+
+/**
+ * @brief `--bench-premultiplied`: fill rate of the same translucent sprite composited with the premultiplied mode off
+ * (straight `BLIT_ALPHA`) and on (premultiplied copy, `BLIT_PREMULTIPLIED`), at full and half global alpha.
+ */
+static void runPremultipliedBenchmark(){
+    const int width = 1024, height = 768, spriteSize = 128, blitsPerFrame = 4000, frames = 5;
+    BitmapManager straight, premultiplied, target;
+    if(!straight.createBitmapObj(spriteSize, spriteSize, 32) || !target.createBitmapObj(width, height, 32)){
+        ENGINE_LOG_ERROR(BENCH, "runPremultipliedBenchmark: createBitmapObj " << SDL_GetError());
+        return;
+    }
+    // soft disc with a color gradient, every alpha from 0 to 255 appears
+    SDL_Surface* sprite = straight.editSurface();
+    for(int y = 0; y < spriteSize; y++){
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(sprite->pixels) + y * sprite->pitch);
+        for(int x = 0; x < spriteSize; x++){
+            float distance = hypotf(x + 0.5f - spriteSize / 2.0f, y + 0.5f - spriteSize / 2.0f) / (spriteSize / 2.0f);
+            Uint32 a = distance >= 1.0f ? 0 : (distance < 0.5f ? 255 : static_cast<Uint32>((1.0f - distance) * 2.0f * 255.0f));
+            row[x] = (a << 24) | (static_cast<Uint32>(x * 2) << 16) | (static_cast<Uint32>(y * 2) << 8) | 0x60;
         }
+    }
+    premultiplied = straight;
+    if(!premultiplied.premultiplyAlpha()){
+        ENGINE_LOG_ERROR(BENCH, "runPremultipliedBenchmark: SDL_PremultiplyAlpha " << SDL_GetError());
+        return;
+    }
 
-        /**
-         * @brief Rotates the bitmap object around its center by the specified angle.
-         *
-         * Uses SDL_RenderCopyEx for rotation. The angle is specified in degrees. Uses a work arond with SDL_Point,
-         * which calculates the center of an object.
-         *
-         * @param angle The angle to rotate the object, in degrees.
-         */
-        void rotate(float angle) override {
-            if(texture != NULL){
-                SDL_Point pt;
-                pt = {(destRect.x + destRect.w) / 2, (destRect.y + destRect.h) / 2};
-                SDL_RenderCopyEx(renderer, texture, NULL, &destRect, angle, &pt, SDL_FLIP_NONE);
+    vector<Uint32> fast(spriteSize), reference(spriteSize), background(spriteSize);
+    const Uint32* line = static_cast<const Uint32*>(premultiplied.getSurface()->pixels) + (spriteSize / 2 + 3) * premultiplied.getSurface()->pitch / 4;
+    for(int i = 0; i < spriteSize; i++){
+        background[i] = 0x80000000u | static_cast<Uint32>(i * 0x010203);
+    }
+    reference = background;
+    fast = background;
+    blitRowPremultipliedScalar(line, reference.data(), spriteSize, 200, 0);
+    selectBlitKernels().premultiplied(line, fast.data(), spriteSize, 200, 0);
+    ENGINE_LOG_INFO(BENCH, selectBlitKernels().name << " premultiplied kernel matches scalar: " << (fast == reference ? "yes" : "NO"));
+
+    // the row kernels alone on a cache resident row, the full frame numbers below are mostly memory bandwidth
+    const Uint32* straightLine = static_cast<const Uint32*>(straight.getSurface()->pixels) + (spriteSize / 2 + 3) * straight.getSurface()->pitch / 4;
+    const int repeats = 200000;
+    for(int test = 0; test < 2; test++){
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int r = 0; r < repeats; r++){
+            if(test == 0){
+                selectBlitKernels().alpha(straightLine, fast.data(), spriteSize, 255, 0);
             } else {
-                cerr << "Something with rotate in BitmapObject!" << endl;
+                selectBlitKernels().premultiplied(line, fast.data(), spriteSize, 255, 0);
             }
         }
+        double seconds = secondsSince(start);
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(2) << (test == 0 ? "row kernel straight" : "row kernel premult ") << "  " << setw(8) << static_cast<double>(repeats) * spriteSize / seconds / 1e6 << " Mpix/s");
+    }
 
-        /**
-         * @brief Sets the source rectangle for cropping the texture from the spritesheet.
-         *
-         * Specifies the area of the texture to be rendered.
-         *
-         * @param x X-coordinate of the source rectangle.
-         * @param y Y-coordinate of the source rectangle.
-         * @param w Width of the source rectangle.
-         * @param h Height of the source rectangle.
-         */
-        void setSrcRect(int x, int y, int w, int h) {
-            this->spritePosX = x;
-            this->spritePosY = y;
-            this->spritePosW = w;
-            this->spritePosH = h;
-            srcRect = {spritePosX, spritePosY, spritePosW, spritePosH};
-            cout << "setSrcRect BitmapObj called" << endl;
-        }
+    Uint32 seed = 2024;
+    auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+    vector<SDL_Rect> places(blitsPerFrame);
+    for(SDL_Rect& place : places){
+        place = {next(width + spriteSize) - spriteSize, next(height + spriteSize) - spriteSize, 0, 0};
+    }
 
-        /**
-         * @brief Scales the bitmap object by the specified factor.
-         *
-         * Adjusts the object's size and position to scale it around its center.
-         *
-         * @param factor The scaling factor.
-         */
-        void scale(float factor){
-            if(texture != NULL){
-                float scaledWidth = objWidth * factor;
-                float scaledHeight = objHeight * factor;
-                float tmpX = (objPosX + objWidth / 2) - scaledWidth / 2;
-                float tmpY = (objPosY + objHeight / 2) - scaledHeight / 2;
-                objPosX = static_cast<int>(tmpX);
-                objPosY = static_cast<int>(tmpY);
-                objWidth = static_cast<int>(scaledWidth);
-                objHeight = static_cast<int>(scaledHeight);
-                draw();
+    const char* names[] = {"straight  a=255", "premult   a=255", "straight  a=128", "premult   a=128"};
+    vector<Uint32> results[2];
+    for(int test = 0; test < 4; test++){
+        bool on = test % 2 == 1;
+        Uint8 alpha = test < 2 ? 255 : 128;
+        SDL_FillRect(target.editSurface(), NULL, 0xFF304050);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int frame = 0; frame < frames; frame++){
+            for(const SDL_Rect& place : places){
+                (on ? premultiplied : straight).copyTo(target, NULL, &place, on ? BLIT_PREMULTIPLIED : BLIT_ALPHA, alpha);
             }
         }
-};
+        double ms = secondsSince(start) * 1000.0 / frames;
+        double megapixels = static_cast<double>(blitsPerFrame) * spriteSize * spriteSize / 1e6;
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(2) << names[test] << "  " << setw(8) << ms << " ms/frame  " << setw(8) << megapixels / ms * 1000.0 << " Mpix/s");
+        if(test < 2){
+            SDL_Surface* surface = target.getSurface();
+            results[test].assign(static_cast<Uint32*>(surface->pixels), static_cast<Uint32*>(surface->pixels) + surface->pitch / 4 * height);
+        }
+    }
+    int maxDifference = 0;
+    for(size_t i = 0; i < results[0].size(); i++){
+        for(int shift = 0; shift < 24; shift += 8){
+            int difference = abs(static_cast<int>((results[0][i] >> shift) & 0xFF) - static_cast<int>((results[1][i] >> shift) & 0xFF));
+            maxDifference = difference > maxDifference ? difference : maxDifference;
+        }
+    }
+    ENGINE_LOG_INFO(BENCH, "largest channel difference between the two a=255 results: " << maxDifference);
+}
 
 /**
- * @class AnimatedObject
- * @brief Abstract base class for objects with animation capabilities.
- *
- * The `AnimatedObject` class provides a pure virtual method `animate` to be implemented
- * by derived classes. It serves as a base class for any object requiring animation functionality.
+ * @brief `--bench-animation`: time of one `AnimationSystem` pass over 100k animations, on the calling thread and
+ * on the shared `JobSystem`, next to the per-object way of reading the clock and looking the frame up for every sprite.
+ * A third run scatters the animations over a world 5x5 views large with levels of detail picked from their bounds.
  */
-class AnimatedObject {
-    public:
-        virtual ~AnimatedObject() = default;
-        /**
-         * @brief Pure virtual method to handle animation logic that will be dervied later.
-         */
-        virtual void animate() = 0;        
-};
+static void runAnimationBenchmark(){
+    const int count = 100000, passes = 600;
+    const Uint32 frameMs = 16;
+    vector<AnimationClip> clips;
+    clips.push_back(AnimationClip("idle", AnimationClip::gridFrames(0, 0, 100, 100, 6), {100}));
+    clips.push_back(AnimationClip("walk", AnimationClip::gridFrames(0, 0, 100, 100, 8), {80}));
+    clips.push_back(AnimationClip("attack", AnimationClip::gridFrames(0, 0, 100, 100, 9), {60, 60, 60, 120, 60}, LOOP_ONCE));
+    clips.push_back(AnimationClip("hurt", AnimationClip::gridFrames(0, 0, 100, 100, 4), {90}, LOOP_PING_PONG));
+    clips.push_back(AnimationClip("run", AnimationClip::gridFrames(0, 0, 64, 64, 9), {50}));
+
+    Uint32 seed = 7;
+    auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+    JobSystem& jobs = JobSystem::shared();
+    for(int threaded = 0; threaded < 2; threaded++){
+        AnimationSystem system(threaded ? &jobs : NULL);
+        for(int i = 0; i < count; i++){
+            system.add(&clips[next(static_cast<int>(clips.size()))]);
+            if(i % 1000 == 999){
+                system.advance(next(50));
+            }
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int pass = 0; pass < passes; pass++){
+            system.advance(frameMs);
+        }
+        double ms = secondsSince(start) * 1000.0 / passes;
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(3) << "AnimationSystem, " << (threaded ? jobs.getThreadCount() : 1) << " thread(s): " << ms << " ms per pass, "
+             << ms * 1e6 / count << " ns per animation");
+    }
 
+    {
+        AnimationSystem system;
+        const SDL_Rect view = {0, 0, 800, 600};
+        for(int i = 0; i < count; i++){
+            int size = 8 + next(93);
+            SDL_Rect bounds = {next(view.w * 5) - view.w * 2, next(view.h * 5) - view.h * 2, size, size};
+            system.add(&clips[next(static_cast<int>(clips.size()))], AnimationSystem::chooseDetail(bounds, view));
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        for(int pass = 0; pass < passes; pass++){
+            system.advance(frameMs);
+        }
+        double ms = secondsSince(start) * 1000.0 / passes;
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(3) << "AnimationSystem with detail levels: " << ms << " ms per pass, "
+             << system.getCount(DETAIL_FULL) << " full, " << system.getCount(DETAIL_HALF) << " half, " << system.getCount(DETAIL_QUARTER) << " quarter, "
+             << system.getCount(DETAIL_EIGHTH) << " eighth, " << system.getCount(DETAIL_HIDDEN) << " hidden");
+    }
+
+    struct PerObject {
+        const AnimationClip* clip;
+        Uint32 clipTime;
+        Uint32 lastTicks;
+        int frame;
+    };
+    vector<PerObject> objects(count);
+    for(PerObject& object : objects){
+        object = {&clips[next(static_cast<int>(clips.size()))], static_cast<Uint32>(next(1000)), SDL_GetTicks(), 0};
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    int passesPerObject = passes / 10;
+    for(int pass = 0; pass < passesPerObject; pass++){
+        for(PerObject& object : objects){
+            Uint32 currentTicks = SDL_GetTicks();
+            object.clipTime = object.clip->wrapTime(object.clipTime + (currentTicks - object.lastTicks) + frameMs);
+            object.frame = object.clip->frameAt(object.clipTime);
+            object.lastTicks = currentTicks;
+        }
+    }
+    double ms = secondsSince(start) * 1000.0 / passesPerObject;
+    ENGINE_LOG_INFO(BENCH, fixed << setprecision(3) << "per object clock and lookup: " << ms << " ms per pass, " << ms * 1e6 / count << " ns per animation");
+}
 
 /**
- * @class SpriteObject
- * @brief A class representing an animated sprite object with drawable and animated capabilities.
- *
- * The `SpriteObject` class extends `BitmapObject` and `AnimatedObject` to provide functionalities
- * for drawing, loading and animating sprites. It uses an SDL texture and source rectangles to manage
- * frame-based animations.
+ * @brief `--bench-tween`: one `TweenSystem` update over 60k running tweens (floats, points and colors with every curve),
+ * and the easing pass alone, scalar versus the picked kernel, which must agree bit for bit.
  */
-class SpriteObject : public BitmapObject, public AnimatedObject {
-    private:
-        string& filename; ///< Reference to the filename of the spritesheet to load.
-        SDL_Renderer* renderer; ///< SDL_Renderer used for rendering the sprite object.
-        int x; ///< X-coordinate of the sprite's position.
-        int y; ///< Y-coordinate of the sprite's position.
-        int w; ///< Width of the frame in the spritesheet.
-        int h; ///< Height of the frame in the spritesheet.
-        SDL_Rect srcRect; ///< Source rectangle for cropping the current frame from the spritesheet.
-        int frameCount;  ///< Total number of frames in the spritesheet.
-        int currentFrame; ///< The current frame of the spritesheet that is being displayed.
-        int animationSpeed; ///< The speed of animation in milliseconds per frame.
-        Uint32 lastFrameTime; ///< Timestamp of the last frame update.
-    public:
-        virtual ~SpriteObject(){}
+static void runTweenBenchmark(){
+    const int floatCount = 30000, pointCount = 20000, colorCount = 10000, passes = 300;
+    vector<float> angles(floatCount, 0.0f);
+    vector<SDL_Point> positions(pointCount);
+    vector<SDL_Color> colors(colorCount);
+    Uint32 seed = 11;
+    auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+    TweenSystem tweens;
+    for(int i = 0; i < floatCount; i++){
+        tweens.tweenFloat(&angles[i], 360.0f, 6000 + next(4000), static_cast<Easing>(i % 10), next(100));
+    }
+    for(int i = 0; i < pointCount; i++){
+        positions[i] = {next(800), next(600)};
+        tweens.tweenPoint(&positions[i].x, &positions[i].y, next(800), next(600), 6000 + next(4000), static_cast<Easing>(i % 10));
+    }
+    for(int i = 0; i < colorCount; i++){
+        colors[i] = {static_cast<Uint8>(next(256)), static_cast<Uint8>(next(256)), static_cast<Uint8>(next(256)), 255};
+        tweens.tweenColor(&colors[i], {255, 255, 255, 0}, 6000 + next(4000), static_cast<Easing>(i % 10));
+    }
+    int count = tweens.getCount();
+    Uint64 start = SDL_GetPerformanceCounter();
+    for(int pass = 0; pass < passes; pass++){
+        tweens.advance(16);
+    }
+    double ms = secondsSince(start) * 1000.0 / passes;
+    ENGINE_LOG_INFO(BENCH, fixed << setprecision(3) << "TweenSystem update, " << count << " tweens: " << ms << " ms per pass, "
+                    << ms * 1e6 / count << " ns per tween");
 
-        /**
-         * @brief Constructor for the `SpriteObject` class.
-         *
-         * Initializes the sprite object with a sprite sheet, renderer, position, and frame dimensions(sprite's frame properties).
-         *
-         * @param filename Reference to a string containing the path to the sprite sheet.
-         * @param renderer Pointer to the SDL_Renderer used for rendering the sprite.
-         * @param x X-coordinate of the sprite's initial position.
-         * @param y Y-coordinate of the sprite's initial position.
-         * @param frameWidth Width of each animation frame in the sprite sheet.
-         * @param frameHeight Height of each animation frame in the sprite sheet.
-         */
-        SpriteObject(string& filename, SDL_Renderer* renderer, int x, int y, int frameWidth, int frameHeight) : BitmapObject(filename, renderer, x, y, w, h), filename(filename), renderer(renderer), x(x), y(y), w(frameWidth), h(frameHeight){
-            this->w = frameWidth;
-            this->h = frameHeight;
-            lastFrameTime = SDL_GetTicks();
-            animationSpeed = 100; // 100 ms
-            currentFrame = 0;
-            frameCount = 9; // number of frames in the spritesheet for each direction while walking.
+    vector<Uint32> starts(count);
+    vector<int> durations(count);
+    vector<float> inverseDurations(count), linear(count), quadratic(count), cubic(count), splits(count), mirrors(count);
+    static const float curves[][5] = {{1, 0, 0, 1, 0}, {0, 1, 0, 1, 0}, {0, 1, 0, 1, 1}, {0, 1, 0, 2, 0}, {0, 0, 1, 2, 0}, {0, -1.70158f, 2.70158f, 1, 1}};
+    for(int i = 0; i < count; i++){
+        const float* curve = curves[i % 6];
+        starts[i] = next(5000);
+        durations[i] = 1 + next(3000);
+        inverseDurations[i] = 1.0f / durations[i];
+        linear[i] = curve[0];
+        quadratic[i] = curve[1];
+        cubic[i] = curve[2];
+        splits[i] = curve[3];
+        mirrors[i] = curve[4];
+    }
+    EaseColumns columns = {starts.data(), durations.data(), inverseDurations.data(), linear.data(), quadratic.data(), cubic.data(), splits.data(), mirrors.data()};
+    vector<float> reference(count), fast(count);
+    const char* names[] = {"scalar", "picked"};
+    EaseBatchFn kernels[] = {easeBatchScalar, selectEaseBatch()};
+    for(int k = 0; k < 2; k++){
+        vector<float>& out = k == 0 ? reference : fast;
+        start = SDL_GetPerformanceCounter();
+        for(int pass = 0; pass < passes; pass++){
+            kernels[k](columns, 2500 + pass * 16, out.data(), 0, count);
         }
+        ms = secondsSince(start) * 1000.0 / passes;
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(3) << "easing pass " << setw(6) << names[k] << ": " << ms << " ms per pass, "
+                        << ms * 1e6 / count << " ns per tween");
+    }
+    ENGINE_LOG_INFO(BENCH, "easing kernels match: " << (memcmp(reference.data(), fast.data(), count * sizeof(float)) == 0 ? "yes" : "NO"));
+}
 
-        /**
-         * @brief Calls in the `draw()` method from the `BitmapObject` class.
-         */
-        void draw() override {
-            BitmapObject::draw();
+/**
+ * @brief `--bench-pacing`: pacing error of 2 s of 60 Hz frames with whole millisecond sleeps and with the hybrid sleep / spin wait.
+ */
+static void runPacingBenchmark(){
+    const int frames = 120;
+    const PacingMode modes[2] = {PACE_SLEEP, PACE_HYBRID};
+    for(PacingMode mode : modes){
+        FramePacer pacer(60.0, mode);
+        for(int frame = 0; frame <= frames; frame++){
+            pacer.wait();
         }
+        PacingStats stats = pacer.getStats();
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(3) << (mode == PACE_SLEEP ? "sleep only:  " : "sleep + spin:") << " mean interval " << stats.meanInterval
+             << " ms, error p50 " << stats.p50Error << " ms, p99 " << stats.p99Error << " ms, max " << stats.maxError << " ms");
+    }
+}
 
-        /**
-         * @brief Updates the animation based on the direction and idle state.
-         *
-         * Adjusts the source rectangle to display the correct frame and row of the sprite sheet with simple calculations.
-         *
-         * @param direction The row in the sprite sheet corresponding to the current direction of animation.
-         * (// 0: Up, 1: Left, 2: Down, 3: Right) according to the spritesheet layout.
-         * @param idle If `true`, the sprite remains idle and displays the first frame of the specified direction.
-         */
-        void animate(int direction, bool idle){
-            Uint32 currentTicks = SDL_GetTicks();
-                if (currentTicks - lastFrameTime > animationSpeed) {
-                    if(!idle){
-                    currentFrame++;
-                    if (currentFrame >= frameCount) {
-                        currentFrame = 0; // Loop back to the first frame
+/**
+ * @brief `--bench-jobs`: a frame of 250k entities on a `JobSystem` with 1 up to the CPU count of threads: position update
+ * writing the draw list, animation advance, culling the draw list to the view, and a small task graph of four dependent
+ * stages of 64 jobs for the scheduling overhead.
+ */
+static void runJobsBenchmark(){
+    const int count = 250000, frames = 200, stages = 4, stageJobs = 64;
+    const SDL_Rect world = {0, 0, 8000, 6000};
+    const SDL_Rect view = {3600, 2700, 800, 600};
+    AnimationClip clip("walk", AnimationClip::gridFrames(0, 0, 100, 100, 8), {80});
+    struct Entity {
+        float x, y, vx, vy;
+        int animation;
+    };
+    int maxThreads = max(1, SDL_GetCPUCount());
+    double baseline = 0.0;
+    for(int threads = 1; threads <= maxThreads; threads++){
+        JobSystem jobs(threads - 1);
+        AnimationSystem animations(&jobs);
+        vector<Entity> entities(count);
+        Uint32 seed = 7;
+        auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+        for(Entity& entity : entities){
+            entity = {static_cast<float>(next(world.w)), static_cast<float>(next(world.h)), (next(400) - 200) / 100.0f, (next(400) - 200) / 100.0f,
+                      animations.add(&clip)};
+        }
+        RenderSnapshot snapshot;
+        SDL_atomic_t sink;
+        SDL_AtomicSet(&sink, 0);
+        double updateMs = 0.0, animationMs = 0.0, cullMs = 0.0, graphMs = 0.0;
+        for(int frame = 0; frame < frames; frame++){
+            Uint64 start = SDL_GetPerformanceCounter();
+            snapshot.sprites.resize(count);
+            jobs.parallelFor(count, [&](int begin, int end){
+                for(int i = begin; i < end; i++){
+                    Entity& entity = entities[i];
+                    SpriteInstance& sprite = snapshot.sprites[i];
+                    sprite.previous = {static_cast<int>(entity.x), static_cast<int>(entity.y), 32, 32};
+                    entity.x += entity.vx;
+                    entity.y += entity.vy;
+                    if(entity.x < world.x || entity.x >= world.x + world.w){
+                        entity.vx = -entity.vx;
                     }
-                        // int row = direction;
-                
-                        setSrcRect(currentFrame * w, direction * h, w, h);
-                    } else {
-                        setSrcRect(0, direction * h, w, h);
+                    if(entity.y < world.y || entity.y >= world.y + world.h){
+                        entity.vy = -entity.vy;
                     }
-                lastFrameTime = currentTicks;
-            }
-        }
+                    sprite.current = {static_cast<int>(entity.x), static_cast<int>(entity.y), 32, 32};
+                    sprite.bitmap = NULL;
+                    sprite.frame = clip.getFrame(animations.getFrame(entity.animation));
+                    sprite.flip = entity.vx < 0 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+                }
+            }, 256);
+            updateMs += secondsSince(start) * 1000.0;
 
-        /**
-         * @brief Derived class which must be present since the `animate()` method is pure virtual function.
-         */
-        void animate() override{
+            start = SDL_GetPerformanceCounter();
+            animations.advance(16);
+            animationMs += secondsSince(start) * 1000.0;
+
+            start = SDL_GetPerformanceCounter();
+            snapshot.cull(view, &jobs);
+            cullMs += secondsSince(start) * 1000.0;
 
+            start = SDL_GetPerformanceCounter();
+            JobSystem::Job* previous = NULL;
+            for(int stage = 0; stage < stages; stage++){
+                JobSystem::Job* group = jobs.create(nullptr);
+                for(int j = 0; j < stageJobs; j++){
+                    JobSystem::Job* job = jobs.create([&sink](){
+                        int sum = 0;
+                        for(int k = 0; k < 2000; k++){
+                            sum += k * k;
+                        }
+                        SDL_AtomicAdd(&sink, sum & 1);
+                    }, group);
+                    if(previous != NULL){
+                        jobs.addDependency(job, previous);
+                    }
+                    jobs.submit(job);
+                }
+                jobs.submit(group);
+                previous = group;
+            }
+            jobs.wait(previous);
+            graphMs += secondsSince(start) * 1000.0;
         }
-};
+        double total = (updateMs + animationMs + cullMs + graphMs) / frames;
+        if(threads == 1){
+            baseline = total;
+        }
+        ENGINE_LOG_INFO(BENCH, fixed << setprecision(3) << threads << " thread(s): update " << updateMs / frames << " ms, animation " << animationMs / frames
+             << " ms, cull " << cullMs / frames << " ms (" << snapshot.sprites.size() << " visible), graph " << graphMs * 1000.0 / (frames * stages * stageJobs)
+             << " us per job, frame " << total << " ms, speedup " << setprecision(2) << baseline / total << "x");
+    }
+}
 
 /**
- * @class Player
- * @brief A class representing a player-controlled sprite in a game.
- * 
- * The `Player` class extends `SpriteObject` to include frame animations for a player object, 
- * has implementation of input events for movement and animation. It manages
- * direction the player is facing, travel speed, and idle state.
+ * @brief Benchmark mode (`--benchmark` or `ENGINE_BENCHMARK=1`): a scripted scene run for a fixed number of frames as
+ * fast as it goes, no pacing and no vsync, with the timings of each phase printed as JSON.
+ *
+ * The scene is the player walking and attacking on a fixed script of key presses, or on a recording given with
+ * `--replay`, among a crowd of soldiers wandering a world twice the size of the view, so some of them are off-screen.
+ * The positions come from `seed` and every frame
+ * is exactly one simulation step and 16 ms of animation, so two runs with the same parameters compute the same frames
+ * and end on the same `checksum`, whatever the machine. Phases: `events` (polling and the scripted input), `update`
+ * (simulation step), `animation` (detail levels and animation advance), `submit` (clear and draw calls) and `present`.
+ *
+ * @param engine Engine to draw with, the caller creates it without vsync.
+ * @param frames Frames to run.
+ * @param seed Seed of the crowd.
+ * @param crowd Number of wandering soldiers.
+ * @param output File the JSON is written to, empty for stdout.
+ * @param replay Recorded input to drive the player with instead of the script, NULL for the script.
+ * @return Exit code for `main()`.
  */
-class Player : public SpriteObject {
-private:
-    int moveSpeed; ///< Movement speed of the player.
-    int direction; ///< 0: Up, 1: Left, 2: Down, 3: Right
-    bool idle; ///< keeps track if the player just standing or moving.
-public:
-    virtual ~Player() = default;
-    
-    /**
-     * @brief Constructs a Player object with specified properties.
-     * 
-     * direction is set to 2, which is looking down. Idle bool is set to true at the start.
-     * 
-     * @param filename The path to the sprite sheet for the player.
-     * @param renderer SDL_Renderer used for rendering the player in the game window.
-     * @param spawnX The x-coordinate where the player spawns.
-     * @param spawnY The y-coordinate where the player spawns.
-     * @param playerWidth The width of a single frame of the player sprite.
-     * @param playerHeight The height of a single frame of the player sprite.
-     * @param moveSpeed The speed at which the player moves.
-     */
-    Player(string& filename, SDL_Renderer* renderer, int spawnX, int spawnY, int playerWidth, int playerHeight, int moveSpeed)
-        : SpriteObject(filename, renderer, spawnX, spawnY, playerWidth, playerHeight), moveSpeed(moveSpeed){
-            direction = 2;
-            idle = true;
-    }
+static int runSceneBenchmark(Engine& engine, int frames, Uint32 seed, int crowd, const string& output, InputRecording* replay = NULL){
+    struct ScriptedKey {
+        int frame; ///< Frame of the 360 frame cycle the key changes on.
+        SDL_Scancode key; ///< The key.
+        bool down; ///< Pressed or released.
+    };
+    static const ScriptedKey script[] = {
+        {0, SDL_SCANCODE_RIGHT, true}, {100, SDL_SCANCODE_RIGHT, false}, {110, SDL_SCANCODE_Z, true}, {111, SDL_SCANCODE_Z, false},
+        {150, SDL_SCANCODE_LEFT, true}, {250, SDL_SCANCODE_LEFT, false}, {260, SDL_SCANCODE_X, true}, {261, SDL_SCANCODE_X, false},
+        {300, SDL_SCANCODE_DOWN, true}, {340, SDL_SCANCODE_DOWN, false}, {345, SDL_SCANCODE_C, true}, {346, SDL_SCANCODE_C, false},
+    };
+    enum {PHASE_EVENTS, PHASE_UPDATE, PHASE_ANIMATION, PHASE_SUBMIT, PHASE_PRESENT, PHASE_COUNT};
+    static const char* phaseNames[PHASE_COUNT] = {"events", "update", "animation", "submit", "present"};
+    struct Walker {
+        SpriteObject* sprite; ///< The soldier.
+        float x, y, vx, vy; ///< Position and speed per step.
+    };
 
-    /**
-     * @brief Gets direction which the player is currently facing.
-     * @return `direction`.
-     */
-    int getDirection(){
-        return direction;
+    string filename = "img/Soldier/Soldier.png";
+    AnimationLibrary::shared().loadDefinitions("img/Soldier/Soldier.anim");
+    const AnimationClip* walking = AnimationLibrary::shared().get("soldier_walk");
+    const AnimationClip* standing = AnimationLibrary::shared().get("soldier_idle");
+    JobSystem& jobs = JobSystem::shared();
+    AnimationSystem animations(&jobs);  // Declared before the sprites using it, they unregister on destruction
+    Player p1(filename, engine.getRenderer(), engine.getWidth() / 2, engine.getHeight() / 2, 100, 100, 2);
+    p1.useSystem(animations);
+    InputState input;
+    p1.useInput(input);
+    const SDL_Rect view = {0, 0, engine.getWidth(), engine.getHeight()};
+    const SDL_Rect world = {-view.w / 2, -view.h / 2, view.w * 2, view.h * 2};
+    vector<Walker> walkers(crowd);
+    const Uint32 initialSeed = seed;
+    auto next = [&seed](int range){seed = seed * 1664525 + 1013904223; return static_cast<int>((seed >> 8) % range);};
+    for(Walker& walker : walkers){
+        walker.x = static_cast<float>(world.x + next(world.w));
+        walker.y = static_cast<float>(world.y + next(world.h));
+        bool moving = next(4) != 0;
+        walker.vx = moving ? (next(200) - 100) / 50.0f : 0.0f;
+        walker.vy = moving ? (next(200) - 100) / 50.0f : 0.0f;
+        walker.sprite = new SpriteObject(filename, engine.getRenderer(), static_cast<int>(walker.x), static_cast<int>(walker.y), moving ? walking : standing);
+        walker.sprite->setFlip(walker.vx < 0 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+        walker.sprite->useSystem(animations);
     }
 
-    /**
-     * @brief Sets direction in which the player is facing.
-     */
-    void setDirection(int direction){
-        this->direction = direction;
+    vector<double> samples[PHASE_COUNT];
+    for(vector<double>& phase : samples){
+        phase.reserve(frames);
     }
-    
-        /**
-     * @brief Handles keyboard input events to control the player's movement and facing / walking direction.
-     * 
-     * @param event The SDL_Event object containing keyboard input data.
-     * 
-     * - **SDL_KEYDOWN**: Updates the direction and moves the player.
-     * Idle is set to false since the movement key is pressed. Each SDLK case which represents a direction,
-     * will call the `setDirection()` method and `translate()` by specified movespeed.
-     * - **SDL_KEYUP**: Sets the player to idle(true).
-     * 
-     */
-    void inputEventHandler(SDL_Event &event) {
-        if (event.type == SDL_KEYDOWN) {
-            idle = false;
-            switch (event.key.keysym.sym) {
-                case SDLK_LEFT:
-                // direction = 1;
-                setDirection(1);
-                    translate(-moveSpeed, 0);
-                    break;
-                case SDLK_RIGHT:
-                // direction = 3;
-                setDirection(3);
-                    translate(moveSpeed, 0);
-                    break;
-                case SDLK_UP:
-                // direction = 0;
-                setDirection(0);
-                    translate(0, -moveSpeed);
-                    break;
-                case SDLK_DOWN:
-                // direction = 2;
-                setDirection(2);
-                    translate(0, moveSpeed);
-                    break;
+    Uint64 runStart = SDL_GetPerformanceCounter();
+    Uint64 mark = runStart;
+    auto lap = [&mark](vector<double>& phase){
+        Uint64 now = SDL_GetPerformanceCounter();
+        phase.push_back(static_cast<double>(now - mark) * 1000.0 / SDL_GetPerformanceFrequency());
+        mark = now;
+    };
+    for(int frame = 0; frame < frames; frame++){
+        mark = SDL_GetPerformanceCounter();
+        SDL_Event e;
+        while(SDL_PollEvent(&e)){
+            // The scene plays the script only, real input would make runs differ
+        }
+        if(replay != NULL){
+            replay->inject(frame, input);
+        }
+        for(const ScriptedKey& step : script){
+            if(replay == NULL && step.frame == frame % 360){
+                SDL_zero(e);
+                e.type = step.down ? SDL_KEYDOWN : SDL_KEYUP;
+                e.key.keysym.scancode = step.key;
+                input.handleEvent(e);
+            }
+        }
+        lap(samples[PHASE_EVENTS]);
+
+        p1.update();
+        input.clearEdges();
+        jobs.parallelFor(crowd, [&](int begin, int end){
+            for(int i = begin; i < end; i++){
+                Walker& walker = walkers[i];
+                walker.x += walker.vx;
+                walker.y += walker.vy;
+                if(walker.x < world.x || walker.x >= world.x + world.w){
+                    walker.vx = -walker.vx;
+                    walker.sprite->setFlip(walker.vx < 0 ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+                }
+                if(walker.y < world.y || walker.y >= world.y + world.h){
+                    walker.vy = -walker.vy;
+                }
+                walker.sprite->setPosition(static_cast<int>(walker.x), static_cast<int>(walker.y));
+            }
+        }, 64);
+        lap(samples[PHASE_UPDATE]);
+
+        p1.updateDetail(view);
+        for(Walker& walker : walkers){
+            walker.sprite->updateDetail(view);
+        }
+        animations.advance(16);
+        lap(samples[PHASE_ANIMATION]);
+
+        SDL_SetRenderDrawColor(engine.getRenderer(), 255, 255, 255, 255);
+        SDL_RenderClear(engine.getRenderer());
+        for(Walker& walker : walkers){
+            if(walker.sprite->getDetail() != DETAIL_HIDDEN){
+                walker.sprite->animate();
+                walker.sprite->draw();
             }
-        } if(event.type == SDL_KEYUP) {
-            idle = true;
         }
+        p1.render(1.0);
+        lap(samples[PHASE_SUBMIT]);
+
+        engine.present();
+        lap(samples[PHASE_PRESENT]);
     }
-    
-    /**
-     * @brief First class to actually use update, what a surprise. 
-     * Updates the player's animation and renders it on the screen
-     * (calls animate with given idle bool and direction and then redraws).
-     * - Calls the `animate` method to update the player's animation state based on direction and idle status.
-     * - Calls the `draw` method to render the player on the screen.
-     */
-    void update(){
-        animate(direction, idle);
-        draw();
+    double totalMs = secondsSince(runStart) * 1000.0;
+
+    // FNV-1a over the final state, equal for equal runs
+    Uint64 checksum = 14695981039346656037ull;
+    auto mix = [&checksum](int value){
+        for(int byte = 0; byte < 4; byte++){
+            checksum = (checksum ^ ((static_cast<unsigned>(value) >> (byte * 8)) & 0xFF)) * 1099511628211ull;
+        }
+    };
+    mix(p1.getX());
+    mix(p1.getY());
+    mix(p1.getFrameRect().x);
+    mix(p1.getFrameRect().y);
+    for(Walker& walker : walkers){
+        mix(walker.sprite->getX());
+        mix(walker.sprite->getY());
+        mix(walker.sprite->getFrameRect().x);
     }
-};
+    for(Walker& walker : walkers){
+        delete walker.sprite;
+    }
+
+    ostringstream json;
+    json << fixed << setprecision(4);
+    json << "{\"benchmark\": \"scene\", \"input\": \"" << (replay != NULL ? "replay" : "script") << "\", \"frames\": " << frames << ", \"seed\": " << initialSeed << ", \"crowd\": " << crowd << ", \"threads\": " << jobs.getThreadCount()
+         << ", \"headless\": " << (engine.isHeadless() ? "true" : "false") << ", \"total_ms\": " << totalMs << ", \"fps\": " << (totalMs > 0.0 ? frames * 1000.0 / totalMs : 0.0)
+         << ", \"checksum\": \"" << hex << checksum << dec << "\", \"phases\": {";
+    for(int phase = 0; phase < PHASE_COUNT; phase++){
+        vector<double>& values = samples[phase];
+        double sum = 0.0;
+        for(double value : values){
+            sum += value;
+        }
+        sort(values.begin(), values.end());
+        auto percentile = [&values](double p){
+            return values.empty() ? 0.0 : values[min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+        };
+        json << (phase > 0 ? ", " : "") << "\"" << phaseNames[phase] << "\": {\"total_ms\": " << sum << ", \"mean_ms\": " << (values.empty() ? 0.0 : sum / values.size())
+             << ", \"p50_ms\": " << percentile(0.50) << ", \"p95_ms\": " << percentile(0.95) << ", \"p99_ms\": " << percentile(0.99)
+             << ", \"max_ms\": " << (values.empty() ? 0.0 : values.back()) << "}";
+    }
+    json << "}}\n";
+
+    Logger::instance().flush();
+    if(output.empty()){
+        fputs(json.str().c_str(), stdout);
+        fflush(stdout);
+        return 0;
+    }
+    FILE* file = fopen(output.c_str(), "w");
+    if(file == NULL){
+        ENGINE_LOG_ERROR(BENCH, "Can't write the benchmark results to " << output);
+        return 1;
+    }
+    fputs(json.str().c_str(), file);
+    fclose(file);
+    ENGINE_LOG_INFO(BENCH, "Benchmark results written to " << output);
+    return 0;
+}
+
+/**
+ * @brief Budget of the deferred work after presenting a frame: the time left before the next one, less a millisecond
+ * for the pacer to wake up in, or 2 ms when the pacer has no deadline to go by.
+ */
+static double deferredBudget(FramePacer& pacer){
+    double left = pacer.getTimeLeft();
+    return left < 0.0 ? 2.0 : max(0.0, left - 1.0);
+}
+
+/**
+ * @brief Animation time of simulation step `step` at `stepsPerSecond` in whole milliseconds, rounded so that the steps
+ * of one second add up to exactly 1000.
+ */
+static Uint32 stepMilliseconds(Uint64 step, int stepsPerSecond){
+    return static_cast<Uint32>((step + 1) * 1000 / stepsPerSecond - step * 1000 / stepsPerSecond);
+}
 
 int main(int argc, char* argv[]) {
-    Engine engine;
-    bool quit = false;
-    SDL_Event e;
+    bool headless = false;
+    bool premultiplied = false;
+    string recordTarget;
+    int frameLimit = 0;
+    bool vsync = false;
+    bool threaded = false;
+    double framesPerSecond = 60.0;
+    string systemsGraph;
+    const char* benchmarkVariable = getenv("ENGINE_BENCHMARK");
+    bool benchmark = benchmarkVariable != NULL && *benchmarkVariable != '\0' && strcmp(benchmarkVariable, "0") != 0;
+    Uint32 seed = 1;
+    int crowd = 200;
+    string benchmarkOutput;
+    string inputTarget;
+    string replaySource;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--headless"){
+            headless = true;
+        } else if(arg == "--record" && i + 1 < argc){
+            recordTarget = argv[++i];
+        } else if(arg == "--frames" && i + 1 < argc){
+            frameLimit = atoi(argv[++i]);
+        } else if(arg == "--fps" && i + 1 < argc){
+            framesPerSecond = atof(argv[++i]);
+        } else if(arg == "--vsync"){
+            vsync = true;
+        } else if(arg == "--threaded"){
+            threaded = true;
+        } else if(arg == "--dump-systems" && i + 1 < argc){
+            systemsGraph = argv[++i];
+        } else if(arg == "--record-input" && i + 1 < argc){
+            inputTarget = argv[++i];
+        } else if(arg == "--replay" && i + 1 < argc){
+            replaySource = argv[++i];
+        } else if(arg == "--benchmark"){
+            benchmark = true;
+        } else if(arg == "--seed" && i + 1 < argc){
+            seed = static_cast<Uint32>(strtoul(argv[++i], NULL, 10));
+        } else if(arg == "--crowd" && i + 1 < argc){
+            crowd = max(0, atoi(argv[++i]));
+        } else if(arg == "--bench-output" && i + 1 < argc){
+            benchmarkOutput = argv[++i];
+        } else if(arg == "--bench-blit"){
+            runBlitBenchmark();
+            return 0;
+        } else if(arg == "--bench-raster"){
+            runRasterBenchmark();
+            return 0;
+        } else if(arg == "--bench-rotate"){
+            runRotateBenchmark();
+            return 0;
+        } else if(arg == "--bench-rle"){
+            runRLEBenchmark();
+            return 0;
+        } else if(arg == "--bench-premultiplied"){
+            runPremultipliedBenchmark();
+            return 0;
+        } else if(arg == "--bench-animation"){
+            runAnimationBenchmark();
+            return 0;
+        } else if(arg == "--bench-tween"){
+            runTweenBenchmark();
+            return 0;
+        } else if(arg == "--bench-pacing"){
+            runPacingBenchmark();
+            return 0;
+        } else if(arg == "--bench-jobs"){
+            runJobsBenchmark();
+            return 0;
+        } else if(arg == "--premultiplied"){
+            premultiplied = true;
+        }
+    }
+
+    InputRecording recording;
+    if(!replaySource.empty()){
+        if(!recording.load(replaySource)){
+            return 1;
+        }
+        headless = true;  // A replay runs without a window, its input comes from the file
+        vsync = false;
+    }
+
+    if(benchmark){
+        // Uncapped: no vsync and no pacer, a fixed frame count (600 or the length of the replay unless --frames says otherwise)
+        Engine engine(headless, 800, 600, false);
+        int frames = frameLimit > 0 ? frameLimit : (replaySource.empty() ? 600 : static_cast<int>(recording.getLength()));
+        return runSceneBenchmark(engine, frames, seed, crowd, benchmarkOutput, replaySource.empty() ? NULL : &recording);
+    }
 
+    Engine engine(headless, 800, 600, vsync);
+    if(premultiplied && !engine.setPremultipliedAlpha(true)){
+        ENGINE_LOG_WARN(ENGINE, "Premultiplied alpha isn't supported by this renderer, using straight alpha");
+    }
     const int FPS = 60; 
-    const int frameDelay = 1000 / FPS;
+    GameLoop loop(FPS, framesPerSecond);  // Fixed 60 Hz simulation, frames paced to --fps (60 by default)
+    loop.getPacer().setVsync(engine.usesVsync());  // Present already waits for the display
+    int framesRendered = 0;
 
-    Uint32 frameStart;
-    int frameTime;
+    if(!recordTarget.empty() && !engine.startRecording(recordTarget, FPS)){
+        ENGINE_LOG_ERROR(RECORDING, "Recording couldn't start: " << recordTarget);
+    }
 
-    string filename = "img/ss.png";  // Use your sprite sheet image here
-    Player p1(filename, engine.getRenderer(), 0, 0, 64, 64, 2);
+    string filename = "img/Soldier/Soldier.png";  // Use your sprite sheet image here
+    AnimationLibrary::shared().loadDefinitions("img/Soldier/Soldier.anim");
+    AnimationSystem animations;  // Declared before the sprites using it, they unregister on destruction
+    Player p1(filename, engine.getRenderer(), 0, 0, 100, 100, 2);
+    p1.useSystem(animations);
+    InputState input;  // Keys gathered per frame, the player reads its actions from it in update()
+    p1.useInput(input);
+    SDL_Rect view = {0, 0, engine.getWidth(), engine.getHeight()};
+    if(!inputTarget.empty() && (threaded || !replaySource.empty())){
+        ENGINE_LOG_WARN(ENGINE, "Input is only recorded in the single-threaded loop without a replay, not recording");
+        inputTarget.clear();
+    } else if(!inputTarget.empty() && !recording.startRecording(inputTarget, FPS)){
+        inputTarget.clear();
+    }
+    // Recorded and replayed runs advance the animations by the steps instead of the clock and keep the player at full
+    // detail, so what the simulation sees only depends on the input of each step
+    bool steppedAnimation = !inputTarget.empty() || !replaySource.empty();
 
-    while (!quit) {
-        SDL_SetRenderDrawColor(engine.getRenderer(), 255, 255, 255, 255);
-        SDL_RenderClear(engine.getRenderer());
-        frameStart = SDL_GetTicks();
+    if(!replaySource.empty()){
+        if(recording.getStepsPerSecond() != FPS){
+            ENGINE_LOG_WARN(ENGINE, "The recording was made at " << recording.getStepsPerSecond() << " steps per second, replaying it at " << FPS);
+        }
+        // One step per frame as fast as it goes, every frame drawn at its latest step, so the frames only depend on the file
+        Uint64 start = SDL_GetPerformanceCounter();
+        Uint64 steps = recording.getLength();
+        for(Uint64 step = 0; step < steps; step++){
+            recording.inject(step, input);
+            p1.update();
+            input.clearEdges();
+            animations.advance(stepMilliseconds(step, FPS));
+            SDL_SetRenderDrawColor(engine.getRenderer(), 255, 255, 255, 255);
+            SDL_RenderClear(engine.getRenderer());
+            p1.render(1.0);
+            engine.present();
+        }
+        double seconds = secondsSince(start);
+        ENGINE_LOG_INFO(ENGINE, fixed << setprecision(3) << "Replayed " << steps << " steps in " << seconds * 1000.0 << " ms ("
+             << (seconds > 0.0 ? steps / seconds : 0.0) << " frames per second), state " << hex << p1.stateHash());
+        return 0;
+    }
 
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) {
+    if(threaded){
+        // The simulation owns the player and the animations until it is stopped, this thread only draws snapshots
+        SimulationThread simulation(FPS);
+        FramePacer& pacer = loop.getPacer();
+        simulation.start([&](SDL_Event& e){
+            input.handleEvent(e);
+        }, [&](double){
+            p1.update();   // Moves the player and steps the soldier state machine
+            input.clearEdges();  // Presses and releases count for one step only
+        }, [&](RenderSnapshot& snapshot){
+            p1.updateDetail(view);  // Off-screen or tiny sprites animate at a reduced rate
+            animations.update();  // One clock sample advances every animation
+            p1.capture(snapshot);   // The player with its shadow, at its last two steps
+        });
+        bool quit = false;
+        while(!quit){
+            SDL_Event e;
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT) {
+                    quit = true;
+                } else if(!simulation.postEvent(e)){
+                    ENGINE_LOG_WARN(THREADS, "Simulation event queue is full, dropping an event");
+                }
+            }
+            SDL_SetRenderDrawColor(engine.getRenderer(), 255, 255, 255, 255);
+            SDL_RenderClear(engine.getRenderer());
+            const RenderSnapshot* snapshot = simulation.latest();
+            if(snapshot != NULL){
+                snapshot->draw(engine.getRenderer(), snapshot->alphaAt(SDL_GetPerformanceCounter()));
+            }
+            engine.present();
+            engine.runDeferredWork(deferredBudget(pacer));
+            if(frameLimit > 0 && ++framesRendered >= frameLimit){
                 quit = true;
             }
-            p1.inputEventHandler(e);
+            pacer.wait();
         }
-
-        p1.animate();  // Call animate to update the current frame
-        p1.update();   // Updates the animation if idle or not
-        
-
-        SDL_RenderPresent(engine.getRenderer());
-        frameTime = SDL_GetTicks() - frameStart;
-        if(frameDelay > frameTime){
-            SDL_Delay(frameDelay - frameTime);
+        simulation.stop();
+    } else {
+        // Per-frame systems, ordered by what they read and write, the ones that don't conflict run concurrently
+        SystemScheduler systems;
+        double frameAlpha = 0.0;
+        systems.addSystem("detail", {"player"}, {"detail"}, [&](){
+            if(!steppedAnimation){
+                p1.updateDetail(view);  // Off-screen or tiny sprites animate at a reduced rate
+            }
+        });
+        systems.addSystem("animation", {"detail"}, {"animation"}, [&](){
+            if(!steppedAnimation){
+                animations.update();  // One clock sample advances every animation
+            }
+        });
+        systems.addSystem("draw", {"player", "animation"}, {"renderer"}, [&](){
+            SDL_SetRenderDrawColor(engine.getRenderer(), 255, 255, 255, 255);
+            SDL_RenderClear(engine.getRenderer());
+            p1.render(frameAlpha);   // Draws the player with its shadow between its last two steps
+        }, SYSTEM_MAIN_THREAD);
+        if(!systemsGraph.empty()){
+            systems.writeDot(systemsGraph);
         }
+        loop.run([&](){
+            SDL_Event e;
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT) {
+                    loop.stop();
+                }
+                recording.record(loop.getStepCount(), e);  // Seen by the next step
+                input.handleEvent(e);
+            }
+        }, [&](double){
+            p1.update();   // Moves the player and steps the soldier state machine
+            input.clearEdges();  // Presses and releases count for one step only
+            if(steppedAnimation){
+                animations.advance(stepMilliseconds(loop.getStepCount(), FPS));
+            }
+        }, [&](double alpha){
+            frameAlpha = alpha;
+            systems.run(&JobSystem::shared());
+            engine.present();
+            engine.runDeferredWork(deferredBudget(loop.getPacer()));
+            if(frameLimit > 0 && ++framesRendered >= frameLimit){
+                loop.stop();
+            }
+        });
+    }
+    loop.getPacer().logStats();
+    engine.getDeferredWork().logStats();
+    if(recording.isRecording()){
+        recording.stopRecording(loop.getStepCount());
+        ENGINE_LOG_INFO(ENGINE, "Recorded " << loop.getStepCount() << " steps of input to " << inputTarget << ", state " << hex << p1.stateHash());
     }
 
     return 0;
@@ -2,8 +2,313 @@
 #include "SDL2/SDL_image.h"
 #include <iostream>
 #include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <functional>
 using namespace std;
 
+/**
+ * @enum LogLevel
+ * @brief Severity of a log message, its number is what `ENGINE_LOG_LEVEL` is compared with.
+ */
+enum LogLevel {
+    LOG_TRACE,  ///< 0: per-frame detail.
+    LOG_DEBUG,  ///< 1: object lifetimes and other development notes.
+    LOG_INFO,   ///< 2: regular progress and results.
+    LOG_WARN,   ///< 3: something didn't work, the program goes on without it.
+    LOG_ERROR   ///< 4: an operation failed.
+};
+
+/**
+ * @enum LogCategory
+ * @brief Part of the engine a log message comes from, each one has its own runtime level.
+ */
+enum LogCategory {
+    LOG_CATEGORY_ENGINE,    ///< Engine setup, windows and renderers.
+    LOG_CATEGORY_RENDER,    ///< Drawing of objects and bitmaps.
+    LOG_CATEGORY_ASSETS,    ///< Loading of images and definitions.
+    LOG_CATEGORY_COUNT      ///< Number of categories.
+};
+
+#ifndef ENGINE_LOG_LEVEL
+#define ENGINE_LOG_LEVEL 2 ///< Lowest `LogLevel` compiled in, messages below it compile to nothing. Build with -DENGINE_LOG_LEVEL=0 to trace.
+#endif
+
+/**
+ * @class Logger
+ * @brief Asynchronous log with levels and categories.
+ *
+ * Messages are formatted on the calling thread into a reused per-thread stream and copied into a bounded
+ * ring buffer, which any number of threads may write to without taking a lock (a sequence number per slot
+ * tells writers and the reader whose turn a slot is). A background thread drains the ring and writes the
+ * messages out, warnings and errors to stderr and the rest to stdout, with one flush per batch.
+ * When the ring is full the message is dropped and counted instead of blocking the caller, the drop count is
+ * reported with the next batch. Messages longer than a slot are cut.
+ *
+ * The `ENGINE_LOG_*` macros are the way to log, they skip formatting for disabled categories and the levels
+ * below `ENGINE_LOG_LEVEL` don't get compiled at all.
+ */
+class Logger {
+    private:
+        static const int capacity = 1024; ///< Number of slots in the ring, a power of two.
+        static const int textSize = 240; ///< Bytes of text a slot holds, the terminator included.
+
+        /**
+         * @brief One message in the ring.
+         */
+        struct Slot {
+            SDL_atomic_t sequence; ///< Equals the write position when the slot is free, one past it when it holds a message.
+            Uint32 ticks; ///< SDL_GetTicks() when the message was written.
+            LogLevel level; ///< Severity.
+            LogCategory category; ///< Origin.
+            int length; ///< Bytes of `text` used.
+            char text[textSize]; ///< The message, not terminated.
+        };
+
+        vector<Slot> slots; ///< The ring.
+        SDL_atomic_t writePosition; ///< Next position a writer claims.
+        int readPosition = 0; ///< Next position the reader takes, only touched with `readLock` held.
+        SDL_atomic_t dropped; ///< Messages lost to a full ring since the last report.
+        SDL_atomic_t levels[LOG_CATEGORY_COUNT]; ///< Lowest level written for each category.
+        SDL_atomic_t running; ///< Cleared to stop the drain thread.
+        SDL_mutex* readLock = NULL; ///< Keeps the ring single-reader while `flush()` drains from another thread.
+        SDL_sem* wake = NULL; ///< Wakes the drain thread early.
+        SDL_Thread* drainThread = NULL; ///< Background writer, NULL when it couldn't start and writers drain themselves.
+
+        /**
+         * @brief Position `count` steps after `position`, the positions wrap around as unsigned numbers.
+         */
+        static int positionAfter(int position, int count){
+            return static_cast<int>(static_cast<unsigned>(position) + static_cast<unsigned>(count));
+        }
+
+        /**
+         * @brief Steps from position `from` to position `to`, negative when `to` is behind.
+         */
+        static int distance(int from, int to){
+            return static_cast<int>(static_cast<unsigned>(to) - static_cast<unsigned>(from));
+        }
+
+        /**
+         * @brief Writes out everything in the ring, returns the number of messages written.
+         */
+        int drain(){
+            static const char* const levelNames[] = {"trace", "debug", "info", "warn", "error"};
+            static const char* const categoryNames[] = {"engine", "render", "assets"};
+            SDL_LockMutex(readLock);
+            int written = 0;
+            int lost = SDL_AtomicSet(&dropped, 0);
+            if(lost > 0){
+                fprintf(stderr, "[%9.3f] %-5s %-9s %d messages dropped, the log ring was full\n", SDL_GetTicks() / 1000.0, "warn", "log", lost);
+            }
+            for(;;){
+                Slot& slot = slots[readPosition & (capacity - 1)];
+                if(SDL_AtomicGet(&slot.sequence) != positionAfter(readPosition, 1)){
+                    break;
+                }
+                SDL_MemoryBarrierAcquire(); // the message fields are read only after its sequence was seen
+                FILE* stream = slot.level >= LOG_WARN ? stderr : stdout;
+                fprintf(stream, "[%9.3f] %-5s %-9s %.*s\n", slot.ticks / 1000.0, levelNames[slot.level], categoryNames[slot.category], slot.length, slot.text);
+                SDL_MemoryBarrierRelease(); // done reading before the slot is handed back to the writers
+                SDL_AtomicSet(&slot.sequence, positionAfter(readPosition, capacity));
+                readPosition = positionAfter(readPosition, 1);
+                written++;
+            }
+            if(written > 0 || lost > 0){
+                fflush(stdout);
+                fflush(stderr);
+            }
+            SDL_UnlockMutex(readLock);
+            return written;
+        }
+
+        /**
+         * @brief Body of the drain thread, drains and naps until `running` is cleared.
+         */
+        static int drainLoop(void* data){
+            Logger* logger = static_cast<Logger*>(data);
+            while(SDL_AtomicGet(&logger->running)){
+                if(logger->drain() == 0){
+                    SDL_SemWaitTimeout(logger->wake, 10);
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * @brief Sets up the ring and starts the drain thread.
+         */
+        Logger() : slots(capacity){
+            for(int i = 0; i < capacity; i++){
+                SDL_AtomicSet(&slots[i].sequence, i);
+            }
+            SDL_AtomicSet(&writePosition, 0);
+            SDL_AtomicSet(&dropped, 0);
+            for(int i = 0; i < LOG_CATEGORY_COUNT; i++){
+                SDL_AtomicSet(&levels[i], LOG_TRACE);
+            }
+            SDL_AtomicSet(&running, 1);
+            readLock = SDL_CreateMutex();
+            wake = SDL_CreateSemaphore(0);
+            if(readLock != NULL && wake != NULL){
+                drainThread = SDL_CreateThread(drainLoop, "logger", this);
+            }
+        }
+    public:
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
+
+        /**
+         * @brief Stops the drain thread and writes out what is left.
+         */
+        ~Logger(){
+            SDL_AtomicSet(&running, 0);
+            if(drainThread != NULL){
+                SDL_SemPost(wake);
+                SDL_WaitThread(drainThread, NULL);
+            }
+            if(readLock != NULL){
+                drain();
+            }
+            SDL_DestroySemaphore(wake);
+            SDL_DestroyMutex(readLock);
+        }
+
+        /**
+         * @brief Tells if a message of `level` in `category` would be written.
+         */
+        bool isEnabled(LogLevel level, LogCategory category){
+            return level >= SDL_AtomicGet(&levels[category]);
+        }
+
+        /**
+         * @brief Sets the lowest level written for `category`, below `ENGINE_LOG_LEVEL` nothing is compiled in anyway.
+         */
+        void setLevel(LogCategory category, LogLevel level){
+            SDL_AtomicSet(&levels[category], level);
+        }
+
+        /**
+         * @brief Sets the lowest level written for every category.
+         */
+        void setLevel(LogLevel level){
+            for(int i = 0; i < LOG_CATEGORY_COUNT; i++){
+                setLevel(static_cast<LogCategory>(i), level);
+            }
+        }
+
+        /**
+         * @brief Puts the text of `message` into the ring, or counts it as dropped when the ring is full.
+         *
+         * @param level Severity.
+         * @param category Origin.
+         * @param message Stream from `formatStream()` holding the formatted text.
+         */
+        void write(LogLevel level, LogCategory category, stringstream& message){
+            if(readLock == NULL){
+                return;
+            }
+            int position = SDL_AtomicGet(&writePosition);
+            Slot* slot;
+            for(;;){
+                slot = &slots[position & (capacity - 1)];
+                int difference = distance(position, SDL_AtomicGet(&slot->sequence));
+                if(difference == 0){
+                    if(SDL_AtomicCAS(&writePosition, position, positionAfter(position, 1))){
+                        break;
+                    }
+                    position = SDL_AtomicGet(&writePosition);
+                } else if(difference < 0){
+                    SDL_AtomicAdd(&dropped, 1);
+                    return;
+                } else {
+                    position = SDL_AtomicGet(&writePosition);
+                }
+            }
+            slot->ticks = SDL_GetTicks();
+            slot->level = level;
+            slot->category = category;
+            slot->length = static_cast<int>(message.rdbuf()->sgetn(slot->text, textSize - 1));
+            SDL_MemoryBarrierRelease(); // the message fields are visible before the sequence that publishes them
+            SDL_AtomicSet(&slot->sequence, positionAfter(position, 1));
+            if(drainThread == NULL){
+                drain();
+            } else if(level >= LOG_ERROR){
+                SDL_SemPost(wake);
+            }
+        }
+
+        /**
+         * @brief Writes out everything logged so far before returning, e.g. before the program aborts.
+         */
+        void flush(){
+            if(readLock != NULL){
+                drain();
+            }
+        }
+
+        /**
+         * @brief Empty stream of the calling thread with the default formatting, messages are formatted into it.
+         */
+        static stringstream& formatStream(){
+            static thread_local stringstream stream;
+            stream.str(string());
+            stream.clear();
+            stream.flags(ios_base::dec | ios_base::skipws);
+            stream.precision(6);
+            stream.fill(' ');
+            return stream;
+        }
+
+        /**
+         * @brief Log shared by the whole program, started on first use.
+         */
+        static Logger& instance(){
+            static Logger logger;
+            return logger;
+        }
+};
+
+/**
+ * @brief Logs `message`, a chain of `<<` operands, at `level` in category `LOG_CATEGORY_<category>`.
+ * The message is only formatted when the category is enabled for the level.
+ */
+#define ENGINE_LOG(level, category, message) do { \
+        if(Logger::instance().isEnabled(level, LOG_CATEGORY_##category)){ \
+            stringstream& logStream = Logger::formatStream(); \
+            logStream << message; \
+            Logger::instance().write(level, LOG_CATEGORY_##category, logStream); \
+        } \
+    } while(0)
+
+#if ENGINE_LOG_LEVEL <= 0
+#define ENGINE_LOG_TRACE(category, message) ENGINE_LOG(LOG_TRACE, category, message)
+#else
+#define ENGINE_LOG_TRACE(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 1
+#define ENGINE_LOG_DEBUG(category, message) ENGINE_LOG(LOG_DEBUG, category, message)
+#else
+#define ENGINE_LOG_DEBUG(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 2
+#define ENGINE_LOG_INFO(category, message) ENGINE_LOG(LOG_INFO, category, message)
+#else
+#define ENGINE_LOG_INFO(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 3
+#define ENGINE_LOG_WARN(category, message) ENGINE_LOG(LOG_WARN, category, message)
+#else
+#define ENGINE_LOG_WARN(category, message) do {} while(0)
+#endif
+#if ENGINE_LOG_LEVEL <= 4
+#define ENGINE_LOG_ERROR(category, message) ENGINE_LOG(LOG_ERROR, category, message)
+#else
+#define ENGINE_LOG_ERROR(category, message) do {} while(0)
+#endif
+
 class Engine {
     private:
             SDL_Renderer* renderer;
@@ -11,10 +316,10 @@ class Engine {
     public:
         Engine(){ 
             if(!Init()){
-                cout << "Engine couldn't initialize!" << endl;
+                ENGINE_LOG_ERROR(ENGINE, "Engine couldn't initialize!");
                 return;
             }
-            cout << "Engine Init was successful" << endl; 
+            ENGINE_LOG_INFO(ENGINE, "Engine Init was successful");
         };
 
         ~Engine(){
@@ -23,16 +328,16 @@ class Engine {
 
         bool Init(){
             if(SDL_InitSubSystem(SDL_INIT_VIDEO) < 0){
-                cout << "SDL_Init_video" << SDL_GetError() << endl;
+                ENGINE_LOG_ERROR(ENGINE, "SDL_Init_video" << SDL_GetError());
                 return false;
             }
             window = SDL_CreateWindow("window", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_ALLOW_HIGHDPI);
 
-            if(window == NULL){cout << "SDL_CreateWindow" << SDL_GetError() << endl; return false;}
+            if(window == NULL){ENGINE_LOG_ERROR(ENGINE, "SDL_CreateWindow" << SDL_GetError()); return false;}
 
             renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
             
-            if(renderer == NULL){cout << "SDL_CreateRenderer" << SDL_GetError() << endl; return false;}
+            if(renderer == NULL){ENGINE_LOG_ERROR(ENGINE, "SDL_CreateRenderer" << SDL_GetError()); return false;}
 
             return true;
         };
@@ -49,6 +354,80 @@ class Engine {
         SDL_Window* getWindow(){return window;};
 };
 
+class GameLoop {
+    private:
+        Uint64 frequency, stepTicks, frameTicks;
+        int maxCatchUpSteps;
+        double stepSeconds;
+        bool running = false;
+        Uint64 stepCount = 0, frameCount = 0, droppedSteps = 0;
+
+        void waitUntil(Uint64 deadline){
+            Uint64 now = SDL_GetPerformanceCounter();
+            if(now < deadline){
+                Uint32 milliseconds = static_cast<Uint32>((deadline - now) * 1000 / frequency);
+                if(milliseconds > 0){
+                    SDL_Delay(milliseconds);
+                }
+            }
+        }
+    public:
+        GameLoop(double updatesPerSecond = 60.0, double framesPerSecond = 60.0, int maxCatchUpSteps = 5)
+            : frequency(SDL_GetPerformanceFrequency()), maxCatchUpSteps(maxCatchUpSteps > 0 ? maxCatchUpSteps : 1){
+            stepTicks = max<Uint64>(1, static_cast<Uint64>(frequency / updatesPerSecond + 0.5));
+            frameTicks = framesPerSecond > 0.0 ? static_cast<Uint64>(frequency / framesPerSecond + 0.5) : 0;
+            stepSeconds = static_cast<double>(stepTicks) / frequency;
+        }
+
+        void run(const function<void()>& input, const function<void(double)>& update, const function<void(double)>& render){
+            running = true;
+            Uint64 previous = SDL_GetPerformanceCounter();
+            Uint64 accumulator = 0;
+            Uint64 nextFrame = previous + frameTicks;
+            while(running){
+                Uint64 now = SDL_GetPerformanceCounter();
+                accumulator += now - previous;
+                previous = now;
+                if(input){
+                    input();
+                }
+                int steps = 0;
+                while(running && accumulator >= stepTicks && steps < maxCatchUpSteps){
+                    update(stepSeconds);
+                    accumulator -= stepTicks;
+                    stepCount++;
+                    steps++;
+                }
+                if(accumulator >= stepTicks){
+                    droppedSteps += accumulator / stepTicks;
+                    accumulator %= stepTicks;
+                }
+                if(!running){
+                    break;
+                }
+                render(static_cast<double>(accumulator) / stepTicks);
+                frameCount++;
+                if(frameTicks > 0){
+                    waitUntil(nextFrame);
+                    now = SDL_GetPerformanceCounter();
+                    nextFrame = now > nextFrame + frameTicks ? now + frameTicks : nextFrame + frameTicks;
+                }
+            }
+        }
+
+        void stop(){
+            running = false;
+        }
+
+        static int interpolate(int previous, int current, double alpha){
+            return previous + static_cast<int>(lround((current - previous) * alpha));
+        }
+
+        Uint64 getStepCount(){ return stepCount; }
+        Uint64 getFrameCount(){ return frameCount; }
+        Uint64 getDroppedSteps(){ return droppedSteps; }
+};
+
 
 class Base {
     public:
@@ -194,7 +573,7 @@ class Rectangle : public virtual ShapeObj {
         Rectangle(){};
 
         void createObject(int x, int y, int w, int h, SDL_Color* color, SDL_Renderer *renderer){
-            cout << "Object Rectangle Created" << endl;
+            ENGINE_LOG_DEBUG(RENDER, "Object Rectangle Created");
             this->x = x;
             this->y = y;
             this->w = w;
@@ -435,7 +814,7 @@ class BitmapObject : public DrawAbility, public Transformability{
                 texture = SDL_CreateTextureFromSurface(renderer, tmpSurface);
                 SDL_FreeSurface(tmpSurface);
             } else {
-                cout << "texture loading failed!" << endl;
+                ENGINE_LOG_ERROR(ASSETS, "texture loading failed! " << filename);
             }
         }
 
@@ -452,13 +831,17 @@ class BitmapObject : public DrawAbility, public Transformability{
             objPosY += dy;
             draw();
         }
+        void setPosition(int x, int y){
+            objPosX = x;
+            objPosY = y;
+        }
         void rotate(float angle) override {
             if(texture != NULL){
                 SDL_Point pt;
-                pt = {(destRect.x + destRect.w) / 2, (destRect.y + destRect.h) / 2};
+                pt = {destRect.w / 2, destRect.h / 2};
                 SDL_RenderCopyEx(renderer, texture, NULL, &destRect, angle, &pt, SDL_FLIP_NONE);
             } else {
-                cerr << "Something with rotate in BitmapObject!" << endl;
+                ENGINE_LOG_WARN(RENDER, "Something with rotate in BitmapObject!");
             }
         }
 
@@ -468,7 +851,7 @@ class BitmapObject : public DrawAbility, public Transformability{
             this->spritePosW = w;
             this->spritePosH = h;
             srcRect = {spritePosX, spritePosY, spritePosW, spritePosH};
-            cout << "setSrcRect BitmapObj called" << endl;
+            ENGINE_LOG_TRACE(RENDER, "setSrcRect BitmapObj called");
         }
         void scale(float factor){
             if(texture != NULL){
@@ -539,13 +922,26 @@ class SpriteObject : public BitmapObject, public AnimatedObject {
 
 class Player : public SpriteObject {
 private:
-    int moveSpeed; ///< Movement speed of the player.
+    int moveSpeed; ///< Movement speed of the player, in pixels per simulation step.
     int direction; ///< 0: Up, 1: Left, 2: Down, 3: Right
     bool idle; ///< keeps track if the player just standing or moving.
+    int heldDirections = 0;
+    int positionX, positionY, previousX, previousY;
+
+    static int directionOf(SDL_Keycode key){
+        switch(key){
+            case SDLK_UP: return 0;
+            case SDLK_LEFT: return 1;
+            case SDLK_DOWN: return 2;
+            case SDLK_RIGHT: return 3;
+            default: return -1;
+        }
+    }
 public:
     virtual ~Player() = default;
     Player(string& filename, SDL_Renderer* renderer, int spawnX, int spawnY, int playerWidth, int playerHeight, int moveSpeed)
-        : SpriteObject(filename, renderer, spawnX, spawnY, playerWidth, playerHeight), moveSpeed(moveSpeed){
+        : SpriteObject(filename, renderer, spawnX, spawnY, playerWidth, playerHeight), moveSpeed(moveSpeed),
+          positionX(spawnX), positionY(spawnY), previousX(spawnX), previousY(spawnY){
             direction = 2;
             idle = true;
     }
@@ -557,31 +953,42 @@ public:
     }
     void inputEventHandler(SDL_Event &event) {
         if (event.type == SDL_KEYDOWN) {
-            idle = false;
-            switch (event.key.keysym.sym) {
-                case SDLK_LEFT:
-                setDirection(1);
-                    translate(-moveSpeed, 0);
-                    break;
-                case SDLK_RIGHT:
-                setDirection(3);
-                    translate(moveSpeed, 0);
-                    break;
-                case SDLK_UP:
-                setDirection(0);
-                    translate(0, -moveSpeed);
-                    break;
-                case SDLK_DOWN:
-                setDirection(2);
-                    translate(0, moveSpeed);
-                    break;
+            int pressed = directionOf(event.key.keysym.sym);
+            if(pressed >= 0){
+                heldDirections |= 1 << pressed;
+                idle = false;
+                setDirection(pressed);
             }
         } if(event.type == SDL_KEYUP) {
-            idle = true;
+            int released = directionOf(event.key.keysym.sym);
+            if(released >= 0){
+                heldDirections &= ~(1 << released);
+                idle = heldDirections == 0;
+                if(!idle && released == direction){
+                    for(int held = 0; held < 4; held++){
+                        if(heldDirections & (1 << held)){
+                            setDirection(held);
+                            break;
+                        }
+                    }
+                }
+            }
         }
     }
     
-    void update(){
+    void update() override {
+        static const int stepX[4] = {0, -1, 0, 1};
+        static const int stepY[4] = {-1, 0, 1, 0};
+        previousX = positionX;
+        previousY = positionY;
+        if(!idle){
+            positionX += stepX[direction] * moveSpeed;
+            positionY += stepY[direction] * moveSpeed;
+        }
+    }
+
+    void render(double alpha){
+        setPosition(GameLoop::interpolate(previousX, positionX, alpha), GameLoop::interpolate(previousY, positionY, alpha));
         animate(direction, idle);
         draw(); // calls spriteobj draw
         // which will then call bitmapobj draw
@@ -590,14 +997,8 @@ public:
 
 int main(int argc, char* argv[]) {
     Engine engine;
-    bool quit = false;
-    SDL_Event e;
-
     const int FPS = 60; 
-    const int frameDelay = 1000 / FPS;
-
-    Uint32 frameStart;
-    int frameTime;
+    GameLoop loop(FPS, FPS);
 
     SDL_Color white = {255, 255, 255, 255};
 
@@ -607,31 +1008,26 @@ int main(int argc, char* argv[]) {
 
     rect.createObject(10, 10, 300, 300, &white, engine.getRenderer());
 
-    while (!quit) {
-        SDL_SetRenderDrawColor(engine.getRenderer(), 0, 0, 0, 255);
-        SDL_RenderClear(engine.getRenderer());
-        frameStart = SDL_GetTicks();
-
-
+    loop.run([&](){
+        SDL_Event e;
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_QUIT) {
-                quit = true;
+                loop.stop();
             }
             p1.inputEventHandler(e);
         }
+    }, [&](double){
+        p1.update();   // Moves the player one fixed step
+    }, [&](double alpha){
+        SDL_SetRenderDrawColor(engine.getRenderer(), 0, 0, 0, 255);
+        SDL_RenderClear(engine.getRenderer());
 
         rect.draw();
 
-        p1.animate();  // Call animate to update the current frame
-        p1.update();   // Updates the animation if idle or not
-        
+        p1.render(alpha);   // Animates and draws the player between its last two steps
 
         SDL_RenderPresent(engine.getRenderer());
-        frameTime = SDL_GetTicks() - frameStart;
-        if(frameDelay > frameTime){
-            SDL_Delay(frameDelay - frameTime);
-        }
-    }
+    });
 
     return 0;
 }